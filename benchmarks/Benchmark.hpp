@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+namespace idragnev::pbrt::benchmarks {
+    struct Timing
+    {
+        double bestSeconds = 0.0;
+        double meanSeconds = 0.0;
+        // Accumulated from the results of each run so that
+        // the measured work can not be optimized away.
+        std::uint64_t checksum = 0;
+    };
+
+    // Runs `fn` once to warm up and then `repetitions` times,
+    // measuring the wall-clock time of each run.
+    // `fn` must return an integral checksum of its results.
+    template <typename F>
+    Timing measure(const std::size_t repetitions, F&& fn) {
+        using Clock = std::chrono::steady_clock;
+
+        Timing result;
+        result.bestSeconds = 1e30;
+        result.checksum = static_cast<std::uint64_t>(fn());
+
+        double totalSeconds = 0.0;
+        for (std::size_t i = 0; i < repetitions; ++i) {
+            const auto start = Clock::now();
+            result.checksum += static_cast<std::uint64_t>(fn());
+            const auto end = Clock::now();
+
+            const double seconds =
+                std::chrono::duration<double>(end - start).count();
+            result.bestSeconds = std::min(result.bestSeconds, seconds);
+            totalSeconds += seconds;
+        }
+        result.meanSeconds =
+            repetitions > 0 ? totalSeconds / static_cast<double>(repetitions)
+                            : 0.0;
+
+        return result;
+    }
+
+    // Prints the timing of a benchmark which processes
+    // `itemsCount` items per run, with the throughput of the best run.
+    inline void report(const std::string_view name,
+                       const Timing& timing,
+                       const std::size_t itemsCount) {
+        const double itemsPerSecond =
+            timing.bestSeconds > 0.0
+                ? static_cast<double>(itemsCount) / timing.bestSeconds
+                : 0.0;
+
+        std::printf("%-40.*s best %9.3f ms  mean %9.3f ms  %8.3f M/s  "
+                    "[checksum %llu]\n",
+                    static_cast<int>(name.size()),
+                    name.data(),
+                    timing.bestSeconds * 1e3,
+                    timing.meanSeconds * 1e3,
+                    itemsPerSecond * 1e-6,
+                    static_cast<unsigned long long>(timing.checksum));
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "Scenes.hpp"
+
+#include "pbrt/core/primitive/GeometricPrimitive.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/RNG.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <numeric>
+
+namespace idragnev::pbrt::benchmarks {
+    Optional<SurfaceInteraction>
+    BoxPrimitive::intersect(const Ray& ray) const {
+        return bounds.intersectP(ray).map([this, &ray](const auto& t) {
+            ray.tMax = t.low();
+
+            SurfaceInteraction result;
+            result.p = ray(t.low());
+            result.primitive = this;
+            return result;
+        });
+    }
+
+    bool BoxPrimitive::intersectP(const Ray& ray) const {
+        return bounds.intersectP(ray).has_value();
+    }
+
+    Point3f randomPoint(rng::RNG& rng) {
+        return Point3f{rng.uniformFloat(),
+                       rng.uniformFloat(),
+                       rng.uniformFloat()};
+    }
+
+    PrimsVec makeBoxes(const std::size_t boxesCount,
+                       const std::size_t clusterSize,
+                       const Float clusterExtent,
+                       const std::uint64_t seed) {
+        rng::RNG rng{seed};
+        Point3f clusterCenter;
+
+        PrimsVec result;
+        result.reserve(boxesCount);
+        for (std::size_t i = 0; i < boxesCount; ++i) {
+            if (i % clusterSize == 0) {
+                clusterCenter = 100.f * randomPoint(rng);
+            }
+
+            const Point3f center =
+                clusterCenter + clusterExtent * Vector3f{randomPoint(rng)};
+            const auto halfExtent = Vector3f{0.05f, 0.05f, 0.05f} +
+                                    0.2f * Vector3f{randomPoint(rng)};
+
+            result.push_back(std::make_shared<BoxPrimitive>(
+                Bounds3f{center - halfExtent, center + halfExtent}));
+        }
+
+        return result;
+    }
+
+    std::vector<Point3f> makeTriangleVertices(const unsigned trianglesCount,
+                                              const Float size,
+                                              const std::uint64_t seed) {
+        rng::RNG rng{seed};
+        std::vector<Point3f> vertices;
+        vertices.reserve(3ull * trianglesCount);
+        for (unsigned i = 0; i < trianglesCount; ++i) {
+            const Point3f center = 100.f * randomPoint(rng);
+            for (std::size_t v = 0; v < 3; ++v) {
+                vertices.push_back(
+                    center + size * (Vector3f{randomPoint(rng)} -
+                                     Vector3f{0.5f, 0.5f, 0.5f}));
+            }
+        }
+
+        return vertices;
+    }
+
+    PrimsVec makeTriangles(const unsigned trianglesCount,
+                           const Float size,
+                           const std::uint64_t seed) {
+        return makeTriangles(makeTriangleVertices(trianglesCount, size, seed));
+    }
+
+    std::shared_ptr<shapes::TriangleMesh>
+    makeTriangleMesh(const std::vector<Point3f>& vertices,
+                     std::shared_ptr<const Texture<Float>> alphaMask) {
+        static const Transformation identity{};
+
+        const auto trianglesCount = static_cast<unsigned>(vertices.size() / 3);
+        std::vector<std::uint32_t> indices(vertices.size());
+        std::iota(indices.begin(), indices.end(), 0u);
+
+        return std::make_shared<shapes::TriangleMesh>(
+            identity,
+            trianglesCount,
+            std::move(indices),
+            vertices,
+            std::vector<Vector3f>{},
+            std::vector<Normal3f>{},
+            std::vector<Point2f>{},
+            std::move(alphaMask),
+            nullptr,
+            std::vector<std::uint32_t>{});
+    }
+
+    PrimsVec makeTriangles(const std::shared_ptr<shapes::TriangleMesh>& mesh) {
+        static const Transformation identity{};
+
+        const auto shapes =
+            shapes::createTriangles(mesh, identity, identity, false);
+        PrimsVec result;
+        result.reserve(shapes.size());
+        for (const auto& shape : shapes) {
+            result.push_back(std::make_shared<GeometricPrimitive>(
+                shape,
+                nullptr,
+                nullptr,
+                MediumInterface{}));
+        }
+
+        return result;
+    }
+
+    PrimsVec makeTriangles(const std::vector<Point3f>& vertices) {
+        return makeTriangles(makeTriangleMesh(vertices));
+    }
+
+    std::vector<Ray> makeRays(const PrimsVec& prims,
+                              const std::size_t raysCount,
+                              const std::uint64_t seed) {
+        rng::RNG rng{seed};
+
+        std::vector<Ray> result;
+        result.reserve(raysCount);
+        for (std::size_t i = 0; i < raysCount; ++i) {
+            const Point3f o = Point3f{50.f, 50.f, 50.f} +
+                              300.f * normalize(Vector3f{randomPoint(rng)} -
+                                                Vector3f{0.5f, 0.5f, 0.5f});
+            const Point3f target =
+                (i % 2 == 0)
+                    ? prims[rng.uniformUInt32(
+                                static_cast<std::uint32_t>(prims.size()))]
+                          ->worldBound()
+                          .boundingSphere()
+                          .center
+                    : 100.f * randomPoint(rng);
+
+            result.push_back(Ray{o, target - o});
+        }
+
+        return result;
+    }
+
+    std::vector<Ray> makePrimaryRays(const std::size_t resolution,
+                                     const std::size_t tileSize) {
+        const Point3f eye{50.f, 50.f, -100.f};
+        const auto toImagePlane = [resolution](const std::size_t i) {
+            return 100.f * (static_cast<Float>(i) + 0.5f) /
+                   static_cast<Float>(resolution);
+        };
+
+        std::vector<Ray> result;
+        result.reserve(resolution * resolution);
+        for (std::size_t tileY = 0; tileY < resolution; tileY += tileSize) {
+            for (std::size_t tileX = 0; tileX < resolution; tileX += tileSize) {
+                const std::size_t yEnd = std::min(tileY + tileSize, resolution);
+                const std::size_t xEnd = std::min(tileX + tileSize, resolution);
+                for (std::size_t y = tileY; y < yEnd; ++y) {
+                    for (std::size_t x = tileX; x < xEnd; ++x) {
+                        const Point3f target{toImagePlane(x),
+                                             toImagePlane(y),
+                                             0.f};
+                        result.push_back(Ray{eye, target - eye});
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "pbrt/core/primitive/Primitive.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/Texture.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace idragnev::pbrt::benchmarks {
+    using PrimsVec = std::vector<std::shared_ptr<const Primitive>>;
+
+    // An axis-aligned box which is hit at the ray's entry point.
+    // Its intersection tests are cheap, so the benchmarks using it
+    // are dominated by the cost of traversing the aggregate.
+    class BoxPrimitive : public Aggregate
+    {
+    public:
+        BoxPrimitive(const Bounds3f& bounds) : bounds(bounds) {}
+
+        Bounds3f worldBound() const override { return bounds; }
+
+        Optional<SurfaceInteraction> intersect(const Ray& ray) const override;
+        bool intersectP(const Ray& ray) const override;
+
+    private:
+        Bounds3f bounds;
+    };
+
+    // Places `clusterSize` boxes within `clusterExtent` of
+    // each random cluster center in [0, 100]^3.
+    PrimsVec makeBoxes(const std::size_t boxesCount,
+                       const std::size_t clusterSize,
+                       const Float clusterExtent,
+                       const std::uint64_t seed);
+
+    // Makes a mesh of `trianglesCount` triangles with edges of
+    // length up to `size` around random points in [0, 100]^3.
+    PrimsVec makeTriangles(const unsigned trianglesCount,
+                           const Float size,
+                           const std::uint64_t seed);
+
+    // The vertices of the triangles made by makeTriangles,
+    // three for each triangle.
+    std::vector<Point3f> makeTriangleVertices(const unsigned trianglesCount,
+                                              const Float size,
+                                              const std::uint64_t seed);
+    // Makes a mesh of the triangles with vertices `vertices`
+    // and the alpha mask `alphaMask`, if not null.
+    std::shared_ptr<shapes::TriangleMesh>
+    makeTriangleMesh(const std::vector<Point3f>& vertices,
+                     std::shared_ptr<const Texture<Float>> alphaMask = nullptr);
+    // The triangles of `mesh` as primitives which share its ownership.
+    PrimsVec makeTriangles(const std::shared_ptr<shapes::TriangleMesh>& mesh);
+    // Makes a mesh of the triangles with vertices `vertices`.
+    PrimsVec makeTriangles(const std::vector<Point3f>& vertices);
+
+    // Makes rays with origins around [0, 100]^3, half of which
+    // are aimed at primitives and the rest at random points.
+    std::vector<Ray> makeRays(const PrimsVec& prims,
+                              const std::size_t raysCount,
+                              const std::uint64_t seed);
+
+    // Makes the primary rays of a pinhole camera looking at [0, 100]^3
+    // from its -z side, ordered tile by tile as a tile renderer
+    // traces them, and by rows within a tile.
+    std::vector<Ray> makePrimaryRays(const std::size_t resolution,
+                                     const std::size_t tileSize);
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
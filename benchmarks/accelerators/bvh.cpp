@@ -0,0 +1,377 @@
+#include "Benchmark.hpp"
+#include "Scenes.hpp"
+
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/core/primitive/GeometricPrimitive.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/Texture.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+
+namespace idragnev::pbrt::benchmarks {
+    using accelerators::BVH;
+    namespace bvh = accelerators::bvh;
+
+    constexpr std::size_t REPETITIONS = 5;
+
+    // An alpha mask which never cuts out a hit. With it the leaves
+    // test their triangles one by one through their meshes.
+    class OpaqueAlphaMask : public Texture<Float>
+    {
+    public:
+        Float evaluate(const SurfaceInteraction&) const override {
+            return 1.f;
+        }
+    };
+
+    void benchmarkTraversal(const std::string& sceneName,
+                            const PrimsVec& prims,
+                            const std::vector<Ray>& rays) {
+        const auto accel = BVH{prims, bvh::SplitMethod::SAH, 4};
+        std::cout << accel.buildStatistics() << std::flush;
+
+        const Timing closestHit = measure(REPETITIONS, [&accel, &rays] {
+            std::size_t hits = 0;
+            for (const Ray& r : rays) {
+                const Ray ray = r;
+                hits += accel.intersect(ray).has_value() ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/" + sceneName + "/intersect", closestHit, rays.size());
+
+        const Timing anyHit = measure(REPETITIONS, [&accel, &rays] {
+            std::size_t hits = 0;
+            for (const Ray& ray : rays) {
+                hits += accel.intersectP(ray) ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/" + sceneName + "/intersectP", anyHit, rays.size());
+
+        const auto shortStackAccel = BVH{prims,
+                                         bvh::SplitMethod::SAH,
+                                         4,
+                                         0,
+                                         bvh::TraversalStack::Short};
+        const Timing shortStackClosestHit =
+            measure(REPETITIONS, [&shortStackAccel, &rays] {
+                std::size_t hits = 0;
+                for (const Ray& r : rays) {
+                    const Ray ray = r;
+                    hits += shortStackAccel.intersect(ray).has_value() ? 1 : 0;
+                }
+                return hits;
+            });
+        report("bvh/" + sceneName + "/intersect (short stack)",
+               shortStackClosestHit,
+               rays.size());
+
+        const Timing shortStackAnyHit =
+            measure(REPETITIONS, [&shortStackAccel, &rays] {
+                std::size_t hits = 0;
+                for (const Ray& ray : rays) {
+                    hits += shortStackAccel.intersectP(ray) ? 1 : 0;
+                }
+                return hits;
+            });
+        report("bvh/" + sceneName + "/intersectP (short stack)",
+               shortStackAnyHit,
+               rays.size());
+
+        // The copy of the rays, whose tMax is updated by the
+        // traversal, is included in the measurement.
+        std::vector<Ray> batch = rays;
+        std::vector<Optional<SurfaceInteraction>> hits(rays.size());
+        const Timing streamClosestHit = measure(REPETITIONS, [&] {
+            std::copy(rays.begin(), rays.end(), batch.begin());
+            accel.intersect(std::span{std::as_const(batch)}, std::span{hits});
+            return std::count_if(hits.begin(), hits.end(), [](const auto& h) {
+                return h.has_value();
+            });
+        });
+        report("bvh/" + sceneName + "/intersect (stream)",
+               streamClosestHit,
+               rays.size());
+
+        const Timing streamAnyHit = measure(REPETITIONS, [&accel, &rays] {
+            const auto occluded = std::make_unique<bool[]>(rays.size());
+            accel.intersectP(std::span{rays},
+                             std::span{occluded.get(), rays.size()});
+            return std::count(occluded.get(),
+                              occluded.get() + rays.size(),
+                              true);
+        });
+        report("bvh/" + sceneName + "/intersectP (stream)",
+               streamAnyHit,
+               rays.size());
+    }
+
+    void benchmarkPacketTraversal(const std::string& sceneName,
+                                  const PrimsVec& prims,
+                                  const std::vector<Ray>& rays) {
+        const auto accel = BVH{prims, bvh::SplitMethod::SAH, 4};
+
+        const Timing singleRays = measure(REPETITIONS, [&accel, &rays] {
+            std::size_t hits = 0;
+            for (const Ray& r : rays) {
+                const Ray ray = r;
+                hits += accel.intersect(ray).has_value() ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/" + sceneName + "/intersect", singleRays, rays.size());
+
+        for (const auto width : {bvh::PacketWidth::Four,
+                                 bvh::PacketWidth::Eight,
+                                 bvh::PacketWidth::Sixteen})
+        {
+            std::vector<Ray> batch = rays;
+            std::vector<Optional<SurfaceInteraction>> hits(rays.size());
+            const Timing packets = measure(REPETITIONS, [&, width] {
+                std::copy(rays.begin(), rays.end(), batch.begin());
+                accel.intersectPackets(std::span{std::as_const(batch)},
+                                       std::span{hits},
+                                       width);
+                return std::count_if(hits.begin(),
+                                     hits.end(),
+                                     [](const auto& h) {
+                                         return h.has_value();
+                                     });
+            });
+            report("bvh/" + sceneName + "/intersect (packets of " +
+                       std::to_string(static_cast<std::size_t>(width)) + ")",
+                   packets,
+                   rays.size());
+        }
+    }
+
+    // The batched queries sort the rays into coherent packets, so they
+    // are expected to outpace single rays on rays in random order which
+    // are coherent once sorted, such as shuffled primary rays.
+    void benchmarkStreamTraversal(const std::string& sceneName,
+                                  const PrimsVec& prims,
+                                  const std::vector<Ray>& rays) {
+        const auto accel = BVH{prims, bvh::SplitMethod::SAH, 4};
+
+        const Timing closestHit = measure(REPETITIONS, [&accel, &rays] {
+            std::size_t hits = 0;
+            for (const Ray& r : rays) {
+                const Ray ray = r;
+                hits += accel.intersect(ray).has_value() ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/" + sceneName + "/intersect", closestHit, rays.size());
+
+        std::vector<Ray> batch = rays;
+        std::vector<Optional<SurfaceInteraction>> hits(rays.size());
+        const Timing streamClosestHit = measure(REPETITIONS, [&] {
+            std::copy(rays.begin(), rays.end(), batch.begin());
+            accel.intersect(std::span{std::as_const(batch)}, std::span{hits});
+            return std::count_if(hits.begin(), hits.end(), [](const auto& h) {
+                return h.has_value();
+            });
+        });
+        report("bvh/" + sceneName + "/intersect (stream)",
+               streamClosestHit,
+               rays.size());
+
+        const Timing anyHit = measure(REPETITIONS, [&accel, &rays] {
+            std::size_t hits = 0;
+            for (const Ray& ray : rays) {
+                hits += accel.intersectP(ray) ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/" + sceneName + "/intersectP", anyHit, rays.size());
+
+        const Timing streamAnyHit = measure(REPETITIONS, [&accel, &rays] {
+            const auto occluded = std::make_unique<bool[]>(rays.size());
+            accel.intersectP(std::span{rays},
+                             std::span{occluded.get(), rays.size()});
+            return std::count(occluded.get(),
+                              occluded.get() + rays.size(),
+                              true);
+        });
+        report("bvh/" + sceneName + "/intersectP (stream)",
+               streamAnyHit,
+               rays.size());
+    }
+
+    struct MeshReadDistances
+    {
+        double indices = 0.0;
+        double vertices = 0.0;
+    };
+
+    // The mean distance in bytes between consecutive reads of the vertex
+    // indices, and of the vertex positions, of the triangles of `accel`
+    // taken in the order of its leaves - a measure of the cache misses
+    // of the reads of the meshes which does not need a profiler.
+    MeshReadDistances meshReadDistances(const BVH& accel) {
+        MeshReadDistances result;
+        std::size_t trianglesCount = 0;
+        std::size_t verticesCount = 0;
+        std::uintptr_t lastIndex = 0;
+        std::uintptr_t lastVertex = 0;
+        const auto addDistance = [](double& sum,
+                                    std::uintptr_t& last,
+                                    const std::uintptr_t address,
+                                    const bool isFirst) {
+            if (!isFirst) {
+                sum += static_cast<double>(address > last ? address - last
+                                                          : last - address);
+            }
+            last = address;
+        };
+
+        for (const auto& primitive : accel.orderedPrimitives()) {
+            const auto& triangle = static_cast<const shapes::Triangle&>(
+                static_cast<const GeometricPrimitive&>(*primitive).shape());
+            const shapes::TriangleMesh& mesh = triangle.mesh();
+            const std::uint32_t number = triangle.numberInMesh();
+
+            // the offset of the indices of the triangle in their array
+            addDistance(result.indices,
+                        lastIndex,
+                        3 * mesh.vertexIndices.bytesPerIndex() * number,
+                        trianglesCount == 0);
+            const auto vertices = mesh.vertexIndices.ofTriangle(number);
+            for (const std::uint32_t v : vertices) {
+                addDistance(result.vertices,
+                            lastVertex,
+                            reinterpret_cast<std::uintptr_t>(
+                                &mesh.vertexWorldCoordinates[v]),
+                            verticesCount == 0);
+                ++verticesCount;
+            }
+            ++trianglesCount;
+        }
+
+        if (trianglesCount > 1) {
+            result.indices /= static_cast<double>(trianglesCount - 1);
+            result.vertices /= static_cast<double>(verticesCount - 1);
+        }
+
+        return result;
+    }
+
+    // The meshes are in the order of the triangles' random positions,
+    // so the triangles of a leaf are scattered over them until
+    // they are reordered. Only leaves with alpha-masked triangles read
+    // the meshes while testing them - the others test the triangle
+    // packets of the BVH, which do not change, and read the mesh only
+    // to complete the closest hit, so without alpha masks the timings
+    // do not improve.
+    void
+    benchmarkMeshReordering(const std::string& sceneName,
+                            const std::shared_ptr<shapes::TriangleMesh>& mesh) {
+        const PrimsVec prims = makeTriangles(mesh);
+        const std::vector<Ray> rays = makeRays(prims, 20'000, 10);
+        auto accel = BVH{prims, bvh::SplitMethod::SAH, 4};
+
+        const auto closestHit = [&accel, &rays] {
+            std::size_t hits = 0;
+            for (const Ray& r : rays) {
+                const Ray ray = r;
+                hits += accel.intersect(ray).has_value() ? 1 : 0;
+            }
+            return hits;
+        };
+        const auto anyHit = [&accel, &rays] {
+            std::size_t hits = 0;
+            for (const Ray& ray : rays) {
+                hits += accel.intersectP(ray) ? 1 : 0;
+            }
+            return hits;
+        };
+
+        const auto reportReadDistances = [&accel, &sceneName](
+                                             const std::string& order) {
+            const MeshReadDistances distances = meshReadDistances(accel);
+            std::printf("bvh/%s (%s): mean distance between consecutive "
+                        "reads %.0f B (indices), %.0f B (vertices)\n",
+                        sceneName.c_str(),
+                        order.c_str(),
+                        distances.indices,
+                        distances.vertices);
+        };
+
+        reportReadDistances("mesh order");
+        report("bvh/" + sceneName + "/intersect (mesh order)",
+               measure(REPETITIONS, closestHit),
+               rays.size());
+        report("bvh/" + sceneName + "/intersectP (mesh order)",
+               measure(REPETITIONS, anyHit),
+               rays.size());
+
+        accel.reorderTriangleMeshes(std::span{&mesh, 1});
+
+        reportReadDistances("leaf order");
+
+        report("bvh/" + sceneName + "/intersect (leaf order)",
+               measure(REPETITIONS, closestHit),
+               rays.size());
+        report("bvh/" + sceneName + "/intersectP (leaf order)",
+               measure(REPETITIONS, anyHit),
+               rays.size());
+    }
+
+    void benchmarkBVHTraversal() {
+        // fits in cache, so the per-leaf overhead of traversal dominates
+        const PrimsVec small = makeBoxes(1'000, 1, 0.f, 5);
+        benchmarkTraversal("small", small, makeRays(small, 100'000, 6));
+
+        const PrimsVec uniform = makeBoxes(100'000, 1, 0.f, 1);
+        benchmarkTraversal("uniform", uniform, makeRays(uniform, 100'000, 2));
+
+        const PrimsVec clustered = makeBoxes(100'000, 1'000, 5.f, 3);
+        benchmarkTraversal("clustered",
+                           clustered,
+                           makeRays(clustered, 100'000, 4));
+
+        const PrimsVec triangles = makeTriangles(100'000, 1.f, 7);
+        benchmarkTraversal("triangles",
+                           triangles,
+                           makeRays(triangles, 100'000, 8));
+
+        // 512x512 primary rays in 16x16 tiles
+        benchmarkPacketTraversal("primary/uniform",
+                                 uniform,
+                                 makePrimaryRays(512, 16));
+        benchmarkPacketTraversal("primary/triangles",
+                                 triangles,
+                                 makePrimaryRays(512, 16));
+
+        std::vector<Ray> shuffledRays = makePrimaryRays(512, 16);
+        std::shuffle(shuffledRays.begin(),
+                     shuffledRays.end(),
+                     std::mt19937{11});
+        benchmarkStreamTraversal("primary/uniform (shuffled)",
+                                 uniform,
+                                 shuffledRays);
+        benchmarkStreamTraversal("primary/triangles (shuffled)",
+                                 triangles,
+                                 shuffledRays);
+
+        // made anew since reordering changes the meshes
+        const std::vector<Point3f> meshVertices =
+            makeTriangleVertices(1'000'000, 1.f, 9);
+        benchmarkMeshReordering("mesh", makeTriangleMesh(meshVertices));
+        benchmarkMeshReordering(
+            "mesh/alpha masked",
+            makeTriangleMesh(meshVertices,
+                             std::make_shared<OpaqueAlphaMask>()));
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "Benchmark.hpp"
+#include "Scenes.hpp"
+
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/accelerators/bvh/DynamicBVH.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+
+#include <string>
+
+namespace idragnev::pbrt::benchmarks {
+    using accelerators::BVH;
+    using accelerators::DynamicBVH;
+    namespace bvh = accelerators::bvh;
+
+    constexpr std::size_t EDIT_REPETITIONS = 5;
+
+    template <typename Accelerator>
+    void benchmarkEditedTraversal(const std::string& name,
+                                  const Accelerator& accel,
+                                  const std::vector<Ray>& rays) {
+        const Timing closestHit = measure(EDIT_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& r : rays) {
+                const Ray ray = r;
+                hits += accel.intersect(ray).has_value() ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/editing/intersect (" + name + ")",
+               closestHit,
+               rays.size());
+
+        const Timing anyHit = measure(EDIT_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& ray : rays) {
+                hits += accel.intersectP(ray) ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/editing/intersectP (" + name + ")",
+               anyHit,
+               rays.size());
+    }
+
+    // A scene of 100k triangles to which 1k props are added
+    // and from which they are removed one by one.
+    void benchmarkSceneEditing() {
+        const PrimsVec scene = makeTriangles(100'000, 1.f, 16);
+        const PrimsVec props = makeBoxes(1'000, 1, 0.f, 17);
+
+        const Timing insertAll = measure(1, [&scene] {
+            DynamicBVH accel;
+            for (const auto& primitive : scene) {
+                accel.insert(primitive);
+            }
+            return accel.height();
+        });
+        report("bvh/editing/build by insertion", insertAll, scene.size());
+
+        DynamicBVH dynamicAccel;
+        for (const auto& primitive : scene) {
+            dynamicAccel.insert(primitive);
+        }
+
+        std::vector<DynamicBVH::Handle> handles(props.size());
+        const Timing edits = measure(EDIT_REPETITIONS, [&] {
+            for (std::size_t i = 0; i < props.size(); ++i) {
+                handles[i] = dynamicAccel.insert(props[i]);
+            }
+            for (const DynamicBVH::Handle handle : handles) {
+                dynamicAccel.remove(handle);
+            }
+            return dynamicAccel.size();
+        });
+        report("bvh/editing/insert or remove a prop",
+               edits,
+               2 * props.size());
+
+        // what each edit costs without the dynamic BVH
+        PrimsVec edited = scene;
+        edited.push_back(props.front());
+        const Timing rebuild = measure(EDIT_REPETITIONS, [&edited] {
+            const auto accel = BVH{edited, bvh::SplitMethod::SAH, 4};
+            return accel.buildStatistics().nodesCount;
+        });
+        report("bvh/editing/rebuild BVH (SAH)", rebuild, 1);
+
+        const Timing hlbvhRebuild = measure(EDIT_REPETITIONS, [&edited] {
+            const auto accel = BVH{edited, bvh::SplitMethod::HLBVH, 4};
+            return accel.buildStatistics().nodesCount;
+        });
+        report("bvh/editing/rebuild BVH (HLBVH)", hlbvhRebuild, 1);
+
+        const std::vector<Ray> rays = makeRays(scene, 100'000, 18);
+        benchmarkEditedTraversal("DynamicBVH", dynamicAccel, rays);
+        benchmarkEditedTraversal("BVH",
+                                 BVH{scene, bvh::SplitMethod::SAH, 1},
+                                 rays);
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
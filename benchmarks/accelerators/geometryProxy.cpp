@@ -0,0 +1,174 @@
+#include "Benchmark.hpp"
+#include "Scenes.hpp"
+
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/accelerators/bvh/GeometryProxy.hpp"
+#include "pbrt/core/primitive/GeometricPrimitive.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+namespace idragnev::pbrt::benchmarks {
+    using accelerators::BVH;
+    using accelerators::GeometryCache;
+    using accelerators::GeometryProxy;
+    using accelerators::LoadedGeometry;
+    namespace bvh = accelerators::bvh;
+
+    constexpr std::size_t PROXY_REPETITIONS = 3;
+    // 8 x 8 x 8 assets of 2000 triangles in [0, 100]^3
+    constexpr std::size_t ASSETS_PER_AXIS = 8;
+    constexpr unsigned ASSET_TRIANGLES_COUNT = 2'000;
+
+    // The triangles of an asset around the center of its cell,
+    // made anew on each load as if read from a file
+    PrimsVec makeAsset(const std::size_t asset) {
+        const Float cellSize = 100.f / static_cast<Float>(ASSETS_PER_AXIS);
+        const Vector3f cellCenter =
+            cellSize *
+            Vector3f{static_cast<Float>(asset % ASSETS_PER_AXIS) + 0.5f,
+                     static_cast<Float>(asset / ASSETS_PER_AXIS %
+                                        ASSETS_PER_AXIS) +
+                         0.5f,
+                     static_cast<Float>(asset / ASSETS_PER_AXIS /
+                                        ASSETS_PER_AXIS) +
+                         0.5f};
+
+        std::vector<Point3f> vertices =
+            makeTriangleVertices(ASSET_TRIANGLES_COUNT, 30.f, 20 + asset);
+        for (Point3f& v : vertices) {
+            v = Point3f{0.1f * Vector3f{v} - Vector3f{5.f, 5.f, 5.f} +
+                        cellCenter};
+        }
+
+        return makeTriangles(vertices);
+    }
+
+    std::size_t assetMemoryUsage(const PrimsVec& asset) {
+        const auto& triangle = static_cast<const shapes::Triangle&>(
+            static_cast<const GeometricPrimitive&>(*asset.front()).shape());
+
+        return triangle.mesh().memoryUsage() +
+               asset.size() * sizeof(GeometricPrimitive);
+    }
+
+    std::vector<std::shared_ptr<const GeometryProxy>>
+    makeProxies(const std::vector<Bounds3f>& assetBounds,
+                const std::shared_ptr<GeometryCache>& cache) {
+        std::vector<std::shared_ptr<const GeometryProxy>> result;
+        result.reserve(assetBounds.size());
+        for (std::size_t i = 0; i < assetBounds.size(); ++i) {
+            result.push_back(std::make_shared<const GeometryProxy>(
+                assetBounds[i],
+                [i]() -> Optional<LoadedGeometry> {
+                    PrimsVec asset = makeAsset(i);
+                    const std::size_t memoryUsage = assetMemoryUsage(asset);
+                    return pbrt::make_optional(
+                        LoadedGeometry{std::move(asset), nullptr, memoryUsage});
+                },
+                cache,
+                bvh::SplitMethod::SAH));
+        }
+
+        return result;
+    }
+
+    std::size_t traceClosestHits(const Primitive& accel,
+                                 const std::vector<Ray>& rays) {
+        std::size_t hits = 0;
+        for (const Ray& r : rays) {
+            const Ray ray = r;
+            hits += accel.intersect(ray).has_value() ? 1 : 0;
+        }
+        return hits;
+    }
+
+    void reportCache(const GeometryCache& cache) {
+        const auto statistics = cache.statistics();
+        std::printf(
+            "  %zu of %zu assets loaded, %.1f MB (%.1f MB evicted), "
+            "%llu loads, %llu evictions, %llu restores\n",
+            cache.loadedProxiesCount(),
+            ASSETS_PER_AXIS * ASSETS_PER_AXIS * ASSETS_PER_AXIS,
+            static_cast<double>(cache.memoryUsage()) / (1 << 20),
+            static_cast<double>(cache.evictedMemoryUsage()) / (1 << 20),
+            static_cast<unsigned long long>(statistics.loadsCount),
+            static_cast<unsigned long long>(statistics.evictionsCount),
+            static_cast<unsigned long long>(statistics.restoresCount));
+    }
+
+    // Primary rays into a grid of assets most of which are hidden
+    // behind the front ones, with all assets loaded and built up front
+    // against proxies which load the assets the rays reach - with room
+    // for all of them and with a budget which evicts some.
+    void benchmarkGeometryProxies() {
+        const std::size_t assetsCount =
+            ASSETS_PER_AXIS * ASSETS_PER_AXIS * ASSETS_PER_AXIS;
+        const std::vector<Ray> rays = makePrimaryRays(256, 16);
+
+        std::vector<Bounds3f> assetBounds(assetsCount);
+        PrimsVec scene;
+        for (std::size_t i = 0; i < assetsCount; ++i) {
+            const PrimsVec asset = makeAsset(i);
+            for (const auto& primitive : asset) {
+                assetBounds[i] =
+                    unionOf(assetBounds[i], primitive->worldBound());
+            }
+            scene.insert(scene.end(), asset.begin(), asset.end());
+        }
+
+        const Timing eagerBuild = measure(1, [&scene] {
+            return BVH{scene, bvh::SplitMethod::SAH, 4}.worldBound().max.x;
+        });
+        report("bvh/proxies/build (eager)", eagerBuild, scene.size());
+        const auto eager = BVH{scene, bvh::SplitMethod::SAH, 4};
+        report("bvh/proxies/intersect (eager)",
+               measure(PROXY_REPETITIONS,
+                       [&] { return traceClosestHits(eager, rays); }),
+               rays.size());
+        scene.clear();
+
+        // each run loads the assets into a new cache
+        const Timing firstFrame = measure(1, [&] {
+            const auto cache = std::make_shared<GeometryCache>(1ull << 34);
+            const auto proxies = makeProxies(assetBounds, cache);
+            const auto accel = BVH{PrimsVec(proxies.begin(), proxies.end()),
+                                   bvh::SplitMethod::SAH};
+            return traceClosestHits(accel, rays);
+        });
+        report("bvh/proxies/intersect (first frame)", firstFrame, rays.size());
+
+        std::size_t workingSetMemory = 0;
+        {
+            const auto cache = std::make_shared<GeometryCache>(1ull << 34);
+            const auto proxies = makeProxies(assetBounds, cache);
+            const auto accel = BVH{PrimsVec(proxies.begin(), proxies.end()),
+                                   bvh::SplitMethod::SAH};
+            report("bvh/proxies/intersect (loaded)",
+                   measure(PROXY_REPETITIONS,
+                           [&] { return traceClosestHits(accel, rays); }),
+                   rays.size());
+            reportCache(*cache);
+            workingSetMemory = cache->memoryUsage();
+        }
+
+        const auto cache =
+            std::make_shared<GeometryCache>(workingSetMemory / 2);
+        const auto proxies = makeProxies(assetBounds, cache);
+        const auto accel = BVH{PrimsVec(proxies.begin(), proxies.end()),
+                               bvh::SplitMethod::SAH};
+        report("bvh/proxies/intersect (half the working set)",
+               measure(PROXY_REPETITIONS,
+                       [&] {
+                           // between the passes
+                           cache->releaseEvictedGeometry();
+                           return traceClosestHits(accel, rays);
+                       }),
+               rays.size());
+        reportCache(*cache);
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "Benchmark.hpp"
+#include "Scenes.hpp"
+
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/accelerators/grid/Grid.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+
+#include <string>
+
+namespace idragnev::pbrt::benchmarks {
+    using accelerators::BVH;
+    using accelerators::Grid;
+    namespace bvh = accelerators::bvh;
+
+    constexpr std::size_t GRID_REPETITIONS = 5;
+
+    template <typename Accelerator>
+    void benchmarkAcceleratorTraversal(const std::string& name,
+                                       const Accelerator& accel,
+                                       const std::vector<Ray>& rays) {
+        const Timing closestHit = measure(GRID_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& r : rays) {
+                const Ray ray = r;
+                hits += accel.intersect(ray).has_value() ? 1 : 0;
+            }
+            return hits;
+        });
+        report(name + "/intersect", closestHit, rays.size());
+
+        const Timing anyHit = measure(GRID_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& ray : rays) {
+                hits += accel.intersectP(ray) ? 1 : 0;
+            }
+            return hits;
+        });
+        report(name + "/intersectP", anyHit, rays.size());
+    }
+
+    void benchmarkGridScene(const std::string& sceneName,
+                            const PrimsVec& prims,
+                            const std::vector<Ray>& rays) {
+        const Timing bvhBuild = measure(GRID_REPETITIONS, [&prims] {
+            return BVH{prims, bvh::SplitMethod::SAH, 4}.worldBound().max.x;
+        });
+        report("bvh/" + sceneName + "/build", bvhBuild, prims.size());
+
+        const Timing gridBuild = measure(GRID_REPETITIONS, [&prims] {
+            return Grid{prims}.resolution()[0];
+        });
+        report("grid/" + sceneName + "/build", gridBuild, prims.size());
+
+        benchmarkAcceleratorTraversal("bvh/" + sceneName,
+                                      BVH{prims, bvh::SplitMethod::SAH, 4},
+                                      rays);
+        benchmarkAcceleratorTraversal("grid/" + sceneName, Grid{prims}, rays);
+    }
+
+    // Compares the grid with the SAH BVH on evenly distributed
+    // primitives, which suit the grid, and on clustered ones,
+    // which crowd few of its cells.
+    void benchmarkGrid() {
+        const PrimsVec spray = makeBoxes(100'000, 1, 0.f, 20);
+        benchmarkGridScene("spray", spray, makeRays(spray, 100'000, 21));
+
+        const PrimsVec triangles = makeTriangles(100'000, 1.f, 22);
+        benchmarkGridScene("triangles",
+                           triangles,
+                           makeRays(triangles, 100'000, 23));
+
+        const PrimsVec clusters = makeBoxes(100'000, 1'000, 1.f, 24);
+        benchmarkGridScene("clusters",
+                           clusters,
+                           makeRays(clusters, 100'000, 25));
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "Benchmark.hpp"
+#include "Scenes.hpp"
+
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/accelerators/kdtree/KdTree.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+
+#include <string>
+
+namespace idragnev::pbrt::benchmarks {
+    using accelerators::BVH;
+    using accelerators::KdTree;
+    namespace bvh = accelerators::bvh;
+
+    constexpr std::size_t KD_TREE_REPETITIONS = 5;
+
+    void benchmarkQueries(const std::string& name,
+                          const Primitive& accel,
+                          const std::vector<Ray>& rays) {
+        const Timing closestHit = measure(KD_TREE_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& r : rays) {
+                const Ray ray = r;
+                hits += accel.intersect(ray).has_value() ? 1 : 0;
+            }
+            return hits;
+        });
+        report(name + "/intersect", closestHit, rays.size());
+
+        const Timing anyHit = measure(KD_TREE_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& ray : rays) {
+                hits += accel.intersectP(ray) ? 1 : 0;
+            }
+            return hits;
+        });
+        report(name + "/intersectP", anyHit, rays.size());
+    }
+
+    void benchmarkKdTreeScene(const std::string& sceneName,
+                              const PrimsVec& prims,
+                              const std::vector<Ray>& rays) {
+        const Timing bvhBuild = measure(KD_TREE_REPETITIONS, [&prims] {
+            return BVH{prims, bvh::SplitMethod::SAH, 4}.worldBound().max.x;
+        });
+        report("bvh/" + sceneName + "/build", bvhBuild, prims.size());
+
+        const Timing kdTreeBuild = measure(KD_TREE_REPETITIONS, [&prims] {
+            return KdTree{prims}.nodesCount();
+        });
+        report("kdtree/" + sceneName + "/build", kdTreeBuild, prims.size());
+
+        benchmarkQueries("bvh/" + sceneName,
+                         BVH{prims, bvh::SplitMethod::SAH, 4},
+                         rays);
+        benchmarkQueries("kdtree/" + sceneName, KdTree{prims}, rays);
+    }
+
+    // Compares the k-d tree with the SAH BVH on the scenes
+    // of the grid benchmark
+    void benchmarkKdTree() {
+        const PrimsVec spray = makeBoxes(100'000, 1, 0.f, 20);
+        benchmarkKdTreeScene("spray", spray, makeRays(spray, 100'000, 21));
+
+        const PrimsVec triangles = makeTriangles(100'000, 1.f, 22);
+        benchmarkKdTreeScene("triangles",
+                             triangles,
+                             makeRays(triangles, 100'000, 23));
+
+        const PrimsVec clusters = makeBoxes(100'000, 1'000, 1.f, 24);
+        benchmarkKdTreeScene("clusters",
+                             clusters,
+                             makeRays(clusters, 100'000, 25));
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
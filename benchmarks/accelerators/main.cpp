@@ -0,0 +1,31 @@
+#include "pbrt/parallel/Parallel.hpp"
+
+namespace idragnev::pbrt::benchmarks {
+    void benchmarkBVHTraversal();
+    void benchmarkInstancing();
+    void benchmarkMotionBlur();
+    void benchmarkSceneEditing();
+    void benchmarkOutOfCoreBuild();
+    void benchmarkGeometryProxies();
+    void benchmarkGrid();
+    void benchmarkKdTree();
+} // namespace idragnev::pbrt::benchmarks
+
+int main() {
+    namespace pbrt = idragnev::pbrt;
+
+    pbrt::parallel::init();
+
+    pbrt::benchmarks::benchmarkBVHTraversal();
+    pbrt::benchmarks::benchmarkInstancing();
+    pbrt::benchmarks::benchmarkMotionBlur();
+    pbrt::benchmarks::benchmarkSceneEditing();
+    pbrt::benchmarks::benchmarkOutOfCoreBuild();
+    pbrt::benchmarks::benchmarkGeometryProxies();
+    pbrt::benchmarks::benchmarkGrid();
+    pbrt::benchmarks::benchmarkKdTree();
+
+    pbrt::parallel::cleanup();
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "Benchmark.hpp"
+#include "Scenes.hpp"
+
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/accelerators/bvh/MotionBVH.hpp"
+#include "pbrt/core/primitive/TransformedPrimitive.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/RNG.hpp"
+
+#include <deque>
+#include <string>
+
+namespace idragnev::pbrt::benchmarks {
+    using accelerators::BVH;
+    using accelerators::MotionBVH;
+    namespace bvh = accelerators::bvh;
+
+    constexpr std::size_t MOTION_REPETITIONS = 3;
+
+    template <typename Accelerator>
+    void benchmarkMotionTraversal(const std::string& name,
+                                  const Accelerator& accel,
+                                  const std::vector<Ray>& rays) {
+        const Timing closestHit = measure(MOTION_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& r : rays) {
+                const Ray ray = r;
+                hits += accel.intersect(ray).has_value() ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/motion/intersect (" + name + ")",
+               closestHit,
+               rays.size());
+
+        const Timing anyHit = measure(MOTION_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& ray : rays) {
+                hits += accel.intersectP(ray) ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/motion/intersectP (" + name + ")", anyHit, rays.size());
+    }
+
+    // Triangles moving up to 10 times their size during the shutter
+    // interval [0, 1], every fourth of them also turning by 10 degrees
+    // around its center, traced with rays at random times.
+    void benchmarkMotionBlur() {
+        const PrimsVec triangles = makeTriangles(20'000, 1.f, 13);
+
+        // AnimatedTransformation refers to its transformations
+        // and the deque keeps them in place
+        std::deque<Transformation> transformations;
+        rng::RNG rng{14};
+        PrimsVec moving;
+        moving.reserve(triangles.size());
+        for (std::size_t i = 0; i < triangles.size(); ++i) {
+            const Point3f center =
+                triangles[i]->worldBound().boundingSphere().center;
+            const Vector3f offset{10.f * rng.uniformFloat() - 5.f,
+                                  10.f * rng.uniformFloat() - 5.f,
+                                  10.f * rng.uniformFloat() - 5.f};
+            const Float angle = (i % 4 == 0) ? 10.f : 0.f;
+
+            const Transformation& start = transformations.emplace_back();
+            const Transformation& end = transformations.emplace_back(
+                translation(offset + Vector3f{center}) * yRotation(angle) *
+                translation(-Vector3f{center}));
+            moving.push_back(std::make_shared<TransformedPrimitive>(
+                triangles[i],
+                AnimatedTransformation{start, 0.f, end, 1.f}));
+        }
+
+        std::vector<Ray> rays = makeRays(moving, 20'000, 15);
+        for (Ray& ray : rays) {
+            ray.time = rng.uniformFloat();
+        }
+
+        const auto accel = BVH{moving, bvh::SplitMethod::SAH, 4};
+        benchmarkMotionTraversal("BVH over motion bounds", accel, rays);
+
+        for (const std::uint32_t timeSegmentsCount : {1u, 4u}) {
+            const auto motionAccel = MotionBVH{moving,
+                                               Intervalf{0.f, 1.f},
+                                               4,
+                                               timeSegmentsCount};
+            benchmarkMotionTraversal(
+                "MotionBVH, time segments: " +
+                    std::to_string(timeSegmentsCount),
+                motionAccel,
+                rays);
+        }
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
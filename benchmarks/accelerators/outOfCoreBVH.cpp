@@ -0,0 +1,100 @@
+#include "Benchmark.hpp"
+#include "Scenes.hpp"
+
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/accelerators/bvh/OutOfCoreBVH.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+namespace idragnev::pbrt::benchmarks {
+    using accelerators::BVH;
+    using accelerators::OutOfCoreBVH;
+    namespace bvh = accelerators::bvh;
+    namespace fs = std::filesystem;
+
+    constexpr std::size_t OUT_OF_CORE_REPETITIONS = 3;
+
+    template <typename Accelerator>
+    void benchmarkOutOfCoreTraversal(const std::string& name,
+                                     const Accelerator& accel,
+                                     const std::vector<Ray>& rays) {
+        const Timing closestHit = measure(OUT_OF_CORE_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& r : rays) {
+                const Ray ray = r;
+                hits += accel.intersect(ray).has_value() ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/out-of-core/intersect (" + name + ")",
+               closestHit,
+               rays.size());
+    }
+
+    // Builds a BVH over 1M triangles streamed from a file with budgets
+    // which force the build out of core or let it build in memory,
+    // against the in-memory SAH build, and traverses the memory mapped
+    // node file with its pages cached by the OS.
+    void benchmarkOutOfCoreBuild() {
+        const std::vector<Point3f> vertices =
+            makeTriangleVertices(1'000'000, 1.f, 18);
+        const PrimsVec prims = makeTriangles(vertices);
+        const std::vector<Ray> rays = makeRays(prims, 100'000, 19);
+
+        const fs::path soup = fs::temp_directory_path() / "pbrt_ooc.soup";
+        const fs::path nodeFile = fs::temp_directory_path() / "pbrt_ooc.bvh";
+        if (!accelerators::writeTriangleSoup(soup, vertices)) {
+            std::printf("bvh/out-of-core: cannot write %s\n",
+                        soup.string().c_str());
+            return;
+        }
+
+        const Timing inMemory = measure(1, [&prims] {
+            return BVH{prims, bvh::SplitMethod::SAH, 4}.worldBound().max.x;
+        });
+        report("bvh/out-of-core/build (in-memory SAH)",
+               inMemory,
+               prims.size());
+
+        for (const std::size_t budgetMB : {16u, 1024u}) {
+            accelerators::OutOfCoreBuildOptions options;
+            options.memoryBudget = budgetMB * 1024u * 1024u;
+
+            accelerators::OutOfCoreBuildStatistics statistics;
+            const Timing build = measure(1, [&] {
+                statistics = accelerators::buildOutOfCoreBVH(soup,
+                                                             nodeFile,
+                                                             options)
+                                 .value_or(statistics);
+                return statistics.nodesCount;
+            });
+            report("bvh/out-of-core/build (" + std::to_string(budgetMB) +
+                       " MB budget)",
+                   build,
+                   prims.size());
+            std::printf("  %llu subtrees built in memory, peak memory "
+                        "%.1f MB, %.1f MB streamed\n",
+                        static_cast<unsigned long long>(
+                            statistics.inCoreSubtreesCount),
+                        static_cast<double>(statistics.peakMemoryUsage) /
+                            (1024.0 * 1024.0),
+                        static_cast<double>(statistics.streamedBytes) /
+                            (1024.0 * 1024.0));
+        }
+
+        const BVH inMemoryAccel{prims, bvh::SplitMethod::SAH, 4};
+        benchmarkOutOfCoreTraversal("in-memory SAH", inMemoryAccel, rays);
+
+        if (const auto accel = OutOfCoreBVH::open(nodeFile);
+            accel.has_value()) {
+            benchmarkOutOfCoreTraversal("memory mapped", *accel, rays);
+        }
+
+        fs::remove(soup);
+        fs::remove(nodeFile);
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "Benchmark.hpp"
+#include "Scenes.hpp"
+
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/accelerators/bvh/TwoLevelBVH.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/RNG.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace idragnev::pbrt::benchmarks {
+    using accelerators::BVH;
+    using accelerators::BVHInstance;
+    using accelerators::TwoLevelBVH;
+    namespace bvh = accelerators::bvh;
+
+    constexpr std::size_t INSTANCING_REPETITIONS = 5;
+
+    // Scales the [0, 100]^3 scene of a bottom-level BVH down to
+    // [0, 10]^3, turns it randomly and places it in [0, 100]^3.
+    std::vector<Transformation>
+    makeInstanceTransformations(const std::size_t instancesCount,
+                                const std::uint64_t seed) {
+        rng::RNG rng{seed};
+
+        std::vector<Transformation> result;
+        result.reserve(instancesCount);
+        for (std::size_t i = 0; i < instancesCount; ++i) {
+            const Vector3f offset{90.f * rng.uniformFloat(),
+                                  90.f * rng.uniformFloat(),
+                                  90.f * rng.uniformFloat()};
+            const Float angle = 360.f * rng.uniformFloat();
+
+            result.push_back(translation(offset) *
+                             yRotation(angle) *
+                             scaling(0.1f, 0.1f, 0.1f));
+        }
+
+        return result;
+    }
+
+    void benchmarkInstancing() {
+        const PrimsVec triangles = makeTriangles(10'000, 1.f, 9);
+        const auto sharedBVH =
+            std::make_shared<const BVH>(triangles, bvh::SplitMethod::SAH, 4);
+
+        constexpr std::size_t instancesCount = 1'000;
+        const std::vector<Transformation> placements[] = {
+            makeInstanceTransformations(instancesCount, 10),
+            makeInstanceTransformations(instancesCount, 11),
+        };
+
+        std::vector<BVHInstance> instances;
+        instances.reserve(instancesCount);
+        for (const Transformation& t : placements[0]) {
+            instances.push_back(BVHInstance{sharedBVH, t});
+        }
+
+        const Timing build = measure(INSTANCING_REPETITIONS, [&instances] {
+            const auto accel = TwoLevelBVH{instances, bvh::SplitMethod::SAH};
+            return accel.topLevelBVH().buildStatistics().nodesCount;
+        });
+        report("bvh/instancing/build", build, instancesCount);
+
+        auto accel = TwoLevelBVH{instances, bvh::SplitMethod::SAH};
+        std::size_t updates = 0;
+        const Timing update = measure(INSTANCING_REPETITIONS, [&] {
+            accel.updateTransformations(placements[++updates % 2]);
+            return updates;
+        });
+        report("bvh/instancing/update transformations",
+               update,
+               instancesCount);
+
+        // the rays are aimed at the instanced scene, which also
+        // occupies [0, 100]^3
+        const std::vector<Ray> rays = makeRays(triangles, 10'000, 12);
+        const Timing closestHit = measure(INSTANCING_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& r : rays) {
+                const Ray ray = r;
+                hits += accel.intersect(ray).has_value() ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/instancing/intersect", closestHit, rays.size());
+
+        const Timing anyHit = measure(INSTANCING_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& ray : rays) {
+                hits += accel.intersectP(ray) ? 1 : 0;
+            }
+            return hits;
+        });
+        report("bvh/instancing/intersectP", anyHit, rays.size());
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
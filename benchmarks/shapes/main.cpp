@@ -0,0 +1,13 @@
+namespace idragnev::pbrt::benchmarks {
+    void benchmarkShapes();
+    void benchmarkTrianglePackets();
+    void benchmarkMeshFiles();
+} // namespace idragnev::pbrt::benchmarks
+
+int main() {
+    idragnev::pbrt::benchmarks::benchmarkShapes();
+    idragnev::pbrt::benchmarks::benchmarkTrianglePackets();
+    idragnev::pbrt::benchmarks::benchmarkMeshFiles();
+
+    return 0;
+}
\ No newline at end of file
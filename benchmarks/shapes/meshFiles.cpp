@@ -0,0 +1,79 @@
+#include "Benchmark.hpp"
+
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+#include "pbrt/shapes/OBJMesh.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace idragnev::pbrt::benchmarks {
+    constexpr std::size_t MESH_FILE_REPETITIONS = 3;
+    constexpr int MESH_FILE_GRID_SIZE = 512;
+
+    // Writes a grid of MESH_FILE_GRID_SIZE^2 quads with texture
+    // coordinates and normals. With `sharesIndices` the corners refer
+    // to the attributes of the same index as their positions,
+    // otherwise they all refer to one normal, like exported meshes of
+    // flat surfaces do.
+    std::filesystem::path writeGridOBJFile(const bool sharesIndices) {
+        constexpr int n = MESH_FILE_GRID_SIZE;
+        const std::filesystem::path path =
+            std::filesystem::temp_directory_path() /
+            (sharesIndices ? "pbrt_benchmark_grid_shared.obj"
+                           : "pbrt_benchmark_grid.obj");
+        std::ofstream file(path);
+
+        for (int y = 0; y <= n; ++y) {
+            for (int x = 0; x <= n; ++x) {
+                const float u = static_cast<float>(x) / n;
+                const float v = static_cast<float>(y) / n;
+                file << "v " << u << ' ' << v << " 0.0\nvt " << u << ' ' << v
+                     << '\n';
+                if (sharesIndices) {
+                    file << "vn 0 0 1\n";
+                }
+            }
+        }
+        if (!sharesIndices) {
+            file << "vn 0 0 1\n";
+        }
+
+        const auto corner = [sharesIndices](const int x, const int y) {
+            const std::string i = std::to_string(y * (n + 1) + x + 1);
+            return i + '/' + i + '/' + (sharesIndices ? i : "1");
+        };
+        for (int y = 0; y < n; ++y) {
+            for (int x = 0; x < n; ++x) {
+                file << "f " << corner(x, y) << ' ' << corner(x + 1, y) << ' '
+                     << corner(x + 1, y + 1) << ' ' << corner(x, y + 1)
+                     << '\n';
+            }
+        }
+
+        return path;
+    }
+
+    void benchmarkMeshFiles() {
+        parallel::init();
+
+        const Transformation identity{};
+        for (const bool sharesIndices : {true, false}) {
+            const std::filesystem::path path = writeGridOBJFile(sharesIndices);
+            const Timing timing = measure(MESH_FILE_REPETITIONS, [&] {
+                const auto triangles =
+                    shapes::loadOBJMesh(path, identity, identity, false);
+                return triangles.has_value() ? triangles->size() : 0;
+            });
+            report(sharesIndices ? "meshFiles/obj/shared indices"
+                                 : "meshFiles/obj/split vertices",
+                   timing,
+                   2 * MESH_FILE_GRID_SIZE * MESH_FILE_GRID_SIZE);
+
+            std::filesystem::remove(path);
+        }
+
+        parallel::cleanup();
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "Benchmark.hpp"
+
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/RNG.hpp"
+#include "pbrt/shapes/Cone.hpp"
+#include "pbrt/shapes/Cylinder.hpp"
+#include "pbrt/shapes/Disk.hpp"
+#include "pbrt/shapes/Paraboloid.hpp"
+#include "pbrt/shapes/Sphere.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+#include "pbrt/shapes/TrianglePacket.hpp"
+
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace idragnev::pbrt::benchmarks {
+    constexpr std::size_t SHAPE_REPETITIONS = 5;
+
+    // Rays from a sphere of radius 4 around the object space origin
+    // to random points in [-1.2, 1.2]^3, which hit about half of the
+    // shapes below
+    std::vector<Ray> makeShapeRays(const Transformation& objectToWorld,
+                                   const std::size_t raysCount,
+                                   const std::uint64_t seed) {
+        rng::RNG rng{seed};
+        const auto randomVector = [&rng] {
+            return Vector3f{rng.uniformFloat() - 0.5f,
+                            rng.uniformFloat() - 0.5f,
+                            rng.uniformFloat() - 0.5f};
+        };
+
+        std::vector<Ray> result;
+        result.reserve(raysCount);
+        for (std::size_t i = 0; i < raysCount; ++i) {
+            const Point3f o = Point3f{0.f, 0.f, 0.f} +
+                              4.f * normalize(randomVector());
+            const Point3f target = Point3f{0.f, 0.f, 0.f} +
+                                   2.4f * randomVector();
+
+            result.push_back(objectToWorld(Ray{o, target - o}));
+        }
+
+        return result;
+    }
+
+    void benchmarkShape(const std::string& name,
+                        const Shape& shape,
+                        const std::vector<Ray>& rays) {
+        const Timing closestHit = measure(SHAPE_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& ray : rays) {
+                hits += shape.intersect(ray).has_value() ? 1 : 0;
+            }
+            return hits;
+        });
+        report(name + "/intersect", closestHit, rays.size());
+
+        const Timing anyHit = measure(SHAPE_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& ray : rays) {
+                hits += shape.intersectP(ray) ? 1 : 0;
+            }
+            return hits;
+        });
+        report(name + "/intersectP", anyHit, rays.size());
+    }
+
+    // Compares the closest-hit and the any-hit queries of each shape.
+    // The partial shapes sweep 270 degrees, so their queries also test
+    // the angle of the hit point.
+    void benchmarkShapes() {
+        using namespace shapes;
+
+        const Transformation objectToWorld =
+            translation(Vector3f{1.f, -2.f, 3.f}) * xRotation(30.f);
+        const Transformation worldToObject = inverse(objectToWorld);
+        const std::vector<Ray> rays =
+            makeShapeRays(objectToWorld, 1'000'000, 30);
+
+        for (const Float phiMax : {360.f, 270.f}) {
+            const std::string sweep = phiMax < 360.f ? "partial" : "full";
+
+            const Sphere sphere{objectToWorld,
+                                worldToObject,
+                                false,
+                                1.f,
+                                -1.f,
+                                1.f,
+                                phiMax};
+            benchmarkShape("sphere/" + sweep, sphere, rays);
+
+            const Cylinder cylinder{objectToWorld,
+                                    worldToObject,
+                                    false,
+                                    1.f,
+                                    -1.f,
+                                    1.f,
+                                    phiMax};
+            benchmarkShape("cylinder/" + sweep, cylinder, rays);
+
+            const Disk disk{objectToWorld,
+                            worldToObject,
+                            false,
+                            0.f,
+                            1.f,
+                            0.f,
+                            phiMax};
+            benchmarkShape("disk/" + sweep, disk, rays);
+
+            const Cone cone{objectToWorld,
+                            worldToObject,
+                            false,
+                            1.f,
+                            1.f,
+                            phiMax};
+            benchmarkShape("cone/" + sweep, cone, rays);
+
+            const Paraboloid paraboloid{objectToWorld,
+                                        worldToObject,
+                                        false,
+                                        1.f,
+                                        0.f,
+                                        1.f,
+                                        phiMax};
+            benchmarkShape("paraboloid/" + sweep, paraboloid, rays);
+        }
+
+        const auto triangle =
+            createTriangleMesh(objectToWorld,
+                               worldToObject,
+                               false,
+                               1,
+                               {0, 1, 2},
+                               {Point3f{-1.f, -1.f, 0.f},
+                                Point3f{1.f, -1.f, 0.f},
+                                Point3f{0.f, 1.f, 0.f}},
+                               {},
+                               {},
+                               {},
+                               nullptr,
+                               nullptr,
+                               {});
+        benchmarkShape("triangle", *triangle.front(), rays);
+    }
+
+    // Finds the closest of the hits of `triangles`
+    // with packets of Width triangles.
+    template <std::size_t Width>
+    void benchmarkTrianglePackets(
+        const std::span<const std::array<Point3f, 3>> triangles,
+        const std::vector<Ray>& rays) {
+        std::vector<shapes::TrianglePacket<Width>> packets(
+            (triangles.size() + Width - 1) / Width);
+        for (std::size_t i = 0; i < triangles.size(); ++i) {
+            const auto& [p0, p1, p2] = triangles[i];
+            auto& packet = packets[i / Width];
+            packet.set(i % Width, p0, p1, p2);
+            packet.count = static_cast<std::uint32_t>(i % Width + 1);
+        }
+
+        const Timing timing = measure(SHAPE_REPETITIONS, [&] {
+            std::size_t hits = 0;
+            for (const Ray& r : rays) {
+                const Ray ray = r;
+                bool isHit = false;
+                for (const auto& packet : packets) {
+                    const auto hit = shapes::intersectTriangles(ray, packet);
+                    if (hit.has_value()) {
+                        ray.tMax = hit->hit.t;
+                        isHit = true;
+                    }
+                }
+                hits += isHit ? 1 : 0;
+            }
+            return hits;
+        });
+        report("triangles/" + std::to_string(triangles.size()) +
+                   "/packets of " + std::to_string(Width),
+               timing,
+               rays.size());
+    }
+
+    // Compares testing the triangles of a BVH leaf one by one
+    // and in packets, for leaves of several sizes.
+    void benchmarkTrianglePackets() {
+        rng::RNG rng{31};
+        const auto randomPoint = [&rng] {
+            return Point3f{2.f * rng.uniformFloat() - 1.f,
+                           2.f * rng.uniformFloat() - 1.f,
+                           2.f * rng.uniformFloat() - 1.f};
+        };
+        const std::vector<Ray> rays =
+            makeShapeRays(Transformation{}, 1'000'000, 32);
+
+        for (const std::size_t trianglesCount : {4u, 8u, 16u}) {
+            std::vector<std::array<Point3f, 3>> triangles;
+            for (std::size_t i = 0; i < trianglesCount; ++i) {
+                const Point3f p0 = randomPoint();
+                triangles.push_back({p0,
+                                     p0 + 0.5f * (randomPoint() - p0),
+                                     p0 + 0.5f * (randomPoint() - p0)});
+            }
+
+            const Timing oneByOne = measure(SHAPE_REPETITIONS, [&] {
+                std::size_t hits = 0;
+                for (const Ray& r : rays) {
+                    const Ray ray = r;
+                    bool isHit = false;
+                    for (const auto& [p0, p1, p2] : triangles) {
+                        const auto hit =
+                            shapes::intersectTriangle(ray, p0, p1, p2);
+                        if (hit.has_value()) {
+                            ray.tMax = hit->t;
+                            isHit = true;
+                        }
+                    }
+                    hits += isHit ? 1 : 0;
+                }
+                return hits;
+            });
+            report("triangles/" + std::to_string(trianglesCount) +
+                       "/one by one",
+                   oneByOne,
+                   rays.size());
+
+            benchmarkTrianglePackets<4>(triangles, rays);
+            benchmarkTrianglePackets<8>(triangles, rays);
+        }
+    }
+} // namespace idragnev::pbrt::benchmarks
\ No newline at end of file
@@ -1,30 +1,58 @@
 #pragma once
 
+#include "BVHStatistics.hpp"
+#include "RayPacket.hpp"
+
 #include "pbrt/core/primitive/Primitive.hpp"
 #include "pbrt/core/Optional.hpp"
 #include "pbrt/memory/MemoryArena.hpp"
 
+#include <array>
 #include <vector>
 #include <memory>
-#include <functional>
+#include <span>
+
+namespace idragnev::pbrt::shapes {
+    struct TriangleMesh;
+} // namespace idragnev::pbrt::shapes
 
 namespace idragnev::pbrt::accelerators {
     namespace bvh {
         struct BuildNode;
         struct BuildTree;
         enum class SplitMethod;
+
+        // The stack of nodes to visit used by single-ray traversals.
+        // Once a stack is full, pushing to it drops its oldest entry and
+        // the traversal finds the dropped nodes again by following
+        // parent links, so trees of any depth are traversed correctly.
+        enum class TraversalStack
+        {
+            // 64 entries (256 bytes), which no tree of practical depth fills
+            Full,
+            // 8 entries (32 bytes), restarting through the parent links
+            // on deep paths
+            Short,
+        };
     } // namespace bvh
 
     class BVH : public Aggregate
     {
     private:
         struct LinearBVHNode;
+        struct LeafTrianglePacket;
         struct FlattenResult;
+        struct ClosestHit;
 
     public:
+        // `treeletRestructuringPasses` > 0 enables the post-build
+        // treelet restructuring which lowers the SAH cost of the tree
+        // at the expense of build time.
         BVH(std::vector<std::shared_ptr<const Primitive>> primitives,
             const bvh::SplitMethod m,
-            const std::uint32_t maxPrimitivesInNode = 1);
+            const std::uint32_t maxPrimitivesInNode = 1,
+            const std::uint32_t treeletRestructuringPasses = 0,
+            const bvh::TraversalStack stack = bvh::TraversalStack::Full);
         ~BVH();
 
         Bounds3f worldBound() const override;
@@ -33,24 +61,157 @@ namespace idragnev::pbrt::accelerators {
         intersect(const Ray& ray) const override;
         bool intersectP(const Ray& ray) const override;
 
+        // The rays are sorted into coherent order, by direction octant,
+        // origin and direction, and consecutive rays in this order are
+        // traced in packets, as by intersectPackets, so that the rays
+        // of a packet share the nodes they visit and the cache lines
+        // these take. Suits large batches of rays in any order which
+        // are coherent once sorted, such as camera rays in random order,
+        // which these trace several times faster than single rays even
+        // on one thread. Rays which stay incoherent take about as long
+        // as single rays, and rays which are already in coherent order
+        // can skip the sort with intersectPackets.
+        // The packets are traced in parallel.
+        void intersect(
+            const std::span<const Ray> rays,
+            const std::span<Optional<SurfaceInteraction>> hits) const override;
+        void intersectP(const std::span<const Ray> rays,
+                        const std::span<bool> occluded) const override;
+
+        // Packet traversal for coherent rays, such as the primary rays
+        // of an image tile or shadow rays towards the same light.
+        // Consecutive rays are traced in packets of `width` rays which
+        // share the bounds test of each visited node, with a mask of
+        // the lanes still active. Packets whose rays point to different
+        // octants, and the few rays left active in a subtree when
+        // a packet diverges, fall back to single-ray traversal.
+        // The results are the same as those of intersect/intersectP.
+        void intersectPackets(
+            const std::span<const Ray> rays,
+            const std::span<Optional<SurfaceInteraction>> hits,
+            const bvh::PacketWidth width = bvh::PacketWidth::Eight) const;
+        void intersectPPackets(
+            const std::span<const Ray> rays,
+            const std::span<bool> occluded,
+            const bvh::PacketWidth width = bvh::PacketWidth::Eight) const;
+
+        // Recomputes the bounds of all nodes, and the stored triangle
+        // vertices, from the current state of the primitives while
+        // keeping the structure of the tree. Much cheaper than building
+        // a new tree when the primitives have moved, though the tree
+        // gets worse the farther they move from where they were
+        // at build time. The build statistics are not updated.
+        // Must not be called concurrently with intersection queries.
+        void refit();
+
+        // Renumbers the triangles of `meshes`, and their vertices, in the
+        // order of the leaves, see shapes::reorderTriangleMeshes. Then
+        // the triangles which are tested or shaded one after another,
+        // such as those of a leaf or of neighbouring leaves, have their
+        // data close in memory rather than in the order of the file they
+        // came from. The primitives refer to their meshes as const, so
+        // the meshes are passed by their owners.
+        // The results of intersection queries do not change.
+        // Must not be called concurrently with intersection queries
+        // of any aggregate with triangles of the same meshes.
+        void reorderTriangleMeshes(
+            const std::span<const std::shared_ptr<shapes::TriangleMesh>>
+                meshes);
+
+        // The primitives in the order of the leaves
+        std::span<const std::shared_ptr<const Primitive>>
+        orderedPrimitives() const noexcept;
+
+        const bvh::BuildStatistics& buildStatistics() const noexcept;
+
+        // Counted only if PBRT_BVH_TRAVERSAL_STATISTICS is defined,
+        // zeros otherwise.
+        bvh::TraversalStatistics
+        traversalStatistics(const bvh::RayQuery query) const noexcept;
+        void resetTraversalStatistics() noexcept;
+
     private:
         bvh::BuildTree buildBVHTree(const bvh::SplitMethod m,
                                     memory::MemoryArena& arena);
         FlattenResult flattenBVHTree(const bvh::BuildNode& buildNode,
                                      const std::size_t linearNodeIndex);
+        void storeParentIndices(const std::size_t nodesCount);
+        std::size_t storeLeafTriangles(const std::size_t nodesCount);
+        void collectNodeStatistics();
 
-        Optional<SurfaceInteraction>
-        intersectLeafNodePrims(const LinearBVHNode& node, const Ray& ray) const;
-        bool intersectPLeafNodePrims(const LinearBVHNode& node,
-                                     const Ray& ray) const;
+        void storeLeafTriangle(const std::size_t nodeIndex,
+                               const std::size_t i,
+                               const std::array<Point3f, 3>& vertices);
+
+        std::span<const std::shared_ptr<const Primitive>>
+        leafPrimitives(const LinearBVHNode& leaf) const;
+        std::span<const LeafTrianglePacket>
+        leafTrianglePackets(const LinearBVHNode& leaf) const;
+
+        void intersectLeaf(const LinearBVHNode& leaf,
+                           const Ray& ray,
+                           ClosestHit& closest,
+                           bvh::TraversalCounters& counters) const;
+        bool leafOccludes(const LinearBVHNode& leaf,
+                          const Ray& ray,
+                          bvh::TraversalCounters& counters) const;
+        Optional<SurfaceInteraction> interactionOf(ClosestHit&& closest,
+                                                   const Ray& ray) const;
+
+        template <typename LeafVisitor>
+        void traverseIntersect(LeafVisitor&& intersectLeaf,
+                               const Ray& ray,
+                               bvh::TraversalCounters& counters,
+                               const std::uint32_t rootIndex = 0) const;
+        template <std::size_t StackCapacity, typename LeafVisitor>
+        void traverseWithStack(LeafVisitor&& intersectLeaf,
+                               const Ray& ray,
+                               bvh::TraversalCounters& counters,
+                               const std::uint32_t rootIndex) const;
+        Optional<std::uint32_t>
+        nextNodeAfter(std::uint32_t nodeIndex,
+                      const std::uint32_t rootIndex,
+                      const std::size_t dirIsNegative[3]) const;
+
+        template <std::size_t Width>
+        void intersectPackets(
+            const std::span<const Ray> rays,
+            const std::span<Optional<SurfaceInteraction>> hits) const;
+        template <std::size_t Width>
+        void intersectPPackets(const std::span<const Ray> rays,
+                               const std::span<bool> occluded) const;
+        template <std::size_t Width>
+        void intersectPacket(const std::span<const Ray> packetRays,
+                             const std::span<ClosestHit> closest,
+                             bvh::TraversalCounters& counters) const;
+        template <std::size_t Width>
+        void intersectPPacket(const std::span<const Ray> packetRays,
+                              const std::span<bool> occluded,
+                              bvh::TraversalCounters& counters) const;
+        template <std::size_t Width, typename LeafVisitor>
+        void traversePacket(LeafVisitor&& intersectLeaf,
+                            bvh::RayPacket<Width>& packet,
+                            const std::span<const Ray> rays,
+                            bvh::TraversalCounters& counters) const;
 
-        void traverseIntersect(
-            std::function<bool(const LinearBVHNode&, const Ray&)> intersectLeaf,
-            const Ray& ray) const;
+        template <typename StreamVisitor>
+        void forEachRayStream(const std::span<const Ray> rays,
+                              StreamVisitor&& visitStream) const;
 
     private:
         std::uint32_t maxPrimitivesInNode = 1;
+        bvh::TraversalStack traversalStack = bvh::TraversalStack::Full;
         std::vector<std::shared_ptr<const Primitive>> primitives;
         LinearBVHNode* nodes = nullptr;
+        // The index of the parent of each node, the root being its own.
+        std::vector<std::uint32_t> parentIndices;
+        // The vertices of the triangles of the leaves which contain
+        // only triangles, in packets of consecutive triangles of a leaf.
+        // Null if there are no such leaves.
+        LeafTrianglePacket* trianglePackets = nullptr;
+        // The index of the first packet of each triangle leaf, by node.
+        std::vector<std::uint32_t> firstPacketIndices;
+        bvh::BuildStatistics statistics;
+        mutable bvh::TraversalStatisticsAccumulator traversalStats;
     };
 } // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -70,11 +70,23 @@ namespace idragnev::pbrt::accelerators::bvh {
         HLBVH,
         Middle,
         EqualCounts,
+        PLOC,
     };
 
     Bounds3f bounds(const std::span<const PrimitiveInfo> range);
     Bounds3f centroidBounds(const std::span<const PrimitiveInfo> range);
 
+    // Makes an interior node with children `a` and `b`, split along
+    // the axis on which their centroids are farthest apart.
+    // The children are ordered by their centroids along that axis,
+    // as front-to-back traversal expects.
+    // Used by the bottom-up builders where no split plane is chosen.
+    BuildNode makeInteriorNode(BuildNode* const a, BuildNode* const b);
+
+    // Computes the SAH cost of `tree`, relative to the surface area
+    // of its root, with traversal and intersection costs of 1.
+    Float sahCost(const BuildTree& tree);
+
     // Uses the Surface Area Heuristic (SAH)
     // to find the minimum cost split position `p`.
     // Partitions the primitives at `p` only if:
@@ -100,4 +112,15 @@ namespace idragnev::pbrt::accelerators::bvh {
                    const std::span<PrimitiveInfo> primitives,
                    const Bounds3f& primitivesBounds,
                    const Bounds3f& primitivesCentroidBounds);
+
+    // Partitions the primitives in equal subsets along the maximum
+    // extent of `rangeCentroidBounds` if they are fewer than 5,
+    // as partitionBySAH otherwise.
+    //
+    // Returns the split position if the primitives were partitioned.
+    Optional<std::size_t>
+    partitionPrimitivesInfoBySAH(const Bounds3f& rangeBounds,
+                                 const Bounds3f& rangeCentroidBounds,
+                                 const std::span<PrimitiveInfo> primsInfoRange,
+                                 const std::size_t maxPrimsInNode);
 } // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
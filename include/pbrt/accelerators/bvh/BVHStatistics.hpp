@@ -0,0 +1,161 @@
+#pragma once
+
+#include "pbrt/core/core.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace idragnev::pbrt::accelerators::bvh {
+    struct BuildPhaseTimes
+    {
+        std::chrono::duration<double> treeBuild{};
+        std::chrono::duration<double> treeletRestructuring{};
+        std::chrono::duration<double> flattening{};
+        std::chrono::duration<double> leafTriangles{};
+    };
+
+    struct BuildStatistics
+    {
+        std::size_t nodesCount = 0;
+        std::size_t interiorNodesCount = 0;
+        std::size_t leavesCount = 0;
+        std::size_t triangleLeavesCount = 0;
+        std::size_t maxDepth = 0;
+        // The bytes of the nodes, the leaf triangles and
+        // the pointers to the primitives, not of the primitives
+        std::size_t memoryUsage = 0;
+        // The number of leaves at each depth, the root being at depth 0.
+        std::vector<std::size_t> leafDepthHistogram;
+        // The number of leaves with each primitives count.
+        std::vector<std::size_t> leafSizeHistogram;
+        // See bvh::sahCost.
+        Float sahCost = 0.f;
+        BuildPhaseTimes phaseTimes;
+    };
+
+    std::ostream& operator<<(std::ostream& os, const BuildStatistics& stats);
+
+    enum class RayQuery
+    {
+        ClosestHit,
+        AnyHit,
+    };
+
+    struct TraversalStatistics
+    {
+        std::uint64_t raysCount = 0;
+        // The nodes whose bounds are hit by the ray.
+        std::uint64_t nodesVisited = 0;
+        std::uint64_t boxTests = 0;
+        std::uint64_t primitiveTests = 0;
+    };
+
+#ifdef PBRT_BVH_TRAVERSAL_STATISTICS
+    inline constexpr bool TRAVERSAL_STATISTICS_ENABLED = true;
+
+    // Counts the work done by a single traversal
+    // of one ray or of a stream of rays.
+    class TraversalCounters
+    {
+    public:
+        explicit TraversalCounters(const std::uint64_t raysCount = 1) noexcept
+            : counts{.raysCount = raysCount} {}
+
+        void countBoxTest() noexcept { ++counts.boxTests; }
+        void countBoxTests(const std::uint64_t n) noexcept {
+            counts.boxTests += n;
+        }
+        void countNodeVisit() noexcept { ++counts.nodesVisited; }
+        void countNodeVisits(const std::uint64_t n) noexcept {
+            counts.nodesVisited += n;
+        }
+        void countPrimitiveTests(const std::uint64_t n) noexcept {
+            counts.primitiveTests += n;
+        }
+
+        const TraversalStatistics& statistics() const noexcept {
+            return counts;
+        }
+
+    private:
+        TraversalStatistics counts;
+    };
+
+    // Accumulates the counters of all traversals, from any thread.
+    class TraversalStatisticsAccumulator
+    {
+    public:
+        void add(const RayQuery query,
+                 const TraversalCounters& counters) noexcept {
+            const TraversalStatistics& s = counters.statistics();
+            Counts& counts = perQuery[static_cast<std::size_t>(query)];
+
+            counts.raysCount.fetch_add(s.raysCount, std::memory_order_relaxed);
+            counts.nodesVisited.fetch_add(s.nodesVisited,
+                                          std::memory_order_relaxed);
+            counts.boxTests.fetch_add(s.boxTests, std::memory_order_relaxed);
+            counts.primitiveTests.fetch_add(s.primitiveTests,
+                                            std::memory_order_relaxed);
+        }
+
+        TraversalStatistics get(const RayQuery query) const noexcept {
+            const Counts& counts = perQuery[static_cast<std::size_t>(query)];
+
+            return TraversalStatistics{
+                .raysCount = counts.raysCount.load(),
+                .nodesVisited = counts.nodesVisited.load(),
+                .boxTests = counts.boxTests.load(),
+                .primitiveTests = counts.primitiveTests.load(),
+            };
+        }
+
+        void reset() noexcept {
+            for (Counts& counts : perQuery) {
+                counts.raysCount = 0;
+                counts.nodesVisited = 0;
+                counts.boxTests = 0;
+                counts.primitiveTests = 0;
+            }
+        }
+
+    private:
+        struct Counts
+        {
+            std::atomic<std::uint64_t> raysCount = 0;
+            std::atomic<std::uint64_t> nodesVisited = 0;
+            std::atomic<std::uint64_t> boxTests = 0;
+            std::atomic<std::uint64_t> primitiveTests = 0;
+        };
+
+        std::array<Counts, 2> perQuery;
+    };
+#else
+    inline constexpr bool TRAVERSAL_STATISTICS_ENABLED = false;
+
+    // Define PBRT_BVH_TRAVERSAL_STATISTICS to enable the counters.
+    // Until then they compile to nothing.
+    class TraversalCounters
+    {
+    public:
+        explicit TraversalCounters(const std::uint64_t = 1) noexcept {}
+
+        void countBoxTest() noexcept {}
+        void countBoxTests(const std::uint64_t) noexcept {}
+        void countNodeVisit() noexcept {}
+        void countNodeVisits(const std::uint64_t) noexcept {}
+        void countPrimitiveTests(const std::uint64_t) noexcept {}
+    };
+
+    class TraversalStatisticsAccumulator
+    {
+    public:
+        void add(const RayQuery, const TraversalCounters&) noexcept {}
+        TraversalStatistics get(const RayQuery) const noexcept { return {}; }
+        void reset() noexcept {}
+    };
+#endif
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
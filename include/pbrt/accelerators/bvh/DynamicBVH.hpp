@@ -0,0 +1,71 @@
+#pragma once
+
+#include "pbrt/core/primitive/Primitive.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+
+#include <vector>
+#include <memory>
+#include <span>
+
+namespace idragnev::pbrt::accelerators {
+    // A BVH which primitives are inserted into and removed from one by
+    // one, for scenes which are edited between renders. Each edit
+    // changes the tree along a single path instead of building it again.
+    // A primitive is inserted as the sibling of the node which increases
+    // the surface area of the tree the least, found by a branch and bound
+    // search, and the nodes on the paths changed by insertions and
+    // removals are rotated when that lowers the surface area of their
+    // children. Each leaf holds a single primitive.
+    // Edits must not be concurrent with intersection queries.
+    class DynamicBVH : public Aggregate
+    {
+    private:
+        struct Node;
+
+    public:
+        // Identifies an inserted primitive until it is removed.
+        // Handles of removed primitives are reused.
+        using Handle = std::uint32_t;
+
+        DynamicBVH();
+        ~DynamicBVH();
+
+        Handle insert(std::shared_ptr<const Primitive> primitive);
+        void remove(const Handle handle);
+
+        std::size_t size() const noexcept;
+        // The number of nodes on the longest path from the root
+        // to a leaf, 0 if the tree is empty.
+        std::size_t height() const noexcept;
+
+        Bounds3f worldBound() const override;
+
+        Optional<SurfaceInteraction>
+        intersect(const Ray& ray) const override;
+        bool intersectP(const Ray& ray) const override;
+
+    private:
+        std::uint32_t allocateNode();
+        void freeNode(const std::uint32_t index);
+
+        std::uint32_t findBestSibling(const Bounds3f& leafBounds) const;
+        void refitAncestors(std::uint32_t index);
+        void rotate(const std::uint32_t index);
+        void updateNode(const std::uint32_t index);
+
+        template <typename LeafVisitor>
+        void traverse(LeafVisitor&& visitLeaf, const Ray& ray) const;
+        template <typename LeafVisitor>
+        void traverse(LeafVisitor&& visitLeaf,
+                      const Ray& ray,
+                      const std::span<std::uint32_t> nodesToVisit) const;
+
+    private:
+        std::vector<Node> nodes;
+        // The primitives of the leaves, at the indices of the leaves
+        std::vector<std::shared_ptr<const Primitive>> primitives;
+        std::uint32_t rootIndex;
+        std::uint32_t freeListHead;
+        std::size_t primitivesCount = 0;
+    };
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "BVH.hpp"
+
+#include "pbrt/core/geometry/Bounds3.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace idragnev::pbrt::accelerators {
+    class GeometryProxy;
+
+    // The primitives of a proxy, loaded when it is first hit
+    struct LoadedGeometry
+    {
+        std::vector<std::shared_ptr<const Primitive>> primitives;
+        // Kept alive as long as the primitives,
+        // such as the transformations their shapes refer to
+        std::shared_ptr<const void> resources;
+        // The bytes of the primitives and their shapes,
+        // counted against the budget of the cache
+        std::size_t memoryUsage = 0;
+    };
+
+    // Returns pbrt::nullopt if the geometry cannot be loaded
+    using GeometryLoader = std::function<Optional<LoadedGeometry>()>;
+
+    // Loads the triangles of a PLY or OBJ file, by its extension,
+    // as geometric primitives with `material`, see loadPLYMesh
+    // and loadOBJMesh. The loads run in parallel, so parallel::init
+    // must have been called before the proxy is first hit.
+    GeometryLoader meshFileLoader(std::filesystem::path path,
+                                  const Transformation& objectToWorld,
+                                  const bool reverseOrientation,
+                                  std::shared_ptr<const Material> material);
+
+    struct GeometryCacheStatistics
+    {
+        std::uint64_t loadsCount = 0;
+        std::uint64_t failedLoadsCount = 0;
+        std::uint64_t evictionsCount = 0;
+        // evicted geometry hit again before it was released
+        std::uint64_t restoresCount = 0;
+    };
+
+    // The geometry loaded by the proxies which share the cache.
+    // Once its memory usage exceeds the budget, the geometry which
+    // was hit least recently is evicted. The geometry used last is
+    // never evicted, so it may exceed the budget on its own.
+    // Evicted geometry is not freed right away since the interactions
+    // found in it refer to its primitives - it is freed once
+    // releaseEvictedGeometry is called and the queries still
+    // traversing it end. Until then it is restored if it is hit again,
+    // so each proxy has at most one copy of its geometry in memory and
+    // between two releases the memory in use is bounded by the budget
+    // and the geometry evicted meanwhile. Once released, evicted
+    // geometry is loaded again when it is hit again.
+    class GeometryCache
+    {
+    private:
+        struct Geometry;
+
+        struct Entry
+        {
+            const GeometryProxy* proxy = nullptr;
+            std::shared_ptr<const Geometry> geometry;
+        };
+
+    public:
+        explicit GeometryCache(const std::size_t memoryBudget);
+        ~GeometryCache();
+
+        GeometryCache(const GeometryCache&) = delete;
+        GeometryCache& operator=(const GeometryCache&) = delete;
+
+        // Frees the evicted geometry. Must not be called while
+        // the interactions found in it are in use, such as between
+        // the passes of a renderer.
+        void releaseEvictedGeometry();
+
+        std::size_t memoryBudget() const noexcept;
+        // The bytes of the geometry which is not evicted,
+        // with the BVHs built over it
+        std::size_t memoryUsage() const;
+        // The bytes of the evicted geometry which is not released yet
+        std::size_t evictedMemoryUsage() const;
+        std::size_t loadedProxiesCount() const;
+        GeometryCacheStatistics statistics() const;
+
+    private:
+        friend class GeometryProxy;
+
+        // Marks the geometry of `proxy` as used most recently,
+        // restoring it if it is evicted. Null if it is not loaded.
+        std::shared_ptr<const Geometry> find(const GeometryProxy& proxy);
+        bool contains(const GeometryProxy& proxy) const;
+        // Evicts the geometry used least recently while the memory
+        // usage exceeds the budget
+        void insert(const GeometryProxy& proxy,
+                    std::shared_ptr<const Geometry> geometry);
+        void erase(const GeometryProxy& proxy);
+        void recordFailedLoad();
+        void pushMostRecentlyUsed(const GeometryProxy& proxy,
+                                  std::shared_ptr<const Geometry> geometry);
+        void evictLeastRecentlyUsed();
+
+    private:
+        mutable std::mutex mutex;
+        std::size_t budget = 0;
+        std::size_t usage = 0;
+        std::size_t evictedUsage = 0;
+        // the most recently used first
+        std::list<Entry> entries;
+        std::unordered_map<const GeometryProxy*, std::list<Entry>::iterator>
+            entryOfProxy;
+        std::unordered_map<const GeometryProxy*,
+                           std::shared_ptr<const Geometry>>
+            evicted;
+        // The geometry of destroyed proxies, released with the evicted
+        std::vector<std::shared_ptr<const Geometry>> orphaned;
+        GeometryCacheStatistics stats;
+    };
+
+    // A primitive which stands for geometry that is loaded only if
+    // a ray reaches its bounds, known in advance, such as an asset of
+    // a large scene which is rarely seen. The first query which
+    // reaches the bounds loads the geometry and builds a BVH over it
+    // while the other queries of the proxy wait. The geometry is kept
+    // in the cache of the proxy until it is evicted and released.
+    // The interactions refer to the loaded primitives. A proxy whose
+    // geometry fails to load is never hit and is not loaded again.
+    class GeometryProxy : public Aggregate
+    {
+    public:
+        GeometryProxy(const Bounds3f& bounds,
+                      GeometryLoader load,
+                      std::shared_ptr<GeometryCache> cache,
+                      const bvh::SplitMethod m,
+                      const std::uint32_t maxPrimitivesInNode = 4);
+        ~GeometryProxy();
+
+        GeometryProxy(const GeometryProxy&) = delete;
+        GeometryProxy& operator=(const GeometryProxy&) = delete;
+
+        Bounds3f worldBound() const override;
+
+        Optional<SurfaceInteraction>
+        intersect(const Ray& ray) const override;
+        bool intersectP(const Ray& ray) const override;
+
+        // Whether the geometry is in the cache and not evicted
+        bool isLoaded() const;
+
+    private:
+        std::shared_ptr<const GeometryCache::Geometry> geometry() const;
+
+    private:
+        Bounds3f bounds;
+        GeometryLoader load;
+        std::shared_ptr<GeometryCache> cache;
+        bvh::SplitMethod splitMethod;
+        std::uint32_t maxPrimitivesInNode = 4;
+        // held by the query which loads the geometry
+        mutable std::mutex loadMutex;
+        mutable std::atomic<bool> failedToLoad = false;
+    };
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -5,11 +5,11 @@
 #include "pbrt/memory/MemoryArena.hpp"
 
 #include <span>
-#include <atomic>
 
 namespace idragnev::pbrt::accelerators::bvh {
     struct MortonPrimitive;
     struct LBVHTreelet;
+    struct RadixTree;
 
     class HLBVHBuilder
     {
@@ -47,15 +47,14 @@ namespace idragnev::pbrt::accelerators::bvh {
         LowerLevels buildLowerLevels(
             std::vector<LBVHTreelet>&& treelets,
             const std::vector<MortonPrimitive>& mortonPrimInfos) const;
-        BuildTree emitLBVH(BuildNode*& buildNodes,
-                           const std::span<const MortonPrimitive> primsSubrange,
-                           PrimsVec& orderedPrims,
-                           std::atomic<std::size_t>& orderedPrimsFreePosition,
-                           const int splitBit) const;
-        BuildNode
-        makeLeafNode(const std::span<const MortonPrimitive> primsRange,
-                     const std::size_t firstPrimIndex,
-                     PrimsVec& orderedPrims) const;
+        RadixTree
+        buildRadixTrees(const std::vector<LBVHTreelet>& treelets,
+                        const std::vector<MortonPrimitive>& mortonPrims,
+                        std::vector<std::uint8_t>& emittedNodesCounts) const;
+        void emitLBVHs(const std::vector<LBVHTreelet>& treelets,
+                       const std::vector<MortonPrimitive>& mortonPrims,
+                       const RadixTree& radixTree,
+                       PrimsVec& orderedPrims) const;
 
     private:
         std::size_t maxPrimitivesInNode = 1;
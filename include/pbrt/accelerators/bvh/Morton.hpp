@@ -0,0 +1,32 @@
+#pragma once
+
+#include "BVHBuilders.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace idragnev::pbrt::accelerators::bvh {
+    namespace constants {
+        inline constexpr std::uint32_t MORTON_CODE_BITS = 63;
+        inline constexpr std::uint32_t MORTON_DIMENSION_BITS =
+            MORTON_CODE_BITS / 3;
+        inline constexpr std::uint32_t MORTON_DIMENSION_MAX =
+            1 << MORTON_DIMENSION_BITS;
+    } // namespace constants
+
+    struct MortonPrimitive
+    {
+        std::size_t index = 0;
+        std::uint64_t mortonCode = 0;
+    };
+
+    // Computes the morton code of each primitive's centroid,
+    // relative to the bounds of all primitive centroids.
+    std::vector<MortonPrimitive>
+    toMortonPrimitives(const std::vector<PrimitiveInfo>& primsInfo);
+    std::uint64_t encodeMorton3(const Vector3f& v);
+    std::uint64_t leftShift3(std::uint64_t x);
+
+    [[nodiscard]] std::vector<MortonPrimitive>
+    radixSort(std::vector<MortonPrimitive> vec);
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "pbrt/core/primitive/Primitive.hpp"
+#include "pbrt/core/transformations/AnimatedTransformation.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/math/Interval.hpp"
+#include "pbrt/memory/MemoryArena.hpp"
+
+#include <vector>
+#include <memory>
+#include <span>
+
+namespace idragnev::pbrt::accelerators {
+    namespace bvh {
+        struct BuildNode;
+    } // namespace bvh
+
+    // A BVH over moving primitives, e.g. TransformedPrimitives with
+    // animated transformations. Its nodes store bounds at the start and
+    // at the end of a time interval which are interpolated by the time
+    // of the ray, instead of the world bounds of the primitives, which
+    // hold the whole motion and grow with the speed of the primitives.
+    // With `timeSegmentsCount` > 1 the shutter interval is split into
+    // segments of equal length with a tree of their own - the bounds
+    // of primitives which do not move along lines, like rotating ones,
+    // are interpolated tighter over shorter intervals.
+    class MotionBVH : public Aggregate
+    {
+    private:
+        struct Node;
+        struct TimeSegment;
+
+    public:
+        MotionBVH(
+            const std::vector<std::shared_ptr<const Primitive>>& primitives,
+            const Intervalf& shutter,
+            const std::uint32_t maxPrimitivesInNode = 1,
+            const std::uint32_t timeSegmentsCount = 1);
+        ~MotionBVH();
+
+        Bounds3f worldBound() const override;
+
+        Optional<SurfaceInteraction>
+        intersect(const Ray& ray) const override;
+        bool intersectP(const Ray& ray) const override;
+
+        std::size_t timeSegmentsCount() const noexcept;
+
+    private:
+        TimeSegment buildTimeSegment(
+            const Intervalf& time,
+            const std::vector<std::shared_ptr<const Primitive>>& primitives,
+            memory::MemoryArena& arena) const;
+        std::uint32_t
+        flattenTree(const bvh::BuildNode& buildNode,
+                    const std::span<const LinearMotionBounds> primitivesBounds,
+                    const std::uint32_t depth,
+                    TimeSegment& segment) const;
+
+        Intervalf timeSegment(const std::size_t index) const noexcept;
+
+        template <typename LeafVisitor>
+        void traverse(LeafVisitor&& visitLeaf, const Ray& ray) const;
+        template <typename LeafVisitor>
+        void traverseSegment(LeafVisitor&& visitLeaf,
+                             const Ray& ray,
+                             const TimeSegment& segment,
+                             const Float segmentTime,
+                             const std::span<std::uint32_t> nodesToVisit) const;
+
+    private:
+        Intervalf shutter;
+        std::uint32_t maxPrimitivesInNode = 1;
+        std::vector<TimeSegment> segments;
+        Bounds3f bounds;
+    };
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "pbrt/core/primitive/Primitive.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/math/Point3.hpp"
+#include "pbrt/memory/MappedFile.hpp"
+
+#include <filesystem>
+#include <span>
+
+namespace idragnev::pbrt::accelerators {
+    namespace bvh {
+        struct OutOfCoreFileHeader;
+        struct OutOfCoreNode;
+        struct OutOfCoreTriangle;
+    } // namespace bvh
+
+    struct OutOfCoreBuildOptions
+    {
+        // The memory the build may use for its buffers and for the
+        // subtrees it builds in memory. Budgets too small to build
+        // a leaf in memory are rejected.
+        std::size_t memoryBudget = 256u * 1024u * 1024u;
+        std::size_t maxTrianglesInNode = 4;
+        // Where the temporary files of the build are written,
+        // the directory of the node file if empty
+        std::filesystem::path scratchDirectory;
+    };
+
+    struct OutOfCoreBuildStatistics
+    {
+        std::uint64_t trianglesCount = 0;
+        std::uint64_t nodesCount = 0;
+        // The subtrees which were small enough to be built in memory
+        std::uint64_t inCoreSubtreesCount = 0;
+        // The bytes of triangles streamed to and from temporary files
+        std::uint64_t streamedBytes = 0;
+        std::size_t peakMemoryUsage = 0;
+    };
+
+    // Writes a triangle soup file, the input of buildOutOfCoreBVH:
+    // the coordinates of the three vertices of each triangle
+    // as native 32-bit floats. `vertices` holds three vertices
+    // for each triangle.
+    bool writeTriangleSoup(const std::filesystem::path& path,
+                           const std::span<const Point3f> vertices);
+
+    // Builds a BVH over the triangles of the triangle soup file `input`
+    // without loading them in memory at once and writes it to the
+    // node file `output`, which is opened with OutOfCoreBVH::open.
+    // The triangles are binned by their centroids in chunks streamed
+    // from disk and partitioned into temporary files until the subsets
+    // are small enough to be built in memory with the SAH, so the
+    // memory used is bounded by `options.memoryBudget`.
+    // Returns pbrt::nullopt if the input is empty or malformed,
+    // the budget is too small or a file operation fails.
+    Optional<OutOfCoreBuildStatistics>
+    buildOutOfCoreBVH(const std::filesystem::path& input,
+                      const std::filesystem::path& output,
+                      const OutOfCoreBuildOptions& options = {});
+
+    // A BVH over the triangles of a node file written by
+    // buildOutOfCoreBVH. The file is memory mapped so only the
+    // nodes and triangles which rays visit are read from disk.
+    // The interactions it finds have the geometry of the triangles
+    // with the default parameterization of Triangle, no shape and
+    // no primitive, and `faceIndex` set to the index of the triangle
+    // in the triangle soup.
+    class OutOfCoreBVH : public Aggregate
+    {
+    public:
+        // Returns pbrt::nullopt if the file cannot be mapped or is not
+        // a node file written by buildOutOfCoreBVH in this build
+        static Optional<OutOfCoreBVH>
+        open(const std::filesystem::path& nodeFile);
+
+        Bounds3f worldBound() const override;
+
+        Optional<SurfaceInteraction>
+        intersect(const Ray& ray) const override;
+        bool intersectP(const Ray& ray) const override;
+
+        std::size_t trianglesCount() const noexcept;
+        std::size_t nodesCount() const noexcept;
+
+    private:
+        explicit OutOfCoreBVH(memory::MappedFile file);
+
+        template <typename LeafVisitor>
+        void traverse(LeafVisitor&& visitLeaf, const Ray& ray) const;
+        template <typename LeafVisitor>
+        void traverse(LeafVisitor&& visitLeaf,
+                      const Ray& ray,
+                      const std::span<std::uint64_t> nodesToVisit) const;
+
+    private:
+        memory::MappedFile file;
+        const bvh::OutOfCoreFileHeader* header = nullptr;
+        std::span<const bvh::OutOfCoreNode> nodes;
+        std::span<const bvh::OutOfCoreTriangle> triangles;
+        std::span<const std::uint64_t> triangleIndices;
+    };
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
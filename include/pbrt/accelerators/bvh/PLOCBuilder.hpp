@@ -0,0 +1,45 @@
+#pragma once
+
+#include "BVHBuilders.hpp"
+
+#include "pbrt/memory/MemoryArena.hpp"
+
+namespace idragnev::pbrt::accelerators::bvh {
+    // Builds the BVH bottom-up by Parallel Locally-Ordered Clustering
+    // (Meister and Bittner, 2018).
+    // Starts with one cluster per primitive, sorted along a morton curve.
+    // In each pass every cluster finds its nearest neighbour - the one
+    // minimizing the surface area of their union - among the
+    // `searchRadius` clusters on each side of it, and mutual nearest
+    // neighbours are merged. Passes run in parallel and are repeated
+    // until a single cluster remains.
+    class PLOCBuilder
+    {
+    private:
+        using PrimsVec = std::vector<std::shared_ptr<const Primitive>>;
+
+        struct Clusters;
+
+    public:
+        PLOCBuilder() = default;
+        PLOCBuilder(const std::size_t maxPrimsInNode,
+                    const std::size_t searchRadius = 16) noexcept
+            : maxPrimitivesInNode(maxPrimsInNode)
+            , searchRadius(searchRadius) {}
+
+        BuildResult operator()(memory::MemoryArena& arena,
+                               const PrimsVec& primitives) const;
+
+    private:
+        BuildNode* mergeClusters(Clusters& clusters) const;
+        std::vector<std::size_t>
+        findNearestNeighbours(const std::vector<BuildNode*>& clusters) const;
+        BuildResult collapseSubtrees(const Clusters& clusters,
+                                     BuildNode* root,
+                                     const PrimsVec& primitives) const;
+
+    private:
+        std::size_t maxPrimitivesInNode = 1;
+        std::size_t searchRadius = 16;
+    };
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
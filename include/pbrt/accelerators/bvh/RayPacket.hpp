@@ -0,0 +1,140 @@
+#pragma once
+
+#include "pbrt/core/core.hpp"
+#include "pbrt/core/Optional.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace idragnev::pbrt::accelerators::bvh {
+    enum class PacketWidth : std::size_t
+    {
+        Four = 4,
+        Eight = 8,
+        Sixteen = 16,
+    };
+
+    // Bit i is set if lane i of a packet is active.
+    using LaneMask = std::uint32_t;
+
+    // The rays of a packet in a structure-of-arrays layout, so that
+    // the bounds of a node are tested against all lanes with the same
+    // (vectorizable) instructions. All rays of a packet have the same
+    // direction signs, hence the same near and far planes of each box.
+    template <std::size_t Width>
+    struct RayPacket
+    {
+        static_assert(Width > 0 && Width <= 32);
+
+        // Returns nullopt if the rays are more than Width or
+        // do not share the signs of their direction components.
+        static Optional<RayPacket> coherent(const std::span<const Ray> rays);
+
+        std::array<Float, Width> ox = {};
+        std::array<Float, Width> oy = {};
+        std::array<Float, Width> oz = {};
+        std::array<Float, Width> invDx = {};
+        std::array<Float, Width> invDy = {};
+        std::array<Float, Width> invDz = {};
+        // Must be kept equal to the tMax of the rays
+        // as they find hits.
+        std::array<Float, Width> tMax = {};
+        std::size_t dirIsNegative[3] = {};
+        // The lanes holding rays which are still traced.
+        LaneMask activeLanes = 0;
+    };
+
+    // Returns the subset of `lanes` whose rays hit `bounds`,
+    // with the same result as Bounds3::intersectP for each of them.
+    template <std::size_t Width>
+    LaneMask intersectBounds(const RayPacket<Width>& packet,
+                             const Bounds3f& bounds,
+                             const LaneMask lanes);
+
+    template <std::size_t Width>
+    Optional<RayPacket<Width>>
+    RayPacket<Width>::coherent(const std::span<const Ray> rays) {
+        if (rays.empty() || rays.size() > Width) {
+            return pbrt::nullopt;
+        }
+
+        RayPacket packet;
+        for (std::size_t i = 0; i < rays.size(); ++i) {
+            const Ray& ray = rays[i];
+            packet.ox[i] = ray.o.x;
+            packet.oy[i] = ray.o.y;
+            packet.oz[i] = ray.o.z;
+            packet.invDx[i] = 1.f / ray.d.x;
+            packet.invDy[i] = 1.f / ray.d.y;
+            packet.invDz[i] = 1.f / ray.d.z;
+            packet.tMax[i] = ray.tMax;
+
+            const std::size_t dirIsNegative[3] = {
+                packet.invDx[i] < 0.f ? 1u : 0u,
+                packet.invDy[i] < 0.f ? 1u : 0u,
+                packet.invDz[i] < 0.f ? 1u : 0u,
+            };
+            if (i == 0) {
+                std::copy_n(dirIsNegative, 3, packet.dirIsNegative);
+            }
+            else if (!std::equal(dirIsNegative,
+                                 dirIsNegative + 3,
+                                 packet.dirIsNegative))
+            {
+                return pbrt::nullopt;
+            }
+        }
+        packet.activeLanes = (LaneMask{1} << rays.size()) - 1;
+
+        return pbrt::make_optional(packet);
+    }
+
+    template <std::size_t Width>
+    LaneMask intersectBounds(const RayPacket<Width>& packet,
+                             const Bounds3f& bounds,
+                             const LaneMask lanes) {
+        constexpr auto k = 1.f + 2.f * gamma(3);
+
+        const std::size_t* const dirIsNeg = packet.dirIsNegative;
+        const Float nearX = bounds[dirIsNeg[0]].x;
+        const Float farX = bounds[1 - dirIsNeg[0]].x;
+        const Float nearY = bounds[dirIsNeg[1]].y;
+        const Float farY = bounds[1 - dirIsNeg[1]].y;
+        const Float nearZ = bounds[dirIsNeg[2]].z;
+        const Float farZ = bounds[1 - dirIsNeg[2]].z;
+
+        // All lanes are tested without branches, so that the loop is
+        // vectorized, and the inactive ones are masked off afterwards.
+        std::array<std::uint32_t, Width> isHit;
+        for (std::size_t i = 0; i < Width; ++i) {
+            const Float txMin = (nearX - packet.ox[i]) * packet.invDx[i];
+            const Float txMax = (farX - packet.ox[i]) * packet.invDx[i] * k;
+            const Float tyMin = (nearY - packet.oy[i]) * packet.invDy[i];
+            const Float tyMax = (farY - packet.oy[i]) * packet.invDy[i] * k;
+            const Float tzMin = (nearZ - packet.oz[i]) * packet.invDz[i];
+            const Float tzMax = (farZ - packet.oz[i]) * packet.invDz[i] * k;
+
+            const bool missesXY = (txMin > tyMax) | (tyMin > txMax);
+            Float tMin = txMin > tyMin ? txMin : tyMin;
+            Float tMax = txMax < tyMax ? txMax : tyMax;
+
+            const bool missesZ = (tMin > tzMax) | (tzMin > tMax);
+            tMin = tzMin > tMin ? tzMin : tMin;
+            tMax = tzMax < tMax ? tzMax : tMax;
+
+            isHit[i] = !missesXY & !missesZ & (tMin < packet.tMax[i]) &
+                       (tMax > 0.f);
+        }
+
+        LaneMask hits = 0;
+        for (std::size_t i = 0; i < Width; ++i) {
+            hits |= isHit[i] << i;
+        }
+
+        return hits & lanes;
+    }
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
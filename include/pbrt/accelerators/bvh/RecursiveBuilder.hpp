@@ -18,6 +18,11 @@ namespace idragnev::pbrt::accelerators::bvh {
 
         BuildResult operator()(memory::MemoryArena& arena,
                                const PrimsVec& prims) const;
+        // Builds with the bounds in `primsInfo`, one for each primitive
+        // in `prims`, instead of the world bounds of the primitives.
+        BuildResult operator()(memory::MemoryArena& arena,
+                               const PrimsVec& prims,
+                               std::vector<PrimitiveInfo> primsInfo) const;
 
     private:
         BuildTree buildSubtree(memory::MemoryArena& arena,
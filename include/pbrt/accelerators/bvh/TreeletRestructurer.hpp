@@ -0,0 +1,33 @@
+#pragma once
+
+#include "BVHBuilders.hpp"
+
+namespace idragnev::pbrt::accelerators::bvh {
+    // Post-build pass which restructures small treelets of a BuildTree
+    // toward minimal SAH cost (Karras and Aila, 2013).
+    // Interior nodes are processed bottom-up, in parallel. Each one
+    // becomes the root of a treelet of up to `treeletLeavesCount` leaves,
+    // formed by repeatedly expanding the treelet leaf with the largest
+    // surface area. The interior nodes of the treelet are then rearranged
+    // in the topology of minimal SAH cost, found by dynamic programming
+    // over the subsets of its leaves.
+    // More passes and bigger treelets yield cheaper trees at the expense
+    // of build time. Leaves are left intact, so the ordered primitives
+    // of the build remain valid.
+    class TreeletRestructurer
+    {
+    public:
+        static constexpr std::size_t MIN_TREELET_LEAVES = 3;
+        static constexpr std::size_t MAX_TREELET_LEAVES = 8;
+
+        TreeletRestructurer() = default;
+        TreeletRestructurer(const std::size_t passesCount,
+                            const std::size_t treeletLeavesCount = 7) noexcept;
+
+        void operator()(BuildTree& tree) const;
+
+    private:
+        std::size_t passesCount = 1;
+        std::size_t treeletLeavesCount = 7;
+    };
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
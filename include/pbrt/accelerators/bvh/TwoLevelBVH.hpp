@@ -0,0 +1,54 @@
+#pragma once
+
+#include "BVH.hpp"
+
+#include "pbrt/core/transformations/Transformation.hpp"
+
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace idragnev::pbrt::accelerators {
+    // A bottom-level BVH placed in the world by its own transformation.
+    // Many instances can share the same BVH.
+    struct BVHInstance
+    {
+        std::shared_ptr<const BVH> bvh;
+        Transformation instanceToWorld;
+    };
+
+    // A two-level acceleration structure - a top-level BVH over
+    // instances of bottom-level BVHs. The geometry of a bottom-level
+    // BVH is stored once, no matter how many instances reference it.
+    // The interactions refer to the primitives of the bottom-level
+    // BVHs, which are shared by their instances.
+    class TwoLevelBVH : public Aggregate
+    {
+    private:
+        class InstancePrimitive;
+
+    public:
+        TwoLevelBVH(const std::vector<BVHInstance>& instances,
+                    const bvh::SplitMethod m);
+        ~TwoLevelBVH();
+
+        Bounds3f worldBound() const override;
+
+        Optional<SurfaceInteraction>
+        intersect(const Ray& ray) const override;
+        bool intersectP(const Ray& ray) const override;
+
+        // Replaces the transformation of each instance, in the order
+        // they were given at construction, and refits the top-level BVH
+        // to the moved instances instead of building it again.
+        // Must not be called concurrently with intersection queries.
+        void updateTransformations(
+            const std::span<const Transformation> instanceToWorld);
+
+        const BVH& topLevelBVH() const noexcept;
+
+    private:
+        std::vector<std::shared_ptr<InstancePrimitive>> instances;
+        BVH topLevel;
+    };
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "pbrt/core/primitive/Primitive.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <span>
+
+namespace idragnev::pbrt::accelerators {
+    // A uniform grid over the world bounds of the primitives. Each cell
+    // lists the primitives whose bounds overlap it and rays walk the
+    // cells they pass through in order with a 3D-DDA, so queries stop
+    // at the first cell which holds a hit. It is cheaper to build than
+    // a BVH and suits dense, evenly distributed primitives - sparse
+    // scenes leave most cells empty and primitives crowded in few cells.
+    class Grid : public Aggregate
+    {
+    public:
+        // The grid has about `cellsPerPrimitive` cells for each primitive,
+        // with at most 256 cells along each axis.
+        explicit Grid(std::vector<std::shared_ptr<const Primitive>> primitives,
+                      const Float cellsPerPrimitive = 2.f);
+
+        Bounds3f worldBound() const override;
+
+        Optional<SurfaceInteraction>
+        intersect(const Ray& ray) const override;
+        bool intersectP(const Ray& ray) const override;
+
+        std::array<std::uint32_t, 3> resolution() const noexcept;
+
+    private:
+        std::uint32_t cellCoordinate(const Float p,
+                                     const std::size_t axis) const noexcept;
+        std::size_t cellIndex(const std::uint32_t x,
+                              const std::uint32_t y,
+                              const std::uint32_t z) const noexcept;
+        std::span<const std::uint32_t>
+        cellPrimitives(const std::size_t cell) const;
+
+        template <typename F>
+        void forEachOverlappedCell(const Bounds3f& primitiveBounds,
+                                   F&& f) const;
+        template <typename CellVisitor>
+        void walk(CellVisitor&& visitCell, const Ray& ray) const;
+
+    private:
+        std::vector<std::shared_ptr<const Primitive>> primitives;
+        Bounds3f bounds;
+        std::array<std::uint32_t, 3> cellsCounts = {0, 0, 0};
+        Vector3f cellSize;
+        Vector3f inverseCellSize;
+        // The primitives of cell `c` are at
+        // [cellOffsets[c], cellOffsets[c + 1]) in cellPrimitiveIndices
+        std::vector<std::uint32_t> cellOffsets;
+        std::vector<std::uint32_t> cellPrimitiveIndices;
+    };
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
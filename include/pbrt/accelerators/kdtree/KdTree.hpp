@@ -0,0 +1,54 @@
+#pragma once
+
+#include "pbrt/core/primitive/Primitive.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace idragnev::pbrt::accelerators {
+    namespace kdtree {
+        struct Node;
+    } // namespace kdtree
+
+    // A k-d tree over static primitives, which splits space by planes
+    // placed with the Surface Area Heuristic (SAH) instead of splitting
+    // the primitives like a BVH, so primitives overlapping a plane are
+    // referenced by both children. Rays visit the children front to
+    // back and stop at the first node which holds a hit.
+    class KdTree : public Aggregate
+    {
+    public:
+        // `maxDepth` = 0 limits the depth to 8 + 1.3 * log2(N)
+        // for N primitives, as pbrt does. Depths above 64 are clamped.
+        explicit KdTree(std::vector<std::shared_ptr<const Primitive>> prims,
+                        const Float intersectCost = 80.f,
+                        const Float traversalCost = 1.f,
+                        const Float emptyBonus = 0.5f,
+                        const std::uint32_t maxPrimitivesInNode = 1,
+                        const std::uint32_t maxDepth = 0);
+        ~KdTree();
+
+        Bounds3f worldBound() const override;
+
+        Optional<SurfaceInteraction>
+        intersect(const Ray& ray) const override;
+        bool intersectP(const Ray& ray) const override;
+
+        std::size_t nodesCount() const noexcept;
+
+    private:
+        template <typename PrimitiveVisitor>
+        void traverse(PrimitiveVisitor&& visitPrimitive,
+                      const Ray& ray) const;
+
+    private:
+        std::vector<std::shared_ptr<const Primitive>> primitives;
+        Bounds3f bounds;
+        // In depth-first order, so the child below the split plane
+        // of an interior node follows it
+        std::vector<kdtree::Node> nodes;
+        // The primitives of the leaves with more than one primitive
+        std::vector<std::uint32_t> primitiveIndices;
+    };
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "core.hpp"
+#include "EFloat.hpp"
+
+#include <cmath>
+
+namespace idragnev::pbrt {
+    // A floating-point value with a bound of its absolute error, like
+    // EFloat. The bound is computed in plain floating-point arithmetic
+    // from first-order error terms and is scaled up to account for its
+    // own rounding, instead of rounding an interval outwards after
+    // every operation, which makes it several times cheaper than
+    // EFloat but also slightly looser.
+    class FastEFloat
+    {
+    public:
+        FastEFloat() = default;
+        FastEFloat(const Float v, const Float err = 0.f) noexcept
+            : v(v)
+            , err(err) {}
+
+        explicit operator Float() const noexcept { return v; }
+
+        Float absoluteError() const noexcept { return err; }
+
+        FastEFloat operator-() const noexcept { return FastEFloat{-v, err}; }
+
+        FastEFloat operator+(const FastEFloat& rhs) const noexcept {
+            const Float sum = v + rhs.v;
+            return FastEFloat{sum,
+                              ErrorScale *
+                                  (err + rhs.err + gamma(1) * std::abs(sum))};
+        }
+
+        FastEFloat operator-(const FastEFloat& rhs) const noexcept {
+            return *this + (-rhs);
+        }
+
+        FastEFloat operator*(const FastEFloat& rhs) const noexcept {
+            const Float product = v * rhs.v;
+            return FastEFloat{
+                product,
+                ErrorScale * (std::abs(v) * rhs.err + std::abs(rhs.v) * err +
+                              err * rhs.err + gamma(1) * std::abs(product))};
+        }
+
+        // The error is infinite when `rhs` may be zero
+        FastEFloat operator/(const FastEFloat& rhs) const noexcept {
+            const Float quotient = v / rhs.v;
+            const Float rhsAbs = std::abs(rhs.v);
+            if (rhsAbs <= rhs.err) {
+                return FastEFloat{quotient, constants::Infinity};
+            }
+
+            return FastEFloat{
+                quotient,
+                ErrorScale *
+                    ((rhsAbs * err + std::abs(v) * rhs.err) /
+                         (rhsAbs * (rhsAbs - rhs.err)) +
+                     gamma(1) * std::abs(quotient))};
+        }
+
+    private:
+        // Bounds the rounding of the few operations
+        // which compute the error of a result
+        static constexpr Float ErrorScale = 1.f + gamma(8);
+
+        Float v = 0.f;
+        Float err = 0.f;
+    };
+
+    inline FastEFloat operator*(const Float lhs, const FastEFloat& rhs) {
+        return FastEFloat{lhs} * rhs;
+    }
+    inline FastEFloat operator+(const Float lhs, const FastEFloat& rhs) {
+        return FastEFloat{lhs} + rhs;
+    }
+    inline FastEFloat operator-(const Float lhs, const FastEFloat& rhs) {
+        return FastEFloat{lhs} - rhs;
+    }
+
+    FastEFloat sqrt(const FastEFloat& fe);
+
+    // The roots of a quadratic equation with FastEFloat coefficients
+    struct FastQuadraticRoots
+    {
+        // Set when the error bounds are too wide to tell whether the
+        // equation has roots or what the signs of the roots are.
+        // The equation must be solved with EFloat then.
+        bool isAmbiguous = false;
+        Optional<QuadraticRoots> roots = pbrt::nullopt;
+    };
+
+    FastQuadraticRoots solveQuadratic(const FastEFloat& a,
+                                      const FastEFloat& b,
+                                      const FastEFloat& c);
+} // namespace idragnev::pbrt
\ No newline at end of file
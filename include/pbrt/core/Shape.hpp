@@ -11,6 +11,22 @@ namespace idragnev::pbrt {
         SurfaceInteraction interaction;
     };
 
+    // A hit found by the first phase of the two-phase intersection
+    // of a shape, with what the shape needs to compute its interaction
+    // in the second phase
+    struct ShapeHit
+    {
+        Float t = constants::Infinity;
+        // The object space hit point of quadrics
+        Point3f pObject;
+        // The error bound of pObject, for the quadrics
+        // which bound it with the ray
+        Vector3f pError;
+        Float phi = 0.f;
+        // The barycentric coordinates of triangle hits
+        Float barycentric[3] = {};
+    };
+
     class Shape
     {
     public:
@@ -22,8 +38,20 @@ namespace idragnev::pbrt {
         virtual Bounds3f objectBound() const = 0;
         virtual Bounds3f worldBound() const;
 
-        virtual Optional<HitRecord>
-        intersect(const Ray& ray, const bool testAlphaTexture = true) const = 0;
+        // Two-phase intersection: intersectHit finds the closest hit
+        // of the ray in (0, ray.tMax] without computing its interaction
+        // and computeInteraction computes the interaction of a hit found
+        // for the same ray. Aggregates compute only the interaction of
+        // the closest of the hits they find.
+        virtual Optional<ShapeHit>
+        intersectHit(const Ray& ray,
+                     const bool testAlphaTexture = true) const = 0;
+        virtual SurfaceInteraction
+        computeInteraction(const Ray& ray, const ShapeHit& hit) const = 0;
+
+        // Both phases of the intersection
+        Optional<HitRecord> intersect(const Ray& ray,
+                                      const bool testAlphaTexture = true) const;
 
         virtual bool intersectP(const Ray& ray,
                                 const bool testAlphaTexture = true) const;
@@ -58,6 +58,7 @@ namespace idragnev::pbrt {
     class Quaternion;
     struct TRS;
     class AnimatedTransformation;
+    struct LinearMotionBounds;
 
     class Interaction;
     class SurfaceInteraction;
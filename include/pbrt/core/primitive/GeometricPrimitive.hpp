@@ -21,14 +21,23 @@ namespace idragnev::pbrt {
         intersect(const Ray& ray) const override;
         bool intersectP(const Ray& ray) const override;
 
+        Optional<PrimitiveHit> intersectHit(const Ray& ray) const override;
+        SurfaceInteraction
+        computeInteraction(const Ray& ray, PrimitiveHit&& hit) const override;
+
         const AreaLight* areaLight() const override;
         const Material* material() const override;
+        const Shape& shape() const noexcept;
         void computeScatteringFunctions(
             SurfaceInteraction& interaction,
             memory::MemoryArena& arena,
             const TransportMode mode,
             const bool allowMultipleLobes) const override;
 
+    private:
+        void completeInteraction(SurfaceInteraction& interaction,
+                                 const Ray& ray) const;
+
     private:
         std::shared_ptr<const Shape> _shape = nullptr;
         std::shared_ptr<const Material> _material = nullptr;
@@ -2,21 +2,44 @@
 
 #include "pbrt/core/core.hpp"
 #include "pbrt/core/Optional.hpp"
+#include "pbrt/core/Shape.hpp"
 
 #include "pbrt/memory/MemoryArena.hpp"
 
+#include <span>
+
 namespace idragnev::pbrt {
+    // A hit found by Primitive::intersectHit. Primitives which do not
+    // split their intersection in two phases compute the interaction
+    // right away.
+    struct PrimitiveHit
+    {
+        ShapeHit shapeHit;
+        Optional<SurfaceInteraction> interaction = pbrt::nullopt;
+    };
+
     class Primitive
     {
     public:
         virtual ~Primitive() = default;
 
         virtual Bounds3f worldBound() const = 0;
+        // The default implementation is for primitives
+        // which do not move - bounded by worldBound() at any time.
+        virtual LinearMotionBounds motionBounds(const Intervalf& time) const;
 
         virtual Optional<SurfaceInteraction>
         intersect(const Ray& r) const = 0;
         virtual bool intersectP(const Ray& r) const = 0;
 
+        // Two-phase intersection, see Shape::intersectHit.
+        // intersectHit updates r.tMax as intersect does and
+        // computeInteraction completes a hit it found for the same ray.
+        // The default implementations run intersect in the first phase.
+        virtual Optional<PrimitiveHit> intersectHit(const Ray& r) const;
+        virtual SurfaceInteraction computeInteraction(const Ray& r,
+                                                      PrimitiveHit&& hit) const;
+
         virtual const AreaLight* areaLight() const = 0;
         virtual const Material* material() const = 0;
         virtual void
@@ -29,6 +52,19 @@ namespace idragnev::pbrt {
     class Aggregate : public Primitive
     {
     public:
+        using Primitive::intersect;
+        using Primitive::intersectP;
+
+        // Batched versions of intersect and intersectP for independent
+        // rays. The result for rays[i] is written at position i and
+        // rays[i].tMax is updated as with a single ray.
+        // The default implementations trace the rays one by one.
+        virtual void
+        intersect(const std::span<const Ray> rays,
+                  const std::span<Optional<SurfaceInteraction>> hits) const;
+        virtual void intersectP(const std::span<const Ray> rays,
+                                const std::span<bool> occluded) const;
+
         // must never be called
         const AreaLight* areaLight() const override;
         const Material* material() const override;
@@ -13,6 +13,7 @@ namespace idragnev::pbrt {
                              const AnimatedTransformation& primitiveToWorld);
 
         Bounds3f worldBound() const override;
+        LinearMotionBounds motionBounds(const Intervalf& time) const override;
 
         Optional<SurfaceInteraction>
         intersect(const Ray& ray) const override;
@@ -1,9 +1,19 @@
 #pragma once
 
 #include "pbrt/core/core.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
 #include "TRS.hpp"
 
 namespace idragnev::pbrt {
+    // Bounds at the start and at the end of a time interval
+    // whose linear interpolation bounds a moving object
+    // at any time within the interval.
+    struct LinearMotionBounds
+    {
+        Bounds3f start;
+        Bounds3f end;
+    };
+
     class AnimatedTransformation
     {
     private:
@@ -35,6 +45,8 @@ namespace idragnev::pbrt {
         Transformation interpolate(const Float time) const;
 
         Bounds3f motionBounds(const Bounds3f& b) const;
+        LinearMotionBounds linearMotionBounds(const Bounds3f& b,
+                                              const Intervalf& time) const;
 
         Ray operator()(const Ray& r) const;
         RayDifferential operator()(const RayDifferential& r) const;
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace idragnev::pbrt::memory {
+    // A read-only view of the contents of a file. The file is mapped
+    // into memory where the platform supports it, so only the pages
+    // which are accessed are read and the OS can evict them under
+    // memory pressure. Otherwise the whole file is read into memory.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        // Check isOpen() to see whether opening the file succeeded.
+        // Opening empty files fails.
+        explicit MappedFile(const std::filesystem::path& path);
+        ~MappedFile();
+
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool isOpen() const noexcept { return address != nullptr; }
+        // Empty if the file is not open. The contents are aligned
+        // at least to L1 cache line boundary.
+        std::span<const std::byte> bytes() const noexcept;
+
+    private:
+        void close() noexcept;
+
+    private:
+        void* address = nullptr;
+        std::size_t size = 0;
+    };
+} // namespace idragnev::pbrt::memory
\ No newline at end of file
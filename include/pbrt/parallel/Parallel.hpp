@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <mutex>
 #include <condition_variable>
@@ -31,4 +33,20 @@ namespace idragnev::pbrt::parallel {
     void parallelFor2D(std::function<void(std::int64_t, std::int64_t)> func,
                        const std::int64_t nX,
                        const std::int64_t nY);
+
+    // Calls `func(first, last)` in parallel for the consecutive ranges
+    // of at most `rangeSize` iterations which [0, count) is split into,
+    // so that the loop over a range is not behind a std::function call
+    template <typename F>
+    void parallelForRanges(F&& func,
+                           const std::size_t count,
+                           const std::size_t rangeSize) {
+        const std::size_t rangesCount = (count + rangeSize - 1) / rangeSize;
+        parallelFor(
+            [&func, count, rangeSize](const std::int64_t range) {
+                const auto first = static_cast<std::size_t>(range) * rangeSize;
+                func(first, std::min(first + rangeSize, count));
+            },
+            static_cast<std::int64_t>(rangesCount));
+    }
 } // namespace idragnev::pbrt::parallel
\ No newline at end of file
@@ -16,8 +16,11 @@ namespace idragnev::pbrt::shapes {
 
         Bounds3f objectBound() const override;
 
-        Optional<HitRecord>
-        intersect(const Ray& ray, const bool testAlphaTexture) const override;
+        Optional<ShapeHit>
+        intersectHit(const Ray& ray,
+                     const bool testAlphaTexture) const override;
+        SurfaceInteraction
+        computeInteraction(const Ray& ray, const ShapeHit& hit) const override;
 
         bool intersectP(const Ray& ray,
                         const bool testAlphaTexture) const override;
@@ -28,16 +31,19 @@ namespace idragnev::pbrt::shapes {
         template <typename R, typename S, typename F>
         R intersectImpl(const Ray& ray, F failure, S success) const;
 
-        HitRecord makeHitRecord(const RayWithErrorBound& ray,
-                                const Point3f& hitPoint,
-                                const EFloat& t,
-                                const Float phi) const;
-
         Optional<QuadraticRoots>
         findIntersectionParams(const Ray& ray,
                                const Vector3f& oErr,
                                const Vector3f& dErr) const;
+        template <typename EFloatT>
+        auto solveIntersectionEquation(const Ray& ray,
+                                       const Vector3f& oErr,
+                                       const Vector3f& dErr) const;
+
+        static Vector3f computeHitPointError(const RayWithErrorBound& ray,
+                                             const EFloat& t);
 
+        bool isClipped(const Point3f& hitPoint) const;
         static Float computePhi(const Point3f& hitPoint);
 
     private:
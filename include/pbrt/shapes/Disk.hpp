@@ -17,8 +17,11 @@ namespace idragnev::pbrt::shapes {
 
         Bounds3f objectBound() const override;
 
-        Optional<HitRecord>
-        intersect(const Ray& ray, const bool testAlphaTexture) const override;
+        Optional<ShapeHit>
+        intersectHit(const Ray& ray,
+                     const bool testAlphaTexture) const override;
+        SurfaceInteraction
+        computeInteraction(const Ray& ray, const ShapeHit& hit) const override;
 
         bool intersectP(const Ray& ray,
                         const bool testAlphaTexture) const override;
@@ -31,12 +34,6 @@ namespace idragnev::pbrt::shapes {
 
         static Float computePhi(const Point3f& hitPoint);
 
-        HitRecord makeHitRecord(const Ray& ray,
-                                const Point3f& hitPoint,
-                                const EFloat& t,
-                                const Float phi,
-                                const Float distToCenterSquared) const;
-
     private:
         Float height;
         Float radius;
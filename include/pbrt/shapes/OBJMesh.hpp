@@ -0,0 +1,29 @@
+#pragma once
+
+#include "pbrt/core/core.hpp"
+#include "pbrt/core/Optional.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace idragnev::pbrt::shapes {
+    // Loads the faces of a Wavefront OBJ file as the triangles of one
+    // mesh created with createTriangles. Only the v, vt, vn and f
+    // statements are read; groups, objects and materials are ignored.
+    // Faces of more than three vertices are split into fans of
+    // triangles. The texture coordinates and the normals are kept only
+    // if every face corner refers to them.
+    // The file is split into chunks at line boundaries which are parsed
+    // in parallel, so parallel::init must have been called.
+    // Returns pbrt::nullopt if the file can not be read, is malformed
+    // or has no faces.
+    Optional<std::vector<std::shared_ptr<Shape>>>
+    loadOBJMesh(const std::filesystem::path& path,
+                const Transformation& objectToWorld,
+                const Transformation& worldToObject,
+                const bool reverseOrientation,
+                std::shared_ptr<const Texture<Float>> alphaMask = nullptr,
+                std::shared_ptr<const Texture<Float>> shadowAlphaMask =
+                    nullptr);
+} // namespace idragnev::pbrt::shapes
\ No newline at end of file
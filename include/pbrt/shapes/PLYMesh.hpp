@@ -0,0 +1,32 @@
+#pragma once
+
+#include "pbrt/core/core.hpp"
+#include "pbrt/core/Optional.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace idragnev::pbrt::shapes {
+    // Loads the triangles of a binary (little or big endian) PLY file
+    // as a mesh created with createTriangles.
+    // The "vertex" element must have the x, y and z properties and
+    // may have nx, ny and nz normals and u and v texture coordinates
+    // (also named s and t, texture_u and texture_v or texture_s and
+    // texture_t). The "face" element must have a vertex_indices
+    // (or vertex_index) list and may have face_indices. Faces of more
+    // than three vertices are split into fans of triangles.
+    // The file is memory mapped and the vertices and faces are
+    // converted from it straight into the mesh in parallel,
+    // so parallel::init must have been called.
+    // Returns pbrt::nullopt if the file can not be read, is an ASCII
+    // PLY file or is malformed.
+    Optional<std::vector<std::shared_ptr<Shape>>>
+    loadPLYMesh(const std::filesystem::path& path,
+                const Transformation& objectToWorld,
+                const Transformation& worldToObject,
+                const bool reverseOrientation,
+                std::shared_ptr<const Texture<Float>> alphaMask = nullptr,
+                std::shared_ptr<const Texture<Float>> shadowAlphaMask =
+                    nullptr);
+} // namespace idragnev::pbrt::shapes
\ No newline at end of file
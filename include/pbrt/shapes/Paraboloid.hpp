@@ -4,7 +4,7 @@
 #include "pbrt/core/Shape.hpp"
 
 namespace idragnev::pbrt::shapes {
-    class Paraboloid : Shape
+    class Paraboloid : public Shape
     {
     public:
         Paraboloid(const Transformation& objectToWorld,
@@ -17,8 +17,11 @@ namespace idragnev::pbrt::shapes {
 
         Bounds3f objectBound() const override;
 
-        Optional<HitRecord>
-        intersect(const Ray& ray, const bool testAlphaTexture) const override;
+        Optional<ShapeHit>
+        intersectHit(const Ray& ray,
+                     const bool testAlphaTexture) const override;
+        SurfaceInteraction
+        computeInteraction(const Ray& ray, const ShapeHit& hit) const override;
 
         bool intersectP(const Ray& ray,
                         const bool testAlphaTexture) const override;
@@ -29,19 +32,19 @@ namespace idragnev::pbrt::shapes {
         template <typename R, typename S, typename F>
         R intersectImpl(const Ray& ray, F failure, S success) const;
 
-        HitRecord makeHitRecord(const RayWithErrorBound& rayWithErrBound,
-                                const Point3f& hitPoint,
-                                const EFloat& t,
-                                const Float phi) const;
-
         Optional<QuadraticRoots>
         findIntersectionParams(const Ray& ray,
                                const Vector3f& oErr,
                                const Vector3f& dErr) const;
+        template <typename EFloatT>
+        auto solveIntersectionEquation(const Ray& ray,
+                                       const Vector3f& oErr,
+                                       const Vector3f& dErr) const;
 
-        Vector3f computeHitPointError(const RayWithErrorBound& ray,
-                                      const EFloat& t) const;
+        static Vector3f computeHitPointError(const RayWithErrorBound& ray,
+                                             const EFloat& t);
 
+        bool isClipped(const Point3f& hitPoint) const;
         static Float computePhi(const Point3f& hitPoint);
 
     private:
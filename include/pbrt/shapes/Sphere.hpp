@@ -17,8 +17,11 @@ namespace idragnev::pbrt::shapes {
 
         Bounds3f objectBound() const override;
 
-        Optional<HitRecord>
-        intersect(const Ray& ray, const bool testAlphaTexture) const override;
+        Optional<ShapeHit>
+        intersectHit(const Ray& ray,
+                     const bool testAlphaTexture) const override;
+        SurfaceInteraction
+        computeInteraction(const Ray& ray, const ShapeHit& hit) const override;
 
         bool intersectP(const Ray& ray,
                         const bool testAlphaTexture) const override;
@@ -29,18 +32,18 @@ namespace idragnev::pbrt::shapes {
         template <typename R, typename S, typename F>
         R intersectImpl(const Ray& ray, F failure, S success) const;
 
-        HitRecord makeHitRecord(const Ray& ray,
-                                const Point3f& hitPoint,
-                                const EFloat& t,
-                                const Float phi) const;
-
         Optional<QuadraticRoots>
         findIntersectionParams(const Ray& ray,
                                const Vector3f& oErr,
                                const Vector3f& dErr) const;
+        template <typename EFloatT>
+        auto solveIntersectionEquation(const Ray& ray,
+                                       const Vector3f& oErr,
+                                       const Vector3f& dErr) const;
 
         Point3f computeHitPoint(const Ray& ray, const EFloat& t) const;
 
+        bool isClipped(const Point3f& hitPoint) const;
         static Float computePhi(const Point3f& hitPoint);
 
     private:
@@ -6,117 +6,249 @@
 #include <vector>
 #include <memory>
 #include <array>
+#include <span>
 
 namespace idragnev::pbrt::shapes {
-    struct TriangleMesh
-    {
-        TriangleMesh(
-            const Transformation& objectToWorld,
-            const unsigned trianglesCount,
-            const std::vector<std::size_t>& vertexIndices,
-            const std::vector<Point3f>& vertexCoordinates,
-            const std::vector<Vector3f>& vertexTangentVectors,
-            const std::vector<Normal3f>& vertexNormalVectors,
-            const std::vector<Point2f>& vertexUVs,
-            std::shared_ptr<const Texture<Float>> alphaMask,
-            std::shared_ptr<const Texture<Float>> shadowAlphaMask,
-            const std::vector<std::size_t>& faceIndices);
+    struct TriangleMesh;
 
-        unsigned trianglesCount = 0;
-        unsigned verticesCount = 0;
-        std::vector<std::size_t> vertexIndices;
-        std::vector<Point3f> vertexWorldCoordinates;
-        std::vector<Normal3f> vertexNormalVectors;
-        std::vector<Vector3f> vertexTangentVectors;
-        std::vector<Point2f> vertexUVs;
-        std::shared_ptr<const Texture<Float>> alphaMask;
-        std::shared_ptr<const Texture<Float>> shadowAlphaMask;
-        std::vector<std::size_t> faceIndices;
+    // The parametric distance and the barycentric coordinates
+    // of a ray-triangle intersection.
+    struct TriangleHit
+    {
+        Float t = 0.f;
+        Float barycentric[3] = {};
     };
 
+    // Watertight ray-triangle intersection test against
+    // the world space vertices `p0`, `p1` and `p2`.
+    // Only hits in (0, ray.tMax] are reported.
+    Optional<TriangleHit> intersectTriangle(const Ray& ray,
+                                            const Point3f& p0,
+                                            const Point3f& p1,
+                                            const Point3f& p2);
+
+    // The hit of Triangle::intersectHit for a hit of intersectTriangle,
+    // for accelerators which intersect the vertices of triangles
+    ShapeHit toShapeHit(const TriangleHit& hit) noexcept;
+
+    // A lightweight handle to a triangle of a TriangleMesh.
+    // The handles are stored in their mesh and share its ownership,
+    // see createTriangleMesh.
     class Triangle : public Shape
     {
     private:
+        // renumbers the triangles when it reorders them
+        friend struct TriangleMesh;
+
         struct PartialDerivatives
         {
             Vector3f dpdu;
             Vector3f dpdv;
         };
 
-        struct RayCoordinateSpaceVertices
-        {
-            Point3f p0;
-            Point3f p1;
-            Point3f p2;
-            Float sz;
-        };
-
     public:
         Triangle(const Transformation& objectToWorld,
                  const Transformation& worldToObject,
                  const bool reverseOrientaton,
-                 std::shared_ptr<const TriangleMesh> parentMesh,
-                 const unsigned number);
+                 const TriangleMesh& parentMesh,
+                 const std::uint32_t number);
 
         Bounds3f objectBound() const override;
         Bounds3f worldBound() const override;
 
-        Optional<HitRecord>
-        intersect(const Ray& ray, const bool testAlphaTexture) const override;
+        Optional<ShapeHit>
+        intersectHit(const Ray& ray,
+                     const bool testAlphaTexture) const override;
+        SurfaceInteraction
+        computeInteraction(const Ray& ray, const ShapeHit& hit) const override;
 
         bool intersectP(const Ray& ray,
                         const bool testAlphaTexture) const override;
 
         Float area() const override;
 
-    private:
-        template <typename R, typename S, typename F>
-        R intersectImpl(const Ray& ray,
-                        const bool testAlphaTexture,
-                        F failure,
-                        S success) const;
+        // Used by accelerators which store the vertices of
+        // triangles next to their nodes to intersect them directly.
+        std::array<Point3f, 3> worldVertices() const;
+        bool hasAlphaMask() const noexcept;
+        bool isDegenerate() const;
+
+        const TriangleMesh& mesh() const noexcept;
+        std::uint32_t numberInMesh() const noexcept;
 
+    private:
         Optional<PartialDerivatives> computePartialDerivatives() const;
+        bool passesAlphaTest(const Ray& ray, const TriangleHit& hit) const;
 
-        HitRecord makeHitRecord(const Ray& ray,
-                                const Float t,
-                                const Point3f& hitPoint,
-                                const Vector3f& pError,
-                                const Point2f& hitPointUV,
-                                const PartialDerivatives& derivatives,
-                                const Float barycentric[3]) const;
         void setShadingGeometry(SurfaceInteraction& interaction,
                                 const Float barycentric[3]) const;
 
+        std::array<std::uint32_t, 3> vertexIndices() const noexcept;
         std::tuple<const Point3f&, const Point3f&, const Point3f&>
         verticesCoordinates() const;
         std::array<Point2f, 3> verticesUVs() const;
 
-        // shears only the x and y dimensions
-        RayCoordinateSpaceVertices
-        verticesInRayCoordinateSpace(const Ray& ray) const;
+    private:
+        // declared first so that it can be placed in the tail padding
+        // of Shape
+        std::uint32_t number = 0;
+        const TriangleMesh* parentMesh = nullptr;
+    };
+
+    // The vertex indices of a mesh, stored in 16 bits per index
+    // when the mesh has at most 2^16 vertices and in 32 bits otherwise
+    class TriangleVertexIndices
+    {
+    public:
+        TriangleVertexIndices() = default;
+        TriangleVertexIndices(std::vector<std::uint32_t> indices,
+                              const std::size_t verticesCount);
+        // `indicesCount` zero indices, to be written with set
+        TriangleVertexIndices(const std::size_t indicesCount,
+                              const std::size_t verticesCount);
+
+        std::array<std::uint32_t, 3>
+        ofTriangle(const std::uint32_t triangle) const noexcept;
 
-        static std::array<Float, 3> edgeFunctionValues(const Point3f& p0,
-                                                       const Point3f& p1,
-                                                       const Point3f& p2);
+        // `index` must be less than the vertices count
+        void set(const std::size_t i, const std::uint32_t index) noexcept;
+
+        std::size_t size() const noexcept;
+        std::size_t bytesPerIndex() const noexcept;
 
     private:
-        std::shared_ptr<const TriangleMesh> parentMesh = nullptr;
-        const std::size_t* firstVertexIndexAddress = nullptr;
-        std::size_t faceIndex = 0;
+        std::vector<std::uint16_t> indices16;
+        std::vector<std::uint32_t> indices32;
+    };
+
+    // A unit vector quantized to 16 bits per coordinate of its projection
+    // onto the octahedron |x| + |y| + |z| = 1, unfolded onto a square
+    struct OctahedralVector
+    {
+        std::uint16_t x = 0;
+        std::uint16_t y = 0;
+    };
+
+    // The optional vertex and face attributes of a mesh
+    // which mesh loaders write in place
+    struct TriangleMeshAttributes
+    {
+        bool normals = false;
+        bool uvs = false;
+        bool faceIndices = false;
+    };
+
+    struct TriangleMesh
+    {
+        TriangleMesh(
+            const Transformation& objectToWorld,
+            const unsigned trianglesCount,
+            std::vector<std::uint32_t> vertexIndices,
+            const std::vector<Point3f>& vertexCoordinates,
+            const std::vector<Vector3f>& vertexTangentVectors,
+            const std::vector<Normal3f>& vertexNormalVectors,
+            const std::vector<Point2f>& vertexUVs,
+            std::shared_ptr<const Texture<Float>> alphaMask,
+            std::shared_ptr<const Texture<Float>> shadowAlphaMask,
+            std::vector<std::uint32_t> faceIndices);
+        // Allocates the storage of a mesh of `verticesCount` vertices
+        // with the `attributes`, all zero, so that mesh loaders
+        // write the world space vertices in place.
+        TriangleMesh(const unsigned trianglesCount,
+                     const unsigned verticesCount,
+                     const TriangleMeshAttributes& attributes,
+                     std::shared_ptr<const Texture<Float>> alphaMask,
+                     std::shared_ptr<const Texture<Float>> shadowAlphaMask);
+
+        // the triangles point to their mesh
+        TriangleMesh(const TriangleMesh&) = delete;
+        TriangleMesh& operator=(const TriangleMesh&) = delete;
+
+        std::uint32_t faceIndex(const std::uint32_t triangle) const noexcept;
+
+        // Replaces the normals and the tangent vectors with octahedral
+        // vectors and the texture coordinates with 16-bit offsets in
+        // their bounds, which shrinks them from 32 to 12 bytes per vertex.
+        // The positions stay exact for the intersection tests.
+        // The attributes are decoded only for the shading geometry,
+        // with directions off by less than 1e-4 radians and texture
+        // coordinates off by less than 1 / 131070 of their bounds.
+        // Normals and tangent vectors are normalized and zero ones
+        // become (0, 0, 1). Must be called before the triangles are
+        // intersected.
+        void quantizeVertexAttributes();
+
+        // Renumbers the triangles in the order of `triangleOrder`,
+        // followed by those which are not in it, and the vertices
+        // in the order in which the renumbered triangles first use them,
+        // so that triangles which are accessed one after another
+        // have their data close in memory. The triangles created by
+        // createTriangles keep their addresses and their vertices.
+        // Must not be called concurrently with intersection tests.
+        void reorder(const std::span<const std::uint32_t> triangleOrder);
+
+        // The bytes of the mesh with its triangles
+        std::size_t memoryUsage() const noexcept;
+
+        bool hasNormals() const noexcept;
+        bool hasTangentVectors() const noexcept;
+        bool hasUVs() const noexcept;
+        // Decode the quantized attributes, if they are quantized
+        Normal3f vertexNormal(const std::uint32_t vertex) const noexcept;
+        Vector3f vertexTangentVector(const std::uint32_t vertex) const noexcept;
+        Point2f vertexUV(const std::uint32_t vertex) const noexcept;
+
+        unsigned trianglesCount = 0;
+        unsigned verticesCount = 0;
+        TriangleVertexIndices vertexIndices;
+        std::vector<Point3f> vertexWorldCoordinates;
+        std::vector<Normal3f> vertexNormalVectors;
+        std::vector<Vector3f> vertexTangentVectors;
+        std::vector<Point2f> vertexUVs;
+        // Replace the attributes above once they are quantized
+        bool isQuantized = false;
+        std::vector<OctahedralVector> quantizedNormals;
+        std::vector<OctahedralVector> quantizedTangentVectors;
+        std::vector<std::array<std::uint16_t, 2>> quantizedUVs;
+        // uv = uvOrigin + quantizedUV * uvScale, per coordinate
+        std::array<Float, 2> uvOrigin = {};
+        std::array<Float, 2> uvScale = {};
+        std::shared_ptr<const Texture<Float>> alphaMask;
+        std::shared_ptr<const Texture<Float>> shadowAlphaMask;
+        std::vector<std::uint32_t> faceIndices;
+        std::vector<Triangle> triangles;
     };
 
+    // Creates a mesh which holds the triangles and returns the triangles.
+    // They share the ownership of the mesh, so it is allocated once
+    // instead of once per triangle.
+
     std::vector<std::shared_ptr<Shape>> createTriangleMesh(
         const Transformation& objectToWorld,
         const Transformation& worldToObject,
         const bool reverseOrientation,
         const unsigned trianglesCount,
-        const std::vector<std::size_t>& vertexIndices,
+        std::vector<std::uint32_t> vertexIndices,
         const std::vector<Point3f>& vertexCoordinates,
         const std::vector<Vector3f>& vertexTangentVectors,
         const std::vector<Normal3f>& vertexNormalVectors,
         const std::vector<Point2f>& vertexUVs,
         std::shared_ptr<const Texture<Float>> alphaMask,
         std::shared_ptr<const Texture<Float>> shadowAlphaMask,
-        const std::vector<std::size_t>& faceIndices);
+        std::vector<std::uint32_t> faceIndices);
+
+    // Reorders each of `meshes` so that its triangles are numbered
+    // in the order in which they are in `triangles`, see
+    // TriangleMesh::reorder. The triangles of other meshes are skipped.
+    void reorderTriangleMeshes(
+        const std::span<const Triangle* const> triangles,
+        const std::span<const std::shared_ptr<TriangleMesh>> meshes);
+
+    // Creates the triangles of `mesh` once its attributes are written.
+    // Like those of createTriangleMesh, they share its ownership.
+    std::vector<std::shared_ptr<Shape>>
+    createTriangles(const std::shared_ptr<TriangleMesh>& mesh,
+                    const Transformation& objectToWorld,
+                    const Transformation& worldToObject,
+                    const bool reverseOrientation);
 } // namespace idragnev::pbrt::shapes
\ No newline at end of file
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "pbrt/core/core.hpp"
+#include "pbrt/core/Optional.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/math/Point3.hpp"
+#include "pbrt/core/math/Vector3.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+namespace idragnev::pbrt::shapes {
+    // The world space vertices of up to Width triangles in
+    // a structure-of-arrays layout, so that a ray is tested against
+    // all of them with the same (vectorizable) instructions.
+    template <std::size_t Width>
+    struct TrianglePacket
+    {
+        static_assert(Width > 0 && Width <= 32);
+
+        static constexpr std::size_t width = Width;
+
+        void set(const std::size_t lane,
+                 const Point3f& p0,
+                 const Point3f& p1,
+                 const Point3f& p2) noexcept;
+        std::array<Point3f, 3> vertices(const std::size_t lane) const noexcept;
+
+        // Indexed by vertex, dimension and lane.
+        std::array<Float, Width> p[3][3] = {};
+        // The lanes [0, count) hold triangles, the rest are never hit.
+        std::uint32_t count = 0;
+    };
+
+    struct TrianglePacketHit
+    {
+        std::uint32_t lane = 0;
+        TriangleHit hit;
+    };
+
+    // Returns the closest of the hits which intersectTriangle
+    // reports for the triangles of `packet`. The edge functions
+    // of all lanes are evaluated in single precision and the few lanes
+    // on which the ray passes exactly through an edge or a vertex
+    // are retested with intersectTriangle, so the test stays watertight.
+    template <std::size_t Width>
+    Optional<TrianglePacketHit>
+    intersectTriangles(const Ray& ray, const TrianglePacket<Width>& packet);
+
+    template <std::size_t Width>
+    bool intersectsAnyTriangle(const Ray& ray,
+                               const TrianglePacket<Width>& packet);
+
+    namespace detail {
+        template <std::size_t Width>
+        struct TrianglePacketLanes
+        {
+            std::array<Float, Width> e0;
+            std::array<Float, Width> e1;
+            std::array<Float, Width> e2;
+            std::array<Float, Width> invDet;
+            std::array<Float, Width> t;
+            // Bit i is set if lane i is hit
+            std::uint32_t hits = 0;
+            // Bit i is set if lane i must be retested with
+            // the double precision edge functions
+            std::uint32_t edgeLanes = 0;
+        };
+
+        inline Float maxAbs(const Float a, const Float b, const Float c) {
+            return std::max(std::abs(a), std::max(std::abs(b), std::abs(c)));
+        }
+
+        // The same computations as intersectTriangle, for all lanes
+        template <std::size_t Width>
+        TrianglePacketLanes<Width>
+        intersectLanes(const Ray& ray, const TrianglePacket<Width>& packet) {
+            const auto kz = maxDimension(abs(ray.d));
+            const auto kx = (kz + 1 < 3) ? kz + 1 : 0;
+            const auto ky = (kx + 1 < 3) ? kx + 1 : 0;
+
+            const Vector3f d = permute(ray.d, kx, ky, kz);
+            const Float sx = -d.x / d.z;
+            const Float sy = -d.y / d.z;
+            const Float sz = 1.f / d.z;
+            const Float ox = ray.o[kx];
+            const Float oy = ray.o[ky];
+            const Float oz = ray.o[kz];
+            const Float tMax = ray.tMax;
+
+            const auto& px0 = packet.p[0][kx];
+            const auto& py0 = packet.p[0][ky];
+            const auto& pz0 = packet.p[0][kz];
+            const auto& px1 = packet.p[1][kx];
+            const auto& py1 = packet.p[1][ky];
+            const auto& pz1 = packet.p[1][kz];
+            const auto& px2 = packet.p[2][kx];
+            const auto& py2 = packet.p[2][ky];
+            const auto& pz2 = packet.p[2][kz];
+
+            // All lanes are tested without branches, so that the loop
+            // is vectorized, and the empty ones are masked off afterwards.
+            TrianglePacketLanes<Width> lanes;
+            std::array<std::uint32_t, Width> isHit;
+            std::array<std::uint32_t, Width> isOnEdge;
+            for (std::size_t i = 0; i < Width; ++i) {
+                const Float z0 = pz0[i] - oz;
+                const Float z1 = pz1[i] - oz;
+                const Float z2 = pz2[i] - oz;
+                const Float x0 = (px0[i] - ox) + sx * z0;
+                const Float y0 = (py0[i] - oy) + sy * z0;
+                const Float x1 = (px1[i] - ox) + sx * z1;
+                const Float y1 = (py1[i] - oy) + sy * z1;
+                const Float x2 = (px2[i] - ox) + sx * z2;
+                const Float y2 = (py2[i] - oy) + sy * z2;
+
+                const Float e0 = x1 * y2 - y1 * x2;
+                const Float e1 = x2 * y0 - y2 * x0;
+                const Float e2 = x0 * y1 - y0 * x1;
+
+                const bool hasNegative = (e0 < 0.f) | (e1 < 0.f) | (e2 < 0.f);
+                const bool hasPositive = (e0 > 0.f) | (e1 > 0.f) | (e2 > 0.f);
+                const Float det = e0 + e1 + e2;
+
+                const Float zt0 = z0 * sz;
+                const Float zt1 = z1 * sz;
+                const Float zt2 = z2 * sz;
+                const Float tScaled = e0 * zt0 + e1 * zt1 + e2 * zt2;
+                const bool isOutOfRange =
+                    ((det < 0.f) &
+                     ((tScaled >= 0.f) | (tScaled < tMax * det))) |
+                    ((det > 0.f) &
+                     ((tScaled <= 0.f) | (tScaled > tMax * det)));
+
+                const Float invDet = 1.f / det;
+                const Float t = tScaled * invDet;
+
+                const Float maxZt = maxAbs(zt0, zt1, zt2);
+                const Float maxXt = maxAbs(x0, x1, x2);
+                const Float maxYt = maxAbs(y0, y1, y2);
+                const Float deltaZ = gamma(3) * maxZt;
+                const Float deltaX = gamma(5) * (maxXt + maxZt);
+                const Float deltaY = gamma(5) * (maxYt + maxZt);
+                const Float deltaE = 2 * (gamma(2) * maxXt * maxYt +
+                                          deltaY * maxXt + deltaX * maxYt);
+                const Float maxE = maxAbs(e0, e1, e2);
+                const Float deltaT = 3 *
+                                     (gamma(3) * maxE * maxZt + deltaE * maxZt +
+                                      deltaZ * maxE) *
+                                     std::abs(invDet);
+
+                lanes.e0[i] = e0;
+                lanes.e1[i] = e1;
+                lanes.e2[i] = e2;
+                lanes.invDet[i] = invDet;
+                lanes.t[i] = t;
+                isHit[i] = !(hasNegative & hasPositive) & (det != 0.f) &
+                           !isOutOfRange & (t > deltaT);
+                isOnEdge[i] = (e0 == 0.f) | (e1 == 0.f) | (e2 == 0.f);
+            }
+
+            for (std::size_t i = 0; i < Width; ++i) {
+                lanes.hits |= isHit[i] << i;
+                lanes.edgeLanes |= isOnEdge[i] << i;
+            }
+
+            const std::uint32_t used =
+                (packet.count < 32) ? (std::uint32_t{1} << packet.count) - 1
+                                    : ~std::uint32_t{0};
+            if constexpr (std::is_same_v<Float, float>) {
+                lanes.edgeLanes &= used;
+                lanes.hits &= used & ~lanes.edgeLanes;
+            }
+            else {
+                lanes.edgeLanes = 0;
+                lanes.hits &= used;
+            }
+
+            return lanes;
+        }
+    } // namespace detail
+
+    template <std::size_t Width>
+    void TrianglePacket<Width>::set(const std::size_t lane,
+                                    const Point3f& p0,
+                                    const Point3f& p1,
+                                    const Point3f& p2) noexcept {
+        const Point3f* const vertices[3] = {&p0, &p1, &p2};
+        for (std::size_t v = 0; v < 3; ++v) {
+            for (std::size_t dim = 0; dim < 3; ++dim) {
+                this->p[v][dim][lane] = (*vertices[v])[dim];
+            }
+        }
+    }
+
+    template <std::size_t Width>
+    std::array<Point3f, 3>
+    TrianglePacket<Width>::vertices(const std::size_t lane) const noexcept {
+        std::array<Point3f, 3> result;
+        for (std::size_t v = 0; v < 3; ++v) {
+            result[v] = Point3f(this->p[v][0][lane],
+                                this->p[v][1][lane],
+                                this->p[v][2][lane]);
+        }
+
+        return result;
+    }
+
+    template <std::size_t Width>
+    Optional<TrianglePacketHit>
+    intersectTriangles(const Ray& ray, const TrianglePacket<Width>& packet) {
+        const detail::TrianglePacketLanes<Width> lanes =
+            detail::intersectLanes(ray, packet);
+
+        Optional<TrianglePacketHit> closest = pbrt::nullopt;
+        for (std::uint32_t i = 0; i < Width; ++i) {
+            const bool isCloser =
+                !closest.has_value() || lanes.t[i] < closest->hit.t;
+            if ((lanes.hits >> i) & 1u && isCloser) {
+                const Float invDet = lanes.invDet[i];
+                closest = TrianglePacketHit{
+                    .lane = i,
+                    .hit = TriangleHit{
+                        .t = lanes.t[i],
+                        .barycentric = {lanes.e0[i] * invDet,
+                                        lanes.e1[i] * invDet,
+                                        lanes.e2[i] * invDet},
+                    },
+                };
+            }
+            else if ((lanes.edgeLanes >> i) & 1u) {
+                const auto [p0, p1, p2] = packet.vertices(i);
+                const auto hit = intersectTriangle(ray, p0, p1, p2);
+                if (hit.has_value() &&
+                    (!closest.has_value() || hit->t < closest->hit.t))
+                {
+                    closest = TrianglePacketHit{.lane = i, .hit = *hit};
+                }
+            }
+        }
+
+        return closest;
+    }
+
+    template <std::size_t Width>
+    bool intersectsAnyTriangle(const Ray& ray,
+                               const TrianglePacket<Width>& packet) {
+        const detail::TrianglePacketLanes<Width> lanes =
+            detail::intersectLanes(ray, packet);
+        if (lanes.hits != 0) {
+            return true;
+        }
+
+        for (std::size_t i = 0; i < Width; ++i) {
+            if ((lanes.edgeLanes >> i) & 1u) {
+                const auto [p0, p1, p2] = packet.vertices(i);
+                if (intersectTriangle(ray, p0, p1, p2).has_value()) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+} // namespace idragnev::pbrt::shapes
\ No newline at end of file
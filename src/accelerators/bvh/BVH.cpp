@@ -1,23 +1,63 @@
 #include "pbrt/accelerators/bvh/BVH.hpp"
 #include "pbrt/accelerators/bvh/RecursiveBuilder.hpp"
 #include "pbrt/accelerators/bvh/HLBVHBuilder.hpp"
+#include "pbrt/accelerators/bvh/PLOCBuilder.hpp"
+#include "pbrt/accelerators/bvh/TreeletRestructurer.hpp"
+#include "pbrt/accelerators/bvh/Morton.hpp"
+#include "pbrt/core/primitive/GeometricPrimitive.hpp"
 #include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+#include "pbrt/shapes/TrianglePacket.hpp"
 #include "pbrt/memory/Memory.hpp"
+#include "pbrt/functional/Functional.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <bit>
+#include <limits>
+#include <memory>
+#include <numeric>
 
 namespace idragnev::pbrt::accelerators {
+    // Holds the last `Capacity` pushed node indices.
+    // Pushing to a full stack overwrites the oldest entry.
+    template <std::size_t Capacity>
     class NodeIndicesStack
     {
+        static_assert(std::has_single_bit(Capacity));
+
     public:
-        void push(const std::size_t index) { data[top++] = index; }
-        std::size_t pop() { return data[--top]; }
+        void push(const std::uint32_t index) noexcept {
+            data[top++ & (Capacity - 1)] = index;
+            if (size < Capacity) {
+                ++size;
+            }
+            else {
+                hasDropped = true;
+            }
+        }
+
+        std::uint32_t pop() noexcept {
+            --size;
+            return data[--top & (Capacity - 1)];
+        }
 
-        bool isEmpty() const noexcept { return top == 0; }
+        bool isEmpty() const noexcept { return size == 0; }
+        bool hasDroppedEntries() const noexcept { return hasDropped; }
 
     private:
         std::size_t top = 0;
-        std::size_t data[64] = {};
+        std::size_t size = 0;
+        bool hasDropped = false;
+        std::uint32_t data[Capacity];
     };
 
+    namespace constants {
+        // The number of rays traced by each task of the batched queries,
+        // in packets of RAY_STREAM_PACKET_WIDTH rays.
+        inline constexpr std::size_t RAY_STREAM_SIZE = 256;
+        inline constexpr std::size_t RAY_STREAM_PACKET_WIDTH = 16;
+    } // namespace constants
+
     struct BVH::FlattenResult
     {
         std::size_t rootIndex = 0;
@@ -28,12 +68,17 @@ namespace idragnev::pbrt::accelerators {
     #pragma warning(push)
     #pragma warning(disable : 4324) // structure padding due to alignment specifier
 #endif
-    // Ensure that nodes do not straddle cache lines
+    // Ensure that nodes do not straddle cache lines. With Float as double
+    // the bounds alone take 48 bytes and the nodes are padded to 64,
+    // a whole cache line.
     struct alignas(32) BVH::LinearBVHNode
     {
-        static LinearBVHNode Leaf(const std::size_t firstPrimitiveIndex,
+        static LinearBVHNode Leaf(const std::uint32_t firstPrimitiveIndex,
                                   const std::uint16_t primitivesCount,
                                   const Bounds3f& bounds) {
+            static_assert(sizeof(Float) != sizeof(float) ||
+                          sizeof(LinearBVHNode) == 32);
+
             return LinearBVHNode{
                 .bounds = bounds,
                 .firstPrimitiveIndex = firstPrimitiveIndex,
@@ -41,7 +86,7 @@ namespace idragnev::pbrt::accelerators {
             };
         }
 
-        static LinearBVHNode Interior(const std::size_t secondChildIndex,
+        static LinearBVHNode Interior(const std::uint32_t secondChildIndex,
                                       const std::uint8_t splitAxis,
                                       const Bounds3f& bounds) {
             return LinearBVHNode{
@@ -54,45 +99,126 @@ namespace idragnev::pbrt::accelerators {
         bool isLeaf() const noexcept { return primitivesCount > 0; }
 
         Bounds3f bounds;
+        // 32-bit indices keep the node within 32 bytes
         union
         {
-            std::size_t firstPrimitiveIndex;
-            std::size_t secondChildIndex;
+            std::uint32_t firstPrimitiveIndex;
+            std::uint32_t secondChildIndex;
         };
         std::uint16_t primitivesCount = 0;
         std::uint8_t splitAxis = 0;
+        // Whether the leaf contains only triangles which can be
+        // intersected with their vertices in BVH::trianglePackets.
+        bool isTriangleLeaf = false;
     };
 #ifdef _MSC_VER
     #pragma warning(pop)
 #endif
 
+    // The world space vertices of up to four consecutive triangles
+    // of a leaf, stored contiguously in BVH order so that triangle
+    // leaves are intersected without going through the primitive,
+    // the shape and the mesh, and a ray is tested against four of them
+    // at once. Lane i of the j-th packet of a leaf holds its
+    // (4j + i)-th primitive, which is used to compute the interaction
+    // of the closest hit.
+    struct BVH::LeafTrianglePacket : shapes::TrianglePacket<4>
+    {
+    };
+
+    // The closest hit of a ray found so far and the index of its
+    // primitive. Only the interaction of the closest hit is computed,
+    // once, after the traversal.
+    struct BVH::ClosestHit
+    {
+        Optional<PrimitiveHit> hit = pbrt::nullopt;
+        std::size_t primitive = 0;
+    };
+
+    const shapes::Triangle* triangleOf(const Primitive& primitive);
+    Optional<std::array<Point3f, 3>>
+    intersectableTriangleVertices(const Primitive& primitive);
+    std::vector<std::uint32_t> coherentRayOrder(std::span<const Ray> rays);
+
     BVH::BVH(std::vector<std::shared_ptr<const Primitive>> prims,
              const bvh::SplitMethod splitMethod,
-             const std::uint32_t maxPrimitivesInNode)
+             const std::uint32_t maxPrimitivesInNode,
+             const std::uint32_t treeletRestructuringPasses,
+             const bvh::TraversalStack stack)
         : maxPrimitivesInNode(std::min(maxPrimitivesInNode, 255u))
+        , traversalStack(stack)
         , primitives(std::move(prims)) {
+        // Node and primitive indices are stored in 32 bits
+        // and there are less than twice as many nodes as primitives.
+        assert(this->primitives.size() <
+               std::numeric_limits<std::uint32_t>::max() / 2);
+
         if (this->primitives.empty() == false) {
+            using Clock = std::chrono::steady_clock;
+
+            bvh::BuildPhaseTimes& times = this->statistics.phaseTimes;
             memory::MemoryArena arena{1024 * 1024};
 
-            const bvh::BuildTree tree = buildBVHTree(splitMethod, arena);
+            auto phaseStart = Clock::now();
+            bvh::BuildTree tree = buildBVHTree(splitMethod, arena);
+            times.treeBuild = Clock::now() - phaseStart;
+
+            if (treeletRestructuringPasses > 0) {
+                phaseStart = Clock::now();
+                const auto restructurer =
+                    bvh::TreeletRestructurer{treeletRestructuringPasses};
+                restructurer(tree);
+                times.treeletRestructuring = Clock::now() - phaseStart;
+            }
+
+            this->statistics.sahCost = bvh::sahCost(tree);
+
+            phaseStart = Clock::now();
             this->nodes =
                 memory::allocCacheAligned<LinearBVHNode>(tree.nodesCount);
             [[maybe_unused]] const auto result = flattenBVHTree(*tree.root, 0);
+            storeParentIndices(tree.nodesCount);
+            times.flattening = Clock::now() - phaseStart;
 
             assert(result.linearNodesWritten == tree.nodesCount);
+
+            phaseStart = Clock::now();
+            const std::size_t packetsCount =
+                storeLeafTriangles(tree.nodesCount);
+            times.leafTriangles = Clock::now() - phaseStart;
+
+            this->statistics.nodesCount = tree.nodesCount;
+            // each node has a parent index and a first packet index
+            this->statistics.memoryUsage =
+                tree.nodesCount *
+                    (sizeof(LinearBVHNode) + 2 * sizeof(std::uint32_t)) +
+                packetsCount * sizeof(LeafTrianglePacket) +
+                this->primitives.size() * sizeof(this->primitives[0]);
+            collectNodeStatistics();
         }
     }
 
     bvh::BuildTree BVH::buildBVHTree(const bvh::SplitMethod splitMethod,
                                      memory::MemoryArena& arena) {
-        const auto recursiveBuilder =
-            bvh::RecursiveBuilder{splitMethod, this->maxPrimitivesInNode};
-        auto hlbvhBuilder = bvh::HLBVHBuilder{this->maxPrimitivesInNode};
-
-        bvh::BuildResult result =
-            splitMethod == bvh::SplitMethod::HLBVH
-                ? hlbvhBuilder(arena, this->primitives)
-                : recursiveBuilder(arena, this->primitives);
+        bvh::BuildResult result = [this, splitMethod, &arena] {
+            switch (splitMethod) {
+                case bvh::SplitMethod::HLBVH: {
+                    auto builder = bvh::HLBVHBuilder{this->maxPrimitivesInNode};
+                    return builder(arena, this->primitives);
+                }
+                case bvh::SplitMethod::PLOC: {
+                    const auto builder =
+                        bvh::PLOCBuilder{this->maxPrimitivesInNode};
+                    return builder(arena, this->primitives);
+                }
+                default: {
+                    const auto builder =
+                        bvh::RecursiveBuilder{splitMethod,
+                                              this->maxPrimitivesInNode};
+                    return builder(arena, this->primitives);
+                }
+            }
+        }();
 
         this->primitives = std::move(result.orderedPrimitives);
 
@@ -107,7 +233,7 @@ namespace idragnev::pbrt::accelerators {
             assert(buildNode.primitivesCount <= 65536);
 
             node = LinearBVHNode::Leaf(
-                buildNode.firstPrimitiveIndex,
+                static_cast<std::uint32_t>(buildNode.firstPrimitiveIndex),
                 static_cast<std::uint16_t>(buildNode.primitivesCount),
                 buildNode.bounds);
 
@@ -124,7 +250,7 @@ namespace idragnev::pbrt::accelerators {
                                left.rootIndex + left.linearNodesWritten);
 
             node = LinearBVHNode::Interior(
-                right.rootIndex,
+                static_cast<std::uint32_t>(right.rootIndex),
                 static_cast<std::uint8_t>(buildNode.splitAxis),
                 buildNode.bounds);
 
@@ -136,48 +262,258 @@ namespace idragnev::pbrt::accelerators {
         }
     }
 
-    BVH::~BVH() { memory::freeAligned(nodes); }
+    void BVH::storeParentIndices(const std::size_t nodesCount) {
+        this->parentIndices.assign(nodesCount, 0);
+        for (std::uint32_t i = 0; i < nodesCount; ++i) {
+            const LinearBVHNode& node = this->nodes[i];
+            if (node.isLeaf() == false) {
+                this->parentIndices[i + 1] = i;
+                this->parentIndices[node.secondChildIndex] = i;
+            }
+        }
+    }
+
+    // Stores the vertices of the triangles which can be intersected
+    // directly and marks the leaves containing only such triangles.
+    // Returns the number of packets of their vertices.
+    std::size_t BVH::storeLeafTriangles(const std::size_t nodesCount) {
+        const std::vector<Optional<std::array<Point3f, 3>>> vertices =
+            functional::fmap(this->primitives, [](const auto& primitive) {
+                return intersectableTriangleVertices(*primitive);
+            });
 
-    Bounds3f BVH::worldBound() const {
-        return (this->nodes != nullptr) ? nodes[0].bounds : Bounds3f{};
+        constexpr std::size_t width = LeafTrianglePacket::width;
+
+        std::size_t packetsCount = 0;
+        this->firstPacketIndices.assign(nodesCount, 0);
+        for (std::size_t i = 0; i < nodesCount; ++i) {
+            LinearBVHNode& node = this->nodes[i];
+            if (node.isLeaf()) {
+                const auto leafVertices =
+                    std::span{vertices.cbegin() + node.firstPrimitiveIndex,
+                              node.primitivesCount};
+
+                node.isTriangleLeaf = std::all_of(
+                    leafVertices.begin(),
+                    leafVertices.end(),
+                    [](const auto& v) { return v.has_value(); });
+                if (node.isTriangleLeaf) {
+                    this->firstPacketIndices[i] =
+                        static_cast<std::uint32_t>(packetsCount);
+                    packetsCount += (node.primitivesCount + width - 1) / width;
+                }
+            }
+        }
+
+        if (packetsCount > 0) {
+            this->trianglePackets =
+                memory::allocCacheAligned<LeafTrianglePacket>(packetsCount);
+            std::uninitialized_value_construct_n(this->trianglePackets,
+                                                 packetsCount);
+
+            for (std::size_t i = 0; i < nodesCount; ++i) {
+                const LinearBVHNode& node = this->nodes[i];
+                if (node.isLeaf() && node.isTriangleLeaf) {
+                    for (std::size_t j = 0; j < node.primitivesCount; ++j) {
+                        const auto& v = vertices[node.firstPrimitiveIndex + j];
+                        storeLeafTriangle(i, j, *v);
+                    }
+                }
+            }
+        }
+
+        return packetsCount;
     }
 
-    Optional<SurfaceInteraction> BVH::intersect(const Ray& ray) const {
-        Optional<SurfaceInteraction> result = pbrt::nullopt;
+    // Stores the vertices of the i-th triangle of a leaf
+    // in the lane of its packet.
+    void BVH::storeLeafTriangle(const std::size_t nodeIndex,
+                                const std::size_t i,
+                                const std::array<Point3f, 3>& vertices) {
+        constexpr std::size_t width = LeafTrianglePacket::width;
 
-        traverseIntersect(
-            [this, &result](const LinearBVHNode& leafNode, const Ray& ray) {
-                result = intersectLeafNodePrims(leafNode, ray)
-                         .disjunction(std::move(result));
-                return false;
-            },
-            ray);
+        LeafTrianglePacket& packet =
+            this->trianglePackets[this->firstPacketIndices[nodeIndex] +
+                                  i / width];
+        const auto lane = static_cast<std::uint32_t>(i % width);
+        packet.set(lane, vertices[0], vertices[1], vertices[2]);
+        packet.count = std::max(packet.count, lane + 1);
+    }
 
-        return result;
+    // Returns the shape of `primitive` if it is a geometric primitive
+    // of a triangle, nullptr otherwise.
+    const shapes::Triangle* triangleOf(const Primitive& primitive) {
+        const auto* const geometric =
+            dynamic_cast<const GeometricPrimitive*>(&primitive);
+
+        return geometric != nullptr
+                   ? dynamic_cast<const shapes::Triangle*>(&geometric->shape())
+                   : nullptr;
     }
 
-    bool BVH::intersectP(const Ray& ray) const {
-        bool result = false;
+    // Returns the vertices of `primitive` if it is a triangle
+    // which is hit exactly when its vertices are hit -
+    // one without an alpha mask and with non-zero area.
+    Optional<std::array<Point3f, 3>>
+    intersectableTriangleVertices(const Primitive& primitive) {
+        const shapes::Triangle* const triangle = triangleOf(primitive);
+        if (triangle == nullptr || triangle->hasAlphaMask() ||
+            triangle->isDegenerate()) {
+            return pbrt::nullopt;
+        }
 
-        traverseIntersect(
-            [this, &result](const LinearBVHNode& leafNode, const Ray& ray) {
-                result = intersectPLeafNodePrims(leafNode, ray);
-                return result;
-            },
-            ray);
+        return pbrt::make_optional(triangle->worldVertices());
+    }
 
-        return result;
+    // Walks the flattened tree, collecting the node counts and
+    // the depth and size histograms of the leaves.
+    void BVH::collectNodeStatistics() {
+        bvh::BuildStatistics& stats = this->statistics;
+
+        struct NodeToVisit
+        {
+            std::size_t index = 0;
+            std::size_t depth = 0;
+        };
+
+        std::vector<NodeToVisit> nodesToVisit{NodeToVisit{0, 0}};
+        while (nodesToVisit.empty() == false) {
+            const NodeToVisit current = nodesToVisit.back();
+            nodesToVisit.pop_back();
+
+            const LinearBVHNode& node = this->nodes[current.index];
+            stats.maxDepth = std::max(stats.maxDepth, current.depth);
+
+            if (node.isLeaf()) {
+                ++stats.leavesCount;
+                stats.triangleLeavesCount += node.isTriangleLeaf ? 1 : 0;
+
+                const auto addTo = [](std::vector<std::size_t>& histogram,
+                                      const std::size_t i) {
+                    if (histogram.size() <= i) {
+                        histogram.resize(i + 1, 0);
+                    }
+                    ++histogram[i];
+                };
+                addTo(stats.leafDepthHistogram, current.depth);
+                addTo(stats.leafSizeHistogram, node.primitivesCount);
+            }
+            else {
+                ++stats.interiorNodesCount;
+                nodesToVisit.push_back({current.index + 1, current.depth + 1});
+                nodesToVisit.push_back(
+                    {node.secondChildIndex, current.depth + 1});
+            }
+        }
+    }
+
+    void BVH::refit() {
+        // Children follow their parents in the flattened tree,
+        // so the nodes are refitted bottom-up in reverse order.
+        for (std::size_t i = this->statistics.nodesCount; i-- > 0;) {
+            LinearBVHNode& node = this->nodes[i];
+
+            if (node.isLeaf()) {
+                node.bounds = Bounds3f{};
+                for (const auto& primitive : leafPrimitives(node)) {
+                    node.bounds = unionOf(node.bounds, primitive->worldBound());
+                }
+
+                if (node.isTriangleLeaf) {
+                    const auto prims = leafPrimitives(node);
+                    for (std::size_t j = 0; j < prims.size(); ++j) {
+                        const auto vertices =
+                            intersectableTriangleVertices(*prims[j]);
+                        if (vertices.has_value()) {
+                            storeLeafTriangle(i, j, *vertices);
+                        }
+                        else {
+                            node.isTriangleLeaf = false;
+                        }
+                    }
+                }
+            }
+            else {
+                const auto& firstChild = this->nodes[i + 1];
+                const auto& secondChild = this->nodes[node.secondChildIndex];
+                node.bounds = unionOf(firstChild.bounds, secondChild.bounds);
+            }
+        }
+    }
+
+    void BVH::reorderTriangleMeshes(
+        const std::span<const std::shared_ptr<shapes::TriangleMesh>> meshes) {
+        std::vector<const shapes::Triangle*> triangles;
+        triangles.reserve(this->primitives.size());
+        for (const auto& primitive : this->primitives) {
+            if (const auto* const triangle = triangleOf(*primitive)) {
+                triangles.push_back(triangle);
+            }
+        }
+
+        shapes::reorderTriangleMeshes(triangles, meshes);
+    }
+
+    std::span<const std::shared_ptr<const Primitive>>
+    BVH::orderedPrimitives() const noexcept {
+        return this->primitives;
     }
 
-    // Traverses the tree, ignoring subtrees which are not intersected by `ray`.
+    const bvh::BuildStatistics& BVH::buildStatistics() const noexcept {
+        return this->statistics;
+    }
+
+    bvh::TraversalStatistics
+    BVH::traversalStatistics(const bvh::RayQuery query) const noexcept {
+        return this->traversalStats.get(query);
+    }
+
+    void BVH::resetTraversalStatistics() noexcept {
+        this->traversalStats.reset();
+    }
+
+    BVH::~BVH() {
+        memory::freeAligned(nodes);
+        memory::freeAligned(trianglePackets);
+    }
+
+    Bounds3f BVH::worldBound() const {
+        return (this->nodes != nullptr) ? nodes[0].bounds : Bounds3f{};
+    }
+
+    template <typename LeafVisitor>
+    void BVH::traverseIntersect(LeafVisitor&& intersectLeaf,
+                                const Ray& ray,
+                                bvh::TraversalCounters& counters,
+                                const std::uint32_t rootIndex) const {
+        switch (this->traversalStack) {
+            case bvh::TraversalStack::Full:
+                traverseWithStack<64>(intersectLeaf, ray, counters, rootIndex);
+                break;
+            case bvh::TraversalStack::Short:
+                traverseWithStack<8>(intersectLeaf, ray, counters, rootIndex);
+                break;
+        }
+    }
+
+    // Traverses the subtree at `rootIndex`, ignoring subtrees which are
+    // not intersected by `ray`.
     // For intersected internal nodes, visits the two child trees in
     // a front-to-back order.
     // Calls `intersectLeaf` with `ray` for each intersected leaf node.
     // (!) Stops the traversal if `intersectLeaf` returns true -
     // `intersectLeaf` indicates whether the traversal should stop. (!)
-    void BVH::traverseIntersect(
-        std::function<bool(const LinearBVHNode&, const Ray&)> intersectLeaf,
-        const Ray& ray) const {
+    // The visitor is a template parameter so that closest-hit and
+    // any-hit traversals each get their own loop with the leaf
+    // intersection inlined.
+    // If the stack has dropped entries, the traversal continues
+    // from the next node in front-to-back order once it runs out
+    // of entries, see nextNodeAfter.
+    template <std::size_t StackCapacity, typename LeafVisitor>
+    void BVH::traverseWithStack(LeafVisitor&& intersectLeaf,
+                                const Ray& ray,
+                                bvh::TraversalCounters& counters,
+                                const std::uint32_t rootIndex) const {
         if (this->nodes == nullptr) {
             return;
         }
@@ -187,21 +523,39 @@ namespace idragnev::pbrt::accelerators {
                                               invDir.y < 0.f ? 1u : 0u,
                                               invDir.z < 0.f ? 1u : 0u};
 
-        NodeIndicesStack nodesToVisit;
-        nodesToVisit.push(0);
+        NodeIndicesStack<StackCapacity> nodesToVisit;
+        nodesToVisit.push(rootIndex);
+        std::uint32_t currentNodeIndex = rootIndex;
+
+        while (true) {
+            if (nodesToVisit.isEmpty() == false) {
+                currentNodeIndex = nodesToVisit.pop();
+            }
+            else if (nodesToVisit.hasDroppedEntries()) {
+                const auto next =
+                    nextNodeAfter(currentNodeIndex, rootIndex, dirIsNegative);
+                if (next.has_value() == false) {
+                    return;
+                }
+                currentNodeIndex = *next;
+            }
+            else {
+                return;
+            }
 
-        while (nodesToVisit.isEmpty() == false) {
-            const std::size_t currentNodeIndex = nodesToVisit.pop();
             const LinearBVHNode& node = this->nodes[currentNodeIndex];
 
+            counters.countBoxTest();
             if (node.bounds.intersectP(ray, invDir, dirIsNegative)) {
+                counters.countNodeVisit();
+
                 if (node.isLeaf()) {
                     if (bool stop = intersectLeaf(node, ray); stop) {
                         return;
                     }
                 }
                 else {
-                    const std::size_t leftChildIndex = currentNodeIndex + 1;
+                    const std::uint32_t leftChildIndex = currentNodeIndex + 1;
 
                     if (dirIsNegative[node.splitAxis] == 1) {
                         nodesToVisit.push(leftChildIndex);
@@ -216,39 +570,549 @@ namespace idragnev::pbrt::accelerators {
         }
     }
 
-    Optional<SurfaceInteraction>
-    BVH::intersectLeafNodePrims(const LinearBVHNode& node,
-                                const Ray& ray) const {
-        Optional<SurfaceInteraction> result = pbrt::nullopt;
+    // Returns the node which a front-to-back traversal of the subtree
+    // at `rootIndex` visits after the subtree at `nodeIndex` -
+    // the far child of the closest ancestor whose near child
+    // contains `nodeIndex`, if any.
+    Optional<std::uint32_t>
+    BVH::nextNodeAfter(std::uint32_t nodeIndex,
+                       const std::uint32_t rootIndex,
+                       const std::size_t dirIsNegative[3]) const {
+        while (nodeIndex != rootIndex) {
+            const std::uint32_t parentIndex = this->parentIndices[nodeIndex];
+            const LinearBVHNode& parent = this->nodes[parentIndex];
+
+            const bool isLeftChild = nodeIndex == parentIndex + 1;
+            const bool isLeftNear = dirIsNegative[parent.splitAxis] == 0;
+            if (isLeftChild == isLeftNear) {
+                return isLeftChild ? parent.secondChildIndex : parentIndex + 1;
+            }
+
+            nodeIndex = parentIndex;
+        }
+
+        return pbrt::nullopt;
+    }
+
+    std::span<const std::shared_ptr<const Primitive>>
+    BVH::leafPrimitives(const LinearBVHNode& leaf) const {
+        assert(leaf.isLeaf());
+
+        return std::span<const std::shared_ptr<const Primitive>>{
+            this->primitives.cbegin() + leaf.firstPrimitiveIndex,
+            leaf.primitivesCount};
+    }
 
-        if (node.isLeaf()) {
-            const auto primsRange =
-                std::span<const std::shared_ptr<const Primitive>>{
-                    this->primitives.cbegin() + node.firstPrimitiveIndex,
-                    node.primitivesCount};
+    std::span<const BVH::LeafTrianglePacket>
+    BVH::leafTrianglePackets(const LinearBVHNode& leaf) const {
+        assert(leaf.isLeaf() && leaf.isTriangleLeaf);
 
-            for (const auto& primitive : primsRange) {
-                result = primitive->intersect(ray).disjunction(std::move(result));
+        constexpr std::size_t width = LeafTrianglePacket::width;
+        const auto nodeIndex = static_cast<std::size_t>(&leaf - this->nodes);
+
+        return std::span<const LeafTrianglePacket>{
+            this->trianglePackets + this->firstPacketIndices[nodeIndex],
+            (leaf.primitivesCount + width - 1) / width};
+    }
+
+    void BVH::intersectLeaf(const LinearBVHNode& leaf,
+                            const Ray& ray,
+                            ClosestHit& closest,
+                            bvh::TraversalCounters& counters) const {
+        counters.countPrimitiveTests(leaf.primitivesCount);
+
+        if (leaf.isTriangleLeaf) {
+            std::size_t first = leaf.firstPrimitiveIndex;
+            for (const LeafTrianglePacket& packet : leafTrianglePackets(leaf)) {
+                const auto hit = shapes::intersectTriangles(ray, packet);
+                if (hit.has_value()) {
+                    ray.tMax = hit->hit.t;
+                    closest.hit = PrimitiveHit{};
+                    closest.hit->shapeHit = shapes::toShapeHit(hit->hit);
+                    closest.primitive = first + hit->lane;
+                }
+                first += packet.count;
             }
         }
+        else {
+            const auto first = leaf.firstPrimitiveIndex;
+            const auto last = first + leaf.primitivesCount;
+            for (std::size_t i = first; i < last; ++i) {
+                if (auto hit = this->primitives[i]->intersectHit(ray);
+                    hit.has_value()) {
+                    closest.hit = std::move(hit);
+                    closest.primitive = i;
+                }
+            }
+        }
+    }
+
+    bool BVH::leafOccludes(const LinearBVHNode& leaf,
+                           const Ray& ray,
+                           bvh::TraversalCounters& counters) const {
+        if (leaf.isTriangleLeaf) {
+            const auto packets = leafTrianglePackets(leaf);
+            return std::any_of(packets.begin(),
+                               packets.end(),
+                               [&ray, &counters](const auto& packet) {
+                                   counters.countPrimitiveTests(packet.count);
+                                   return shapes::intersectsAnyTriangle(
+                                       ray,
+                                       packet);
+                               });
+        }
+        else {
+            const auto prims = leafPrimitives(leaf);
+            return std::any_of(prims.begin(),
+                               prims.end(),
+                               [&ray, &counters](const auto& p) {
+                                   counters.countPrimitiveTests(1);
+                                   return p->intersectP(ray);
+                               });
+        }
+    }
+
+    // Computes the interaction of the closest hit found by a traversal.
+    Optional<SurfaceInteraction> BVH::interactionOf(ClosestHit&& closest,
+                                                    const Ray& ray) const {
+        if (!closest.hit.has_value()) {
+            return pbrt::nullopt;
+        }
+
+        const auto& primitive = this->primitives[closest.primitive];
+        return pbrt::make_optional(
+            primitive->computeInteraction(ray, std::move(*closest.hit)));
+    }
+
+    Optional<SurfaceInteraction> BVH::intersect(const Ray& ray) const {
+        ClosestHit closest;
+        bvh::TraversalCounters counters;
+
+        traverseIntersect(
+            [this, &closest, &counters](const LinearBVHNode& leafNode,
+                                        const Ray& ray) {
+                intersectLeaf(leafNode, ray, closest, counters);
+                return false;
+            },
+            ray,
+            counters);
+        this->traversalStats.add(bvh::RayQuery::ClosestHit, counters);
+
+        return interactionOf(std::move(closest), ray);
+    }
+
+    bool BVH::intersectP(const Ray& ray) const {
+        bool result = false;
+        bvh::TraversalCounters counters;
+
+        traverseIntersect(
+            [this, &result, &counters](const LinearBVHNode& leafNode,
+                                       const Ray& ray) {
+                result = leafOccludes(leafNode, ray, counters);
+                return result;
+            },
+            ray,
+            counters);
+        this->traversalStats.add(bvh::RayQuery::AnyHit, counters);
 
         return result;
     }
 
-    bool BVH::intersectPLeafNodePrims(const LinearBVHNode& node,
-                                      const Ray& ray) const {
-        if (node.isLeaf() == false) {
-            return false;
+    void BVH::intersectPackets(
+        const std::span<const Ray> rays,
+        const std::span<Optional<SurfaceInteraction>> hits,
+        const bvh::PacketWidth width) const {
+        switch (width) {
+            case bvh::PacketWidth::Four:
+                intersectPackets<4>(rays, hits);
+                break;
+            case bvh::PacketWidth::Eight:
+                intersectPackets<8>(rays, hits);
+                break;
+            case bvh::PacketWidth::Sixteen:
+                intersectPackets<16>(rays, hits);
+                break;
+        }
+    }
+
+    void BVH::intersectPPackets(const std::span<const Ray> rays,
+                                const std::span<bool> occluded,
+                                const bvh::PacketWidth width) const {
+        switch (width) {
+            case bvh::PacketWidth::Four:
+                intersectPPackets<4>(rays, occluded);
+                break;
+            case bvh::PacketWidth::Eight:
+                intersectPPackets<8>(rays, occluded);
+                break;
+            case bvh::PacketWidth::Sixteen:
+                intersectPPackets<16>(rays, occluded);
+                break;
+        }
+    }
+
+    template <std::size_t Width>
+    void BVH::intersectPackets(
+        const std::span<const Ray> rays,
+        const std::span<Optional<SurfaceInteraction>> hits) const {
+        assert(rays.size() == hits.size());
+
+        for (std::size_t first = 0; first < rays.size(); first += Width) {
+            const std::size_t count = std::min(Width, rays.size() - first);
+            const auto packetRays = rays.subspan(first, count);
+            std::array<ClosestHit, Width> closest;
+            bvh::TraversalCounters counters{count};
+
+            intersectPacket<Width>(packetRays, closest, counters);
+            this->traversalStats.add(bvh::RayQuery::ClosestHit, counters);
+
+            for (std::size_t lane = 0; lane < count; ++lane) {
+                hits[first + lane] =
+                    interactionOf(std::move(closest[lane]), packetRays[lane]);
+            }
+        }
+    }
+
+    template <std::size_t Width>
+    void BVH::intersectPPackets(const std::span<const Ray> rays,
+                                const std::span<bool> occluded) const {
+        assert(rays.size() == occluded.size());
+
+        for (std::size_t first = 0; first < rays.size(); first += Width) {
+            const std::size_t count = std::min(Width, rays.size() - first);
+            bvh::TraversalCounters counters{count};
+
+            intersectPPacket<Width>(rays.subspan(first, count),
+                                    occluded.subspan(first, count),
+                                    counters);
+            this->traversalStats.add(bvh::RayQuery::AnyHit, counters);
         }
+    }
 
-        const auto primsRange =
-            std::span<const std::shared_ptr<const Primitive>>{
-                this->primitives.cbegin() + node.firstPrimitiveIndex,
-                node.primitivesCount};
+    // Finds the closest hit of each of `packetRays`, no more than
+    // Width rays, traversing the tree with all of them at once if they
+    // form a packet and one by one otherwise
+    template <std::size_t Width>
+    void BVH::intersectPacket(const std::span<const Ray> packetRays,
+                              const std::span<ClosestHit> closest,
+                              bvh::TraversalCounters& counters) const {
+        if (auto packet = bvh::RayPacket<Width>::coherent(packetRays);
+            packet.has_value()) {
+            traversePacket(
+                [this, &packetRays, &closest, &counters](
+                    const LinearBVHNode& leafNode,
+                    const std::size_t lane) {
+                    intersectLeaf(leafNode,
+                                  packetRays[lane],
+                                  closest[lane],
+                                  counters);
+                    return false;
+                },
+                *packet,
+                packetRays,
+                counters);
+        }
+        else {
+            for (std::size_t lane = 0; lane < packetRays.size(); ++lane) {
+                traverseIntersect(
+                    [this, &closest, &counters, lane](
+                        const LinearBVHNode& leafNode,
+                        const Ray& ray) {
+                        intersectLeaf(leafNode, ray, closest[lane], counters);
+                        return false;
+                    },
+                    packetRays[lane],
+                    counters);
+            }
+        }
+    }
 
-        return std::any_of(
-            primsRange.begin(),
-            primsRange.end(),
-            [&ray](const auto& p) { return p->intersectP(ray); });
+    template <std::size_t Width>
+    void BVH::intersectPPacket(const std::span<const Ray> packetRays,
+                               const std::span<bool> occluded,
+                               bvh::TraversalCounters& counters) const {
+        std::fill(occluded.begin(), occluded.end(), false);
+
+        if (auto packet = bvh::RayPacket<Width>::coherent(packetRays);
+            packet.has_value()) {
+            traversePacket(
+                [this, &packetRays, &occluded, &counters](
+                    const LinearBVHNode& leafNode,
+                    const std::size_t lane) {
+                    occluded[lane] =
+                        leafOccludes(leafNode, packetRays[lane], counters);
+                    return occluded[lane];
+                },
+                *packet,
+                packetRays,
+                counters);
+        }
+        else {
+            for (std::size_t lane = 0; lane < packetRays.size(); ++lane) {
+                traverseIntersect(
+                    [this, &occluded, &counters, lane](
+                        const LinearBVHNode& leafNode,
+                        const Ray& ray) {
+                        occluded[lane] = leafOccludes(leafNode, ray, counters);
+                        return occluded[lane];
+                    },
+                    packetRays[lane],
+                    counters);
+            }
+        }
+    }
+
+    // Traverses the tree with all rays of `packet` at once, testing the
+    // bounds of each visited node against the lanes which reached it.
+    // Calls `intersectLeaf` with each intersected leaf node and each
+    // lane which hits it. A lane is dropped from the packet if
+    // `intersectLeaf` returns true for it.
+    // Once no more than a quarter of the lanes reach an interior node,
+    // the packet has diverged and these lanes traverse its subtree
+    // one by one. So do the lanes reaching nodes deeper than
+    // the stack of the packet.
+    template <std::size_t Width, typename LeafVisitor>
+    void BVH::traversePacket(LeafVisitor&& intersectLeaf,
+                             bvh::RayPacket<Width>& packet,
+                             const std::span<const Ray> rays,
+                             bvh::TraversalCounters& counters) const {
+        if (this->nodes == nullptr) {
+            return;
+        }
+
+        struct PacketEntry
+        {
+            std::uint32_t nodeIndex = 0;
+            bvh::LaneMask lanes = 0;
+        };
+
+        // On paths deeper than the stack, the lanes continue
+        // as single rays, which handle any depth.
+        std::array<PacketEntry, 64> entries;
+        std::size_t entriesCount = 0;
+        entries[entriesCount++] = PacketEntry{0, packet.activeLanes};
+
+        const auto visitLanes = [](const bvh::LaneMask lanes,
+                                   const auto& f) {
+            for (std::size_t lane = 0; lane < Width; ++lane) {
+                if ((lanes >> lane) & 1u) {
+                    f(lane);
+                }
+            }
+        };
+        const auto intersectLaneLeaf = [&](const LinearBVHNode& leafNode,
+                                           const std::size_t lane) {
+            const bool stop = intersectLeaf(leafNode, lane);
+            if (stop) {
+                packet.activeLanes &= ~(bvh::LaneMask{1} << lane);
+            }
+            return stop;
+        };
+
+        while (entriesCount > 0) {
+            const PacketEntry entry = entries[--entriesCount];
+            const bvh::LaneMask lanes = entry.lanes & packet.activeLanes;
+            if (lanes == 0) {
+                continue;
+            }
+
+            const LinearBVHNode& node = this->nodes[entry.nodeIndex];
+            const bvh::LaneMask hitLanes =
+                bvh::intersectBounds(packet, node.bounds, lanes);
+            const auto hitLanesCount =
+                static_cast<std::size_t>(std::popcount(hitLanes));
+            counters.countBoxTests(std::popcount(lanes));
+            counters.countNodeVisits(hitLanesCount);
+            if (hitLanesCount == 0) {
+                continue;
+            }
+
+            if (node.isLeaf()) {
+                visitLanes(hitLanes, [&](const std::size_t lane) {
+                    intersectLaneLeaf(node, lane);
+                    packet.tMax[lane] = rays[lane].tMax;
+                });
+            }
+            else if (4 * hitLanesCount <= Width ||
+                     entriesCount + 2 > entries.size()) {
+                visitLanes(hitLanes, [&](const std::size_t lane) {
+                    const Ray& ray = rays[lane];
+                    traverseIntersect(
+                        [&](const LinearBVHNode& leafNode, const Ray&) {
+                            return intersectLaneLeaf(leafNode, lane);
+                        },
+                        ray,
+                        counters,
+                        entry.nodeIndex);
+                    packet.tMax[lane] = ray.tMax;
+                });
+            }
+            else {
+                const std::uint32_t leftChildIndex = entry.nodeIndex + 1;
+                const PacketEntry left{leftChildIndex, hitLanes};
+                const PacketEntry right{node.secondChildIndex, hitLanes};
+
+                if (packet.dirIsNegative[node.splitAxis] == 1) {
+                    entries[entriesCount++] = left;
+                    entries[entriesCount++] = right;
+                }
+                else {
+                    entries[entriesCount++] = right;
+                    entries[entriesCount++] = left;
+                }
+            }
+        }
+    }
+
+    // Returns the indices of `rays` sorted by direction octant, then by
+    // the morton code of the ray origin, relative to the bounds of all
+    // origins, and then by the morton code of the ray direction.
+    // Consecutive rays in this order tend to visit the same nodes,
+    // including rays from a common origin, such as those of a camera
+    // or of the ambient occlusion of a point.
+    std::vector<std::uint32_t> coherentRayOrder(std::span<const Ray> rays) {
+        const Bounds3f originBounds = std::accumulate(
+            rays.begin(),
+            rays.end(),
+            Bounds3f{},
+            [](const Bounds3f& b, const Ray& ray) {
+                return unionOf(b, ray.o);
+            });
+
+        std::vector<bvh::MortonPrimitive> keys(rays.size());
+        parallel::parallelFor(
+            [&rays, &keys, &originBounds](const std::int64_t i) {
+                using bvh::constants::MORTON_DIMENSION_MAX;
+
+                const Ray& ray = rays[i];
+                const std::uint64_t octant = (ray.d.x < 0.f ? 1u : 0u) |
+                                             (ray.d.y < 0.f ? 2u : 0u) |
+                                             (ray.d.z < 0.f ? 4u : 0u);
+                const Float length = ray.d.length();
+                const Vector3f direction =
+                    length > 0.f ? ray.d / length : Vector3f{};
+                const Vector3f directionOffset =
+                    0.5f * (direction + Vector3f{1.f, 1.f, 1.f});
+                // The 30 most significant bits of each 63-bit code,
+                // 10 bits of each dimension
+                const std::uint64_t origin =
+                    bvh::encodeMorton3(MORTON_DIMENSION_MAX *
+                                       originBounds.offset(ray.o)) >>
+                    33;
+                const std::uint64_t dir =
+                    bvh::encodeMorton3(MORTON_DIMENSION_MAX *
+                                       directionOffset) >>
+                    33;
+                keys[i] = bvh::MortonPrimitive{
+                    .index = static_cast<std::size_t>(i),
+                    .mortonCode = (octant << 60) | (origin << 30) | dir,
+                };
+            },
+            static_cast<std::int64_t>(rays.size()),
+            4096);
+
+        return functional::fmap(
+            bvh::radixSort(std::move(keys)),
+            [](const bvh::MortonPrimitive& key) {
+                return static_cast<std::uint32_t>(key.index);
+            });
+    }
+
+    // Splits the rays into streams of consecutive rays
+    // in coherent order and calls `visitStream` with the indices
+    // of each stream's rays. The streams are visited in parallel.
+    template <typename StreamVisitor>
+    void BVH::forEachRayStream(const std::span<const Ray> rays,
+                               StreamVisitor&& visitStream) const {
+        assert(rays.size() <= std::numeric_limits<std::uint32_t>::max());
+
+        const std::vector<std::uint32_t> order = coherentRayOrder(rays);
+        const std::size_t streamsCount =
+            (order.size() + constants::RAY_STREAM_SIZE - 1) /
+            constants::RAY_STREAM_SIZE;
+
+        parallel::parallelFor(
+            [&order, &visitStream](const std::int64_t i) {
+                const std::size_t first = i * constants::RAY_STREAM_SIZE;
+                const std::size_t count =
+                    std::min(constants::RAY_STREAM_SIZE, order.size() - first);
+                visitStream(std::span{order}.subspan(first, count));
+            },
+            static_cast<std::int64_t>(streamsCount),
+            1);
+    }
+
+    void
+    BVH::intersect(const std::span<const Ray> rays,
+                   const std::span<Optional<SurfaceInteraction>> hits) const {
+        assert(rays.size() == hits.size());
+
+        constexpr std::size_t WIDTH = constants::RAY_STREAM_PACKET_WIDTH;
+
+        using Stream = std::span<const std::uint32_t>;
+        forEachRayStream(rays, [&](const Stream stream) {
+            bvh::TraversalCounters counters{stream.size()};
+
+            // The rays of a packet are copied next to each other,
+            // as the packet traversal indexes them by lane
+            for (std::size_t first = 0; first < stream.size();
+                 first += WIDTH) {
+                const std::size_t count =
+                    std::min(WIDTH, stream.size() - first);
+                const auto packetStream = stream.subspan(first, count);
+                std::array<Ray, WIDTH> packetRays;
+                std::array<ClosestHit, WIDTH> closest;
+                for (std::size_t lane = 0; lane < count; ++lane) {
+                    packetRays[lane] = rays[packetStream[lane]];
+                }
+
+                intersectPacket<WIDTH>(
+                    std::span{packetRays}.first(count),
+                    closest,
+                    counters);
+
+                for (std::size_t lane = 0; lane < count; ++lane) {
+                    const Ray& ray = rays[packetStream[lane]];
+                    ray.tMax = packetRays[lane].tMax;
+                    hits[packetStream[lane]] =
+                        interactionOf(std::move(closest[lane]), ray);
+                }
+            }
+            this->traversalStats.add(bvh::RayQuery::ClosestHit, counters);
+        });
+    }
+
+    void BVH::intersectP(const std::span<const Ray> rays,
+                         const std::span<bool> occluded) const {
+        assert(rays.size() == occluded.size());
+
+        constexpr std::size_t WIDTH = constants::RAY_STREAM_PACKET_WIDTH;
+
+        using Stream = std::span<const std::uint32_t>;
+        forEachRayStream(rays, [&](const Stream stream) {
+            bvh::TraversalCounters counters{stream.size()};
+
+            for (std::size_t first = 0; first < stream.size();
+                 first += WIDTH) {
+                const std::size_t count =
+                    std::min(WIDTH, stream.size() - first);
+                const auto packetStream = stream.subspan(first, count);
+                std::array<Ray, WIDTH> packetRays;
+                std::array<bool, WIDTH> packetOccluded;
+                for (std::size_t lane = 0; lane < count; ++lane) {
+                    packetRays[lane] = rays[packetStream[lane]];
+                }
+
+                intersectPPacket<WIDTH>(
+                    std::span{packetRays}.first(count),
+                    std::span{packetOccluded}.first(count),
+                    counters);
+
+                for (std::size_t lane = 0; lane < count; ++lane) {
+                    occluded[packetStream[lane]] = packetOccluded[lane];
+                }
+            }
+            this->traversalStats.add(bvh::RayQuery::AnyHit, counters);
+        });
     }
 } // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "pbrt/accelerators/bvh/BVHBuilders.hpp"
 
 #include <numeric>
+#include <vector>
 
 namespace idragnev::pbrt::accelerators::bvh {
     Bounds3f bounds(const std::span<const PrimitiveInfo> range) {
@@ -22,4 +23,41 @@ namespace idragnev::pbrt::accelerators::bvh {
                 return unionOf(acc, info.centroid);
             });
     }
+
+    BuildNode makeInteriorNode(BuildNode* const a, BuildNode* const b) {
+        const Point3f centroidA = 0.5f * a->bounds.min + 0.5f * a->bounds.max;
+        const Point3f centroidB = 0.5f * b->bounds.min + 0.5f * b->bounds.max;
+        const Vector3f delta = centroidB - centroidA;
+        const std::size_t splitAxis = maxDimension(abs(delta));
+
+        return (delta[splitAxis] >= 0.f) ? BuildNode::Interior(splitAxis, a, b)
+                                         : BuildNode::Interior(splitAxis, b, a);
+    }
+
+    Float sahCost(const BuildTree& tree) {
+        if (tree.root == nullptr) {
+            return 0.f;
+        }
+
+        Float cost = 0.f;
+        std::vector<const BuildNode*> nodesToVisit{tree.root};
+        while (nodesToVisit.empty() == false) {
+            const BuildNode* const node = nodesToVisit.back();
+            nodesToVisit.pop_back();
+
+            if (node->primitivesCount > 0) {
+                cost += node->bounds.surfaceArea() *
+                        static_cast<Float>(node->primitivesCount);
+            }
+            else {
+                cost += node->bounds.surfaceArea();
+                nodesToVisit.push_back(node->children[0]);
+                nodesToVisit.push_back(node->children[1]);
+            }
+        }
+
+        const Float rootArea = tree.root->bounds.surfaceArea();
+
+        return rootArea > 0.f ? cost / rootArea : 0.f;
+    }
 } // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "pbrt/accelerators/bvh/BVHStatistics.hpp"
+
+#include <ostream>
+
+namespace idragnev::pbrt::accelerators::bvh {
+    void printHistogram(std::ostream& os,
+                        const char* const label,
+                        const std::vector<std::size_t>& histogram) {
+        os << "  " << label << ":\n";
+        for (std::size_t i = 0; i < histogram.size(); ++i) {
+            if (histogram[i] > 0) {
+                os << "    " << i << ": " << histogram[i] << '\n';
+            }
+        }
+    }
+
+    std::ostream& operator<<(std::ostream& os, const BuildStatistics& stats) {
+        const auto ms = [](const std::chrono::duration<double> d) {
+            return std::chrono::duration<double, std::milli>(d).count();
+        };
+
+        os << "BVH build statistics:\n"
+           << "  nodes: " << stats.nodesCount
+           << " (interior: " << stats.interiorNodesCount
+           << ", leaves: " << stats.leavesCount
+           << ", triangle leaves: " << stats.triangleLeavesCount << ")\n"
+           << "  max depth: " << stats.maxDepth << '\n'
+           << "  memory (bytes): " << stats.memoryUsage << '\n'
+           << "  SAH cost: " << stats.sahCost << '\n'
+           << "  phase times (ms): tree build "
+           << ms(stats.phaseTimes.treeBuild) << ", treelet restructuring "
+           << ms(stats.phaseTimes.treeletRestructuring) << ", flattening "
+           << ms(stats.phaseTimes.flattening) << ", leaf triangles "
+           << ms(stats.phaseTimes.leafTriangles) << '\n';
+
+        printHistogram(os, "leaves by depth", stats.leafDepthHistogram);
+        printHistogram(os,
+                       "leaves by primitives count",
+                       stats.leafSizeHistogram);
+
+        return os;
+    }
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
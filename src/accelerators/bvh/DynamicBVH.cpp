@@ -0,0 +1,385 @@
+#include "pbrt/accelerators/bvh/DynamicBVH.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace idragnev::pbrt::accelerators {
+    namespace constants {
+        inline constexpr std::uint32_t NULL_NODE =
+            std::numeric_limits<std::uint32_t>::max();
+        // Traversals of higher trees allocate their stack
+        inline constexpr std::size_t DYNAMIC_BVH_STACK_SIZE = 64;
+    } // namespace constants
+
+    struct DynamicBVH::Node
+    {
+        bool isLeaf() const noexcept {
+            return children[0] == constants::NULL_NODE;
+        }
+
+        Bounds3f bounds;
+        // The next node of the free list for free nodes
+        std::uint32_t parent = constants::NULL_NODE;
+        // Ordered by their centroids along `splitAxis`,
+        // as front-to-back traversal expects
+        std::uint32_t children[2] = {constants::NULL_NODE,
+                                     constants::NULL_NODE};
+        std::uint16_t height = 1;
+        std::uint8_t splitAxis = 0;
+    };
+
+    Point3f centroid(const Bounds3f& b);
+
+    DynamicBVH::DynamicBVH()
+        : rootIndex(constants::NULL_NODE)
+        , freeListHead(constants::NULL_NODE) {}
+
+    DynamicBVH::~DynamicBVH() = default;
+
+    std::size_t DynamicBVH::size() const noexcept {
+        return this->primitivesCount;
+    }
+
+    std::size_t DynamicBVH::height() const noexcept {
+        return this->rootIndex != constants::NULL_NODE
+                   ? this->nodes[this->rootIndex].height
+                   : 0;
+    }
+
+    Bounds3f DynamicBVH::worldBound() const {
+        return this->rootIndex != constants::NULL_NODE
+                   ? this->nodes[this->rootIndex].bounds
+                   : Bounds3f{};
+    }
+
+    std::uint32_t DynamicBVH::allocateNode() {
+        if (this->freeListHead != constants::NULL_NODE) {
+            const std::uint32_t index = this->freeListHead;
+            this->freeListHead = this->nodes[index].parent;
+            this->nodes[index] = Node{};
+            return index;
+        }
+
+        assert(this->nodes.size() < constants::NULL_NODE);
+
+        this->nodes.emplace_back();
+        this->primitives.emplace_back();
+        return static_cast<std::uint32_t>(this->nodes.size() - 1);
+    }
+
+    void DynamicBVH::freeNode(const std::uint32_t index) {
+        this->nodes[index] = Node{};
+        this->nodes[index].parent = this->freeListHead;
+        this->primitives[index] = nullptr;
+        this->freeListHead = index;
+    }
+
+    DynamicBVH::Handle
+    DynamicBVH::insert(std::shared_ptr<const Primitive> primitive) {
+        assert(primitive != nullptr);
+
+        const std::uint32_t leaf = allocateNode();
+        this->nodes[leaf].bounds = primitive->worldBound();
+        this->primitives[leaf] = std::move(primitive);
+        ++this->primitivesCount;
+
+        if (this->rootIndex == constants::NULL_NODE) {
+            this->rootIndex = leaf;
+            return leaf;
+        }
+
+        const std::uint32_t sibling =
+            findBestSibling(this->nodes[leaf].bounds);
+        const std::uint32_t oldParent = this->nodes[sibling].parent;
+        const std::uint32_t newParent = allocateNode();
+
+        Node& parent = this->nodes[newParent];
+        parent.parent = oldParent;
+        parent.children[0] = sibling;
+        parent.children[1] = leaf;
+        this->nodes[sibling].parent = newParent;
+        this->nodes[leaf].parent = newParent;
+
+        if (oldParent == constants::NULL_NODE) {
+            this->rootIndex = newParent;
+        }
+        else {
+            auto& children = this->nodes[oldParent].children;
+            children[children[0] == sibling ? 0 : 1] = newParent;
+        }
+
+        refitAncestors(newParent);
+
+        return leaf;
+    }
+
+    void DynamicBVH::remove(const Handle leaf) {
+        assert(leaf < this->nodes.size());
+        assert(this->nodes[leaf].isLeaf() && this->primitives[leaf]);
+
+        const std::uint32_t parent = this->nodes[leaf].parent;
+        freeNode(leaf);
+        --this->primitivesCount;
+
+        if (parent == constants::NULL_NODE) {
+            this->rootIndex = constants::NULL_NODE;
+            return;
+        }
+
+        const auto& parentChildren = this->nodes[parent].children;
+        const std::uint32_t sibling =
+            parentChildren[0] == leaf ? parentChildren[1] : parentChildren[0];
+        const std::uint32_t grandparent = this->nodes[parent].parent;
+        freeNode(parent);
+
+        this->nodes[sibling].parent = grandparent;
+        if (grandparent == constants::NULL_NODE) {
+            this->rootIndex = sibling;
+        }
+        else {
+            auto& children = this->nodes[grandparent].children;
+            children[children[0] == parent ? 0 : 1] = sibling;
+
+            refitAncestors(grandparent);
+        }
+    }
+
+    // Finds the node whose sibling the new leaf should become to
+    // increase the total surface area of the interior nodes the least.
+    // The cost of a sibling is the surface area of the new parent plus
+    // the increase of the surface areas of its ancestors - inherited by
+    // the children of each visited node. Subtrees whose inherited cost
+    // plus the area of the leaf - a lower bound for the cost of any of
+    // their nodes - is not less than the best cost found are skipped.
+    std::uint32_t
+    DynamicBVH::findBestSibling(const Bounds3f& leafBounds) const {
+        struct Candidate
+        {
+            bool operator>(const Candidate& other) const noexcept {
+                return inheritedCost > other.inheritedCost;
+            }
+
+            Float inheritedCost = 0.f;
+            std::uint32_t index = 0;
+        };
+
+        const Float leafArea = leafBounds.surfaceArea();
+
+        std::uint32_t best = this->rootIndex;
+        Float bestCost =
+            unionOf(this->nodes[best].bounds, leafBounds).surfaceArea();
+
+        std::priority_queue<Candidate,
+                            std::vector<Candidate>,
+                            std::greater<Candidate>>
+            candidates;
+        candidates.push(Candidate{0.f, this->rootIndex});
+
+        while (candidates.empty() == false) {
+            const Candidate candidate = candidates.top();
+            candidates.pop();
+
+            if (candidate.inheritedCost + leafArea >= bestCost) {
+                break;
+            }
+
+            const Node& node = this->nodes[candidate.index];
+            const Float directCost =
+                unionOf(node.bounds, leafBounds).surfaceArea();
+            const Float cost = directCost + candidate.inheritedCost;
+            if (cost < bestCost) {
+                best = candidate.index;
+                bestCost = cost;
+            }
+
+            if (node.isLeaf() == false) {
+                const Float inheritedCost = candidate.inheritedCost +
+                                            directCost -
+                                            node.bounds.surfaceArea();
+                if (inheritedCost + leafArea < bestCost) {
+                    candidates.push(Candidate{inheritedCost, node.children[0]});
+                    candidates.push(Candidate{inheritedCost, node.children[1]});
+                }
+            }
+        }
+
+        return best;
+    }
+
+    // Updates the nodes on the path from `index` to the root,
+    // rotating each of them first.
+    void DynamicBVH::refitAncestors(std::uint32_t index) {
+        while (index != constants::NULL_NODE) {
+            rotate(index);
+            updateNode(index);
+            index = this->nodes[index].parent;
+        }
+    }
+
+    // Swaps a child of the node at `index` with a child of its other
+    // child if that lowers the surface area of the other child the most.
+    // The children of the node must be up to date.
+    void DynamicBVH::rotate(const std::uint32_t index) {
+        struct Rotation
+        {
+            std::uint32_t child = 0;
+            std::uint32_t grandchild = 0;
+            Float areaDecrease = 0.f;
+        };
+
+        const auto& children = this->nodes[index].children;
+
+        Rotation best;
+        for (const std::size_t i : {0u, 1u}) {
+            const std::uint32_t child = children[i];
+            const Node& other = this->nodes[children[1 - i]];
+            if (other.isLeaf()) {
+                continue;
+            }
+
+            for (const std::size_t j : {0u, 1u}) {
+                const Node& kept = this->nodes[other.children[1 - j]];
+                const Float area =
+                    unionOf(this->nodes[child].bounds, kept.bounds)
+                        .surfaceArea();
+                const Float decrease = other.bounds.surfaceArea() - area;
+                if (decrease > best.areaDecrease) {
+                    best = Rotation{child, other.children[j], decrease};
+                }
+            }
+        }
+
+        if (best.areaDecrease > 0.f) {
+            const std::uint32_t other = this->nodes[best.grandchild].parent;
+
+            auto& nodeChildren = this->nodes[index].children;
+            nodeChildren[nodeChildren[0] == best.child ? 0 : 1] =
+                best.grandchild;
+            auto& otherChildren = this->nodes[other].children;
+            otherChildren[otherChildren[0] == best.grandchild ? 0 : 1] =
+                best.child;
+
+            this->nodes[best.grandchild].parent = index;
+            this->nodes[best.child].parent = other;
+
+            updateNode(other);
+        }
+    }
+
+    // Recomputes the bounds, the height and the split axis
+    // of the interior node at `index` from its children.
+    void DynamicBVH::updateNode(const std::uint32_t index) {
+        Node& node = this->nodes[index];
+        const Node& first = this->nodes[node.children[0]];
+        const Node& second = this->nodes[node.children[1]];
+
+        node.bounds = unionOf(first.bounds, second.bounds);
+        node.height = static_cast<std::uint16_t>(
+            1 + std::max(first.height, second.height));
+
+        const Point3f firstCentroid = centroid(first.bounds);
+        const Point3f secondCentroid = centroid(second.bounds);
+        const Vector3f separation = abs(secondCentroid - firstCentroid);
+        node.splitAxis = static_cast<std::uint8_t>(
+            maxDimension(separation));
+
+        if (firstCentroid[node.splitAxis] > secondCentroid[node.splitAxis]) {
+            std::swap(node.children[0], node.children[1]);
+        }
+    }
+
+    Point3f centroid(const Bounds3f& b) { return 0.5f * b.min + 0.5f * b.max; }
+
+    Optional<SurfaceInteraction> DynamicBVH::intersect(const Ray& ray) const {
+        Optional<SurfaceInteraction> result = pbrt::nullopt;
+
+        traverse(
+            [&result, &ray](const Primitive& primitive) {
+                if (auto interaction = primitive.intersect(ray);
+                    interaction.has_value())
+                {
+                    result = std::move(interaction);
+                }
+                return false;
+            },
+            ray);
+
+        return result;
+    }
+
+    bool DynamicBVH::intersectP(const Ray& ray) const {
+        bool isOccluded = false;
+
+        traverse(
+            [&isOccluded, &ray](const Primitive& primitive) {
+                isOccluded = primitive.intersectP(ray);
+                return isOccluded;
+            },
+            ray);
+
+        return isOccluded;
+    }
+
+    // Calls `visitLeaf` with the primitive of each intersected leaf
+    // and stops if it returns true, as BVH::traverseWithStack does.
+    template <typename LeafVisitor>
+    void DynamicBVH::traverse(LeafVisitor&& visitLeaf, const Ray& ray) const {
+        // A traversal holds at most one node to visit
+        // per node on the current path
+        const std::size_t treeHeight = height();
+        if (treeHeight == 0) {
+            return;
+        }
+        else if (treeHeight <= constants::DYNAMIC_BVH_STACK_SIZE) {
+            std::array<std::uint32_t, constants::DYNAMIC_BVH_STACK_SIZE> stack;
+            traverse(visitLeaf, ray, stack);
+        }
+        else {
+            std::vector<std::uint32_t> stack(treeHeight);
+            traverse(visitLeaf, ray, stack);
+        }
+    }
+
+    template <typename LeafVisitor>
+    void DynamicBVH::traverse(
+        LeafVisitor&& visitLeaf,
+        const Ray& ray,
+        const std::span<std::uint32_t> nodesToVisit) const {
+        const Vector3f invDir{1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z};
+        const std::size_t dirIsNegative[3] = {invDir.x < 0.f ? 1u : 0u,
+                                              invDir.y < 0.f ? 1u : 0u,
+                                              invDir.z < 0.f ? 1u : 0u};
+
+        std::size_t toVisitCount = 0;
+        nodesToVisit[toVisitCount++] = this->rootIndex;
+
+        while (toVisitCount > 0) {
+            const std::uint32_t nodeIndex = nodesToVisit[--toVisitCount];
+            const Node& node = this->nodes[nodeIndex];
+
+            if (node.bounds.intersectP(ray, invDir, dirIsNegative)) {
+                if (node.isLeaf()) {
+                    if (bool stop = visitLeaf(*this->primitives[nodeIndex]);
+                        stop)
+                    {
+                        return;
+                    }
+                }
+                else if (dirIsNegative[node.splitAxis] == 1) {
+                    nodesToVisit[toVisitCount++] = node.children[0];
+                    nodesToVisit[toVisitCount++] = node.children[1];
+                }
+                else {
+                    nodesToVisit[toVisitCount++] = node.children[1];
+                    nodesToVisit[toVisitCount++] = node.children[0];
+                }
+            }
+        }
+    }
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include "pbrt/accelerators/bvh/GeometryProxy.hpp"
+#include "pbrt/core/primitive/GeometricPrimitive.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/shapes/OBJMesh.hpp"
+#include "pbrt/shapes/PLYMesh.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <cctype>
+#include <string>
+
+namespace idragnev::pbrt::accelerators {
+    // The geometry of a proxy with the BVH built over it
+    struct GeometryCache::Geometry
+    {
+        Geometry(LoadedGeometry&& loaded,
+                 const bvh::SplitMethod m,
+                 const std::uint32_t maxPrimitivesInNode)
+            : resources(std::move(loaded.resources))
+            , bvh(std::move(loaded.primitives), m, maxPrimitivesInNode)
+            , memoryUsage(loaded.memoryUsage +
+                          bvh.buildStatistics().memoryUsage) {}
+
+        // declared before the BVH so that it outlives the primitives
+        std::shared_ptr<const void> resources;
+        BVH bvh;
+        std::size_t memoryUsage = 0;
+    };
+
+    Optional<std::vector<std::shared_ptr<Shape>>>
+    loadMeshFile(const std::filesystem::path& path,
+                 const Transformation& objectToWorld,
+                 const Transformation& worldToObject,
+                 const bool reverseOrientation);
+
+    GeometryLoader meshFileLoader(std::filesystem::path path,
+                                  const Transformation& objectToWorld,
+                                  const bool reverseOrientation,
+                                  std::shared_ptr<const Material> material) {
+        // the triangles refer to their transformations
+        const auto transformations =
+            std::make_shared<const std::array<Transformation, 2>>(
+                std::array{objectToWorld, inverse(objectToWorld)});
+
+        return [path = std::move(path),
+                transformations,
+                reverseOrientation,
+                material = std::move(material)]() -> Optional<LoadedGeometry> {
+            const auto& [objectToWorld, worldToObject] = *transformations;
+            const auto shapes = loadMeshFile(path,
+                                             objectToWorld,
+                                             worldToObject,
+                                             reverseOrientation);
+            if (!shapes.has_value()) {
+                return pbrt::nullopt;
+            }
+
+            LoadedGeometry result;
+            result.primitives.reserve(shapes->size());
+            for (const auto& shape : *shapes) {
+                result.primitives.push_back(
+                    std::make_shared<GeometricPrimitive>(shape,
+                                                         material,
+                                                         nullptr,
+                                                         MediumInterface{}));
+            }
+            result.resources = transformations;
+            result.memoryUsage =
+                shapes->size() * sizeof(GeometricPrimitive) +
+                (shapes->empty()
+                     ? 0
+                     : static_cast<const shapes::Triangle&>(*shapes->front())
+                           .mesh()
+                           .memoryUsage());
+
+            return pbrt::make_optional(std::move(result));
+        };
+    }
+
+    // Loads the mesh with loadPLYMesh or loadOBJMesh by the extension
+    // of the file, in any case.
+    Optional<std::vector<std::shared_ptr<Shape>>>
+    loadMeshFile(const std::filesystem::path& path,
+                 const Transformation& objectToWorld,
+                 const Transformation& worldToObject,
+                 const bool reverseOrientation) {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(),
+                       extension.end(),
+                       extension.begin(),
+                       [](const unsigned char c) {
+                           return static_cast<char>(std::tolower(c));
+                       });
+
+        if (extension == ".ply") {
+            return shapes::loadPLYMesh(path,
+                                       objectToWorld,
+                                       worldToObject,
+                                       reverseOrientation);
+        }
+        if (extension == ".obj") {
+            return shapes::loadOBJMesh(path,
+                                       objectToWorld,
+                                       worldToObject,
+                                       reverseOrientation);
+        }
+
+        return pbrt::nullopt;
+    }
+
+    GeometryCache::GeometryCache(const std::size_t memoryBudget)
+        : budget(memoryBudget) {}
+
+    GeometryCache::~GeometryCache() = default;
+
+    void GeometryCache::releaseEvictedGeometry() {
+        const auto lock = std::lock_guard{this->mutex};
+        this->evicted.clear();
+        this->orphaned.clear();
+        this->evictedUsage = 0;
+    }
+
+    std::size_t GeometryCache::memoryBudget() const noexcept {
+        return this->budget;
+    }
+
+    std::size_t GeometryCache::memoryUsage() const {
+        const auto lock = std::lock_guard{this->mutex};
+        return this->usage;
+    }
+
+    std::size_t GeometryCache::evictedMemoryUsage() const {
+        const auto lock = std::lock_guard{this->mutex};
+        return this->evictedUsage;
+    }
+
+    std::size_t GeometryCache::loadedProxiesCount() const {
+        const auto lock = std::lock_guard{this->mutex};
+        return this->entries.size();
+    }
+
+    GeometryCacheStatistics GeometryCache::statistics() const {
+        const auto lock = std::lock_guard{this->mutex};
+        return this->stats;
+    }
+
+    std::shared_ptr<const GeometryCache::Geometry>
+    GeometryCache::find(const GeometryProxy& proxy) {
+        const auto lock = std::lock_guard{this->mutex};
+
+        if (const auto it = this->entryOfProxy.find(&proxy);
+            it != this->entryOfProxy.end())
+        {
+            // splicing keeps the iterators to the entries valid
+            this->entries.splice(this->entries.begin(),
+                                 this->entries,
+                                 it->second);
+
+            return it->second->geometry;
+        }
+
+        // Evicted geometry is still in memory, so it is restored
+        // instead of loading a second copy of it
+        const auto it = this->evicted.find(&proxy);
+        if (it == this->evicted.end()) {
+            return nullptr;
+        }
+
+        std::shared_ptr<const Geometry> geometry = std::move(it->second);
+        this->evicted.erase(it);
+        this->evictedUsage -= geometry->memoryUsage;
+        ++this->stats.restoresCount;
+        pushMostRecentlyUsed(proxy, geometry);
+
+        return geometry;
+    }
+
+    bool GeometryCache::contains(const GeometryProxy& proxy) const {
+        const auto lock = std::lock_guard{this->mutex};
+        return this->entryOfProxy.contains(&proxy);
+    }
+
+    void GeometryCache::insert(const GeometryProxy& proxy,
+                               std::shared_ptr<const Geometry> geometry) {
+        const auto lock = std::lock_guard{this->mutex};
+        assert(!this->entryOfProxy.contains(&proxy) &&
+               !this->evicted.contains(&proxy));
+
+        ++this->stats.loadsCount;
+        pushMostRecentlyUsed(proxy, std::move(geometry));
+    }
+
+    void GeometryCache::pushMostRecentlyUsed(
+        const GeometryProxy& proxy,
+        std::shared_ptr<const Geometry> geometry) {
+        this->usage += geometry->memoryUsage;
+        this->entries.push_front(Entry{&proxy, std::move(geometry)});
+        this->entryOfProxy.emplace(&proxy, this->entries.begin());
+
+        while (this->usage > this->budget && this->entries.size() > 1) {
+            evictLeastRecentlyUsed();
+        }
+    }
+
+    void GeometryCache::evictLeastRecentlyUsed() {
+        Entry& entry = this->entries.back();
+        this->usage -= entry.geometry->memoryUsage;
+        this->evictedUsage += entry.geometry->memoryUsage;
+        this->entryOfProxy.erase(entry.proxy);
+        this->evicted.emplace(entry.proxy, std::move(entry.geometry));
+        this->entries.pop_back();
+        ++this->stats.evictionsCount;
+    }
+
+    // The interactions found in the geometry of a destroyed proxy
+    // may still be in use, so it is released with the evicted geometry.
+    // It is no longer found by the address of the proxy, which
+    // another proxy may take.
+    void GeometryCache::erase(const GeometryProxy& proxy) {
+        const auto lock = std::lock_guard{this->mutex};
+
+        if (const auto it = this->entryOfProxy.find(&proxy);
+            it != this->entryOfProxy.end())
+        {
+            this->usage -= it->second->geometry->memoryUsage;
+            this->evictedUsage += it->second->geometry->memoryUsage;
+            this->orphaned.push_back(std::move(it->second->geometry));
+            this->entries.erase(it->second);
+            this->entryOfProxy.erase(it);
+        }
+        if (const auto it = this->evicted.find(&proxy);
+            it != this->evicted.end())
+        {
+            this->orphaned.push_back(std::move(it->second));
+            this->evicted.erase(it);
+        }
+    }
+
+    void GeometryCache::recordFailedLoad() {
+        const auto lock = std::lock_guard{this->mutex};
+        ++this->stats.failedLoadsCount;
+    }
+
+    GeometryProxy::GeometryProxy(const Bounds3f& bounds,
+                                 GeometryLoader load,
+                                 std::shared_ptr<GeometryCache> cache,
+                                 const bvh::SplitMethod m,
+                                 const std::uint32_t maxPrimitivesInNode)
+        : bounds(bounds)
+        , load(std::move(load))
+        , cache(std::move(cache))
+        , splitMethod(m)
+        , maxPrimitivesInNode(maxPrimitivesInNode) {
+        assert(this->cache != nullptr);
+    }
+
+    GeometryProxy::~GeometryProxy() { this->cache->erase(*this); }
+
+    Bounds3f GeometryProxy::worldBound() const { return this->bounds; }
+
+    // The bounds are tested first so that only the rays
+    // which reach them load the geometry.
+    Optional<SurfaceInteraction>
+    GeometryProxy::intersect(const Ray& ray) const {
+        if (!this->bounds.intersectP(ray).has_value()) {
+            return pbrt::nullopt;
+        }
+
+        // held until the traversal ends, even if evicted meanwhile
+        const auto geometry = this->geometry();
+
+        return geometry != nullptr ? geometry->bvh.intersect(ray)
+                                   : pbrt::nullopt;
+    }
+
+    bool GeometryProxy::intersectP(const Ray& ray) const {
+        if (!this->bounds.intersectP(ray).has_value()) {
+            return false;
+        }
+
+        const auto geometry = this->geometry();
+
+        return geometry != nullptr && geometry->bvh.intersectP(ray);
+    }
+
+    bool GeometryProxy::isLoaded() const {
+        return this->cache->contains(*this);
+    }
+
+    std::shared_ptr<const GeometryCache::Geometry>
+    GeometryProxy::geometry() const {
+        if (this->failedToLoad) {
+            return nullptr;
+        }
+        if (auto geometry = this->cache->find(*this)) {
+            return geometry;
+        }
+
+        const auto lock = std::lock_guard{this->loadMutex};
+        // loaded by another query while this one waited
+        if (auto geometry = this->cache->find(*this)) {
+            return geometry;
+        }
+        if (this->failedToLoad) {
+            return nullptr;
+        }
+
+        Optional<LoadedGeometry> loaded = this->load();
+        if (!loaded.has_value()) {
+            this->failedToLoad = true;
+            this->cache->recordFailedLoad();
+            return nullptr;
+        }
+
+        auto geometry = std::make_shared<const GeometryCache::Geometry>(
+            std::move(*loaded),
+            this->splitMethod,
+            this->maxPrimitivesInNode);
+        this->cache->insert(*this, geometry);
+
+        return geometry;
+    }
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
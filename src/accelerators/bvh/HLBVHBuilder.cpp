@@ -1,35 +1,28 @@
 #include "pbrt/accelerators/bvh/HLBVHBuilder.hpp"
+#include "pbrt/accelerators/bvh/Morton.hpp"
 #include "pbrt/functional/Functional.hpp"
 #include "pbrt/parallel/Parallel.hpp"
 
 #include <numeric>
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <atomic>
 
 namespace idragnev::pbrt::accelerators::bvh {
     namespace constants {
-        constexpr std::uint32_t MORTON_CODE_BITS = 30;
-        constexpr std::uint32_t MORTON_DIMENSION_BITS = MORTON_CODE_BITS / 3;
-        constexpr std::uint32_t MORTON_DIMENSION_MAX = 1 << MORTON_DIMENSION_BITS;
         constexpr std::uint32_t MORTON_CODE_CLUSTER_BITS = 12;
-        constexpr std::uint32_t MORTON_CODE_CLUSTER_MASK = 0b00111111111111000000000000000000;
+        constexpr std::uint64_t MORTON_CODE_CLUSTER_MASK =
+            ((std::uint64_t{1} << MORTON_CODE_CLUSTER_BITS) - 1)
+            << (MORTON_CODE_BITS - MORTON_CODE_CLUSTER_BITS);
+        constexpr std::size_t NO_PARENT =
+            std::numeric_limits<std::size_t>::max();
+        constexpr std::int64_t CHUNK_SIZE = 512;
     } // namespace constants
 
-    struct MortonPrimitive
-    {
-        std::size_t index = 0;
-        std::uint32_t mortonCode = 0;
-    };
-
-    std::vector<MortonPrimitive>
-    toMortonPrimitives(const std::vector<PrimitiveInfo>& primsInfo);
-    std::uint32_t encodeMorton3(const Vector3f& v);
-    std::uint32_t leftShift3(std::uint32_t x);
-
-    [[nodiscard]] std::vector<MortonPrimitive>
-    radixSort(std::vector<MortonPrimitive> vec);
-
-    Optional<std::size_t>
-    findSplitPosition(const std::span<const MortonPrimitive> prims,
-                      const std::uint32_t splitMask) noexcept;
+    int commonPrefixLength(const std::span<const MortonPrimitive> prims,
+                           const std::int64_t i,
+                           const std::int64_t j) noexcept;
 
     // Represents a cluster of primitives which
     // have matching bits for the selected morton code mask.
@@ -46,10 +39,34 @@ namespace idragnev::pbrt::accelerators::bvh {
         BuildNode* nodes = nullptr;
     };
 
+    // An internal node of the binary radix tree built over the
+    // sorted morton codes of a treelet. All indices are positions
+    // in the sorted morton primitives array.
+    // The node covers the inclusive range [first .. last] and
+    // its children cover [first .. split] and [split + 1 .. last].
+    // The radix tree of a treelet with N primitives has N - 1 internal
+    // nodes which are stored at [treelet.first .. treelet.first + N - 1).
+    struct RadixTreeNode
+    {
+        std::size_t first = 0;
+        std::size_t last = 0;
+        std::size_t split = 0;
+        std::size_t parent = constants::NO_PARENT;
+        std::size_t splitAxis = 0;
+    };
+
+    struct RadixTree
+    {
+        std::vector<RadixTreeNode> internalNodes;
+        std::vector<std::size_t> leafParents;
+    };
+
     std::vector<LBVHTreelet>
     splitToTreelets(const std::vector<MortonPrimitive>& prims,
                     memory::MemoryArena& arena,
                     const bool zeroInitializeAllocatedNodes);
+    std::size_t treeletIndex(const std::vector<LBVHTreelet>& treelets,
+                             const std::size_t primIndex) noexcept;
 
     BuildResult HLBVHBuilder::operator()(memory::MemoryArena& arena,
                                          const PrimsVec& primitives) { 
@@ -79,127 +96,6 @@ namespace idragnev::pbrt::accelerators::bvh {
         return buildBVH(arena, std::move(lls));
     }
 
-    std::vector<MortonPrimitive>
-    toMortonPrimitives(const std::vector<PrimitiveInfo>& primsInfo) {
-        std::vector<MortonPrimitive> result{primsInfo.size()};
-
-        const Bounds3f primsCentroidBounds =
-            centroidBounds(std::span{primsInfo.cbegin(), primsInfo.size()});
-
-        constexpr std::int64_t CHUNK_SIZE = 512;
-        const auto iterationsCount =
-            static_cast<std::int64_t>(primsInfo.size());
-
-        parallel::parallelFor(
-            [&result, &primsInfo, &primsCentroidBounds](const std::int64_t i) {
-                const auto& info = primsInfo[static_cast<std::size_t>(i)];
-                auto& primitive = result[static_cast<std::size_t>(i)];
-
-                const Vector3f centroidOffset =
-                    primsCentroidBounds.offset(info.centroid);
-
-                primitive.index = info.index;
-                primitive.mortonCode = encodeMorton3(
-                    constants::MORTON_DIMENSION_MAX * centroidOffset);
-            },
-            iterationsCount,
-            CHUNK_SIZE);
-
-        return result;
-    }
-
-    std::uint32_t encodeMorton3(const Vector3f& v) {
-        assert(static_cast<int>(v.x) >= 0);
-        assert(static_cast<int>(v.y) >= 0);
-        assert(static_cast<int>(v.z) >= 0);
-
-        const auto x = static_cast<std::uint32_t>(v.x);
-        const auto y = static_cast<std::uint32_t>(v.y);
-        const auto z = static_cast<std::uint32_t>(v.z);
-
-        return (leftShift3(z) << 2) |
-               (leftShift3(y) << 1) |
-                leftShift3(x);
-    }
-
-    std::uint32_t leftShift3(std::uint32_t x) {
-        using constants::MORTON_DIMENSION_MAX;
-
-        assert(x <= MORTON_DIMENSION_MAX);
-        if (x == MORTON_DIMENSION_MAX) {
-            --x;
-        }
-
-        x = (x | (x << 16)) & 0b00000011000000000000000011111111;
-        // x = ---- --98 ---- ---- ---- ---- 7654 3210
-
-        x = (x | (x << 8)) & 0b00000011000000001111000000001111;
-        // x = ---- --98 ---- ---- 7654 ---- ---- 3210
-
-        x = (x | (x << 4)) & 0b00000011000011000011000011000011;
-        // x = ---- --98 ---- 76-- --54 ---- 32-- --10
-
-        x = (x | (x << 2)) & 0b00001001001001001001001001001001;
-        // x = ---- 9--8 --7- -6-- 5--4 --3- -2-- 1--0
-
-        return x;
-    }
-
-    std::vector<MortonPrimitive> radixSort(std::vector<MortonPrimitive> input) {
-        using constants::MORTON_CODE_BITS;
-
-        constexpr std::size_t BITS_PER_PASS = 6;
-        static_assert((MORTON_CODE_BITS % BITS_PER_PASS) == 0,
-                      "BITS_PER_PASS must evenly divide MORTON_CODE_BITS");
-
-        constexpr std::size_t PASSES_COUNT = MORTON_CODE_BITS / BITS_PER_PASS;
-        constexpr std::size_t BUCKETS_COUNT = 1 << BITS_PER_PASS;
-
-        const auto bucketIndex = [](const std::uint32_t mortonCode,
-                                    const std::size_t lowBit) {
-            constexpr std::size_t mask = (1 << BITS_PER_PASS) - 1;
-            const auto result = (mortonCode >> lowBit) & mask;
-
-            assert(result < BUCKETS_COUNT);
-
-            return result;
-        };
-
-        std::vector<MortonPrimitive> temp{input.size()};
-        for (std::size_t pass = 0; pass < PASSES_COUNT; ++pass) {
-            const std::size_t lowBit = pass * BITS_PER_PASS;
-
-            const std::vector<MortonPrimitive>& in = (pass & 1) ? temp : input;
-            std::vector<MortonPrimitive>& out = (pass & 1) ? input : temp;
-
-            std::size_t bucketSizes[BUCKETS_COUNT] = {};
-            for (const MortonPrimitive& mp : in) {
-                const std::size_t index = bucketIndex(mp.mortonCode, lowBit);
-                ++bucketSizes[index];
-            }
-
-            std::size_t outIndices[BUCKETS_COUNT] = {};
-            for (std::size_t i = 1; i < BUCKETS_COUNT; ++i) {
-                outIndices[i] = outIndices[i - 1] + bucketSizes[i - 1];
-            }
-
-            for (const MortonPrimitive& mp : in) {
-                const std::size_t bucket = bucketIndex(mp.mortonCode, lowBit);
-                const std::size_t outIndex = outIndices[bucket];
-
-                out[outIndex] = mp;
-                ++outIndices[bucket];
-            }
-        }
-
-        if constexpr (PASSES_COUNT & 1) {
-            return temp;
-        }
-        else {
-            return input;
-        }
-    }
-
     // Generates a vector of `LBVHTreelet`s -
     // one treelet for each cluster of primitives with matching
     // morton code bits for the selected bit mask.
@@ -241,172 +137,270 @@ namespace idragnev::pbrt::accelerators::bvh {
         return result;
     }
 
+    std::size_t treeletIndex(const std::vector<LBVHTreelet>& treelets,
+                             const std::size_t primIndex) noexcept {
+        const auto pos = std::upper_bound(
+            treelets.cbegin(),
+            treelets.cend(),
+            primIndex,
+            [](const std::size_t i, const LBVHTreelet& t) {
+                return i < t.firstPrimitiveIndex;
+            });
+        assert(pos != treelets.cbegin());
+
+        return static_cast<std::size_t>(pos - treelets.cbegin()) - 1;
+    }
+
+    // Builds the LBVH of each treelet without recursion:
+    //   - the internal nodes of the binary radix trees of all treelets
+    //     are computed independently of each other in parallel
+    //   - the build nodes are emitted bottom-up in parallel,
+    //     starting from each primitive
     HLBVHBuilder::LowerLevels HLBVHBuilder::buildLowerLevels(
         std::vector<LBVHTreelet>&& treelets,
         const std::vector<MortonPrimitive>& mortonPrimInfos) const {
-        // start with the highest morton code bit which is not guaranteed
-        // to be the same for each primitive in the cluster
-        constexpr std::size_t splitBit = (constants::MORTON_CODE_BITS - 1) -
-                                         constants::MORTON_CODE_CLUSTER_BITS;
+        std::vector<std::uint8_t> emittedNodesCounts(mortonPrimInfos.size(), 0);
+        const RadixTree radixTree =
+            buildRadixTrees(treelets, mortonPrimInfos, emittedNodesCounts);
 
-        std::atomic<std::size_t> nodesCount = 0;
-        std::atomic<std::size_t> orderedPrimsFreePosition = 0;
         PrimsVec orderedPrimitives = {this->prims->size(), nullptr};
-
-        parallel::parallelFor(
-            [&treelets,
-             &nodesCount,
-             &orderedPrimsFreePosition,
-             &orderedPrimitives,
-             &mortonPrimInfos,
-             this](const std::int64_t i) {
-                LBVHTreelet& treelet = treelets[static_cast<std::size_t>(i)];
-
-                const auto lbvh = emitLBVH(
-                    treelet.nodes,
-                    std::span<const MortonPrimitive>{
-                        mortonPrimInfos.cbegin() + treelet.firstPrimitiveIndex,
-                        treelet.primitivesCount},
-                    orderedPrimitives,
-                    orderedPrimsFreePosition,
-                    splitBit);
-
-                treelet.nodes = lbvh.root;
-                nodesCount += lbvh.nodesCount;
-            },
-            static_cast<std::int64_t>(treelets.size()));
+        emitLBVHs(treelets, mortonPrimInfos, radixTree, orderedPrimitives);
 
         return LowerLevels{
+            // the root is the first internal node or
+            // the only leaf node of single primitive treelets
             .roots =
                 functional::fmap(treelets, [](auto& t) { return t.nodes; }),
-            .nodesCount = nodesCount,
+            .nodesCount = std::accumulate(emittedNodesCounts.cbegin(),
+                                          emittedNodesCounts.cend(),
+                                          std::size_t{0}),
             .orderedPrimitives = std::move(orderedPrimitives),
         };
     }
 
-    // Recursively builds a BVH on the allocated `buildNodes`
-    // using the range of morton primitives `primsRange`.
-    // Writes the corresponding primitives in the `orderedPrims` subrange
-    // [orderedPrimsFreePos .. orderedPrimsFreePos + primsRange.size)
-    // Splits the primitives based on the `splitBit` of their morton code.
-    // `buildNodes` is advanced each time a node is used,
-    // leaving the pointer pointing to an unused node.
+    // Computes the internal nodes of the binary radix tree
+    // of each treelet as described in "Maximizing Parallelism in the
+    // Construction of BVHs, Octrees, and k-d Trees" (Karras 2012).
+    // The range of each node is found from the common prefix lengths
+    // of the morton codes around it, so all nodes are processed in parallel.
+    // Writes the number of build nodes each radix tree node
+    // will emit in `emittedNodesCounts`.
     //
-    // (!) Assumes `primsRange` is sorted on MortonPrimitive::mortonCode (!)
-    BuildTree
-    HLBVHBuilder::emitLBVH(BuildNode*& buildNodes,
-                           const std::span<const MortonPrimitive> primsRange,
-                           PrimsVec& orderedPrims,
-                           std::atomic<std::size_t>& orderedPrimsFreePos,
-                           const int splitBit) const {
-        if (splitBit < 0 || primsRange.size() < this->maxPrimitivesInNode) {
-            const std::size_t firstPrimIndex =
-                orderedPrimsFreePos.fetch_add(primsRange.size());
-            BuildNode* const node = buildNodes++;
-            *node = makeLeafNode(primsRange, firstPrimIndex, orderedPrims);
-
-            return BuildTree{
-                .root = node,
-                .nodesCount = 1,
-            };
-        }
-        else {
-            const std::uint32_t splitMask = 1 << splitBit;
-            if ((primsRange.front().mortonCode & splitMask) ==
-                (primsRange.back().mortonCode & splitMask))
-            {
-                // prims are sorted -> they all match in this bit
-                return emitLBVH(buildNodes,
-                                primsRange,
-                                orderedPrims,
-                                orderedPrimsFreePos,
-                                splitBit - 1);
-            }
-
-            const auto splitPos = findSplitPosition(primsRange, splitMask)
-                                      .or_else([] {
-                                          assert(false);
-                                          return 0;
-                                      })
-                                      .value();
-
-            BuildNode* const node = buildNodes++;
-            const auto left = emitLBVH(buildNodes,
-                                       primsRange.first(splitPos),
-                                       orderedPrims,
-                                       orderedPrimsFreePos,
-                                       splitBit - 1);
-            const auto right = emitLBVH(buildNodes,
-                                        primsRange.subspan(splitPos),
-                                        orderedPrims,
-                                        orderedPrimsFreePos,
-                                        splitBit - 1);
-            const std::size_t splitAxis = splitBit % 3;
-            *node = BuildNode::Interior(splitAxis, left.root, right.root);
-
-            return BuildTree{
-                .root = node,
-                .nodesCount = left.nodesCount + right.nodesCount + 1,
-            };
-        }
-    }
+    // (!) Assumes `mortonPrims` is sorted on MortonPrimitive::mortonCode (!)
+    RadixTree HLBVHBuilder::buildRadixTrees(
+        const std::vector<LBVHTreelet>& treelets,
+        const std::vector<MortonPrimitive>& mortonPrims,
+        std::vector<std::uint8_t>& emittedNodesCounts) const {
+        RadixTree result{
+            .internalNodes = std::vector<RadixTreeNode>(mortonPrims.size()),
+            .leafParents = std::vector<std::size_t>(mortonPrims.size(),
+                                                    constants::NO_PARENT),
+        };
 
-    BuildNode HLBVHBuilder::makeLeafNode(
-        const std::span<const MortonPrimitive> primsRange,
-        const std::size_t firstPrimIndex,
-        PrimsVec& orderedPrims) const {
-        const PrimsVec& primitives = *(this->prims);
+        parallel::parallelFor(
+            [&treelets, &mortonPrims, &emittedNodesCounts, &result, this](
+                const std::int64_t g) {
+                const auto globalIndex = static_cast<std::size_t>(g);
+                const LBVHTreelet& treelet =
+                    treelets[treeletIndex(treelets, globalIndex)];
+                const std::size_t first = treelet.firstPrimitiveIndex;
+                const auto i = static_cast<std::int64_t>(globalIndex - first);
+
+                if (treelet.primitivesCount == 1) {
+                    // the treelet is a single leaf node
+                    emittedNodesCounts[globalIndex] = 1;
+                    return;
+                }
+                if (const auto n =
+                        static_cast<std::int64_t>(treelet.primitivesCount);
+                    i == n - 1) {
+                    // there are only N - 1 internal nodes
+                    return;
+                }
+
+                const auto prims = std::span<const MortonPrimitive>{
+                    mortonPrims.cbegin() + first,
+                    treelet.primitivesCount};
+                const auto delta = [&prims, i](const std::int64_t j) {
+                    return commonPrefixLength(prims, i, j);
+                };
+
+                // direction of the range
+                const std::int64_t d = delta(i + 1) > delta(i - 1) ? 1 : -1;
+
+                // upper bound for the length of the range
+                const int deltaMin = delta(i - d);
+                std::int64_t lMax = 2;
+                while (delta(i + lMax * d) > deltaMin) {
+                    lMax *= 2;
+                }
+
+                // the other end of the range, found with binary search
+                std::int64_t l = 0;
+                for (std::int64_t t = lMax / 2; t >= 1; t /= 2) {
+                    if (delta(i + (l + t) * d) > deltaMin) {
+                        l += t;
+                    }
+                }
+                const std::int64_t j = i + l * d;
+
+                // the split position, found with binary search
+                const int deltaNode = delta(j);
+                std::int64_t s = 0;
+                for (std::int64_t t = l; t > 1;) {
+                    t = (t + 1) / 2;
+                    if (delta(i + (s + t) * d) > deltaNode) {
+                        s += t;
+                    }
+                }
+                const std::int64_t split =
+                    i + s * d + std::min(d, std::int64_t{0});
+
+                const auto toGlobal = [first](const std::int64_t local) {
+                    return first + static_cast<std::size_t>(local);
+                };
+                const std::uint64_t differingBits =
+                    prims[static_cast<std::size_t>(std::min(i, j))].mortonCode ^
+                    prims[static_cast<std::size_t>(std::max(i, j))].mortonCode;
+
+                RadixTreeNode& node = result.internalNodes[globalIndex];
+                node.first = toGlobal(std::min(i, j));
+                node.last = toGlobal(std::max(i, j));
+                node.split = toGlobal(split);
+                // the axis of the highest bit in which the range differs
+                const int highestBit = 63 - std::countl_zero(differingBits);
+                node.splitAxis = (differingBits != 0)
+                                     ? static_cast<std::size_t>(highestBit % 3)
+                                     : 0;
+
+                // every node is the parent of its children,
+                // so the children's parents are written exactly once
+                const bool isLeftLeaf = node.first == node.split;
+                const bool isRightLeaf = node.last == node.split + 1;
+                (isLeftLeaf ? result.leafParents[node.split]
+                            : result.internalNodes[node.split].parent) =
+                    globalIndex;
+                (isRightLeaf ? result.leafParents[node.split + 1]
+                             : result.internalNodes[node.split + 1].parent) =
+                    globalIndex;
+
+                // a node is emitted as an interior node if it holds too
+                // many primitives, otherwise it is collapsed to a leaf
+                // by its parent (or by itself if it is the root)
+                const std::size_t maxPrims = this->maxPrimitivesInNode;
+                const std::size_t size = node.last - node.first + 1;
+                const std::size_t leftSize = node.split - node.first + 1;
+                const std::size_t rightSize = node.last - node.split;
+                if (size > maxPrims) {
+                    emittedNodesCounts[globalIndex] = static_cast<std::uint8_t>(
+                        1 + (leftSize <= maxPrims ? 1 : 0) +
+                        (rightSize <= maxPrims ? 1 : 0));
+                }
+                else if (i == 0) {
+                    emittedNodesCounts[globalIndex] = 1;
+                }
+            },
+            static_cast<std::int64_t>(mortonPrims.size()),
+            constants::CHUNK_SIZE);
 
-        Bounds3f bounds;
-        for (std::size_t writePos = firstPrimIndex;
-             const MortonPrimitive& mp : primsRange)
-        {
-            bounds = unionOf(bounds, this->primitivesInfo[mp.index].bounds);
+        return result;
+    }
 
-            orderedPrims[writePos] = primitives[mp.index];
-            ++writePos;
+    // Length of the longest common prefix of the morton codes of
+    // `prims[i]` and `prims[j]`. Equal codes are distinguished by
+    // the indices of the primitives.
+    // Returns -1 if `j` is outside of `prims`.
+    int commonPrefixLength(const std::span<const MortonPrimitive> prims,
+                           const std::int64_t i,
+                           const std::int64_t j) noexcept {
+        if (j < 0 || j >= static_cast<std::int64_t>(prims.size())) {
+            return -1;
         }
 
-        return BuildNode::Leaf(firstPrimIndex, primsRange.size(), bounds);
-    }
+        const std::uint64_t ci = prims[static_cast<std::size_t>(i)].mortonCode;
+        const std::uint64_t cj = prims[static_cast<std::size_t>(j)].mortonCode;
 
-    // Finds the position of the first primitive in `prims`
-    // which differs from its predecessor in the `splitMask` bits
-    // of its morton code.
-    //
-    // (!) Assumes that `prims` is sorted by MortonPrimitive::mortonCode. (!)
-    Optional<std::size_t>
-    findSplitPosition(const std::span<const MortonPrimitive> prims,
-                      const std::uint32_t splitMask) noexcept {
-        if (prims.empty()) {
-            return pbrt::nullopt;
+        if (ci == cj) {
+            const auto indicesDiff = static_cast<std::uint64_t>(i ^ j);
+            return 64 + std::countl_zero(indicesDiff);
         }
 
-        std::size_t left = 0;
-        std::size_t right = prims.size() - 1;
-
-        while (left + 1 != right) {
-            const auto mid = (left + right) / 2;
+        return std::countl_zero(ci ^ cj);
+    }
 
-            if ((prims[left].mortonCode & splitMask) ==
-                (prims[mid].mortonCode & splitMask)) {
-                // since the prims are sorted, this indicates
-                // that prims[left .. mid] match in those bits
-                left = mid;
-            }
-            else {
-                right = mid;
-            }
-        }
+    // Emits the build nodes of each treelet bottom-up:
+    // each primitive writes its leaf node and walks up the radix tree.
+    // The first thread to reach an internal node stops there,
+    // the second one emits it since both of its children are ready.
+    // Internal nodes holding at most `maxPrimitivesInNode` primitives
+    // are emitted as leaves, leaving their descendants unreachable.
+    // Writes the primitives in `orderedPrims` in morton order.
+    void
+    HLBVHBuilder::emitLBVHs(const std::vector<LBVHTreelet>& treelets,
+                            const std::vector<MortonPrimitive>& mortonPrims,
+                            const RadixTree& radixTree,
+                            PrimsVec& orderedPrims) const {
+        std::vector<std::atomic<std::uint32_t>> visitsCounts(
+            mortonPrims.size());
 
-        if ((prims[left].mortonCode & splitMask) !=
-            (prims[right].mortonCode & splitMask))
-        {
-            return pbrt::make_optional(right);
-        }
-        else {
-            return pbrt::nullopt;
-        }
+        parallel::parallelFor(
+            [&treelets,
+             &mortonPrims,
+             &radixTree,
+             &orderedPrims,
+             &visitsCounts,
+             this](const std::int64_t g) {
+                const auto primIndex = static_cast<std::size_t>(g);
+                const LBVHTreelet& treelet =
+                    treelets[treeletIndex(treelets, primIndex)];
+                const std::size_t first = treelet.firstPrimitiveIndex;
+
+                const auto internalNode = [&treelet,
+                                           first](const std::size_t i) {
+                    return treelet.nodes + (i - first);
+                };
+                const auto leafNode = [&treelet, first](const std::size_t i) {
+                    return treelet.nodes + (treelet.primitivesCount - 1) +
+                           (i - first);
+                };
+
+                const MortonPrimitive& mp = mortonPrims[primIndex];
+                orderedPrims[primIndex] = (*this->prims)[mp.index];
+                *leafNode(primIndex) =
+                    BuildNode::Leaf(primIndex,
+                                    1,
+                                    this->primitivesInfo[mp.index].bounds);
+
+                for (std::size_t i = radixTree.leafParents[primIndex];
+                     i != constants::NO_PARENT;
+                     i = radixTree.internalNodes[i].parent)
+                {
+                    const auto visits =
+                        visitsCounts[i].fetch_add(1, std::memory_order_acq_rel);
+                    if (visits == 0) {
+                        return;
+                    }
+
+                    const RadixTreeNode& rn = radixTree.internalNodes[i];
+                    BuildNode* const left = (rn.first == rn.split)
+                                                ? leafNode(rn.split)
+                                                : internalNode(rn.split);
+                    BuildNode* const right = (rn.last == rn.split + 1)
+                                                 ? leafNode(rn.split + 1)
+                                                 : internalNode(rn.split + 1);
+                    BuildNode node =
+                        BuildNode::Interior(rn.splitAxis, left, right);
+
+                    if (const std::size_t size = rn.last - rn.first + 1;
+                        size <= this->maxPrimitivesInNode) {
+                        node = BuildNode::Leaf(rn.first, size, node.bounds);
+                    }
+
+                    *internalNode(i) = node;
+                }
+            },
+            static_cast<std::int64_t>(mortonPrims.size()),
+            constants::CHUNK_SIZE);
     }
 
     BuildResult HLBVHBuilder::buildBVH(memory::MemoryArena& arena,
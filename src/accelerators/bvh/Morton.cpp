@@ -0,0 +1,127 @@
+#include "pbrt/accelerators/bvh/Morton.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+namespace idragnev::pbrt::accelerators::bvh {
+    namespace constants {
+        constexpr std::int64_t CHUNK_SIZE = 512;
+    } // namespace constants
+
+    std::vector<MortonPrimitive>
+    toMortonPrimitives(const std::vector<PrimitiveInfo>& primsInfo) {
+        std::vector<MortonPrimitive> result{primsInfo.size()};
+
+        const Bounds3f primsCentroidBounds =
+            centroidBounds(std::span{primsInfo.cbegin(), primsInfo.size()});
+
+        const auto iterationsCount =
+            static_cast<std::int64_t>(primsInfo.size());
+
+        parallel::parallelFor(
+            [&result, &primsInfo, &primsCentroidBounds](const std::int64_t i) {
+                const auto& info = primsInfo[static_cast<std::size_t>(i)];
+                auto& primitive = result[static_cast<std::size_t>(i)];
+
+                const Vector3f centroidOffset =
+                    primsCentroidBounds.offset(info.centroid);
+
+                primitive.index = info.index;
+                primitive.mortonCode = encodeMorton3(
+                    constants::MORTON_DIMENSION_MAX * centroidOffset);
+            },
+            iterationsCount,
+            constants::CHUNK_SIZE);
+
+        return result;
+    }
+
+    std::uint64_t encodeMorton3(const Vector3f& v) {
+        assert(static_cast<int>(v.x) >= 0);
+        assert(static_cast<int>(v.y) >= 0);
+        assert(static_cast<int>(v.z) >= 0);
+
+        const auto x = static_cast<std::uint64_t>(v.x);
+        const auto y = static_cast<std::uint64_t>(v.y);
+        const auto z = static_cast<std::uint64_t>(v.z);
+
+        return (leftShift3(z) << 2) |
+               (leftShift3(y) << 1) |
+                leftShift3(x);
+    }
+
+    // Spreads the low 21 bits of `x` so that there are
+    // two zero bits between each pair of consecutive bits.
+    std::uint64_t leftShift3(std::uint64_t x) {
+        using constants::MORTON_DIMENSION_MAX;
+
+        assert(x <= MORTON_DIMENSION_MAX);
+        if (x == MORTON_DIMENSION_MAX) {
+            --x;
+        }
+
+        // split the bits into progressively smaller groups
+        // until each bit is followed by two zero bits
+        x = (x | (x << 32)) & 0x001f00000000ffff;
+        x = (x | (x << 16)) & 0x001f0000ff0000ff;
+        x = (x | (x << 8)) & 0x100f00f00f00f00f;
+        x = (x | (x << 4)) & 0x10c30c30c30c30c3;
+        x = (x | (x << 2)) & 0x1249249249249249;
+
+        return x;
+    }
+
+    std::vector<MortonPrimitive> radixSort(std::vector<MortonPrimitive> input) {
+        using constants::MORTON_CODE_BITS;
+
+        constexpr std::size_t BITS_PER_PASS = 9;
+        static_assert((MORTON_CODE_BITS % BITS_PER_PASS) == 0,
+                      "BITS_PER_PASS must evenly divide MORTON_CODE_BITS");
+
+        constexpr std::size_t PASSES_COUNT = MORTON_CODE_BITS / BITS_PER_PASS;
+        constexpr std::size_t BUCKETS_COUNT = 1 << BITS_PER_PASS;
+
+        const auto bucketIndex = [](const std::uint64_t mortonCode,
+                                    const std::size_t lowBit) {
+            constexpr std::uint64_t mask = (1 << BITS_PER_PASS) - 1;
+            const auto result =
+                static_cast<std::size_t>((mortonCode >> lowBit) & mask);
+
+            assert(result < BUCKETS_COUNT);
+
+            return result;
+        };
+
+        std::vector<MortonPrimitive> temp{input.size()};
+        for (std::size_t pass = 0; pass < PASSES_COUNT; ++pass) {
+            const std::size_t lowBit = pass * BITS_PER_PASS;
+
+            const std::vector<MortonPrimitive>& in = (pass & 1) ? temp : input;
+            std::vector<MortonPrimitive>& out = (pass & 1) ? input : temp;
+
+            std::size_t bucketSizes[BUCKETS_COUNT] = {};
+            for (const MortonPrimitive& mp : in) {
+                const std::size_t index = bucketIndex(mp.mortonCode, lowBit);
+                ++bucketSizes[index];
+            }
+
+            std::size_t outIndices[BUCKETS_COUNT] = {};
+            for (std::size_t i = 1; i < BUCKETS_COUNT; ++i) {
+                outIndices[i] = outIndices[i - 1] + bucketSizes[i - 1];
+            }
+
+            for (const MortonPrimitive& mp : in) {
+                const std::size_t bucket = bucketIndex(mp.mortonCode, lowBit);
+                const std::size_t outIndex = outIndices[bucket];
+
+                out[outIndex] = mp;
+                ++outIndices[bucket];
+            }
+        }
+
+        if constexpr (PASSES_COUNT & 1) {
+            return temp;
+        }
+        else {
+            return input;
+        }
+    }
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
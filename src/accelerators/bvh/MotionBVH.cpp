@@ -0,0 +1,329 @@
+#include "pbrt/accelerators/bvh/MotionBVH.hpp"
+#include "pbrt/accelerators/bvh/RecursiveBuilder.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/functional/Functional.hpp"
+
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <limits>
+
+namespace idragnev::pbrt::accelerators {
+#ifdef _MSC_VER
+    #pragma warning(push)
+    #pragma warning(disable : 4324) // structure padding due to alignment specifier
+#endif
+    // Ensure that nodes do not straddle cache lines
+    struct alignas(64) MotionBVH::Node
+    {
+        bool isLeaf() const noexcept { return primitivesCount > 0; }
+
+        // `t` is the time relative to the time segment of the node,
+        // 0 at its start and 1 at its end
+        Bounds3f boundsAt(const Float t) const noexcept {
+            return Bounds3f{lerp(t, bounds.start.min, bounds.end.min),
+                            lerp(t, bounds.start.max, bounds.end.max)};
+        }
+
+        LinearMotionBounds bounds;
+        union
+        {
+            std::uint32_t firstPrimitiveIndex;
+            std::uint32_t secondChildIndex;
+        };
+        std::uint16_t primitivesCount = 0;
+        std::uint8_t splitAxis = 0;
+    };
+#ifdef _MSC_VER
+    #pragma warning(pop)
+#endif
+
+    // A tree bounding the primitives during one segment of the shutter
+    // interval. The primitives are ordered as its leaves reference them.
+    struct MotionBVH::TimeSegment
+    {
+        std::vector<std::shared_ptr<const Primitive>> primitives;
+        std::vector<Node> nodes;
+        std::uint32_t maxDepth = 0;
+    };
+
+    namespace constants {
+        // Traversals of deeper trees allocate their stack
+        inline constexpr std::size_t MOTION_BVH_STACK_SIZE = 64;
+    } // namespace constants
+
+    LinearMotionBounds unionOf(const LinearMotionBounds& a,
+                               const LinearMotionBounds& b);
+    Bounds3f boundsAtMiddle(const LinearMotionBounds& b);
+
+    MotionBVH::MotionBVH(
+        const std::vector<std::shared_ptr<const Primitive>>& prims,
+        const Intervalf& shutter,
+        const std::uint32_t maxPrimitivesInNode,
+        const std::uint32_t timeSegmentsCount)
+        : shutter(shutter)
+        , maxPrimitivesInNode(std::min(maxPrimitivesInNode, 255u)) {
+        assert(timeSegmentsCount > 0);
+        assert(prims.size() < std::numeric_limits<std::uint32_t>::max() / 2);
+
+        for (const auto& primitive : prims) {
+            this->bounds = pbrt::unionOf(this->bounds, primitive->worldBound());
+        }
+
+        if (prims.empty() == false) {
+            this->segments.resize(timeSegmentsCount);
+
+            memory::MemoryArena arena{1024 * 1024};
+            for (std::size_t i = 0; i < timeSegmentsCount; ++i) {
+                this->segments[i] =
+                    buildTimeSegment(timeSegment(i), prims, arena);
+                arena.reset();
+            }
+        }
+    }
+
+    MotionBVH::~MotionBVH() = default;
+
+    Intervalf MotionBVH::timeSegment(const std::size_t index) const noexcept {
+        const Float length = (this->shutter.high() - this->shutter.low()) /
+                             static_cast<Float>(this->segments.size());
+        const Float start =
+            this->shutter.low() + static_cast<Float>(index) * length;
+        const Float end = (index + 1 == this->segments.size())
+                              ? this->shutter.high()
+                              : start + length;
+
+        return Intervalf{start, end};
+    }
+
+    // The tree of a segment is built for the bounds of the primitives
+    // in the middle of the segment.
+    MotionBVH::TimeSegment MotionBVH::buildTimeSegment(
+        const Intervalf& time,
+        const std::vector<std::shared_ptr<const Primitive>>& primitives,
+        memory::MemoryArena& arena) const {
+        std::vector<bvh::PrimitiveInfo> primitivesInfo =
+            functional::fmapIndexed(
+                primitives,
+                [&time](const auto& primitive, const std::size_t i) {
+                    const LinearMotionBounds motionBounds =
+                        primitive->motionBounds(time);
+                    return bvh::PrimitiveInfo{i, boundsAtMiddle(motionBounds)};
+                });
+
+        const auto builder = bvh::RecursiveBuilder{bvh::SplitMethod::SAH,
+                                                   this->maxPrimitivesInNode};
+        bvh::BuildResult result =
+            builder(arena, primitives, std::move(primitivesInfo));
+
+        const std::vector<LinearMotionBounds> primitivesBounds =
+            functional::fmap(result.orderedPrimitives,
+                             [&time](const auto& primitive) {
+                                 return primitive->motionBounds(time);
+                             });
+
+        TimeSegment segment;
+        segment.primitives = std::move(result.orderedPrimitives);
+        segment.nodes.reserve(result.tree.nodesCount);
+        flattenTree(*result.tree.root, primitivesBounds, 0, segment);
+
+        assert(segment.nodes.size() == result.tree.nodesCount);
+
+        return segment;
+    }
+
+    // Appends the nodes of the subtree at `buildNode` to the nodes
+    // of `segment` in depth-first order and returns the index of
+    // its root. The bounds of the build nodes are not used, as they
+    // are the bounds in the middle of the segment.
+    std::uint32_t MotionBVH::flattenTree(
+        const bvh::BuildNode& buildNode,
+        const std::span<const LinearMotionBounds> primitivesBounds,
+        const std::uint32_t depth,
+        TimeSegment& segment) const {
+        const auto nodeIndex = static_cast<std::uint32_t>(segment.nodes.size());
+        segment.nodes.emplace_back();
+        segment.maxDepth = std::max(segment.maxDepth, depth);
+
+        if (const auto isLeafNode = buildNode.primitivesCount > 0; isLeafNode) {
+            assert(buildNode.primitivesCount <= 65536);
+
+            const auto leafBounds =
+                primitivesBounds.subspan(buildNode.firstPrimitiveIndex,
+                                         buildNode.primitivesCount);
+            LinearMotionBounds nodeBounds = leafBounds.front();
+            for (const LinearMotionBounds& b : leafBounds) {
+                nodeBounds = unionOf(nodeBounds, b);
+            }
+
+            Node& node = segment.nodes[nodeIndex];
+            node.bounds = nodeBounds;
+            node.firstPrimitiveIndex =
+                static_cast<std::uint32_t>(buildNode.firstPrimitiveIndex);
+            node.primitivesCount =
+                static_cast<std::uint16_t>(buildNode.primitivesCount);
+        }
+        else {
+            const std::uint32_t left = flattenTree(*buildNode.children[0],
+                                                   primitivesBounds,
+                                                   depth + 1,
+                                                   segment);
+            const std::uint32_t right = flattenTree(*buildNode.children[1],
+                                                    primitivesBounds,
+                                                    depth + 1,
+                                                    segment);
+
+            Node& node = segment.nodes[nodeIndex];
+            node.bounds = unionOf(segment.nodes[left].bounds,
+                                  segment.nodes[right].bounds);
+            node.secondChildIndex = right;
+            node.splitAxis = static_cast<std::uint8_t>(buildNode.splitAxis);
+        }
+
+        return nodeIndex;
+    }
+
+    // The union of the bounds at each end is interpolated conservatively
+    // as well - its lower bound at any time is not greater than
+    // the interpolated lower bounds of `a` and `b`, and its upper bound
+    // is not less than their interpolated upper bounds.
+    LinearMotionBounds unionOf(const LinearMotionBounds& a,
+                               const LinearMotionBounds& b) {
+        return LinearMotionBounds{
+            .start = pbrt::unionOf(a.start, b.start),
+            .end = pbrt::unionOf(a.end, b.end),
+        };
+    }
+
+    Bounds3f boundsAtMiddle(const LinearMotionBounds& b) {
+        return Bounds3f{lerp(0.5f, b.start.min, b.end.min),
+                        lerp(0.5f, b.start.max, b.end.max)};
+    }
+
+    Bounds3f MotionBVH::worldBound() const { return this->bounds; }
+
+    std::size_t MotionBVH::timeSegmentsCount() const noexcept {
+        return this->segments.size();
+    }
+
+    Optional<SurfaceInteraction> MotionBVH::intersect(const Ray& ray) const {
+        Optional<SurfaceInteraction> result = pbrt::nullopt;
+
+        traverse(
+            [&result, &ray](const auto primitives) {
+                for (const auto& primitive : primitives) {
+                    if (auto interaction = primitive->intersect(ray);
+                        interaction.has_value())
+                    {
+                        result = std::move(interaction);
+                    }
+                }
+                return false;
+            },
+            ray);
+
+        return result;
+    }
+
+    bool MotionBVH::intersectP(const Ray& ray) const {
+        bool isOccluded = false;
+
+        traverse(
+            [&isOccluded, &ray](const auto primitives) {
+                isOccluded = std::any_of(primitives.begin(),
+                                         primitives.end(),
+                                         [&ray](const auto& primitive) {
+                                             return primitive->intersectP(ray);
+                                         });
+                return isOccluded;
+            },
+            ray);
+
+        return isOccluded;
+    }
+
+    // Traverses the tree of the time segment containing the time
+    // of `ray`, clamped to the shutter interval.
+    // Calls `visitLeaf` with the primitives of each intersected leaf
+    // and stops if it returns true, as BVH::traverseWithStack does.
+    template <typename LeafVisitor>
+    void MotionBVH::traverse(LeafVisitor&& visitLeaf, const Ray& ray) const {
+        if (this->segments.empty()) {
+            return;
+        }
+
+        const Float time =
+            clamp(ray.time, this->shutter.low(), this->shutter.high());
+        const Float segmentLength =
+            (this->shutter.high() - this->shutter.low()) /
+            static_cast<Float>(this->segments.size());
+        const std::size_t segmentIndex =
+            segmentLength > 0.f
+                ? std::min(static_cast<std::size_t>(
+                               (time - this->shutter.low()) / segmentLength),
+                           this->segments.size() - 1)
+                : 0;
+
+        const Intervalf segmentTime = timeSegment(segmentIndex);
+        const Float segmentDuration = segmentTime.high() - segmentTime.low();
+        const Float t =
+            segmentDuration > 0.f
+                ? clamp((time - segmentTime.low()) / segmentDuration, 0.f, 1.f)
+                : 0.f;
+
+        // A traversal holds at most one node to visit per level
+        // below the current one, and the root
+        const TimeSegment& segment = this->segments[segmentIndex];
+        if (segment.maxDepth < constants::MOTION_BVH_STACK_SIZE) {
+            std::array<std::uint32_t, constants::MOTION_BVH_STACK_SIZE> stack;
+            traverseSegment(visitLeaf, ray, segment, t, stack);
+        }
+        else {
+            std::vector<std::uint32_t> stack(segment.maxDepth + 1);
+            traverseSegment(visitLeaf, ray, segment, t, stack);
+        }
+    }
+
+    template <typename LeafVisitor>
+    void MotionBVH::traverseSegment(
+        LeafVisitor&& visitLeaf,
+        const Ray& ray,
+        const TimeSegment& segment,
+        const Float segmentTime,
+        const std::span<std::uint32_t> nodesToVisit) const {
+        const Vector3f invDir{1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z};
+        const std::size_t dirIsNegative[3] = {invDir.x < 0.f ? 1u : 0u,
+                                              invDir.y < 0.f ? 1u : 0u,
+                                              invDir.z < 0.f ? 1u : 0u};
+
+        std::size_t toVisitCount = 0;
+        nodesToVisit[toVisitCount++] = 0;
+
+        while (toVisitCount > 0) {
+            const std::uint32_t nodeIndex = nodesToVisit[--toVisitCount];
+            const Node& node = segment.nodes[nodeIndex];
+
+            const Bounds3f nodeBounds = node.boundsAt(segmentTime);
+            if (nodeBounds.intersectP(ray, invDir, dirIsNegative)) {
+                if (node.isLeaf()) {
+                    const auto primitives =
+                        std::span{segment.primitives}.subspan(
+                            node.firstPrimitiveIndex,
+                            node.primitivesCount);
+                    if (bool stop = visitLeaf(primitives); stop) {
+                        return;
+                    }
+                }
+                else if (dirIsNegative[node.splitAxis] == 1) {
+                    nodesToVisit[toVisitCount++] = nodeIndex + 1;
+                    nodesToVisit[toVisitCount++] = node.secondChildIndex;
+                }
+                else {
+                    nodesToVisit[toVisitCount++] = node.secondChildIndex;
+                    nodesToVisit[toVisitCount++] = nodeIndex + 1;
+                }
+            }
+        }
+    }
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
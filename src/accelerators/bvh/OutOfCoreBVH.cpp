@@ -0,0 +1,999 @@
+#include "pbrt/accelerators/bvh/OutOfCoreBVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/memory/Memory.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace idragnev::pbrt::accelerators {
+    namespace constants {
+        inline constexpr std::array<char, 8> OUT_OF_CORE_FILE_MAGIC = {
+            'P', 'B', 'R', 'T', 'B', 'V', 'H', '\0'};
+        inline constexpr std::uint32_t OUT_OF_CORE_FILE_VERSION = 1;
+        inline constexpr std::size_t OUT_OF_CORE_SECTION_ALIGNMENT =
+            memory::constants::L1_CACHE_LINE_SIZE;
+        inline constexpr std::size_t CENTROID_BINS_COUNT = 16;
+        // Traversals of deeper trees allocate their stack
+        inline constexpr std::size_t OUT_OF_CORE_BVH_STACK_SIZE = 64;
+    } // namespace constants
+
+    namespace bvh {
+        struct OutOfCoreFileHeader
+        {
+            std::array<char, 8> magic{};
+            std::uint32_t version = 0;
+            // The size of Float in the build which wrote the file
+            std::uint32_t floatSize = 0;
+            std::uint64_t trianglesCount = 0;
+            std::uint64_t nodesCount = 0;
+            std::uint64_t maxDepth = 0;
+            std::uint64_t trianglesOffset = 0;
+            std::uint64_t triangleIndicesOffset = 0;
+            std::uint64_t nodesOffset = 0;
+            Bounds3f bounds;
+        };
+
+        // The nodes are stored in depth-first order,
+        // so the first child of an interior node follows it
+        struct OutOfCoreNode
+        {
+            bool isLeaf() const noexcept { return trianglesCount > 0; }
+
+            Bounds3f bounds;
+            // The first triangle of leaves,
+            // the second child of interior nodes
+            std::uint64_t offset = 0;
+            std::uint32_t trianglesCount = 0;
+            std::uint32_t splitAxis = 0;
+        };
+
+        struct OutOfCoreTriangle
+        {
+            Point3f p0;
+            Point3f p1;
+            Point3f p2;
+        };
+
+        // A triangle in the temporary files of the build
+        // with its index in the triangle soup
+        struct TriangleRecord
+        {
+            OutOfCoreTriangle triangle;
+            std::uint64_t index = 0;
+        };
+
+        // Not trivially copyable in debug builds, where the copies
+        // of points check their coordinates
+        static_assert(std::is_standard_layout_v<OutOfCoreFileHeader> &&
+                          std::is_standard_layout_v<OutOfCoreNode> &&
+                          std::is_standard_layout_v<TriangleRecord>,
+                      "The out-of-core BVH structures are read and written "
+                      "as raw bytes");
+
+        // Triangles which are consecutive in one of the temporary files
+        struct TriangleRange
+        {
+            std::size_t file = 0;
+            std::uint64_t first = 0;
+            std::uint64_t count = 0;
+            Bounds3f bounds;
+            Bounds3f centroidBounds;
+        };
+
+        struct CentroidBin
+        {
+            std::uint64_t count = 0;
+            Bounds3f bounds;
+            Bounds3f centroidBounds;
+        };
+
+        using CentroidBins =
+            std::array<CentroidBin, constants::CENTROID_BINS_COUNT>;
+
+        // The memory held by the buffers of a build
+        class MemoryUsage
+        {
+        public:
+            // Releases the reserved memory when destroyed
+            class Reservation
+            {
+            public:
+                Reservation(MemoryUsage& usage, const std::size_t bytes)
+                    : usage(usage)
+                    , bytes(bytes) {
+                    usage.current += bytes;
+                    usage.peak = std::max(usage.peak, usage.current);
+                }
+                ~Reservation() { usage.current -= bytes; }
+
+                Reservation(const Reservation&) = delete;
+                Reservation& operator=(const Reservation&) = delete;
+
+            private:
+                MemoryUsage& usage;
+                std::size_t bytes;
+            };
+
+            Reservation reserve(const std::size_t bytes) {
+                return Reservation{*this, bytes};
+            }
+
+            std::size_t peakUsage() const noexcept { return peak; }
+
+        private:
+            std::size_t current = 0;
+            std::size_t peak = 0;
+        };
+
+        class OutOfCoreBuilder
+        {
+        public:
+            OutOfCoreBuilder(const OutOfCoreBuildOptions& options,
+                             const std::uint64_t trianglesCount,
+                             std::ifstream& input,
+                             std::ofstream& output,
+                             std::array<std::fstream, 2>& scratchFiles);
+
+            // Returns false if a file operation failed
+            bool operator()();
+
+            OutOfCoreBuildStatistics statistics() const;
+
+        private:
+            TriangleRange convertInput();
+
+            std::uint64_t buildSubtree(const TriangleRange& range,
+                                       const std::uint64_t depth);
+            std::uint64_t buildInCore(const TriangleRange& range,
+                                      const std::uint64_t depth);
+            std::size_t buildInCoreNode(const std::span<PrimitiveInfo> infos,
+                                        const std::uint64_t firstTriangle,
+                                        const std::uint64_t firstNode,
+                                        const std::uint64_t depth,
+                                        std::vector<OutOfCoreNode>& nodes);
+
+            CentroidBins binCentroids(const TriangleRange& range,
+                                      const std::size_t axis);
+            void partition(const TriangleRange& range,
+                           const std::size_t axis,
+                           const std::size_t splitBin,
+                           const std::uint64_t leftCount);
+
+            void readRecords(const std::size_t file,
+                             const std::uint64_t first,
+                             const std::span<TriangleRecord> records);
+            void writeRecords(const std::size_t file,
+                              const std::uint64_t first,
+                              const std::span<const TriangleRecord> records);
+            void writeNodes(const std::uint64_t first,
+                            const std::span<const OutOfCoreNode> nodes);
+            void writeHeader(const Bounds3f& bounds);
+
+        private:
+            std::size_t maxTrianglesInNode;
+            // The number of triangles in the buffers of the streaming
+            // passes, three of which fit in the memory budget
+            std::size_t chunkSize;
+            // The most triangles which are built in memory at once
+            std::uint64_t inCoreCapacity;
+
+            std::ifstream& input;
+            std::ofstream& output;
+            std::array<std::fstream, 2>& scratchFiles;
+
+            std::uint64_t trianglesCount;
+            std::uint64_t trianglesOffset;
+            std::uint64_t triangleIndicesOffset;
+            std::uint64_t nodesOffset;
+
+            std::uint64_t writtenTrianglesCount = 0;
+            std::uint64_t nodesCount = 0;
+            std::uint64_t maxDepth = 0;
+            std::uint64_t inCoreSubtreesCount = 0;
+            std::uint64_t streamedBytes = 0;
+            MemoryUsage memoryUsage;
+        };
+
+        std::size_t chunkSize(const OutOfCoreBuildOptions& options);
+        std::uint64_t inCoreCapacity(const OutOfCoreBuildOptions& options);
+        Bounds3f triangleBounds(const OutOfCoreTriangle& triangle);
+        Point3f centroid(const Bounds3f& bounds);
+        std::size_t centroidBin(const Point3f& centroid,
+                                const Bounds3f& centroidBounds,
+                                const std::size_t axis);
+        std::size_t findCentroidSplit(const CentroidBins& bins);
+        TriangleRange mergeBins(const std::span<const CentroidBin> bins);
+        std::uint64_t alignSection(const std::uint64_t offset);
+        SurfaceInteraction makeInteraction(const Ray& ray,
+                                           const OutOfCoreTriangle& triangle,
+                                           const shapes::TriangleHit& hit,
+                                           const std::uint64_t faceIndex);
+    } // namespace bvh
+
+    bool writeTriangleSoup(const std::filesystem::path& path,
+                           const std::span<const Point3f> vertices) {
+        assert(vertices.size() % 3 == 0);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        for (const Point3f& p : vertices) {
+            const float coordinates[3] = {static_cast<float>(p.x),
+                                          static_cast<float>(p.y),
+                                          static_cast<float>(p.z)};
+            file.write(reinterpret_cast<const char*>(coordinates),
+                       sizeof(coordinates));
+        }
+
+        return file.good();
+    }
+
+    Optional<OutOfCoreBuildStatistics>
+    buildOutOfCoreBVH(const std::filesystem::path& input,
+                      const std::filesystem::path& output,
+                      const OutOfCoreBuildOptions& options) {
+        namespace fs = std::filesystem;
+
+        constexpr std::uint64_t TRIANGLE_SIZE = 9 * sizeof(float);
+
+        if (options.maxTrianglesInNode == 0 || bvh::chunkSize(options) == 0 ||
+            bvh::inCoreCapacity(options) < options.maxTrianglesInNode)
+        {
+            return pbrt::nullopt;
+        }
+
+        std::error_code error;
+        const std::uint64_t inputSize = fs::file_size(input, error);
+        if (error || inputSize == 0 || inputSize % TRIANGLE_SIZE != 0) {
+            return pbrt::nullopt;
+        }
+
+        const fs::path scratchDirectory = options.scratchDirectory.empty()
+                                              ? output.parent_path()
+                                              : options.scratchDirectory;
+        const std::array<fs::path, 2> scratchPaths = {
+            scratchDirectory / (output.filename().string() + ".scratch0"),
+            scratchDirectory / (output.filename().string() + ".scratch1"),
+        };
+
+        Optional<OutOfCoreBuildStatistics> result = pbrt::nullopt;
+        {
+            constexpr auto SCRATCH_MODE = std::ios::in | std::ios::out |
+                                          std::ios::binary | std::ios::trunc;
+
+            std::ifstream inputFile(input, std::ios::binary);
+            std::ofstream outputFile(output,
+                                     std::ios::binary | std::ios::trunc);
+            std::array<std::fstream, 2> scratchFiles = {
+                std::fstream(scratchPaths[0], SCRATCH_MODE),
+                std::fstream(scratchPaths[1], SCRATCH_MODE),
+            };
+
+            const bool areOpen = inputFile.is_open() &&
+                                 outputFile.is_open() &&
+                                 scratchFiles[0].is_open() &&
+                                 scratchFiles[1].is_open();
+            if (areOpen) {
+                bvh::OutOfCoreBuilder build(options,
+                                            inputSize / TRIANGLE_SIZE,
+                                            inputFile,
+                                            outputFile,
+                                            scratchFiles);
+                if (build()) {
+                    result = pbrt::make_optional(build.statistics());
+                }
+            }
+        }
+
+        fs::remove(scratchPaths[0], error);
+        fs::remove(scratchPaths[1], error);
+        if (!result.has_value()) {
+            fs::remove(output, error);
+        }
+
+        return result;
+    }
+
+    namespace bvh {
+        std::size_t chunkSize(const OutOfCoreBuildOptions& options) {
+            return options.memoryBudget / (3 * sizeof(TriangleRecord));
+        }
+
+        // A subtree of n triangles is built in memory with n records,
+        // n PrimitiveInfos and at most 2n - 1 nodes
+        std::uint64_t inCoreCapacity(const OutOfCoreBuildOptions& options) {
+            constexpr std::size_t BYTES_PER_TRIANGLE =
+                sizeof(TriangleRecord) + sizeof(PrimitiveInfo) +
+                2 * sizeof(OutOfCoreNode);
+
+            // the triangles of a leaf are counted with 32 bits
+            return std::min<std::uint64_t>(
+                options.memoryBudget / BYTES_PER_TRIANGLE,
+                std::numeric_limits<std::uint32_t>::max());
+        }
+
+        OutOfCoreBuilder::OutOfCoreBuilder(
+            const OutOfCoreBuildOptions& options,
+            const std::uint64_t trianglesCount,
+            std::ifstream& input,
+            std::ofstream& output,
+            std::array<std::fstream, 2>& scratchFiles)
+            : maxTrianglesInNode(options.maxTrianglesInNode)
+            , chunkSize(bvh::chunkSize(options))
+            , inCoreCapacity(bvh::inCoreCapacity(options))
+            , input(input)
+            , output(output)
+            , scratchFiles(scratchFiles)
+            , trianglesCount(trianglesCount) {
+            this->trianglesOffset = alignSection(sizeof(OutOfCoreFileHeader));
+            this->triangleIndicesOffset =
+                alignSection(this->trianglesOffset +
+                             trianglesCount * sizeof(OutOfCoreTriangle));
+            this->nodesOffset =
+                alignSection(this->triangleIndicesOffset +
+                             trianglesCount * sizeof(std::uint64_t));
+        }
+
+        std::uint64_t alignSection(const std::uint64_t offset) {
+            return memory::alignUp(offset,
+                                   constants::OUT_OF_CORE_SECTION_ALIGNMENT);
+        }
+
+        // File operations fail silently, setting the state of their
+        // stream, so the state is checked once the build is done
+        bool OutOfCoreBuilder::operator()() {
+            const TriangleRange root = convertInput();
+            if (!this->input.good()) {
+                return false;
+            }
+
+            buildSubtree(root, 0);
+            writeHeader(root.bounds);
+
+            assert(this->writtenTrianglesCount == this->trianglesCount);
+
+            this->output.flush();
+            return this->output.good() && !this->scratchFiles[0].fail() &&
+                   !this->scratchFiles[1].fail();
+        }
+
+        OutOfCoreBuildStatistics OutOfCoreBuilder::statistics() const {
+            return OutOfCoreBuildStatistics{
+                .trianglesCount = this->trianglesCount,
+                .nodesCount = this->nodesCount,
+                .inCoreSubtreesCount = this->inCoreSubtreesCount,
+                .streamedBytes = this->streamedBytes,
+                .peakMemoryUsage = this->memoryUsage.peakUsage(),
+            };
+        }
+
+        // Copies the triangles of the input to the first temporary file
+        // and computes their bounds and the bounds of their centroids
+        TriangleRange OutOfCoreBuilder::convertInput() {
+            const auto reservation = this->memoryUsage.reserve(
+                this->chunkSize * (9 * sizeof(float) + sizeof(TriangleRecord)));
+            std::vector<float> coordinates(9 * this->chunkSize);
+            std::vector<TriangleRecord> records(this->chunkSize);
+
+            TriangleRange range;
+            range.count = this->trianglesCount;
+            for (std::uint64_t first = 0; first < this->trianglesCount;
+                 first += this->chunkSize)
+            {
+                const auto count = static_cast<std::size_t>(
+                    std::min<std::uint64_t>(this->chunkSize,
+                                            this->trianglesCount - first));
+                this->input.read(
+                    reinterpret_cast<char*>(coordinates.data()),
+                    static_cast<std::streamsize>(count * 9 * sizeof(float)));
+
+                for (std::size_t i = 0; i < count; ++i) {
+                    const float* const c = &coordinates[9 * i];
+                    TriangleRecord& record = records[i];
+                    record.triangle.p0 = Point3f(c[0], c[1], c[2]);
+                    record.triangle.p1 = Point3f(c[3], c[4], c[5]);
+                    record.triangle.p2 = Point3f(c[6], c[7], c[8]);
+                    record.index = first + i;
+
+                    const Bounds3f bounds = triangleBounds(record.triangle);
+                    range.bounds = unionOf(range.bounds, bounds);
+                    range.centroidBounds =
+                        unionOf(range.centroidBounds, centroid(bounds));
+                }
+
+                writeRecords(0, first, std::span{records}.first(count));
+            }
+
+            return range;
+        }
+
+        // Splits ranges which do not fit in memory by the SAH over binned
+        // centroids, partitioning their triangles into the other temporary
+        // file, until they are small enough to be built in memory.
+        // Returns the index of the root of the subtree.
+        std::uint64_t
+        OutOfCoreBuilder::buildSubtree(const TriangleRange& range,
+                                       const std::uint64_t depth) {
+            this->maxDepth = std::max(this->maxDepth, depth);
+
+            if (range.count <= this->inCoreCapacity) {
+                return buildInCore(range, depth);
+            }
+
+            const std::size_t axis = range.centroidBounds.maximumExtent();
+            TriangleRange left;
+            TriangleRange right;
+            if (range.centroidBounds.max[axis] ==
+                range.centroidBounds.min[axis]) {
+                // the centroids coincide, split the range by count in place
+                left = range;
+                left.count = range.count / 2;
+                right = range;
+                right.first = range.first + left.count;
+                right.count = range.count - left.count;
+            }
+            else {
+                const CentroidBins bins = binCentroids(range, axis);
+                const std::size_t splitBin = findCentroidSplit(bins);
+                const auto binsSpan = std::span<const CentroidBin>{bins};
+
+                left = mergeBins(binsSpan.first(splitBin + 1));
+                left.file = 1 - range.file;
+                left.first = range.first;
+                right = mergeBins(binsSpan.subspan(splitBin + 1));
+                right.file = 1 - range.file;
+                right.first = range.first + left.count;
+
+                partition(range, axis, splitBin, left.count);
+            }
+
+            const std::uint64_t index = this->nodesCount++;
+            buildSubtree(left, depth + 1);
+            const std::uint64_t secondChild = buildSubtree(right, depth + 1);
+
+            const OutOfCoreNode node{
+                .bounds = range.bounds,
+                .offset = secondChild,
+                .trianglesCount = 0,
+                .splitAxis = static_cast<std::uint32_t>(axis),
+            };
+            writeNodes(index, std::span{&node, 1});
+
+            return index;
+        }
+
+        std::uint64_t
+        OutOfCoreBuilder::buildInCore(const TriangleRange& range,
+                                      const std::uint64_t depth) {
+            const auto count = static_cast<std::size_t>(range.count);
+            const std::size_t maxNodesCount = 2 * count - 1;
+            const auto reservation = this->memoryUsage.reserve(
+                count * (sizeof(TriangleRecord) + sizeof(PrimitiveInfo)) +
+                maxNodesCount * sizeof(OutOfCoreNode));
+
+            std::vector<TriangleRecord> records(count);
+            readRecords(range.file, range.first, records);
+
+            std::vector<PrimitiveInfo> infos;
+            infos.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                infos.emplace_back(i, triangleBounds(records[i].triangle));
+            }
+
+            const std::uint64_t firstTriangle = this->writtenTrianglesCount;
+            const std::uint64_t firstNode = this->nodesCount;
+            std::vector<OutOfCoreNode> nodes;
+            nodes.reserve(maxNodesCount);
+            buildInCoreNode(infos, firstTriangle, firstNode, depth, nodes);
+
+            // the PrimitiveInfos are partitioned in leaf order
+            this->output.seekp(static_cast<std::streamoff>(
+                this->trianglesOffset +
+                firstTriangle * sizeof(OutOfCoreTriangle)));
+            for (const PrimitiveInfo& info : infos) {
+                const TriangleRecord& record = records[info.index];
+                this->output.write(
+                    reinterpret_cast<const char*>(&record.triangle),
+                    sizeof(OutOfCoreTriangle));
+            }
+            this->output.seekp(static_cast<std::streamoff>(
+                this->triangleIndicesOffset +
+                firstTriangle * sizeof(std::uint64_t)));
+            for (const PrimitiveInfo& info : infos) {
+                const TriangleRecord& record = records[info.index];
+                this->output.write(
+                    reinterpret_cast<const char*>(&record.index),
+                    sizeof(std::uint64_t));
+            }
+            writeNodes(firstNode, nodes);
+
+            this->writtenTrianglesCount += count;
+            this->nodesCount += nodes.size();
+            this->inCoreSubtreesCount += 1;
+
+            return firstNode;
+        }
+
+        // Builds the subtree of `infos` like RecursiveBuilder with
+        // SplitMethod::SAH does, appending its nodes in depth-first order.
+        // Returns the index of its root in `nodes`.
+        std::size_t
+        OutOfCoreBuilder::buildInCoreNode(const std::span<PrimitiveInfo> infos,
+                                          const std::uint64_t firstTriangle,
+                                          const std::uint64_t firstNode,
+                                          const std::uint64_t depth,
+                                          std::vector<OutOfCoreNode>& nodes) {
+            this->maxDepth = std::max(this->maxDepth, depth);
+
+            const std::size_t index = nodes.size();
+            nodes.emplace_back();
+
+            const Bounds3f rangeBounds = bvh::bounds(infos);
+
+            std::size_t splitAxis = 0;
+            Optional<std::size_t> splitPosition = pbrt::nullopt;
+            if (infos.size() > 1) {
+                const Bounds3f rangeCentroidBounds = centroidBounds(infos);
+                splitAxis = rangeCentroidBounds.maximumExtent();
+
+                if (rangeCentroidBounds.max[splitAxis] !=
+                    rangeCentroidBounds.min[splitAxis]) {
+                    splitPosition =
+                        partitionPrimitivesInfoBySAH(rangeBounds,
+                                                     rangeCentroidBounds,
+                                                     infos,
+                                                     this->maxTrianglesInNode);
+                }
+            }
+
+            if (splitPosition.has_value()) {
+                const std::size_t split = splitPosition.value();
+                buildInCoreNode(infos.first(split),
+                                firstTriangle,
+                                firstNode,
+                                depth + 1,
+                                nodes);
+                const std::size_t secondChild =
+                    buildInCoreNode(infos.subspan(split),
+                                    firstTriangle + split,
+                                    firstNode,
+                                    depth + 1,
+                                    nodes);
+
+                nodes[index] = OutOfCoreNode{
+                    .bounds = rangeBounds,
+                    .offset = firstNode + secondChild,
+                    .trianglesCount = 0,
+                    .splitAxis = static_cast<std::uint32_t>(splitAxis),
+                };
+            }
+            else {
+                nodes[index] = OutOfCoreNode{
+                    .bounds = rangeBounds,
+                    .offset = firstTriangle,
+                    .trianglesCount = static_cast<std::uint32_t>(infos.size()),
+                };
+            }
+
+            return index;
+        }
+
+        CentroidBins OutOfCoreBuilder::binCentroids(const TriangleRange& range,
+                                                    const std::size_t axis) {
+            const auto reservation =
+                this->memoryUsage.reserve(this->chunkSize *
+                                          sizeof(TriangleRecord));
+            std::vector<TriangleRecord> records(this->chunkSize);
+
+            CentroidBins bins{};
+            for (std::uint64_t i = 0; i < range.count; i += this->chunkSize) {
+                const auto count = static_cast<std::size_t>(
+                    std::min<std::uint64_t>(this->chunkSize, range.count - i));
+                const auto chunk = std::span{records}.first(count);
+                readRecords(range.file, range.first + i, chunk);
+
+                for (const TriangleRecord& record : chunk) {
+                    const Bounds3f bounds = triangleBounds(record.triangle);
+                    const Point3f c = centroid(bounds);
+                    CentroidBin& bin =
+                        bins[centroidBin(c, range.centroidBounds, axis)];
+
+                    bin.count += 1;
+                    bin.bounds = unionOf(bin.bounds, bounds);
+                    bin.centroidBounds = unionOf(bin.centroidBounds, c);
+                }
+            }
+
+            return bins;
+        }
+
+        // Writes the triangles of `range` in the bins up to `splitBin`
+        // and those in the rest of the bins to the start and to the end
+        // of the same range in the other temporary file
+        void OutOfCoreBuilder::partition(const TriangleRange& range,
+                                         const std::size_t axis,
+                                         const std::size_t splitBin,
+                                         const std::uint64_t leftCount) {
+            const auto reservation =
+                this->memoryUsage.reserve(3 * this->chunkSize *
+                                          sizeof(TriangleRecord));
+            std::vector<TriangleRecord> records(this->chunkSize);
+            std::array<std::vector<TriangleRecord>, 2> sides;
+            sides[0].reserve(this->chunkSize);
+            sides[1].reserve(this->chunkSize);
+
+            const std::size_t destination = 1 - range.file;
+            std::array<std::uint64_t, 2> sideEnds = {range.first,
+                                                     range.first + leftCount};
+            const auto flush = [this, destination, &sides, &sideEnds](
+                                   const std::size_t side) {
+                writeRecords(destination, sideEnds[side], sides[side]);
+                sideEnds[side] += sides[side].size();
+                sides[side].clear();
+            };
+
+            for (std::uint64_t i = 0; i < range.count; i += this->chunkSize) {
+                const auto count = static_cast<std::size_t>(
+                    std::min<std::uint64_t>(this->chunkSize, range.count - i));
+                const auto chunk = std::span{records}.first(count);
+                readRecords(range.file, range.first + i, chunk);
+
+                for (const TriangleRecord& record : chunk) {
+                    const Point3f c = centroid(triangleBounds(record.triangle));
+                    const std::size_t side =
+                        centroidBin(c, range.centroidBounds, axis) <= splitBin
+                            ? 0
+                            : 1;
+
+                    sides[side].push_back(record);
+                    if (sides[side].size() == this->chunkSize) {
+                        flush(side);
+                    }
+                }
+            }
+            flush(0);
+            flush(1);
+
+            assert(sideEnds[0] == range.first + leftCount);
+            assert(sideEnds[1] == range.first + range.count);
+        }
+
+        void OutOfCoreBuilder::readRecords(
+            const std::size_t file,
+            const std::uint64_t first,
+            const std::span<TriangleRecord> records) {
+            std::fstream& stream = this->scratchFiles[file];
+            stream.seekg(
+                static_cast<std::streamoff>(first * sizeof(TriangleRecord)));
+            stream.read(reinterpret_cast<char*>(records.data()),
+                        static_cast<std::streamsize>(records.size_bytes()));
+
+            this->streamedBytes += records.size_bytes();
+        }
+
+        void OutOfCoreBuilder::writeRecords(
+            const std::size_t file,
+            const std::uint64_t first,
+            const std::span<const TriangleRecord> records) {
+            std::fstream& stream = this->scratchFiles[file];
+            stream.seekp(
+                static_cast<std::streamoff>(first * sizeof(TriangleRecord)));
+            stream.write(reinterpret_cast<const char*>(records.data()),
+                         static_cast<std::streamsize>(records.size_bytes()));
+
+            this->streamedBytes += records.size_bytes();
+        }
+
+        void OutOfCoreBuilder::writeNodes(
+            const std::uint64_t first,
+            const std::span<const OutOfCoreNode> nodes) {
+            this->output.seekp(static_cast<std::streamoff>(
+                this->nodesOffset + first * sizeof(OutOfCoreNode)));
+            this->output.write(
+                reinterpret_cast<const char*>(nodes.data()),
+                static_cast<std::streamsize>(nodes.size_bytes()));
+        }
+
+        void OutOfCoreBuilder::writeHeader(const Bounds3f& bounds) {
+            const OutOfCoreFileHeader header{
+                .magic = constants::OUT_OF_CORE_FILE_MAGIC,
+                .version = constants::OUT_OF_CORE_FILE_VERSION,
+                .floatSize = sizeof(Float),
+                .trianglesCount = this->trianglesCount,
+                .nodesCount = this->nodesCount,
+                .maxDepth = this->maxDepth,
+                .trianglesOffset = this->trianglesOffset,
+                .triangleIndicesOffset = this->triangleIndicesOffset,
+                .nodesOffset = this->nodesOffset,
+                .bounds = bounds,
+            };
+
+            this->output.seekp(0);
+            this->output.write(reinterpret_cast<const char*>(&header),
+                               sizeof(header));
+        }
+
+        Bounds3f triangleBounds(const OutOfCoreTriangle& triangle) {
+            return unionOf(Bounds3f{triangle.p0, triangle.p1}, triangle.p2);
+        }
+
+        // Computed like the centroids of PrimitiveInfo
+        Point3f centroid(const Bounds3f& bounds) {
+            return 0.5f * bounds.min + 0.5f * bounds.max;
+        }
+
+        std::size_t centroidBin(const Point3f& centroid,
+                                const Bounds3f& centroidBounds,
+                                const std::size_t axis) {
+            const Float offset = centroidBounds.offset(centroid)[axis];
+            const auto index = static_cast<std::size_t>(
+                offset * static_cast<Float>(constants::CENTROID_BINS_COUNT));
+
+            return std::min(index, constants::CENTROID_BINS_COUNT - 1);
+        }
+
+        // Returns the last bin on the left side of the split
+        // with the minimum SAH cost
+        std::size_t findCentroidSplit(const CentroidBins& bins) {
+            std::array<Float, constants::CENTROID_BINS_COUNT> leftCosts{};
+            CentroidBin left;
+            for (std::size_t i = 0; i < bins.size(); ++i) {
+                left.count += bins[i].count;
+                left.bounds = unionOf(left.bounds, bins[i].bounds);
+                leftCosts[i] = left.count > 0 ? static_cast<Float>(left.count) *
+                                                    left.bounds.surfaceArea()
+                                              : 0.f;
+            }
+
+            const std::uint64_t totalCount = left.count;
+
+            Float minCost = pbrt::constants::Infinity;
+            std::size_t splitBin = 0;
+            CentroidBin right;
+            for (std::size_t i = bins.size() - 1; i > 0; --i) {
+                right.count += bins[i].count;
+                right.bounds = unionOf(right.bounds, bins[i].bounds);
+
+                if (right.count > 0 && right.count < totalCount) {
+                    const Float cost =
+                        leftCosts[i - 1] + static_cast<Float>(right.count) *
+                                               right.bounds.surfaceArea();
+                    if (cost < minCost) {
+                        minCost = cost;
+                        splitBin = i - 1;
+                    }
+                }
+            }
+
+            assert(minCost < pbrt::constants::Infinity);
+
+            return splitBin;
+        }
+
+        TriangleRange mergeBins(const std::span<const CentroidBin> bins) {
+            TriangleRange range;
+            for (const CentroidBin& bin : bins) {
+                range.count += bin.count;
+                range.bounds = unionOf(range.bounds, bin.bounds);
+                range.centroidBounds =
+                    unionOf(range.centroidBounds, bin.centroidBounds);
+            }
+
+            return range;
+        }
+    } // namespace bvh
+
+    Optional<OutOfCoreBVH>
+    OutOfCoreBVH::open(const std::filesystem::path& nodeFile) {
+        using bvh::OutOfCoreFileHeader;
+
+        memory::MappedFile file(nodeFile);
+        const auto bytes = file.bytes();
+        if (bytes.size() < sizeof(OutOfCoreFileHeader)) {
+            return pbrt::nullopt;
+        }
+
+        const auto& header =
+            *reinterpret_cast<const OutOfCoreFileHeader*>(bytes.data());
+        const auto fits = [size = bytes.size()](const std::uint64_t offset,
+                                                const std::uint64_t count,
+                                                const std::size_t elementSize) {
+            return offset <= size && count <= (size - offset) / elementSize;
+        };
+
+        const bool isValid =
+            header.magic == constants::OUT_OF_CORE_FILE_MAGIC &&
+            header.version == constants::OUT_OF_CORE_FILE_VERSION &&
+            header.floatSize == sizeof(Float) && header.nodesCount > 0 &&
+            fits(header.trianglesOffset,
+                 header.trianglesCount,
+                 sizeof(bvh::OutOfCoreTriangle)) &&
+            fits(header.triangleIndicesOffset,
+                 header.trianglesCount,
+                 sizeof(std::uint64_t)) &&
+            fits(header.nodesOffset,
+                 header.nodesCount,
+                 sizeof(bvh::OutOfCoreNode));
+        if (!isValid) {
+            return pbrt::nullopt;
+        }
+
+        return pbrt::make_optional(OutOfCoreBVH{std::move(file)});
+    }
+
+    OutOfCoreBVH::OutOfCoreBVH(memory::MappedFile f) : file(std::move(f)) {
+        const std::byte* const bytes = this->file.bytes().data();
+
+        this->header =
+            reinterpret_cast<const bvh::OutOfCoreFileHeader*>(bytes);
+        this->nodes = std::span{reinterpret_cast<const bvh::OutOfCoreNode*>(
+                                    bytes + this->header->nodesOffset),
+                                this->header->nodesCount};
+        this->triangles =
+            std::span{reinterpret_cast<const bvh::OutOfCoreTriangle*>(
+                          bytes + this->header->trianglesOffset),
+                      this->header->trianglesCount};
+        this->triangleIndices =
+            std::span{reinterpret_cast<const std::uint64_t*>(
+                          bytes + this->header->triangleIndicesOffset),
+                      this->header->trianglesCount};
+    }
+
+    Bounds3f OutOfCoreBVH::worldBound() const { return this->header->bounds; }
+
+    std::size_t OutOfCoreBVH::trianglesCount() const noexcept {
+        return this->triangles.size();
+    }
+
+    std::size_t OutOfCoreBVH::nodesCount() const noexcept {
+        return this->nodes.size();
+    }
+
+    Optional<SurfaceInteraction>
+    OutOfCoreBVH::intersect(const Ray& ray) const {
+        Optional<std::uint64_t> closestTriangle = pbrt::nullopt;
+        shapes::TriangleHit closestHit;
+
+        traverse(
+            [this, &ray, &closestTriangle, &closestHit](
+                const bvh::OutOfCoreNode& leaf) {
+                const auto last = leaf.offset + leaf.trianglesCount;
+                for (std::uint64_t i = leaf.offset; i < last; ++i) {
+                    const bvh::OutOfCoreTriangle& t = this->triangles[i];
+                    if (const auto hit =
+                            shapes::intersectTriangle(ray, t.p0, t.p1, t.p2);
+                        hit.has_value())
+                    {
+                        ray.tMax = hit->t;
+                        closestTriangle = i;
+                        closestHit = hit.value();
+                    }
+                }
+                return false;
+            },
+            ray);
+
+        return closestTriangle.map([this, &ray, &closestHit](
+                                       const std::uint64_t i) {
+            return bvh::makeInteraction(ray,
+                                        this->triangles[i],
+                                        closestHit,
+                                        this->triangleIndices[i]);
+        });
+    }
+
+    bool OutOfCoreBVH::intersectP(const Ray& ray) const {
+        bool hit = false;
+
+        traverse(
+            [this, &ray, &hit](const bvh::OutOfCoreNode& leaf) {
+                const auto first = this->triangles.begin() + leaf.offset;
+                hit = std::any_of(first,
+                                  first + leaf.trianglesCount,
+                                  [&ray](const bvh::OutOfCoreTriangle& t) {
+                                      return shapes::intersectTriangle(ray,
+                                                                       t.p0,
+                                                                       t.p1,
+                                                                       t.p2)
+                                          .has_value();
+                                  });
+                return hit;
+            },
+            ray);
+
+        return hit;
+    }
+
+    template <typename LeafVisitor>
+    void OutOfCoreBVH::traverse(LeafVisitor&& visitLeaf,
+                                const Ray& ray) const {
+        // A traversal holds at most one node to visit
+        // per node on the current path
+        const std::uint64_t stackSize = this->header->maxDepth + 1;
+        if (stackSize <= constants::OUT_OF_CORE_BVH_STACK_SIZE) {
+            std::array<std::uint64_t, constants::OUT_OF_CORE_BVH_STACK_SIZE>
+                stack;
+            traverse(visitLeaf, ray, stack);
+        }
+        else {
+            std::vector<std::uint64_t> stack(stackSize);
+            traverse(visitLeaf, ray, stack);
+        }
+    }
+
+    template <typename LeafVisitor>
+    void OutOfCoreBVH::traverse(
+        LeafVisitor&& visitLeaf,
+        const Ray& ray,
+        const std::span<std::uint64_t> nodesToVisit) const {
+        const Vector3f invDir{1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z};
+        const std::size_t dirIsNegative[3] = {invDir.x < 0.f ? 1u : 0u,
+                                              invDir.y < 0.f ? 1u : 0u,
+                                              invDir.z < 0.f ? 1u : 0u};
+
+        std::size_t toVisitCount = 0;
+        nodesToVisit[toVisitCount++] = 0;
+
+        while (toVisitCount > 0) {
+            const std::uint64_t nodeIndex = nodesToVisit[--toVisitCount];
+            const bvh::OutOfCoreNode& node = this->nodes[nodeIndex];
+
+            if (node.bounds.intersectP(ray, invDir, dirIsNegative)) {
+                if (node.isLeaf()) {
+                    if (bool stop = visitLeaf(node); stop) {
+                        return;
+                    }
+                }
+                else if (dirIsNegative[node.splitAxis] == 1) {
+                    nodesToVisit[toVisitCount++] = nodeIndex + 1;
+                    nodesToVisit[toVisitCount++] = node.offset;
+                }
+                else {
+                    nodesToVisit[toVisitCount++] = node.offset;
+                    nodesToVisit[toVisitCount++] = nodeIndex + 1;
+                }
+            }
+        }
+    }
+
+    namespace bvh {
+        // Like the interactions of Triangle with the default
+        // parameterization of its vertices: (0, 0), (1, 0), (1, 1)
+        SurfaceInteraction makeInteraction(const Ray& ray,
+                                           const OutOfCoreTriangle& triangle,
+                                           const shapes::TriangleHit& hit,
+                                           const std::uint64_t faceIndex) {
+            const auto& [p0, p1, p2] = triangle;
+            const Float b0 = hit.barycentric[0];
+            const Float b1 = hit.barycentric[1];
+            const Float b2 = hit.barycentric[2];
+
+            const Float xAbsSum = (std::abs(b0 * p0.x) + std::abs(b1 * p1.x) +
+                                   std::abs(b2 * p2.x));
+            const Float yAbsSum = (std::abs(b0 * p0.y) + std::abs(b1 * p1.y) +
+                                   std::abs(b2 * p2.y));
+            const Float zAbsSum = (std::abs(b0 * p0.z) + std::abs(b1 * p1.z) +
+                                   std::abs(b2 * p2.z));
+            const Vector3f pError =
+                gamma(7) * Vector3f(xAbsSum, yAbsSum, zAbsSum);
+
+            return SurfaceInteraction{b0 * p0 + b1 * p1 + b2 * p2,
+                                      pError,
+                                      Point2f(b1 + b2, b2),
+                                      -ray.d,
+                                      p1 - p0,
+                                      p2 - p1,
+                                      Normal3f::zero(),
+                                      Normal3f::zero(),
+                                      ray.time,
+                                      nullptr,
+                                      static_cast<std::size_t>(faceIndex)};
+        }
+    } // namespace bvh
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "pbrt/accelerators/bvh/PLOCBuilder.hpp"
+#include "pbrt/accelerators/bvh/Morton.hpp"
+#include "pbrt/functional/Functional.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+namespace idragnev::pbrt::accelerators::bvh {
+    namespace constants {
+        constexpr std::int64_t PLOC_CHUNK_SIZE = 256;
+    } // namespace constants
+
+    // The nodes of the tree being built. The first N nodes are the
+    // leaves (one per primitive, in morton order) and the remaining
+    // N - 1 are the interior nodes, allocated as clusters get merged.
+    // `active` holds the current clusters, in morton order.
+    struct PLOCBuilder::Clusters
+    {
+        std::size_t indexOf(const BuildNode& node) const noexcept {
+            return static_cast<std::size_t>(&node - nodes);
+        }
+
+        BuildNode* nodes = nullptr;
+        std::vector<std::size_t> primitivesCounts;
+        std::vector<BuildNode*> active;
+        std::atomic<std::size_t> nextNodeIndex = 0;
+    };
+
+    BuildResult PLOCBuilder::operator()(memory::MemoryArena& arena,
+                                        const PrimsVec& primitives) const {
+        if (primitives.empty()) {
+            return BuildResult{};
+        }
+
+        const std::vector<PrimitiveInfo> primitivesInfo =
+            functional::fmapIndexed(
+                primitives,
+                [](const auto& primitive, const std::size_t i) {
+                    return PrimitiveInfo{i, primitive->worldBound()};
+                });
+        const std::vector<MortonPrimitive> mortonPrims =
+            radixSort(toMortonPrimitives(primitivesInfo));
+
+        const std::size_t primsCount = primitives.size();
+        const std::size_t maxNodesCount = 2 * primsCount - 1;
+
+        Clusters clusters;
+        clusters.nodes = arena.alloc<BuildNode>(maxNodesCount, false);
+        clusters.primitivesCounts.resize(maxNodesCount, 1);
+        clusters.active.resize(primsCount);
+        clusters.nextNodeIndex = primsCount;
+
+        parallel::parallelFor(
+            [&clusters, &mortonPrims, &primitivesInfo](const std::int64_t i) {
+                const auto index = static_cast<std::size_t>(i);
+                const std::size_t primIndex = mortonPrims[index].index;
+
+                BuildNode& leaf = clusters.nodes[index];
+                leaf = BuildNode::Leaf(primIndex,
+                                       1,
+                                       primitivesInfo[primIndex].bounds);
+                clusters.active[index] = &leaf;
+            },
+            static_cast<std::int64_t>(primsCount),
+            constants::PLOC_CHUNK_SIZE);
+
+        BuildNode* const root = mergeClusters(clusters);
+
+        return collapseSubtrees(clusters, root, primitives);
+    }
+
+    // Repeatedly merges mutual nearest neighbours until
+    // a single cluster remains. Returns the root of the resulting tree.
+    BuildNode* PLOCBuilder::mergeClusters(Clusters& clusters) const {
+        std::vector<BuildNode*>& active = clusters.active;
+
+        while (active.size() > 1) {
+            const std::vector<std::size_t> neighbours =
+                findNearestNeighbours(active);
+
+            // Each pair of mutual nearest neighbours is merged by the
+            // cluster which comes first, which stores the merged cluster
+            // at its own position and invalidates the other one.
+            parallel::parallelFor(
+                [&clusters, &active, &neighbours](const std::int64_t i) {
+                    const auto index = static_cast<std::size_t>(i);
+                    const std::size_t neighbour = neighbours[index];
+
+                    if (index < neighbour && neighbours[neighbour] == index) {
+                        const std::size_t nodeIndex =
+                            clusters.nextNodeIndex.fetch_add(1);
+                        BuildNode& node = clusters.nodes[nodeIndex];
+
+                        node = makeInteriorNode(active[index],
+                                                active[neighbour]);
+                        clusters.primitivesCounts[nodeIndex] =
+                            clusters.primitivesCounts[clusters.indexOf(
+                                *active[index])] +
+                            clusters.primitivesCounts[clusters.indexOf(
+                                *active[neighbour])];
+
+                        active[index] = &node;
+                        active[neighbour] = nullptr;
+                    }
+                },
+                static_cast<std::int64_t>(active.size()),
+                constants::PLOC_CHUNK_SIZE);
+
+            [[maybe_unused]] const auto erasedCount =
+                std::erase(active, nullptr);
+            assert(erasedCount > 0);
+        }
+
+        return active.front();
+    }
+
+    // Finds the nearest neighbour of each cluster within the search
+    // radius. Ties are broken in favour of the leftmost neighbour so
+    // that pair distances are totally ordered and the closest pair
+    // of clusters is always a mutual one.
+    std::vector<std::size_t> PLOCBuilder::findNearestNeighbours(
+        const std::vector<BuildNode*>& clusters) const {
+        std::vector<std::size_t> result(clusters.size());
+
+        const std::size_t radius = std::max(this->searchRadius, std::size_t{1});
+
+        parallel::parallelFor(
+            [&result, &clusters, radius](const std::int64_t i) {
+                const auto index = static_cast<std::size_t>(i);
+                const Bounds3f& bounds = clusters[index]->bounds;
+
+                const std::size_t first = index > radius ? index - radius : 0;
+                const std::size_t last =
+                    std::min(index + radius, clusters.size() - 1);
+
+                std::size_t nearest = index;
+                Float minDistance = std::numeric_limits<Float>::infinity();
+                for (std::size_t j = first; j <= last; ++j) {
+                    if (j == index) {
+                        continue;
+                    }
+
+                    const Float distance =
+                        unionOf(bounds, clusters[j]->bounds).surfaceArea();
+                    if (distance < minDistance || nearest == index) {
+                        minDistance = distance;
+                        nearest = j;
+                    }
+                }
+
+                result[index] = nearest;
+            },
+            static_cast<std::int64_t>(clusters.size()),
+            constants::PLOC_CHUNK_SIZE);
+
+        return result;
+    }
+
+    // Assigns contiguous ranges of the ordered primitives to the leaves,
+    // in depth-first order, turning each subtree with no more than
+    // `maxPrimitivesInNode` primitives into a single leaf.
+    BuildResult
+    PLOCBuilder::collapseSubtrees(const Clusters& clusters,
+                                  BuildNode* const root,
+                                  const PrimsVec& primitives) const {
+        BuildResult result;
+        result.tree.root = root;
+        result.orderedPrimitives.reserve(primitives.size());
+
+        std::vector<BuildNode*> nodesToVisit{root};
+        std::vector<BuildNode*> subtreeNodes;
+
+        while (nodesToVisit.empty() == false) {
+            BuildNode* const node = nodesToVisit.back();
+            nodesToVisit.pop_back();
+            ++result.tree.nodesCount;
+
+            const std::size_t primsCount =
+                clusters.primitivesCounts[clusters.indexOf(*node)];
+            if (primsCount > this->maxPrimitivesInNode) {
+                nodesToVisit.push_back(node->children[1]);
+                nodesToVisit.push_back(node->children[0]);
+                continue;
+            }
+
+            const std::size_t firstPrimIndex = result.orderedPrimitives.size();
+
+            subtreeNodes.push_back(node);
+            while (subtreeNodes.empty() == false) {
+                const BuildNode* const current = subtreeNodes.back();
+                subtreeNodes.pop_back();
+
+                if (current->primitivesCount > 0) {
+                    result.orderedPrimitives.push_back(
+                        primitives[current->firstPrimitiveIndex]);
+                }
+                else {
+                    subtreeNodes.push_back(current->children[1]);
+                    subtreeNodes.push_back(current->children[0]);
+                }
+            }
+
+            *node = BuildNode::Leaf(firstPrimIndex, primsCount, node->bounds);
+        }
+
+        return result;
+    }
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "pbrt/accelerators/bvh/RecursiveBuilder.hpp"
 #include "pbrt/functional/Functional.hpp"
 
+#include <assert.h>
+
 namespace idragnev::pbrt::accelerators::bvh {
     std::size_t partitionPrimitivesInfoInEqualSubsets(
         const std::size_t splitAxis,
@@ -8,25 +10,29 @@ namespace idragnev::pbrt::accelerators::bvh {
     Optional<std::size_t> partitionPrimitivesInfoAtAxisMiddle(
         const Bounds3f& rangeCentroidBounds,
         const std::span<PrimitiveInfo> primsInfoRange);
-    Optional<std::size_t>
-    partitionPrimitivesInfoBySAH(const Bounds3f& rangeBounds,
-                                 const Bounds3f& rangeCentroidBounds,
-                                 const std::span<PrimitiveInfo> primsInfoRange,
-                                 const std::size_t maxPrimsInNode);
 
     BuildResult RecursiveBuilder::operator()(memory::MemoryArena& arena,
                                              const PrimsVec& primitives) const {
+        return (*this)(arena,
+                       primitives,
+                       functional::fmapIndexed(
+                           primitives,
+                           [](const auto& primitive, const std::size_t i) {
+                               return PrimitiveInfo{i, primitive->worldBound()};
+                           }));
+    }
+
+    BuildResult RecursiveBuilder::operator()(
+        memory::MemoryArena& arena,
+        const PrimsVec& primitives,
+        std::vector<PrimitiveInfo> primitivesInfo) const {
+        assert(primitivesInfo.size() == primitives.size());
+
         BuildResult result{};
         if (primitives.empty()) {
             return result;
         }
 
-        std::vector<PrimitiveInfo> primitivesInfo = functional::fmapIndexed(
-            primitives,
-            [](const auto& primitive, const std::size_t i) {
-                return PrimitiveInfo{i, primitive->worldBound()};
-            });
-
         result.orderedPrimitives.reserve(primitives.size());
         result.tree = buildSubtree(
             arena,
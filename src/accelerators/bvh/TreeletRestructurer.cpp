@@ -0,0 +1,349 @@
+#include "pbrt/accelerators/bvh/TreeletRestructurer.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <memory>
+
+namespace idragnev::pbrt::accelerators::bvh {
+    namespace constants {
+        constexpr std::uint32_t NO_NODE =
+            std::numeric_limits<std::uint32_t>::max();
+        constexpr std::int64_t RESTRUCTURING_CHUNK_SIZE = 64;
+        // Restructure only if the cost drops by more than this fraction,
+        // so that floating point noise does not cause needless rewrites.
+        constexpr Float MIN_RELATIVE_COST_GAIN = 1e-5f;
+    } // namespace constants
+
+    // Index based view of the topology of a BuildTree with
+    // the unnormalized SAH cost of each subtree.
+    // The BuildNodes are kept in sync with it as treelets are restructured.
+    struct TreeTopology
+    {
+        bool isLeaf(const std::uint32_t node) const noexcept {
+            return nodes[node]->primitivesCount > 0;
+        }
+
+        std::vector<BuildNode*> nodes;
+        std::vector<std::uint32_t> parents;
+        std::vector<std::array<std::uint32_t, 2>> children;
+        std::vector<Float> costs;
+        std::vector<std::uint32_t> leaves;
+    };
+
+    // The leaves of a treelet are roots of subtrees which are left
+    // intact and its interior nodes are the ones to be rearranged.
+    // The first interior node is the root of the treelet.
+    // A treelet with N leaves has N - 1 interior nodes.
+    struct Treelet
+    {
+        static constexpr std::size_t MAX_LEAVES =
+            TreeletRestructurer::MAX_TREELET_LEAVES;
+
+        std::array<std::uint32_t, MAX_LEAVES> leaves = {};
+        std::array<std::uint32_t, MAX_LEAVES - 1> interiorNodes = {};
+        std::size_t leavesCount = 0;
+    };
+
+    // The optimal topology over the subsets of a treelet's leaves,
+    // where subsets are bitmasks of leaf positions in the treelet.
+    struct OptimalTopology
+    {
+        static constexpr std::size_t MAX_SUBSETS = std::size_t{1}
+                                                   << Treelet::MAX_LEAVES;
+
+        std::array<Float, MAX_SUBSETS> costs = {};
+        std::array<std::uint32_t, MAX_SUBSETS> partitions = {};
+    };
+
+    TreeTopology makeTopology(BuildNode* const root);
+    void runRestructuringPass(TreeTopology& topology,
+                              const std::size_t treeletLeavesCount);
+    void restructureTreelet(TreeTopology& topology,
+                            const std::uint32_t root,
+                            const std::size_t treeletLeavesCount);
+    Treelet formTreelet(const TreeTopology& topology,
+                        const std::uint32_t root,
+                        const std::size_t maxLeavesCount);
+    void findOptimalTopology(const TreeTopology& topology,
+                             const Treelet& treelet,
+                             OptimalTopology& result);
+    void rebuildTreelet(TreeTopology& topology,
+                        const Treelet& treelet,
+                        const OptimalTopology& optimal);
+
+    TreeletRestructurer::TreeletRestructurer(
+        const std::size_t passesCount,
+        const std::size_t treeletLeavesCount) noexcept
+        : passesCount(passesCount)
+        , treeletLeavesCount(std::clamp(treeletLeavesCount,
+                                        MIN_TREELET_LEAVES,
+                                        MAX_TREELET_LEAVES)) {}
+
+    void TreeletRestructurer::operator()(BuildTree& tree) const {
+        if (tree.root == nullptr || tree.root->primitivesCount > 0) {
+            return;
+        }
+
+        TreeTopology topology = makeTopology(tree.root);
+        for (std::size_t pass = 0; pass < this->passesCount; ++pass) {
+            runRestructuringPass(topology, this->treeletLeavesCount);
+        }
+    }
+
+    TreeTopology makeTopology(BuildNode* const root) {
+        TreeTopology result;
+
+        struct NodeToVisit
+        {
+            BuildNode* node = nullptr;
+            std::uint32_t parent = constants::NO_NODE;
+            std::size_t childSlot = 0;
+        };
+
+        std::vector<NodeToVisit> nodesToVisit{NodeToVisit{.node = root}};
+        while (nodesToVisit.empty() == false) {
+            const NodeToVisit current = nodesToVisit.back();
+            nodesToVisit.pop_back();
+
+            const auto index = static_cast<std::uint32_t>(result.nodes.size());
+            result.nodes.push_back(current.node);
+            result.parents.push_back(current.parent);
+            result.children.push_back({constants::NO_NODE, constants::NO_NODE});
+
+            if (current.parent != constants::NO_NODE) {
+                result.children[current.parent][current.childSlot] = index;
+            }
+
+            if (current.node->primitivesCount > 0) {
+                result.leaves.push_back(index);
+            }
+            else {
+                nodesToVisit.push_back(NodeToVisit{current.node->children[1],
+                                                   index,
+                                                   1});
+                nodesToVisit.push_back(NodeToVisit{current.node->children[0],
+                                                   index,
+                                                   0});
+            }
+        }
+
+        // parents precede their children, so costs are computed backwards
+        result.costs.resize(result.nodes.size());
+        for (std::size_t i = result.nodes.size(); i-- > 0;) {
+            const auto node = static_cast<std::uint32_t>(i);
+            const Float area = result.nodes[i]->bounds.surfaceArea();
+
+            result.costs[i] =
+                result.isLeaf(node)
+                    ? area * static_cast<Float>(
+                                 result.nodes[i]->primitivesCount)
+                    : area + result.costs[result.children[i][0]] +
+                          result.costs[result.children[i][1]];
+        }
+
+        return result;
+    }
+
+    // Each leaf starts a walk towards the root. The walk which reaches
+    // an interior node second restructures the treelet rooted at it,
+    // when both of its subtrees are already processed.
+    void runRestructuringPass(TreeTopology& topology,
+                              const std::size_t treeletLeavesCount) {
+        const auto visitCounts =
+            std::make_unique<std::atomic<std::uint32_t>[]>(
+                topology.nodes.size());
+
+        parallel::parallelFor(
+            [&topology, &visitCounts, treeletLeavesCount](
+                const std::int64_t i) {
+                const std::uint32_t leaf =
+                    topology.leaves[static_cast<std::size_t>(i)];
+
+                std::uint32_t current = topology.parents[leaf];
+                while (current != constants::NO_NODE) {
+                    const std::uint32_t visitsBefore =
+                        visitCounts[current].fetch_add(
+                            1,
+                            std::memory_order_acq_rel);
+                    if (visitsBefore == 0) {
+                        return;
+                    }
+
+                    restructureTreelet(topology, current, treeletLeavesCount);
+                    current = topology.parents[current];
+                }
+            },
+            static_cast<std::int64_t>(topology.leaves.size()),
+            constants::RESTRUCTURING_CHUNK_SIZE);
+    }
+
+    void restructureTreelet(TreeTopology& topology,
+                            const std::uint32_t root,
+                            const std::size_t treeletLeavesCount) {
+        const Treelet treelet =
+            formTreelet(topology, root, treeletLeavesCount);
+        if (treelet.leavesCount < TreeletRestructurer::MIN_TREELET_LEAVES) {
+            return;
+        }
+
+        OptimalTopology optimal;
+        findOptimalTopology(topology, treelet, optimal);
+
+        const std::size_t allLeaves =
+            (std::size_t{1} << treelet.leavesCount) - 1;
+        const Float currentCost = topology.costs[root];
+        const Float optimalCost = optimal.costs[allLeaves];
+
+        if (optimalCost <
+            currentCost * (1.f - constants::MIN_RELATIVE_COST_GAIN)) {
+            rebuildTreelet(topology, treelet, optimal);
+        }
+    }
+
+    // Starts with the children of `root` as leaves and repeatedly
+    // expands the interior leaf with the largest surface area.
+    Treelet formTreelet(const TreeTopology& topology,
+                        const std::uint32_t root,
+                        const std::size_t maxLeavesCount) {
+        Treelet treelet;
+        treelet.interiorNodes[0] = root;
+        treelet.leaves[0] = topology.children[root][0];
+        treelet.leaves[1] = topology.children[root][1];
+        treelet.leavesCount = 2;
+
+        while (treelet.leavesCount < maxLeavesCount) {
+            std::size_t largest = treelet.leavesCount;
+            Float largestArea = -1.f;
+            for (std::size_t i = 0; i < treelet.leavesCount; ++i) {
+                const std::uint32_t node = treelet.leaves[i];
+                const Float area = topology.nodes[node]->bounds.surfaceArea();
+
+                if (topology.isLeaf(node) == false && area > largestArea) {
+                    largest = i;
+                    largestArea = area;
+                }
+            }
+
+            if (largest == treelet.leavesCount) {
+                break;
+            }
+
+            const std::uint32_t expanded = treelet.leaves[largest];
+            treelet.interiorNodes[treelet.leavesCount - 1] = expanded;
+            treelet.leaves[largest] = topology.children[expanded][0];
+            treelet.leaves[treelet.leavesCount] =
+                topology.children[expanded][1];
+            ++treelet.leavesCount;
+        }
+
+        return treelet;
+    }
+
+    // Subsets are processed in increasing numeric order, so all proper
+    // subsets of a subset are processed before it. Only partitions whose
+    // first part contains the lowest leaf of the subset are considered,
+    // as the rest are their mirror images.
+    void findOptimalTopology(const TreeTopology& topology,
+                             const Treelet& treelet,
+                             OptimalTopology& result) {
+        const std::size_t subsetsCount = std::size_t{1} << treelet.leavesCount;
+
+        std::array<Bounds3f, OptimalTopology::MAX_SUBSETS> bounds;
+        for (std::size_t i = 0; i < treelet.leavesCount; ++i) {
+            const std::uint32_t leaf = treelet.leaves[i];
+            bounds[std::size_t{1} << i] = topology.nodes[leaf]->bounds;
+            result.costs[std::size_t{1} << i] = topology.costs[leaf];
+        }
+
+        for (std::size_t subset = 1; subset < subsetsCount; ++subset) {
+            if (std::has_single_bit(subset)) {
+                continue;
+            }
+
+            const std::size_t lowestLeaf = subset & (~subset + 1);
+            bounds[subset] =
+                unionOf(bounds[lowestLeaf], bounds[subset ^ lowestLeaf]);
+
+            Float bestCost = std::numeric_limits<Float>::infinity();
+            std::size_t bestPartition = lowestLeaf;
+            for (std::size_t part = (subset - 1) & subset; part > 0;
+                 part = (part - 1) & subset) {
+                if ((part & lowestLeaf) == 0) {
+                    continue;
+                }
+
+                const Float cost =
+                    result.costs[part] + result.costs[subset ^ part];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestPartition = part;
+                }
+            }
+
+            result.costs[subset] = bounds[subset].surfaceArea() + bestCost;
+            result.partitions[subset] =
+                static_cast<std::uint32_t>(bestPartition);
+        }
+    }
+
+    // Reuses the interior nodes of `treelet` to build its optimal
+    // topology, keeping its root in place.
+    void rebuildTreelet(TreeTopology& topology,
+                        const Treelet& treelet,
+                        const OptimalTopology& optimal) {
+        struct Subtree
+        {
+            std::size_t subset = 0;
+            std::uint32_t node = constants::NO_NODE;
+        };
+
+        const std::size_t allLeaves =
+            (std::size_t{1} << treelet.leavesCount) - 1;
+
+        // Interior nodes are assigned top-down and
+        // their bounds and costs are updated bottom-up,
+        // by traversing the assigned ones backwards.
+        std::array<Subtree, Treelet::MAX_LEAVES - 1> assigned;
+        std::size_t assignedCount = 0;
+        assigned[assignedCount++] =
+            Subtree{allLeaves, treelet.interiorNodes[0]};
+
+        for (std::size_t i = 0; i < assignedCount; ++i) {
+            const Subtree current = assigned[i];
+            const std::size_t part = optimal.partitions[current.subset];
+            const std::size_t parts[2] = {part, current.subset ^ part};
+
+            for (std::size_t slot = 0; slot < 2; ++slot) {
+                std::uint32_t child = constants::NO_NODE;
+                if (std::has_single_bit(parts[slot])) {
+                    const auto leafIndex = static_cast<std::size_t>(
+                        std::countr_zero(parts[slot]));
+                    child = treelet.leaves[leafIndex];
+                }
+                else {
+                    child = treelet.interiorNodes[assignedCount];
+                    assigned[assignedCount++] = Subtree{parts[slot], child};
+                }
+
+                topology.children[current.node][slot] = child;
+                topology.parents[child] = current.node;
+            }
+        }
+
+        for (std::size_t i = assignedCount; i-- > 0;) {
+            const std::uint32_t node = assigned[i].node;
+            const std::uint32_t child0 = topology.children[node][0];
+            const std::uint32_t child1 = topology.children[node][1];
+
+            *topology.nodes[node] = makeInteriorNode(topology.nodes[child0],
+                                                     topology.nodes[child1]);
+            topology.costs[node] = topology.nodes[node]->bounds.surfaceArea() +
+                                   topology.costs[child0] +
+                                   topology.costs[child1];
+        }
+    }
+} // namespace idragnev::pbrt::accelerators::bvh
\ No newline at end of file
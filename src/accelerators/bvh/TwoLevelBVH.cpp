@@ -0,0 +1,110 @@
+#include "pbrt/accelerators/bvh/TwoLevelBVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/functional/Functional.hpp"
+
+#include <assert.h>
+
+namespace idragnev::pbrt::accelerators {
+    // Intersects its BVH with the rays transformed to instance space.
+    // Unlike TransformedPrimitive, the transformation is not animated,
+    // so both directions of it are computed once.
+    class TwoLevelBVH::InstancePrimitive : public Aggregate
+    {
+    public:
+        InstancePrimitive(std::shared_ptr<const BVH> bvh,
+                          const Transformation& instanceToWorld)
+            : bvh(std::move(bvh)) {
+            setTransformation(instanceToWorld);
+        }
+
+        void setTransformation(const Transformation& instanceToWorld) {
+            this->instanceToWorld = instanceToWorld;
+            this->worldToInstance = inverse(instanceToWorld);
+            this->bounds = instanceToWorld(this->bvh->worldBound());
+        }
+
+        Bounds3f worldBound() const override { return bounds; }
+
+        Optional<SurfaceInteraction>
+        intersect(const Ray& ray) const override {
+            const Ray instanceRay = this->worldToInstance(ray);
+
+            return this->bvh->intersect(instanceRay)
+                .map([this, &ray, &instanceRay](
+                         SurfaceInteraction&& interaction)
+                         -> SurfaceInteraction {
+                    ray.tMax = instanceRay.tMax;
+
+                    return this->instanceToWorld.isIdentity() == false
+                               ? this->instanceToWorld(interaction)
+                               : std::move(interaction);
+                });
+        }
+
+        bool intersectP(const Ray& ray) const override {
+            return this->bvh->intersectP(this->worldToInstance(ray));
+        }
+
+    private:
+        std::shared_ptr<const BVH> bvh;
+        Transformation instanceToWorld;
+        Transformation worldToInstance;
+        Bounds3f bounds;
+    };
+
+    template <typename P>
+    std::vector<std::shared_ptr<const Primitive>>
+    asPrimitives(const std::vector<std::shared_ptr<P>>& primitives);
+
+    TwoLevelBVH::TwoLevelBVH(const std::vector<BVHInstance>& instances,
+                             const bvh::SplitMethod splitMethod)
+        : instances(functional::fmap(instances,
+                                     [](const BVHInstance& instance) {
+                                         assert(instance.bvh != nullptr);
+                                         return std::make_shared<
+                                             InstancePrimitive>(
+                                             instance.bvh,
+                                             instance.instanceToWorld);
+                                     }))
+        , topLevel(asPrimitives(this->instances), splitMethod) {}
+
+    TwoLevelBVH::~TwoLevelBVH() = default;
+
+    template <typename P>
+    std::vector<std::shared_ptr<const Primitive>>
+    asPrimitives(const std::vector<std::shared_ptr<P>>& primitives) {
+        return std::vector<std::shared_ptr<const Primitive>>(
+            primitives.begin(),
+            primitives.end());
+    }
+
+    Bounds3f TwoLevelBVH::worldBound() const {
+        return this->topLevel.worldBound();
+    }
+
+    Optional<SurfaceInteraction>
+    TwoLevelBVH::intersect(const Ray& ray) const {
+        return this->topLevel.intersect(ray);
+    }
+
+    bool TwoLevelBVH::intersectP(const Ray& ray) const {
+        return this->topLevel.intersectP(ray);
+    }
+
+    void TwoLevelBVH::updateTransformations(
+        const std::span<const Transformation> instanceToWorld) {
+        assert(instanceToWorld.size() == this->instances.size());
+
+        for (std::size_t i = 0; i < instanceToWorld.size(); ++i) {
+            this->instances[i]->setTransformation(instanceToWorld[i]);
+        }
+        this->topLevel.refit();
+    }
+
+    const BVH& TwoLevelBVH::topLevelBVH() const noexcept {
+        return this->topLevel;
+    }
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -0,0 +1,328 @@
+#include "pbrt/accelerators/grid/Grid.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace idragnev::pbrt::accelerators {
+    namespace constants {
+        inline constexpr std::uint32_t GRID_MAX_RESOLUTION = 256;
+        inline constexpr std::int64_t GRID_BUILD_CHUNK_SIZE = 256;
+        // The number of primitives whose tests a walk remembers
+        // so that it tests primitives spanning several cells once
+        inline constexpr std::size_t GRID_MAILBOX_SIZE = 8;
+        inline constexpr std::uint32_t EMPTY_MAILBOX_SLOT =
+            std::numeric_limits<std::uint32_t>::max();
+    } // namespace constants
+
+    // Remembers the primitives tested by a walk in slots
+    // selected by their indices
+    class Mailbox
+    {
+    public:
+        Mailbox() { slots.fill(constants::EMPTY_MAILBOX_SLOT); }
+
+        // Returns false if the primitive was recently tested
+        bool markTested(const std::uint32_t primitive) noexcept {
+            std::uint32_t& slot =
+                slots[primitive % constants::GRID_MAILBOX_SIZE];
+            if (slot == primitive) {
+                return false;
+            }
+            slot = primitive;
+            return true;
+        }
+
+    private:
+        std::array<std::uint32_t, constants::GRID_MAILBOX_SIZE> slots;
+    };
+
+    Grid::Grid(std::vector<std::shared_ptr<const Primitive>> prims,
+               const Float cellsPerPrimitive)
+        : primitives(std::move(prims)) {
+        assert(this->primitives.size() < constants::EMPTY_MAILBOX_SLOT);
+
+        if (this->primitives.empty()) {
+            return;
+        }
+
+        const auto primitivesCount =
+            static_cast<std::int64_t>(this->primitives.size());
+        std::vector<Bounds3f> primitivesBounds(this->primitives.size());
+        parallel::parallelFor(
+            [this, &primitivesBounds](const std::int64_t i) {
+                const auto index = static_cast<std::size_t>(i);
+                primitivesBounds[index] =
+                    this->primitives[index]->worldBound();
+            },
+            primitivesCount,
+            constants::GRID_BUILD_CHUNK_SIZE);
+
+        for (const Bounds3f& b : primitivesBounds) {
+            this->bounds = unionOf(this->bounds, b);
+        }
+
+        // cubic cells with the requested density, as far as the
+        // resolution limit and the flat dimensions of the bounds allow
+        const Vector3f diagonal = this->bounds.diagonal();
+        const Float maxExtent = diagonal[this->bounds.maximumExtent()];
+        const Float cellsPerUnitLength =
+            maxExtent > 0.f
+                ? std::cbrt(cellsPerPrimitive *
+                            static_cast<Float>(this->primitives.size())) /
+                      maxExtent
+                : 0.f;
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            const Float cells = std::round(diagonal[axis] * cellsPerUnitLength);
+            this->cellsCounts[axis] = static_cast<std::uint32_t>(
+                clamp(cells,
+                      1.f,
+                      static_cast<Float>(constants::GRID_MAX_RESOLUTION)));
+            this->cellSize[axis] =
+                diagonal[axis] / static_cast<Float>(this->cellsCounts[axis]);
+            this->inverseCellSize[axis] = this->cellSize[axis] > 0.f
+                                              ? 1.f / this->cellSize[axis]
+                                              : 0.f;
+        }
+
+        // Counting sort of the primitives into the cells they overlap:
+        // count the primitives of each cell, compute the offsets of the
+        // cells and then count down to place each primitive
+        const std::size_t cellsCount = static_cast<std::size_t>(
+            this->cellsCounts[0] * this->cellsCounts[1] *
+            this->cellsCounts[2]);
+        std::vector<std::atomic<std::uint32_t>> cellSizes(cellsCount);
+        parallel::parallelFor(
+            [this, &primitivesBounds, &cellSizes](const std::int64_t i) {
+                forEachOverlappedCell(
+                    primitivesBounds[static_cast<std::size_t>(i)],
+                    [&cellSizes](const std::size_t cell) {
+                        cellSizes[cell].fetch_add(1, std::memory_order_relaxed);
+                    });
+            },
+            primitivesCount,
+            constants::GRID_BUILD_CHUNK_SIZE);
+
+        this->cellOffsets.resize(cellsCount + 1);
+        std::uint64_t offset = 0;
+        for (std::size_t cell = 0; cell < cellsCount; ++cell) {
+            this->cellOffsets[cell] = static_cast<std::uint32_t>(offset);
+            offset += cellSizes[cell].load(std::memory_order_relaxed);
+        }
+        assert(offset <= std::numeric_limits<std::uint32_t>::max());
+        this->cellOffsets[cellsCount] = static_cast<std::uint32_t>(offset);
+
+        this->cellPrimitiveIndices.resize(static_cast<std::size_t>(offset));
+        parallel::parallelFor(
+            [this, &primitivesBounds, &cellSizes](const std::int64_t i) {
+                const auto index = static_cast<std::uint32_t>(i);
+                forEachOverlappedCell(
+                    primitivesBounds[index],
+                    [this, index, &cellSizes](const std::size_t cell) {
+                        const std::uint32_t position =
+                            this->cellOffsets[cell] +
+                            cellSizes[cell].fetch_sub(
+                                1,
+                                std::memory_order_relaxed) -
+                            1;
+                        this->cellPrimitiveIndices[position] = index;
+                    });
+            },
+            primitivesCount,
+            constants::GRID_BUILD_CHUNK_SIZE);
+
+        // the order of the primitives within a cell depends on
+        // the scheduling of the threads, make the queries deterministic
+        parallel::parallelFor(
+            [this](const std::int64_t cell) {
+                const auto first = this->cellPrimitiveIndices.begin() +
+                                   this->cellOffsets[cell];
+                const auto last = this->cellPrimitiveIndices.begin() +
+                                  this->cellOffsets[cell + 1];
+                std::sort(first, last);
+            },
+            static_cast<std::int64_t>(cellsCount),
+            constants::GRID_BUILD_CHUNK_SIZE);
+    }
+
+    Bounds3f Grid::worldBound() const { return this->bounds; }
+
+    std::array<std::uint32_t, 3> Grid::resolution() const noexcept {
+        return this->cellsCounts;
+    }
+
+    std::uint32_t Grid::cellCoordinate(const Float p,
+                                       const std::size_t axis) const noexcept {
+        const Float cell =
+            (p - this->bounds.min[axis]) * this->inverseCellSize[axis];
+        return static_cast<std::uint32_t>(
+            clamp(cell,
+                  0.f,
+                  static_cast<Float>(this->cellsCounts[axis] - 1)));
+    }
+
+    std::size_t Grid::cellIndex(const std::uint32_t x,
+                                const std::uint32_t y,
+                                const std::uint32_t z) const noexcept {
+        return (static_cast<std::size_t>(z) * this->cellsCounts[1] + y) *
+                   this->cellsCounts[0] +
+               x;
+    }
+
+    std::span<const std::uint32_t>
+    Grid::cellPrimitives(const std::size_t cell) const {
+        const std::uint32_t first = this->cellOffsets[cell];
+        const std::uint32_t last = this->cellOffsets[cell + 1];
+        return std::span<const std::uint32_t>{
+            this->cellPrimitiveIndices.data() + first,
+            last - first};
+    }
+
+    template <typename F>
+    void Grid::forEachOverlappedCell(const Bounds3f& primitiveBounds,
+                                     F&& f) const {
+        std::uint32_t first[3];
+        std::uint32_t last[3];
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            first[axis] = cellCoordinate(primitiveBounds.min[axis], axis);
+            last[axis] = cellCoordinate(primitiveBounds.max[axis], axis);
+        }
+
+        for (std::uint32_t z = first[2]; z <= last[2]; ++z) {
+            for (std::uint32_t y = first[1]; y <= last[1]; ++y) {
+                for (std::uint32_t x = first[0]; x <= last[0]; ++x) {
+                    f(cellIndex(x, y, z));
+                }
+            }
+        }
+    }
+
+    Optional<SurfaceInteraction> Grid::intersect(const Ray& ray) const {
+        Optional<PrimitiveHit> closest = pbrt::nullopt;
+        std::uint32_t closestPrimitive = 0;
+        Mailbox mailbox;
+
+        walk(
+            [&](const std::size_t cell) {
+                for (const std::uint32_t i : cellPrimitives(cell)) {
+                    if (!mailbox.markTested(i)) {
+                        continue;
+                    }
+                    if (auto hit = this->primitives[i]->intersectHit(ray);
+                        hit.has_value())
+                    {
+                        closest = std::move(hit);
+                        closestPrimitive = i;
+                    }
+                }
+                return false;
+            },
+            ray);
+
+        if (!closest.has_value()) {
+            return pbrt::nullopt;
+        }
+
+        return pbrt::make_optional(
+            this->primitives[closestPrimitive]->computeInteraction(
+                ray,
+                std::move(*closest)));
+    }
+
+    bool Grid::intersectP(const Ray& ray) const {
+        bool hit = false;
+        Mailbox mailbox;
+
+        walk(
+            [this, &ray, &hit, &mailbox](const std::size_t cell) {
+                const auto prims = cellPrimitives(cell);
+                hit = std::any_of(
+                    prims.begin(),
+                    prims.end(),
+                    [this, &ray, &mailbox](const std::uint32_t i) {
+                        return mailbox.markTested(i) &&
+                               this->primitives[i]->intersectP(ray);
+                    });
+                return hit;
+            },
+            ray);
+
+        return hit;
+    }
+
+    // Visits the cells which the ray passes through in order with the
+    // 3D-DDA of Amanatides and Woo, until `visitCell` returns true or
+    // the ray ends (its tMax is lowered by the hits found on the way)
+    template <typename CellVisitor>
+    void Grid::walk(CellVisitor&& visitCell, const Ray& ray) const {
+        if (this->primitives.empty()) {
+            return;
+        }
+
+        const Optional<Intervalf> range = this->bounds.intersectP(ray);
+        if (!range.has_value()) {
+            return;
+        }
+
+        const Float tEntry = range->low();
+        const Point3f entry = ray(tEntry);
+
+        std::uint32_t cell[3];
+        Float nextCrossingT[3];
+        Float deltaT[3];
+        bool isAscending[3];
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            cell[axis] = cellCoordinate(entry[axis], axis);
+            isAscending[axis] = ray.d[axis] >= 0.f;
+
+            if (ray.d[axis] == 0.f) {
+                nextCrossingT[axis] = pbrt::constants::Infinity;
+                deltaT[axis] = pbrt::constants::Infinity;
+                continue;
+            }
+
+            const std::uint32_t crossedBoundary =
+                isAscending[axis] ? cell[axis] + 1 : cell[axis];
+            const Float boundary =
+                this->bounds.min[axis] +
+                static_cast<Float>(crossedBoundary) * this->cellSize[axis];
+            nextCrossingT[axis] =
+                tEntry + (boundary - entry[axis]) / ray.d[axis];
+            deltaT[axis] = this->cellSize[axis] / std::abs(ray.d[axis]);
+        }
+
+        while (true) {
+            if (bool stop = visitCell(cellIndex(cell[0], cell[1], cell[2]));
+                stop)
+            {
+                return;
+            }
+
+            const std::size_t axis =
+                std::min_element(nextCrossingT, nextCrossingT + 3) -
+                nextCrossingT;
+            // hits within the cell or the end of the ray come first
+            if (ray.tMax < nextCrossingT[axis]) {
+                return;
+            }
+
+            if (isAscending[axis]) {
+                if (++cell[axis] == this->cellsCounts[axis]) {
+                    return;
+                }
+            }
+            else {
+                if (cell[axis] == 0) {
+                    return;
+                }
+                --cell[axis];
+            }
+            nextCrossingT[axis] += deltaT[axis];
+        }
+    }
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -0,0 +1,628 @@
+#include "pbrt/accelerators/kdtree/KdTree.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <cmath>
+#include <numeric>
+#include <span>
+
+namespace idragnev::pbrt::accelerators {
+    namespace constants {
+        // The traversal stack holds at most one node per level
+        inline constexpr std::uint32_t KD_TREE_MAX_DEPTH = 64;
+        // The levels split before the subtrees below them
+        // are built in parallel
+        inline constexpr std::uint32_t KD_TREE_PARALLEL_DEPTH = 6;
+        // Smaller subtrees are built by a single task
+        inline constexpr std::size_t KD_TREE_MIN_PARALLEL_PRIMITIVES = 4096;
+        inline constexpr std::int64_t KD_TREE_BUILD_CHUNK_SIZE = 256;
+    } // namespace constants
+
+    namespace kdtree {
+        // 8 bytes when Float is single precision
+        struct Node
+        {
+            static constexpr std::uint32_t LEAF_FLAG = 3;
+
+            // `primitives` is the primitive of leaves with one primitive
+            // and the offset of the primitives in primitiveIndices for
+            // leaves with more
+            static Node Leaf(const std::uint32_t primitivesCount,
+                             const std::uint32_t primitives) {
+                Node node;
+                node.primitives = primitives;
+                node.bits = (primitivesCount << 2) | LEAF_FLAG;
+                return node;
+            }
+
+            static Node Interior(const std::size_t splitAxis,
+                                 const Float split,
+                                 const std::uint32_t aboveChild) {
+                assert(splitAxis < 3);
+
+                Node node;
+                node.split = split;
+                node.bits =
+                    (aboveChild << 2) | static_cast<std::uint32_t>(splitAxis);
+                return node;
+            }
+
+            bool isLeaf() const noexcept { return (bits & 3) == LEAF_FLAG; }
+            std::size_t splitAxis() const noexcept { return bits & 3; }
+            std::uint32_t primitivesCount() const noexcept { return bits >> 2; }
+            std::uint32_t aboveChild() const noexcept { return bits >> 2; }
+
+            union
+            {
+                Float split;
+                std::uint32_t primitives = 0;
+            };
+            // The split axis, or LEAF_FLAG for leaves, in the low 2 bits
+            // and the index of the child above the split plane or the
+            // number of primitives of leaves in the rest
+            std::uint32_t bits = 0;
+        };
+        static_assert(sizeof(Float) != sizeof(float) || sizeof(Node) == 8);
+
+        struct BuildParameters
+        {
+            Float intersectCost = 80.f;
+            Float traversalCost = 1.f;
+            Float emptyBonus = 0.5f;
+            std::uint32_t maxPrimitivesInNode = 1;
+            std::uint32_t maxDepth = 0;
+        };
+
+        enum class EdgeType : std::uint8_t
+        {
+            Start,
+            End,
+        };
+
+        // The start or the end of the bounds of a primitive along an axis
+        struct BoundEdge
+        {
+            Float t = 0.f;
+            std::uint32_t primitive = 0;
+            EdgeType type = EdgeType::Start;
+        };
+
+        using EdgeBuffers = std::array<std::vector<BoundEdge>, 3>;
+
+        // A subtree to build over `primitives`
+        struct BuildTask
+        {
+            Bounds3f bounds;
+            std::vector<std::uint32_t> primitives;
+            std::uint32_t depth = 0;
+            // The splits on the path to the subtree
+            // which cost more than leaves would
+            std::uint32_t badRefines = 0;
+        };
+
+        struct SplitDecision
+        {
+            std::size_t axis = 0;
+            Float position = 0.f;
+            BuildTask below;
+            BuildTask above;
+        };
+
+        // A node of the levels split before the subtrees are built in
+        // parallel. The child below the split follows the node.
+        struct TopNode
+        {
+            Optional<std::size_t> task = pbrt::nullopt;
+            std::size_t splitAxis = 0;
+            Float split = 0.f;
+            std::size_t aboveChild = 0;
+        };
+
+        struct BuildResult
+        {
+            std::vector<Node> nodes;
+            std::vector<std::uint32_t> primitiveIndices;
+        };
+
+        // Builds the tree with the SAH split planes of pbrt's KdTreeAccel.
+        // The top levels are split by a single thread and the subtrees
+        // below them are built in parallel and joined in depth-first order.
+        class Builder
+        {
+        public:
+            Builder(const std::span<const Bounds3f> primitivesBounds,
+                    const BuildParameters& parameters)
+                : primitivesBounds(primitivesBounds)
+                , parameters(parameters) {}
+
+            BuildResult operator()(BuildTask root) const;
+
+        private:
+            Optional<SplitDecision> split(const BuildTask& task,
+                                          EdgeBuffers& buffers) const;
+            void buildSubtree(const BuildTask& task,
+                              EdgeBuffers& buffers,
+                              BuildResult& result) const;
+            void splitTopLevels(BuildTask task,
+                                EdgeBuffers& buffers,
+                                std::vector<TopNode>& topNodes,
+                                std::vector<BuildTask>& tasks) const;
+            void joinSubtrees(const std::vector<TopNode>& topNodes,
+                              const std::size_t topNode,
+                              std::vector<BuildResult>& subtrees,
+                              BuildResult& result) const;
+
+        private:
+            std::span<const Bounds3f> primitivesBounds;
+            BuildParameters parameters;
+        };
+
+        Node makeLeaf(const std::vector<std::uint32_t>& primitives,
+                      std::vector<std::uint32_t>& primitiveIndices);
+    } // namespace kdtree
+
+    KdTree::KdTree(std::vector<std::shared_ptr<const Primitive>> prims,
+                   const Float intersectCost,
+                   const Float traversalCost,
+                   const Float emptyBonus,
+                   const std::uint32_t maxPrimitivesInNode,
+                   const std::uint32_t maxDepth)
+        : primitives(std::move(prims)) {
+        if (this->primitives.empty()) {
+            return;
+        }
+
+        std::vector<Bounds3f> primitivesBounds(this->primitives.size());
+        parallel::parallelFor(
+            [this, &primitivesBounds](const std::int64_t i) {
+                const auto index = static_cast<std::size_t>(i);
+                primitivesBounds[index] =
+                    this->primitives[index]->worldBound();
+            },
+            static_cast<std::int64_t>(this->primitives.size()),
+            constants::KD_TREE_BUILD_CHUNK_SIZE);
+
+        for (const Bounds3f& b : primitivesBounds) {
+            this->bounds = unionOf(this->bounds, b);
+        }
+
+        const std::uint32_t depthLimit =
+            maxDepth > 0
+                ? maxDepth
+                : static_cast<std::uint32_t>(std::round(
+                      8.f + 1.3f * std::log2(static_cast<Float>(
+                                       this->primitives.size()))));
+
+        const auto parameters = kdtree::BuildParameters{
+            .intersectCost = intersectCost,
+            .traversalCost = traversalCost,
+            .emptyBonus = emptyBonus,
+            .maxPrimitivesInNode = std::max(maxPrimitivesInNode, 1u),
+            .maxDepth = std::min(depthLimit, constants::KD_TREE_MAX_DEPTH),
+        };
+
+        kdtree::BuildTask root;
+        root.bounds = this->bounds;
+        root.primitives.resize(this->primitives.size());
+        std::iota(root.primitives.begin(), root.primitives.end(), 0u);
+
+        kdtree::BuildResult result =
+            kdtree::Builder{primitivesBounds, parameters}(std::move(root));
+        this->nodes = std::move(result.nodes);
+        this->primitiveIndices = std::move(result.primitiveIndices);
+    }
+
+    KdTree::~KdTree() = default;
+
+    Bounds3f KdTree::worldBound() const { return this->bounds; }
+
+    std::size_t KdTree::nodesCount() const noexcept {
+        return this->nodes.size();
+    }
+
+    namespace kdtree {
+        BuildResult Builder::operator()(BuildTask root) const {
+            EdgeBuffers buffers;
+            std::vector<TopNode> topNodes;
+            std::vector<BuildTask> tasks;
+            splitTopLevels(std::move(root), buffers, topNodes, tasks);
+
+            std::vector<BuildResult> subtrees(tasks.size());
+            parallel::parallelFor(
+                [this, &tasks, &subtrees](const std::int64_t i) {
+                    const auto index = static_cast<std::size_t>(i);
+                    EdgeBuffers taskBuffers;
+                    buildSubtree(tasks[index], taskBuffers, subtrees[index]);
+                    tasks[index] = BuildTask{};
+                },
+                static_cast<std::int64_t>(tasks.size()));
+
+            BuildResult result;
+            joinSubtrees(topNodes, 0, subtrees, result);
+
+            assert(result.nodes.size() < (1u << 30));
+
+            return result;
+        }
+
+        void Builder::splitTopLevels(BuildTask task,
+                                     EdgeBuffers& buffers,
+                                     std::vector<TopNode>& topNodes,
+                                     std::vector<BuildTask>& tasks) const {
+            const std::size_t index = topNodes.size();
+            topNodes.emplace_back();
+
+            auto decision =
+                (task.depth < constants::KD_TREE_PARALLEL_DEPTH &&
+                 task.primitives.size() >=
+                     constants::KD_TREE_MIN_PARALLEL_PRIMITIVES)
+                    ? split(task, buffers)
+                    : pbrt::nullopt;
+            if (!decision.has_value()) {
+                topNodes[index].task = tasks.size();
+                tasks.push_back(std::move(task));
+                return;
+            }
+
+            // the primitives are held by the children from now on
+            task = BuildTask{};
+            splitTopLevels(std::move(decision->below),
+                           buffers,
+                           topNodes,
+                           tasks);
+            const std::size_t aboveChild = topNodes.size();
+            splitTopLevels(std::move(decision->above),
+                           buffers,
+                           topNodes,
+                           tasks);
+
+            topNodes[index].splitAxis = decision->axis;
+            topNodes[index].split = decision->position;
+            topNodes[index].aboveChild = aboveChild;
+        }
+
+        // Appends the nodes of `topNode` and of the subtrees below it
+        // to `result` in depth-first order
+        void Builder::joinSubtrees(const std::vector<TopNode>& topNodes,
+                                   const std::size_t topNode,
+                                   std::vector<BuildResult>& subtrees,
+                                   BuildResult& result) const {
+            const TopNode& node = topNodes[topNode];
+
+            if (node.task.has_value()) {
+                BuildResult& subtree = subtrees[node.task.value()];
+                const auto nodesOffset =
+                    static_cast<std::uint32_t>(result.nodes.size());
+                const auto indicesOffset =
+                    static_cast<std::uint32_t>(result.primitiveIndices.size());
+
+                for (Node n : subtree.nodes) {
+                    if (!n.isLeaf()) {
+                        n = Node::Interior(n.splitAxis(),
+                                           n.split,
+                                           n.aboveChild() + nodesOffset);
+                    }
+                    else if (n.primitivesCount() > 1) {
+                        n.primitives += indicesOffset;
+                    }
+                    result.nodes.push_back(n);
+                }
+                result.primitiveIndices.insert(
+                    result.primitiveIndices.end(),
+                    subtree.primitiveIndices.begin(),
+                    subtree.primitiveIndices.end());
+
+                subtree = BuildResult{};
+                return;
+            }
+
+            const std::size_t index = result.nodes.size();
+            result.nodes.emplace_back();
+            joinSubtrees(topNodes, topNode + 1, subtrees, result);
+            const auto aboveChild =
+                static_cast<std::uint32_t>(result.nodes.size());
+            joinSubtrees(topNodes, node.aboveChild, subtrees, result);
+
+            result.nodes[index] =
+                Node::Interior(node.splitAxis, node.split, aboveChild);
+        }
+
+        void Builder::buildSubtree(const BuildTask& task,
+                                   EdgeBuffers& buffers,
+                                   BuildResult& result) const {
+            const std::size_t index = result.nodes.size();
+            result.nodes.emplace_back();
+
+            const Optional<SplitDecision> decision = split(task, buffers);
+            if (!decision.has_value()) {
+                result.nodes[index] =
+                    makeLeaf(task.primitives, result.primitiveIndices);
+                return;
+            }
+
+            buildSubtree(decision->below, buffers, result);
+            const auto aboveChild =
+                static_cast<std::uint32_t>(result.nodes.size());
+            buildSubtree(decision->above, buffers, result);
+
+            result.nodes[index] =
+                Node::Interior(decision->axis, decision->position, aboveChild);
+        }
+
+        // Finds the split plane with the minimum SAH cost among the
+        // bounds of the primitives, trying the other axes if there is
+        // none along the axis of maximum extent.
+        // Returns pbrt::nullopt if the task should become a leaf.
+        Optional<SplitDecision> Builder::split(const BuildTask& task,
+                                               EdgeBuffers& buffers) const {
+            const std::size_t primitivesCount = task.primitives.size();
+            const Float totalSurfaceArea = task.bounds.surfaceArea();
+            if (primitivesCount <= this->parameters.maxPrimitivesInNode ||
+                task.depth >= this->parameters.maxDepth ||
+                totalSurfaceArea <= 0.f)
+            {
+                return pbrt::nullopt;
+            }
+
+            const Float invTotalSurfaceArea = 1.f / totalSurfaceArea;
+            const Vector3f d = task.bounds.diagonal();
+            const Float leafCost = this->parameters.intersectCost *
+                                   static_cast<Float>(primitivesCount);
+
+            Float bestCost = pbrt::constants::Infinity;
+            Optional<std::size_t> bestAxis = pbrt::nullopt;
+            std::size_t bestOffset = 0;
+
+            std::size_t axis = task.bounds.maximumExtent();
+            for (std::size_t retries = 0;
+                 retries < 3 && !bestAxis.has_value();
+                 ++retries, axis = (axis + 1) % 3)
+            {
+                std::vector<BoundEdge>& edges = buffers[axis];
+                edges.resize(2 * primitivesCount);
+                for (std::size_t i = 0; i < primitivesCount; ++i) {
+                    const std::uint32_t p = task.primitives[i];
+                    const Bounds3f& b = this->primitivesBounds[p];
+                    edges[2 * i] = BoundEdge{b.min[axis], p, EdgeType::Start};
+                    edges[2 * i + 1] = BoundEdge{b.max[axis], p, EdgeType::End};
+                }
+                std::sort(edges.begin(),
+                          edges.end(),
+                          [](const BoundEdge& a, const BoundEdge& b) {
+                              return a.t == b.t ? a.type < b.type : a.t < b.t;
+                          });
+
+                const std::size_t otherAxis0 = (axis + 1) % 3;
+                const std::size_t otherAxis1 = (axis + 2) % 3;
+                const Float planeArea = d[otherAxis0] * d[otherAxis1];
+                const Float planePerimeter = d[otherAxis0] + d[otherAxis1];
+
+                std::size_t belowCount = 0;
+                std::size_t aboveCount = primitivesCount;
+                for (std::size_t i = 0; i < edges.size(); ++i) {
+                    if (edges[i].type == EdgeType::End) {
+                        --aboveCount;
+                    }
+
+                    const Float t = edges[i].t;
+                    if (t > task.bounds.min[axis] &&
+                        t < task.bounds.max[axis]) {
+                        const Float belowSurfaceArea =
+                            2.f * (planeArea +
+                                   (t - task.bounds.min[axis]) *
+                                       planePerimeter);
+                        const Float aboveSurfaceArea =
+                            2.f * (planeArea +
+                                   (task.bounds.max[axis] - t) *
+                                       planePerimeter);
+                        const Float pBelow =
+                            belowSurfaceArea * invTotalSurfaceArea;
+                        const Float pAbove =
+                            aboveSurfaceArea * invTotalSurfaceArea;
+                        const Float bonus =
+                            (belowCount == 0 || aboveCount == 0)
+                                ? this->parameters.emptyBonus
+                                : 0.f;
+                        const Float cost =
+                            this->parameters.traversalCost +
+                            this->parameters.intersectCost * (1.f - bonus) *
+                                (pBelow * static_cast<Float>(belowCount) +
+                                 pAbove * static_cast<Float>(aboveCount));
+
+                        if (cost < bestCost) {
+                            bestCost = cost;
+                            bestAxis = axis;
+                            bestOffset = i;
+                        }
+                    }
+
+                    if (edges[i].type == EdgeType::Start) {
+                        ++belowCount;
+                    }
+                }
+                assert(belowCount == primitivesCount && aboveCount == 0);
+            }
+
+            const std::uint32_t badRefines =
+                task.badRefines + (bestCost > leafCost ? 1 : 0);
+            if (!bestAxis.has_value() || badRefines == 3 ||
+                (bestCost > 4.f * leafCost && primitivesCount < 16))
+            {
+                return pbrt::nullopt;
+            }
+
+            const std::size_t splitAxis = bestAxis.value();
+            const std::vector<BoundEdge>& edges = buffers[splitAxis];
+            const Float position = edges[bestOffset].t;
+
+            SplitDecision result{
+                .axis = splitAxis,
+                .position = position,
+                .below = BuildTask{.bounds = task.bounds,
+                                   .primitives = {},
+                                   .depth = task.depth + 1,
+                                   .badRefines = badRefines},
+                .above = BuildTask{.bounds = task.bounds,
+                                   .primitives = {},
+                                   .depth = task.depth + 1,
+                                   .badRefines = badRefines},
+            };
+            result.below.bounds.max[splitAxis] = position;
+            result.above.bounds.min[splitAxis] = position;
+
+            for (std::size_t i = 0; i < bestOffset; ++i) {
+                if (edges[i].type == EdgeType::Start) {
+                    result.below.primitives.push_back(edges[i].primitive);
+                }
+            }
+            for (std::size_t i = bestOffset + 1; i < edges.size(); ++i) {
+                if (edges[i].type == EdgeType::End) {
+                    result.above.primitives.push_back(edges[i].primitive);
+                }
+            }
+
+            return result;
+        }
+
+        Node makeLeaf(const std::vector<std::uint32_t>& primitives,
+                      std::vector<std::uint32_t>& primitiveIndices) {
+            const auto count = static_cast<std::uint32_t>(primitives.size());
+            if (count == 0) {
+                return Node::Leaf(0, 0);
+            }
+            else if (count == 1) {
+                return Node::Leaf(1, primitives[0]);
+            }
+
+            const auto offset =
+                static_cast<std::uint32_t>(primitiveIndices.size());
+            primitiveIndices.insert(primitiveIndices.end(),
+                                    primitives.begin(),
+                                    primitives.end());
+            return Node::Leaf(count, offset);
+        }
+    } // namespace kdtree
+
+    Optional<SurfaceInteraction> KdTree::intersect(const Ray& ray) const {
+        Optional<PrimitiveHit> closest = pbrt::nullopt;
+        std::uint32_t closestPrimitive = 0;
+
+        traverse(
+            [this, &ray, &closest, &closestPrimitive](
+                const std::uint32_t primitive) {
+                if (auto hit = this->primitives[primitive]->intersectHit(ray);
+                    hit.has_value())
+                {
+                    closest = std::move(hit);
+                    closestPrimitive = primitive;
+                }
+                return false;
+            },
+            ray);
+
+        if (!closest.has_value()) {
+            return pbrt::nullopt;
+        }
+
+        return pbrt::make_optional(
+            this->primitives[closestPrimitive]->computeInteraction(
+                ray,
+                std::move(*closest)));
+    }
+
+    bool KdTree::intersectP(const Ray& ray) const {
+        bool hit = false;
+
+        traverse(
+            [this, &ray, &hit](const std::uint32_t primitive) {
+                hit = this->primitives[primitive]->intersectP(ray);
+                return hit;
+            },
+            ray);
+
+        return hit;
+    }
+
+    // Visits the primitives of the leaves which the ray passes through,
+    // front to back, until `visitPrimitive` returns true or the next
+    // leaf starts after the end of the ray (its tMax is lowered
+    // by the hits found on the way)
+    template <typename PrimitiveVisitor>
+    void KdTree::traverse(PrimitiveVisitor&& visitPrimitive,
+                          const Ray& ray) const {
+        if (this->nodes.empty()) {
+            return;
+        }
+
+        const Optional<Intervalf> range = this->bounds.intersectP(ray);
+        if (!range.has_value()) {
+            return;
+        }
+
+        struct NodeToVisit
+        {
+            std::uint32_t node = 0;
+            Float tMin = 0.f;
+            Float tMax = 0.f;
+        };
+
+        const Vector3f invDir{1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z};
+        std::array<NodeToVisit, constants::KD_TREE_MAX_DEPTH> nodesToVisit;
+        std::size_t toVisitCount = 0;
+
+        std::uint32_t index = 0;
+        Float tMin = range->low();
+        Float tMax = range->high();
+        while (ray.tMax >= tMin) {
+            const kdtree::Node& node = this->nodes[index];
+
+            if (!node.isLeaf()) {
+                const std::size_t axis = node.splitAxis();
+                const Float tPlane = (node.split - ray.o[axis]) * invDir[axis];
+                const bool isBelowFirst =
+                    (ray.o[axis] < node.split) ||
+                    (ray.o[axis] == node.split && ray.d[axis] <= 0.f);
+                const std::uint32_t first =
+                    isBelowFirst ? index + 1 : node.aboveChild();
+                const std::uint32_t second =
+                    isBelowFirst ? node.aboveChild() : index + 1;
+
+                if (tPlane > tMax || tPlane <= 0.f) {
+                    index = first;
+                }
+                else if (tPlane < tMin) {
+                    index = second;
+                }
+                else {
+                    nodesToVisit[toVisitCount++] =
+                        NodeToVisit{second, tPlane, tMax};
+                    index = first;
+                    tMax = tPlane;
+                }
+                continue;
+            }
+
+            const std::uint32_t count = node.primitivesCount();
+            for (std::uint32_t i = 0; i < count; ++i) {
+                const std::uint32_t primitive =
+                    count == 1 ? node.primitives
+                               : this->primitiveIndices[node.primitives + i];
+                if (bool stop = visitPrimitive(primitive); stop) {
+                    return;
+                }
+            }
+
+            if (toVisitCount == 0) {
+                return;
+            }
+            --toVisitCount;
+            index = nodesToVisit[toVisitCount].node;
+            tMin = nodesToVisit[toVisitCount].tMin;
+            tMax = nodesToVisit[toVisitCount].tMax;
+        }
+    }
+} // namespace idragnev::pbrt::accelerators
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "pbrt/core/FastEFloat.hpp"
+
+#include <assert.h>
+#include <algorithm>
+
+namespace idragnev::pbrt {
+    FastEFloat sqrt(const FastEFloat& fe) {
+        const auto v = static_cast<Float>(fe);
+        const Float err = fe.absoluteError();
+        assert(v >= 0.f);
+
+        const Float root = std::sqrt(v);
+        // |sqrt(x) - sqrt(y)| = |x - y| / (sqrt(x) + sqrt(y))
+        const Float lowRoot = std::sqrt(std::max(v - err, Float(0)));
+        const Float rootErr = (root + lowRoot > 0.f)
+                                  ? err / (root + lowRoot)
+                                  : std::sqrt(err);
+
+        return FastEFloat{root,
+                          (1.f + gamma(2)) * (rootErr + gamma(1) * root)};
+    }
+
+    FastQuadraticRoots solveQuadratic(const FastEFloat& a,
+                                      const FastEFloat& b,
+                                      const FastEFloat& c) {
+        const FastEFloat D = b * b - 4.f * a * c;
+        const auto DValue = static_cast<Float>(D);
+        if (DValue + D.absoluteError() < 0.f) {
+            return FastQuadraticRoots{};
+        }
+        // Also takes a NaN discriminant, such as that of a degenerate ray
+        if (!(DValue - D.absoluteError() > 0.f)) {
+            return FastQuadraticRoots{.isAmbiguous = true,
+                                      .roots = pbrt::nullopt};
+        }
+
+        const FastEFloat sqrtD = sqrt(D);
+        // avoid the cancellation of b and sqrtD
+        const FastEFloat q = (static_cast<Float>(b) < 0.f)
+                                 ? -0.5f * (b - sqrtD)
+                                 : -0.5f * (b + sqrtD);
+        const FastEFloat t0 = q / a;
+        const FastEFloat t1 = c / q;
+
+        // Also rejects NaNs and infinite errors, where a or q may be 0
+        const auto hasKnownSign = [](const FastEFloat& t) {
+            return std::abs(static_cast<Float>(t)) > t.absoluteError();
+        };
+        if (!hasKnownSign(t0) || !hasKnownSign(t1)) {
+            return FastQuadraticRoots{.isAmbiguous = true,
+                                      .roots = pbrt::nullopt};
+        }
+
+        const auto toEFloat = [](const FastEFloat& t) {
+            return EFloat{static_cast<Float>(t), t.absoluteError()};
+        };
+        const auto roots =
+            static_cast<Float>(t0) > static_cast<Float>(t1)
+                ? QuadraticRoots{toEFloat(t1), toEFloat(t0)}
+                : QuadraticRoots{toEFloat(t0), toEFloat(t1)};
+
+        return FastQuadraticRoots{.isAmbiguous = false,
+                                  .roots = pbrt::make_optional(roots)};
+    }
+} // namespace idragnev::pbrt
\ No newline at end of file
@@ -15,7 +15,18 @@ namespace idragnev::pbrt {
         return (*objectToWorldTransform)(objectBound());
     }
 
+    Optional<HitRecord> Shape::intersect(const Ray& ray,
+                                         const bool testAlphaTexture) const {
+        return intersectHit(ray, testAlphaTexture)
+            .map([this, &ray](const ShapeHit& hit) {
+                HitRecord result;
+                result.t = hit.t;
+                result.interaction = computeInteraction(ray, hit);
+                return result;
+            });
+    }
+
     bool Shape::intersectP(const Ray& ray, const bool testAlphaTexture) const {
-        return intersect(ray, testAlphaTexture).has_value();
+        return intersectHit(ray, testAlphaTexture).has_value();
     }
 } // namespace idragnev::pbrt
\ No newline at end of file
@@ -32,16 +32,41 @@ namespace idragnev::pbrt {
                 ray.tMax = hitRecord.t;
 
                 auto& interaction = hitRecord.interaction;
-                interaction.primitive = this;
-                interaction.mediumInterface =
-                    _mediumInterface.isMediumTransition()
-                        ? _mediumInterface
-                        : MediumInterface{ray.medium};
+                completeInteraction(interaction, ray);
 
                 return std::move(interaction);
             });
     }
 
+    Optional<PrimitiveHit>
+    GeometricPrimitive::intersectHit(const Ray& ray) const {
+        return _shape->intersectHit(ray).map([&ray](const ShapeHit& hit) {
+            ray.tMax = hit.t;
+
+            PrimitiveHit result;
+            result.shapeHit = hit;
+            return result;
+        });
+    }
+
+    SurfaceInteraction
+    GeometricPrimitive::computeInteraction(const Ray& ray,
+                                           PrimitiveHit&& hit) const {
+        auto interaction = _shape->computeInteraction(ray, hit.shapeHit);
+        completeInteraction(interaction, ray);
+
+        return interaction;
+    }
+
+    void GeometricPrimitive::completeInteraction(
+        SurfaceInteraction& interaction,
+        const Ray& ray) const {
+        interaction.primitive = this;
+        interaction.mediumInterface = _mediumInterface.isMediumTransition()
+                                          ? _mediumInterface
+                                          : MediumInterface{ray.medium};
+    }
+
     void GeometricPrimitive::computeScatteringFunctions(
         SurfaceInteraction& interaction,
         memory::MemoryArena& arena,
@@ -62,4 +87,6 @@ namespace idragnev::pbrt {
     const Material* GeometricPrimitive::material() const {
         return _material.get();
     }
+
+    const Shape& GeometricPrimitive::shape() const noexcept { return *_shape; }
 } // namespace idragnev::pbrt
\ No newline at end of file
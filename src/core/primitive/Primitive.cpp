@@ -1,8 +1,50 @@
 #include "pbrt/core/primitive/Primitive.hpp"
+#include "pbrt/core/transformations/AnimatedTransformation.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
 
 #include <assert.h>
 
 namespace idragnev::pbrt {
+    LinearMotionBounds Primitive::motionBounds(const Intervalf&) const {
+        const Bounds3f bounds = worldBound();
+        return LinearMotionBounds{bounds, bounds};
+    }
+
+    Optional<PrimitiveHit> Primitive::intersectHit(const Ray& r) const {
+        return intersect(r).map([&r](SurfaceInteraction&& interaction) {
+            PrimitiveHit result;
+            result.shapeHit.t = r.tMax;
+            result.interaction = std::move(interaction);
+            return result;
+        });
+    }
+
+    SurfaceInteraction Primitive::computeInteraction(const Ray&,
+                                                     PrimitiveHit&& hit) const {
+        assert(hit.interaction.has_value());
+        return std::move(*hit.interaction);
+    }
+
+    void Aggregate::intersect(
+        const std::span<const Ray> rays,
+        const std::span<Optional<SurfaceInteraction>> hits) const {
+        assert(rays.size() == hits.size());
+
+        for (std::size_t i = 0; i < rays.size(); ++i) {
+            hits[i] = intersect(rays[i]);
+        }
+    }
+
+    void Aggregate::intersectP(const std::span<const Ray> rays,
+                               const std::span<bool> occluded) const {
+        assert(rays.size() == occluded.size());
+
+        for (std::size_t i = 0; i < rays.size(); ++i) {
+            occluded[i] = intersectP(rays[i]);
+        }
+    }
+
     const AreaLight* Aggregate::areaLight() const {
         assert(false);
         return nullptr;
@@ -43,6 +43,13 @@ namespace idragnev::pbrt {
         return primitiveToWorldTransform.motionBounds(primitive->worldBound());
     }
 
+    LinearMotionBounds
+    TransformedPrimitive::motionBounds(const Intervalf& time) const {
+        return primitiveToWorldTransform.linearMotionBounds(
+            primitive->worldBound(),
+            time);
+    }
+
     const AreaLight* TransformedPrimitive::areaLight() const {
         assert(false);
         return nullptr;
@@ -775,6 +775,40 @@ namespace idragnev::pbrt {
         }
     }
 
+    // Without rotation each point of `b` moves along a line, so the
+    // bounds of the corners at the ends of `time` are interpolated
+    // conservatively - the lower bound of the moving corners is a concave
+    // function of time and the upper bound is a convex one.
+    // Rotating corners move along arcs and both ends get the bounds over
+    // the whole interval, as do intervals with times out of the animation
+    // range, where the points stop moving.
+    LinearMotionBounds
+    AnimatedTransformation::linearMotionBounds(const Bounds3f& b,
+                                               const Intervalf& time) const {
+        if (!actuallyAnimated) {
+            const Bounds3f bounds = (*startTransform)(b);
+            return LinearMotionBounds{bounds, bounds};
+        }
+
+        const Transformation start = interpolate(time.low());
+        const Transformation end = interpolate(time.high());
+        const bool isWithinAnimation =
+            startTime <= time.low() && time.high() <= endTime;
+
+        if (!hasRotation && isWithinAnimation) {
+            return LinearMotionBounds{start(b), end(b)};
+        }
+        else {
+            const auto motion =
+                AnimatedTransformation{start,
+                                       std::max(time.low(), startTime),
+                                       end,
+                                       std::min(time.high(), endTime)};
+            const Bounds3f bounds = motion.motionBounds(b);
+            return LinearMotionBounds{bounds, bounds};
+        }
+    }
+
     Bounds3f AnimatedTransformation::pointMotionBounds(const Point3f& p) const {
         if (!actuallyAnimated) {
             return Bounds3f{(*startTransform)(p)};
@@ -3,8 +3,16 @@
 #include "pbrt/core/math/Point3.hpp"
 #include "pbrt/core/geometry/Bounds3.hpp"
 #include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
 
 namespace idragnev::pbrt {
+    Vector3f transformedPointError(const math::Matrix4x4& matrix,
+                                   const Point3f& p,
+                                   const Vector3f& pError);
+    Vector3f transformedVectorError(const math::Matrix4x4& matrix,
+                                    const Vector3f& v,
+                                    const Vector3f& vError);
+
     bool Transformation::hasScale() const noexcept {
         const auto scales = [&transform = *this](const Vector3f& v) {
             const auto len = transform(v).lengthSquared();
@@ -54,24 +62,137 @@ namespace idragnev::pbrt {
         return result;
     }
 
+    // Offsets the transformed origin by its rounding error
+    // along the direction so that it stays on the surface's side
+    // the ray was spawned from.
+    Ray Transformation::operator()(const Ray& r) const {
+        const auto& transform = *this;
+
+        Point3f o = transform(r.o);
+        const Vector3f d = transform(r.d);
+        const Vector3f oError = transformedPointError(m, r.o, Vector3f{});
+
+        Float tMax = r.tMax;
+        if (const Float lenSquared = d.lengthSquared(); lenSquared > 0.f) {
+            const Float dt = dot(abs(d), oError) / lenSquared;
+            o += dt * d;
+            tMax -= dt;
+        }
+
+        return Ray{o, d, tMax, r.time, r.medium};
+    }
+
+    RayDifferential
+    Transformation::operator()(const RayDifferential& r) const {
+        const auto& transform = *this;
+
+        RayDifferential result{transform(static_cast<const Ray&>(r))};
+        result.hasDifferentials = r.hasDifferentials;
+        result.rxOrigin = transform(r.rxOrigin);
+        result.ryOrigin = transform(r.ryOrigin);
+        result.rxDirection = transform(r.rxDirection);
+        result.ryDirection = transform(r.ryDirection);
+
+        return result;
+    }
+
     SurfaceInteraction
-    Transformation::operator()([[maybe_unused]] const SurfaceInteraction& si) const {
-        // TODO
-        return {};
+    Transformation::operator()(const SurfaceInteraction& si) const {
+        const auto& transform = *this;
+
+        SurfaceInteraction result;
+        result.p = transform(si.p);
+        result.pError = transformedPointError(m, si.p, si.pError);
+        result.n = normalize(transform(si.n));
+        result.wo = normalize(transform(si.wo));
+        result.time = si.time;
+        result.mediumInterface = si.mediumInterface;
+        result.uv = si.uv;
+        result.dpdu = transform(si.dpdu);
+        result.dpdv = transform(si.dpdv);
+        result.dndu = transform(si.dndu);
+        result.dndv = transform(si.dndv);
+        result.shape = si.shape;
+        result.primitive = si.primitive;
+        result.bsdf = si.bsdf;
+        result.bssrdf = si.bssrdf;
+        result.faceIndex = si.faceIndex;
+        result.shading.n = normalize(transform(si.shading.n));
+        result.shading.dpdu = transform(si.shading.dpdu);
+        result.shading.dpdv = transform(si.shading.dpdv);
+        result.shading.dndu = transform(si.shading.dndu);
+        result.shading.dndv = transform(si.shading.dndv);
+        if (dot(result.shading.n, result.n) < 0.f) {
+            result.shading.n = -result.shading.n;
+        }
+
+        return result;
+    }
+
+    // Bounds the absolute error of transforming `p` with `matrix`,
+    // given the error `pError` which `p` already carries.
+    Vector3f transformedPointError(const math::Matrix4x4& matrix,
+                                   const Point3f& p,
+                                   const Vector3f& pError) {
+        const auto& mm = matrix.m;
+        const auto rowError = [&mm, &p, &pError](const std::size_t i) {
+            return (gamma(3) + 1.f) * (std::abs(mm[i][0]) * pError.x +
+                                       std::abs(mm[i][1]) * pError.y +
+                                       std::abs(mm[i][2]) * pError.z) +
+                   gamma(3) * (std::abs(mm[i][0] * p.x) +
+                               std::abs(mm[i][1] * p.y) +
+                               std::abs(mm[i][2] * p.z) + std::abs(mm[i][3]));
+        };
+
+        return Vector3f{rowError(0), rowError(1), rowError(2)};
+    }
+
+    // The same for vectors, which are not translated
+    Vector3f transformedVectorError(const math::Matrix4x4& matrix,
+                                    const Vector3f& v,
+                                    const Vector3f& vError) {
+        const auto& mm = matrix.m;
+        const auto rowError = [&mm, &v, &vError](const std::size_t i) {
+            return (gamma(3) + 1.f) * (std::abs(mm[i][0]) * vError.x +
+                                       std::abs(mm[i][1]) * vError.y +
+                                       std::abs(mm[i][2]) * vError.z) +
+                   gamma(3) * (std::abs(mm[i][0] * v.x) +
+                               std::abs(mm[i][1] * v.y) +
+                               std::abs(mm[i][2] * v.z));
+        };
+
+        return Vector3f{rowError(0), rowError(1), rowError(2)};
     }
 
     RayWithErrorBound
-    Transformation::transformWithErrBound([[maybe_unused]] const Ray& r) const {
-        // TODO
-        return {};
+    Transformation::transformWithErrBound(const Ray& r) const {
+        return transformWithErrBound(r, Vector3f{}, Vector3f{});
     }
 
+    // Unlike operator()(const Ray&), keeps tMax so that the parametric
+    // distances of hits along the transformed ray can be compared
+    // with the original tMax.
     RayWithErrorBound
-    Transformation::transformWithErrBound([[maybe_unused]] const Ray& r,
-                                          [[maybe_unused]] const Vector3f& oErrorIn,
-                                          [[maybe_unused]] const Vector3f& dErrorIn) const {
-        // TODO
-        return {};
+    Transformation::transformWithErrBound(const Ray& r,
+                                          const Vector3f& oErrorIn,
+                                          const Vector3f& dErrorIn) const {
+        const auto& transform = *this;
+
+        Point3f o = transform(r.o);
+        const Vector3f d = transform(r.d);
+        const Vector3f oError = transformedPointError(m, r.o, oErrorIn);
+        const Vector3f dError = transformedVectorError(m, r.d, dErrorIn);
+
+        if (const Float lenSquared = d.lengthSquared(); lenSquared > 0.f) {
+            const Float dt = dot(abs(d), oError) / lenSquared;
+            o += dt * d;
+        }
+
+        return RayWithErrorBound{
+            .ray = Ray{o, d, r.tMax, r.time, r.medium},
+            .oError = oError,
+            .dError = dError,
+        };
     }
 
     Transformation translation(const Vector3f& delta) noexcept {
@@ -0,0 +1,134 @@
+#include "pbrt/memory/MappedFile.hpp"
+#include "pbrt/memory/Memory.hpp"
+
+#include <utility>
+
+#if defined(PBRT_HAS_MMAP)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#elif defined(PBRT_HAS_WIN32_FILE_MAPPING)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fstream>
+#endif
+
+namespace idragnev::pbrt::memory {
+    MappedFile::MappedFile(const std::filesystem::path& path) {
+#if defined(PBRT_HAS_MMAP)
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            return;
+        }
+
+        struct stat status;
+        if (::fstat(fd, &status) == 0 && status.st_size > 0) {
+            const auto fileSize = static_cast<std::size_t>(status.st_size);
+            void* const mapping =
+                ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                this->address = mapping;
+                this->size = fileSize;
+            }
+        }
+        // the mapping stays valid after the file is closed
+        ::close(fd);
+#elif defined(PBRT_HAS_WIN32_FILE_MAPPING)
+        const HANDLE file = ::CreateFileW(path.c_str(),
+                                          GENERIC_READ,
+                                          FILE_SHARE_READ,
+                                          nullptr,
+                                          OPEN_EXISTING,
+                                          FILE_ATTRIBUTE_NORMAL,
+                                          nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (::GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+            const HANDLE mapping = ::CreateFileMappingW(file,
+                                                        nullptr,
+                                                        PAGE_READONLY,
+                                                        0,
+                                                        0,
+                                                        nullptr);
+            if (mapping != nullptr) {
+                // the view stays valid after the handles are closed
+                this->address =
+                    ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (this->address != nullptr) {
+                    this->size = static_cast<std::size_t>(fileSize.QuadPart);
+                }
+                ::CloseHandle(mapping);
+            }
+        }
+        ::CloseHandle(file);
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            return;
+        }
+
+        const auto fileSize = static_cast<std::size_t>(file.tellg());
+        if (fileSize == 0) {
+            return;
+        }
+
+        void* const buffer = allocCacheAligned(fileSize);
+        if (buffer == nullptr) {
+            return;
+        }
+
+        file.seekg(0);
+        if (file.read(static_cast<char*>(buffer),
+                      static_cast<std::streamsize>(fileSize))) {
+            this->address = buffer;
+            this->size = fileSize;
+        }
+        else {
+            freeAligned(buffer);
+        }
+#endif
+    }
+
+    MappedFile::~MappedFile() { close(); }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+        : address(std::exchange(other.address, nullptr))
+        , size(std::exchange(other.size, 0)) {}
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            this->address = std::exchange(other.address, nullptr);
+            this->size = std::exchange(other.size, 0);
+        }
+
+        return *this;
+    }
+
+    std::span<const std::byte> MappedFile::bytes() const noexcept {
+        return {static_cast<const std::byte*>(this->address), this->size};
+    }
+
+    void MappedFile::close() noexcept {
+        if (this->address == nullptr) {
+            return;
+        }
+
+#if defined(PBRT_HAS_MMAP)
+        ::munmap(this->address, this->size);
+#elif defined(PBRT_HAS_WIN32_FILE_MAPPING)
+        ::UnmapViewOfFile(this->address);
+#else
+        freeAligned(this->address);
+#endif
+        this->address = nullptr;
+        this->size = 0;
+    }
+} // namespace idragnev::pbrt::memory
\ No newline at end of file
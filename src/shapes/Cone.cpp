@@ -2,6 +2,7 @@
 #include "pbrt/core/geometry/Bounds3.hpp"
 #include "pbrt/core/transformations/Transformation.hpp"
 #include "pbrt/core/EFloat.hpp"
+#include "pbrt/core/FastEFloat.hpp"
 
 namespace idragnev::pbrt::shapes {
     Cone::Cone(const Transformation& objectToWorld,
@@ -20,12 +21,20 @@ namespace idragnev::pbrt::shapes {
                         Point3f{radius, radius, height}};
     }
 
-    Optional<HitRecord> Cone::intersect(const Ray& ray, const bool) const {
-        return intersectImpl<Optional<HitRecord>>(
-            ray,
+    Optional<ShapeHit> Cone::intersectHit(const Ray& rayInWorldSpace,
+                                          const bool) const {
+        return intersectImpl<Optional<ShapeHit>>(
+            rayInWorldSpace,
             pbrt::nullopt,
-            [this](const auto&... args) {
-                return pbrt::make_optional(makeHitRecord(args...));
+            [](const RayWithErrorBound& rayWithErrBound,
+               const Point3f& hitPoint,
+               const EFloat& t) {
+                ShapeHit hit;
+                hit.t = static_cast<Float>(t);
+                hit.pObject = hitPoint;
+                hit.pError = computeHitPointError(rayWithErrBound, t);
+                hit.phi = computePhi(hitPoint);
+                return pbrt::make_optional(hit);
             });
     }
 
@@ -64,36 +73,36 @@ namespace idragnev::pbrt::shapes {
         }
 
         auto hitPoint = ray(static_cast<Float>(tHit));
-        auto phi = computePhi(hitPoint);
-        if (hitPoint.z < 0.f || hitPoint.z > height || phi > phiMax) {
+        if (isClipped(hitPoint)) {
             if (tHit == t1 || t1.upperBound() > ray.tMax) {
                 return failure;
             }
 
             tHit = t1;
             hitPoint = ray(static_cast<Float>(tHit));
-            phi = computePhi(hitPoint);
-            if (hitPoint.z < 0.f || hitPoint.z > height || phi > phiMax) {
+            if (isClipped(hitPoint)) {
                 return failure;
             }
         }
 
-        return success(rayWithErrBound, hitPoint, tHit, phi);
+        return success(rayWithErrBound, hitPoint, tHit);
     }
 
-    Optional<QuadraticRoots>
-    Cone::findIntersectionParams(const Ray& ray,
-                                 const Vector3f& oErr,
-                                 const Vector3f& dErr) const {
-        const auto ox = EFloat(ray.o.x, oErr.x);
-        const auto oy = EFloat(ray.o.y, oErr.y);
-        const auto oz = EFloat(ray.o.z, oErr.z);
-        const auto dx = EFloat(ray.d.x, dErr.x);
-        const auto dy = EFloat(ray.d.y, dErr.y);
-        const auto dz = EFloat(ray.d.z, dErr.z);
+    // will be instantiated only in this translation unit
+    // so it is fine to define it here
+    template <typename EFloatT>
+    auto Cone::solveIntersectionEquation(const Ray& ray,
+                                         const Vector3f& oErr,
+                                         const Vector3f& dErr) const {
+        const auto ox = EFloatT(ray.o.x, oErr.x);
+        const auto oy = EFloatT(ray.o.y, oErr.y);
+        const auto oz = EFloatT(ray.o.z, oErr.z);
+        const auto dx = EFloatT(ray.d.x, dErr.x);
+        const auto dy = EFloatT(ray.d.y, dErr.y);
+        const auto dz = EFloatT(ray.d.z, dErr.z);
 
         const auto k = [this] {
-            const auto x = EFloat(radius) / EFloat(height);
+            const auto x = EFloatT(radius) / EFloatT(height);
             return x * x;
         }();
 
@@ -104,15 +113,34 @@ namespace idragnev::pbrt::shapes {
         return solveQuadratic(a, b, c);
     }
 
+    Optional<QuadraticRoots>
+    Cone::findIntersectionParams(const Ray& ray,
+                                 const Vector3f& oErr,
+                                 const Vector3f& dErr) const {
+        const FastQuadraticRoots fast =
+            solveIntersectionEquation<FastEFloat>(ray, oErr, dErr);
+        return fast.isAmbiguous
+                   ? solveIntersectionEquation<EFloat>(ray, oErr, dErr)
+                   : fast.roots;
+    }
+
+    bool Cone::isClipped(const Point3f& hitPoint) const {
+        return hitPoint.z < 0.f || hitPoint.z > height ||
+               (phiMax < 2 * math::constants::Pi &&
+                computePhi(hitPoint) > phiMax);
+    }
+
     Float Cone::computePhi(const Point3f& hitPoint) {
         const Float phi = std::atan2(hitPoint.y, hitPoint.x);
         return phi < 0.f ? (phi + 2 * math::constants::Pi) : phi;
     }
 
-    HitRecord Cone::makeHitRecord(const RayWithErrorBound& rayWithErrBound,
-                                  const Point3f& hitPoint,
-                                  const EFloat& t,
-                                  const Float phi) const {
+    SurfaceInteraction
+    Cone::computeInteraction(const Ray& rayInWorldSpace,
+                             const ShapeHit& hit) const {
+        const Point3f& hitPoint = hit.pObject;
+        const Float phi = hit.phi;
+
         const Float u = phi / phiMax;
         const Float v = hitPoint.z / height;
 
@@ -141,37 +169,41 @@ namespace idragnev::pbrt::shapes {
         const auto dndv = Normal3f{(g * F - f * G) * invEGF2 * dpdu +
                                    (f * F - g * E) * invEGF2 * dpdv};
 
-        const auto& [ray, oErr, dErr] = rayWithErrBound;
-        const auto ox = EFloat(ray.o.x, oErr.x);
-        const auto oy = EFloat(ray.o.y, oErr.y);
-        const auto oz = EFloat(ray.o.z, oErr.z);
-        const auto dx = EFloat(ray.d.x, dErr.x);
-        const auto dy = EFloat(ray.d.y, dErr.y);
-        const auto dz = EFloat(ray.d.z, dErr.z);
-        const auto px = ox + t * dx;
-        const auto py = oy + t * dy;
-        const auto pz = oz + t * dz;
-        const auto pError = Vector3f{px.absoluteError(),
-                                     py.absoluteError(),
-                                     pz.absoluteError()};
-        const auto wo = -ray.d;
+        const auto wo = -(*worldToObjectTransform)(rayInWorldSpace.d);
 
         const auto interaction = SurfaceInteraction{hitPoint,
-                                                    pError,
+                                                    hit.pError,
                                                     Point2f{u, v},
                                                     wo,
                                                     dpdu,
                                                     dpdv,
                                                     dndu,
                                                     dndv,
-                                                    ray.time,
+                                                    rayInWorldSpace.time,
                                                     this};
 
-        HitRecord result;
-        result.interaction = (*objectToWorldTransform)(interaction);
-        result.t = static_cast<Float>(t);
+        return (*objectToWorldTransform)(interaction);
+    }
+
+    Vector3f
+    Cone::computeHitPointError(const RayWithErrorBound& rayWithErrBound,
+                               const EFloat& t) {
+        const auto& [ray, oErr, dErr] = rayWithErrBound;
+
+        const auto ox = EFloat(ray.o.x, oErr.x);
+        const auto oy = EFloat(ray.o.y, oErr.y);
+        const auto oz = EFloat(ray.o.z, oErr.z);
+        const auto dx = EFloat(ray.d.x, dErr.x);
+        const auto dy = EFloat(ray.d.y, dErr.y);
+        const auto dz = EFloat(ray.d.z, dErr.z);
+
+        const EFloat px = ox + t * dx;
+        const EFloat py = oy + t * dy;
+        const EFloat pz = oz + t * dz;
 
-        return result;
+        return Vector3f{px.absoluteError(),
+                        py.absoluteError(),
+                        pz.absoluteError()};
     }
 
     Float Cone::area() const {
@@ -2,6 +2,7 @@
 #include "pbrt/core/geometry/Bounds3.hpp"
 #include "pbrt/core/transformations/Transformation.hpp"
 #include "pbrt/core/EFloat.hpp"
+#include "pbrt/core/FastEFloat.hpp"
 
 namespace idragnev::pbrt::shapes {
     Cylinder::Cylinder(const Transformation& objectToWorld,
@@ -22,13 +23,17 @@ namespace idragnev::pbrt::shapes {
                         Point3f(radius, radius, zMax)};
     }
 
-    Optional<HitRecord> Cylinder::intersect(const Ray& rayInWorldSpace,
-                                                 const bool) const {
-        return intersectImpl<Optional<HitRecord>>(
+    Optional<ShapeHit> Cylinder::intersectHit(const Ray& rayInWorldSpace,
+                                              const bool) const {
+        return intersectImpl<Optional<ShapeHit>>(
             rayInWorldSpace,
             pbrt::nullopt,
-            [this](const auto&... args) {
-                return pbrt::make_optional(makeHitRecord(args...));
+            [](const Ray&, const Point3f& hitPoint, const EFloat& t) {
+                ShapeHit hit;
+                hit.t = static_cast<Float>(t);
+                hit.pObject = hitPoint;
+                hit.phi = computePhi(hitPoint);
+                return pbrt::make_optional(hit);
             });
     }
 
@@ -66,8 +71,7 @@ namespace idragnev::pbrt::shapes {
         }
 
         auto hitPoint = computeHitPoint(ray, tShapeHit);
-        auto phi = computePhi(hitPoint);
-        if (hitPoint.z < zMin || hitPoint.z > zMax || phi > phiMax) {
+        if (isClipped(hitPoint)) {
             if (tShapeHit == t1 || t1.upperBound() > ray.tMax) {
                 return failure;
             }
@@ -75,31 +79,43 @@ namespace idragnev::pbrt::shapes {
             tShapeHit = t1;
 
             hitPoint = computeHitPoint(ray, tShapeHit);
-            phi = computePhi(hitPoint);
-            if (hitPoint.z < zMin || hitPoint.z > zMax || phi > phiMax) {
+            if (isClipped(hitPoint)) {
                 return failure;
             }
         }
 
-        return success(ray, hitPoint, tShapeHit, phi);
+        return success(ray, hitPoint, tShapeHit);
     }
 
-    Optional<QuadraticRoots>
-    Cylinder::findIntersectionParams(const Ray& ray,
-                                     const Vector3f& oErr,
-                                     const Vector3f& dErr) const {
-        const auto ox = EFloat(ray.o.x, oErr.x);
-        const auto oy = EFloat(ray.o.y, oErr.y);
-        const auto dx = EFloat(ray.d.x, dErr.x);
-        const auto dy = EFloat(ray.d.y, dErr.y);
+    // will be instantiated only in this translation unit
+    // so it is fine to define it here
+    template <typename EFloatT>
+    auto Cylinder::solveIntersectionEquation(const Ray& ray,
+                                             const Vector3f& oErr,
+                                             const Vector3f& dErr) const {
+        const auto ox = EFloatT(ray.o.x, oErr.x);
+        const auto oy = EFloatT(ray.o.y, oErr.y);
+        const auto dx = EFloatT(ray.d.x, dErr.x);
+        const auto dy = EFloatT(ray.d.y, dErr.y);
 
         const auto a = dx * dx + dy * dy;
         const auto b = 2 * (dx * ox + dy * oy);
-        const auto c = ox * ox + oy * oy - EFloat(radius) * EFloat(radius);
+        const auto c = ox * ox + oy * oy - EFloatT(radius) * EFloatT(radius);
 
         return solveQuadratic(a, b, c);
     }
 
+    Optional<QuadraticRoots>
+    Cylinder::findIntersectionParams(const Ray& ray,
+                                     const Vector3f& oErr,
+                                     const Vector3f& dErr) const {
+        const FastQuadraticRoots fast =
+            solveIntersectionEquation<FastEFloat>(ray, oErr, dErr);
+        return fast.isAmbiguous
+                   ? solveIntersectionEquation<EFloat>(ray, oErr, dErr)
+                   : fast.roots;
+    }
+
     Point3f Cylinder::computeHitPoint(const Ray& ray, const EFloat& t) const {
         const auto p = ray(static_cast<Float>(t));
         const Float hitRad = std::sqrt(p.x * p.x + p.y * p.y);
@@ -108,15 +124,23 @@ namespace idragnev::pbrt::shapes {
         return Point3f{p.x * k, p.y * k, p.z};
     }
 
+    bool Cylinder::isClipped(const Point3f& hitPoint) const {
+        return hitPoint.z < zMin || hitPoint.z > zMax ||
+               (phiMax < 2 * math::constants::Pi &&
+                computePhi(hitPoint) > phiMax);
+    }
+
     Float Cylinder::computePhi(const Point3f& hitPoint) {
         const Float phi = std::atan2(hitPoint.y, hitPoint.x);
         return phi < 0.f ? (phi + 2 * math::constants::Pi) : phi;
     }
 
-    HitRecord Cylinder::makeHitRecord(const Ray& ray,
-                                      const Point3f& hitPoint,
-                                      const EFloat& t,
-                                      const Float phi) const {
+    SurfaceInteraction
+    Cylinder::computeInteraction(const Ray& rayInWorldSpace,
+                                 const ShapeHit& hit) const {
+        const Point3f& hitPoint = hit.pObject;
+        const Float phi = hit.phi;
+
         const Float u = phi / phiMax;
         const Float v = (hitPoint.z - zMin) / (zMax - zMin);
 
@@ -145,7 +169,7 @@ namespace idragnev::pbrt::shapes {
 
         const Vector3f pError =
             gamma(3) * abs(Vector3f(hitPoint.x, hitPoint.y, 0.f));
-        const auto wo = -ray.d;
+        const auto wo = -(*worldToObjectTransform)(rayInWorldSpace.d);
 
         const auto interaction = SurfaceInteraction{hitPoint,
                                                     pError,
@@ -155,14 +179,10 @@ namespace idragnev::pbrt::shapes {
                                                     dpdv,
                                                     dndu,
                                                     dndv,
-                                                    ray.time,
+                                                    rayInWorldSpace.time,
                                                     this};
 
-        HitRecord result;
-        result.interaction = (*objectToWorldTransform)(interaction);
-        result.t = static_cast<Float>(t);
-
-        return result;
+        return (*objectToWorldTransform)(interaction);
     }
 
     Float Cylinder::area() const { return (zMax - zMin) * radius * phiMax; }
@@ -23,12 +23,16 @@ namespace idragnev::pbrt::shapes {
                         Point3f{radius, radius, height}};
     }
 
-    Optional<HitRecord> Disk::intersect(const Ray& ray, const bool) const {
-        return intersectImpl<Optional<HitRecord>>(
+    Optional<ShapeHit> Disk::intersectHit(const Ray& ray, const bool) const {
+        return intersectImpl<Optional<ShapeHit>>(
             ray,
             pbrt::nullopt,
-            [this](const auto&... args) {
-                return pbrt::make_optional(makeHitRecord(args...));
+            [](const Ray&, const Point3f& hitPoint, const Float t) {
+                ShapeHit hit;
+                hit.t = t;
+                hit.pObject = hitPoint;
+                hit.phi = computePhi(hitPoint);
+                return pbrt::make_optional(hit);
             });
     }
 
@@ -65,12 +69,14 @@ namespace idragnev::pbrt::shapes {
             return failure;
         }
 
-        const auto phi = computePhi(hitPoint);
-        if (phi > phiMax) {
+        // full disks need no angle of the hit point
+        if (phiMax < 2 * math::constants::Pi &&
+            computePhi(hitPoint) > phiMax)
+        {
             return failure;
         }
 
-        return success(ray, hitPoint, tShapeHit, phi, distToCenterSquared);
+        return success(ray, hitPoint, tShapeHit);
     }
 
     Float Disk::computePhi(const Point3f& hitPoint) {
@@ -78,11 +84,13 @@ namespace idragnev::pbrt::shapes {
         return phi < 0.f ? (phi + 2 * math::constants::Pi) : phi;
     }
 
-    HitRecord Disk::makeHitRecord(const Ray& ray,
-                                  const Point3f& hitPoint,
-                                  const EFloat& t,
-                                  const Float phi,
-                                  const Float distToCenterSquared) const {
+    SurfaceInteraction Disk::computeInteraction(const Ray& rayInWorldSpace,
+                                                const ShapeHit& hit) const {
+        const Point3f& hitPoint = hit.pObject;
+        const Float phi = hit.phi;
+        const Float distToCenterSquared =
+            hitPoint.x * hitPoint.x + hitPoint.y * hitPoint.y;
+
         const Float u = phi / phiMax;
         const Float rHit = std::sqrt(distToCenterSquared);
         const Float v = (radius - rHit) / (radius - innerRadius);
@@ -95,7 +103,7 @@ namespace idragnev::pbrt::shapes {
 
         const auto p = Point3f{hitPoint.x, hitPoint.y, height};
         const auto pError = Vector3f{0.f, 0.f, 0.f};
-        const auto wo = -ray.d;
+        const auto wo = -(*worldToObjectTransform)(rayInWorldSpace.d);
 
         const auto interaction = SurfaceInteraction{p,
                                                     pError,
@@ -105,14 +113,10 @@ namespace idragnev::pbrt::shapes {
                                                     dpdv,
                                                     dndu,
                                                     dndv,
-                                                    ray.time,
+                                                    rayInWorldSpace.time,
                                                     this};
 
-        HitRecord result;
-        result.interaction = (*objectToWorldTransform)(interaction);
-        result.t = static_cast<Float>(t);
-
-        return result;
+        return (*objectToWorldTransform)(interaction);
     }
 
     Float Disk::area() const {
@@ -0,0 +1,565 @@
+#include "pbrt/shapes/OBJMesh.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/math/Point2.hpp"
+#include "pbrt/core/math/Point3.hpp"
+#include "pbrt/core/math/Normal3.hpp"
+#include "pbrt/memory/MappedFile.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <limits>
+#include <span>
+#include <string_view>
+
+namespace idragnev::pbrt::shapes {
+    namespace constants {
+        // The bytes of a file parsed by one parallel iteration,
+        // extended to the end of the line they end in
+        inline constexpr std::size_t OBJ_CHUNK_SIZE = 1024 * 1024;
+        // The vertices or face corners copied by one parallel iteration
+        inline constexpr std::size_t OBJ_RANGE_SIZE = 16 * 1024;
+    } // namespace constants
+
+    namespace obj {
+        // The attributes a face corner refers to,
+        // indexing its arrays of indices
+        enum Attribute : std::size_t
+        {
+            POSITION = 0,
+            UV = 1,
+            NORMAL = 2,
+        };
+
+        inline constexpr std::int64_t NO_INDEX =
+            std::numeric_limits<std::int64_t>::min();
+        inline constexpr std::uint32_t NO_VERTEX =
+            std::numeric_limits<std::uint32_t>::max();
+
+        // A face corner as parsed from a chunk, with zero-based indices.
+        // The attributes of the preceding chunks are not counted yet,
+        // so relative (negative) indices are stored relative to
+        // the first attribute of the chunk and are marked in `isRelative`.
+        struct ParsedCorner
+        {
+            std::array<std::int64_t, 3> indices = {NO_INDEX,
+                                                   NO_INDEX,
+                                                   NO_INDEX};
+            std::uint8_t isRelative = 0; // one bit per Attribute
+        };
+
+        struct Chunk
+        {
+            std::vector<Point3f> positions;
+            std::vector<Point2f> uvs;
+            std::vector<Normal3f> normals;
+            // three per triangle
+            std::vector<ParsedCorner> corners;
+            std::size_t cornersWithUVs = 0;
+            std::size_t cornersWithNormals = 0;
+            bool isValid = true;
+        };
+
+        // A face corner with indices into the attributes of the whole
+        // file, NO_VERTEX for the attributes it does not refer to
+        using Corner = std::array<std::uint32_t, 3>;
+
+        // The attributes of all chunks, in world space
+        struct Contents
+        {
+            std::vector<Point3f> positions;
+            std::vector<Point2f> uvs;
+            std::vector<Normal3f> normals;
+            // three per triangle
+            std::vector<Corner> corners;
+            bool hasUVs = false;
+            bool hasNormals = false;
+            // Whether each corner refers to the texture coordinates
+            // and the normal of the same index as its position
+            bool sharesIndices = true;
+        };
+    } // namespace obj
+
+    std::vector<std::string_view> splitOBJChunks(std::string_view text);
+    obj::Chunk parseOBJChunk(std::string_view text);
+    bool parseOBJLine(std::string_view line, obj::Chunk& chunk);
+    bool parseOBJFace(std::string_view line, obj::Chunk& chunk);
+    Optional<obj::ParsedCorner> parseOBJCorner(std::string_view token,
+                                               const obj::Chunk& chunk);
+    std::string_view nextOBJToken(std::string_view& line) noexcept;
+    Optional<Float> parseOBJFloat(const std::string_view token) noexcept;
+
+    Optional<obj::Contents>
+    mergeOBJChunks(const std::vector<obj::Chunk>& chunks,
+                   const Transformation& objectToWorld);
+    std::shared_ptr<TriangleMesh> createOBJTriangleMesh(
+        const obj::Contents& contents,
+        std::shared_ptr<const Texture<Float>> alphaMask,
+        std::shared_ptr<const Texture<Float>> shadowAlphaMask);
+
+    Optional<std::vector<std::shared_ptr<Shape>>>
+    loadOBJMesh(const std::filesystem::path& path,
+                const Transformation& objectToWorld,
+                const Transformation& worldToObject,
+                const bool reverseOrientation,
+                std::shared_ptr<const Texture<Float>> alphaMask,
+                std::shared_ptr<const Texture<Float>> shadowAlphaMask) {
+        const memory::MappedFile file{path};
+        const std::span<const std::byte> bytes = file.bytes();
+        const std::string_view text{
+            reinterpret_cast<const char*>(bytes.data()),
+            bytes.size()};
+
+        const std::vector<std::string_view> texts = splitOBJChunks(text);
+        std::vector<obj::Chunk> chunks(texts.size());
+        parallel::parallelFor(
+            [&texts, &chunks](const std::int64_t i) {
+                chunks[i] = parseOBJChunk(texts[i]);
+            },
+            static_cast<std::int64_t>(texts.size()));
+
+        const Optional<obj::Contents> contents =
+            mergeOBJChunks(chunks, objectToWorld);
+        // the attributes are copied into the contents
+        chunks.clear();
+        if (!contents.has_value() || contents->corners.empty()) {
+            return pbrt::nullopt;
+        }
+
+        const std::shared_ptr<TriangleMesh> mesh =
+            createOBJTriangleMesh(*contents,
+                                  std::move(alphaMask),
+                                  std::move(shadowAlphaMask));
+
+        return pbrt::make_optional(createTriangles(mesh,
+                                                   objectToWorld,
+                                                   worldToObject,
+                                                   reverseOrientation));
+    }
+
+    // Splits `text` into chunks of about OBJ_CHUNK_SIZE bytes
+    // which end at line boundaries
+    std::vector<std::string_view> splitOBJChunks(std::string_view text) {
+        std::vector<std::string_view> chunks;
+        chunks.reserve(text.size() / constants::OBJ_CHUNK_SIZE + 1);
+        while (!text.empty()) {
+            const std::size_t size =
+                std::min(constants::OBJ_CHUNK_SIZE, text.size());
+            const std::size_t newline = text.find('\n', size - 1);
+            const std::size_t end =
+                newline == std::string_view::npos ? text.size() : newline + 1;
+
+            chunks.push_back(text.substr(0, end));
+            text.remove_prefix(end);
+        }
+
+        return chunks;
+    }
+
+    obj::Chunk parseOBJChunk(std::string_view text) {
+        obj::Chunk chunk;
+        while (!text.empty() && chunk.isValid) {
+            const std::size_t newline = text.find('\n');
+            const std::string_view line = text.substr(0, newline);
+            text.remove_prefix(newline == std::string_view::npos
+                                   ? text.size()
+                                   : newline + 1);
+
+            chunk.isValid = parseOBJLine(line, chunk);
+        }
+
+        return chunk;
+    }
+
+    // Comments, empty lines and statements other than
+    // v, vt, vn and f are skipped. So are the values after
+    // those which are read, like the w coordinates and vertex colors.
+    bool parseOBJLine(std::string_view line, obj::Chunk& chunk) {
+        const std::string_view statement = nextOBJToken(line);
+        if (statement == "f") {
+            return parseOBJFace(line, chunk);
+        }
+
+        const bool isPosition = statement == "v";
+        const bool isNormal = statement == "vn";
+        const bool isUV = statement == "vt";
+        if (!isPosition && !isNormal && !isUV) {
+            return true;
+        }
+
+        std::array<Float, 3> values = {};
+        for (std::size_t i = 0; i < (isUV ? 2 : 3); ++i) {
+            const std::string_view token = nextOBJToken(line);
+            // the v coordinate is optional
+            if (isUV && i == 1 && token.empty()) {
+                break;
+            }
+
+            const Optional<Float> value = parseOBJFloat(token);
+            if (!value.has_value()) {
+                return false;
+            }
+            values[i] = *value;
+        }
+
+        if (isPosition) {
+            chunk.positions.push_back(Point3f{values[0], values[1], values[2]});
+        }
+        else if (isNormal) {
+            chunk.normals.push_back(Normal3f{values[0], values[1], values[2]});
+        }
+        else {
+            chunk.uvs.push_back(Point2f{values[0], values[1]});
+        }
+
+        return true;
+    }
+
+    // Splits the face into a fan of triangles around its first corner
+    bool parseOBJFace(std::string_view line, obj::Chunk& chunk) {
+        const auto push = [&chunk](const obj::ParsedCorner& corner) {
+            chunk.corners.push_back(corner);
+            chunk.cornersWithUVs += corner.indices[obj::UV] != obj::NO_INDEX;
+            chunk.cornersWithNormals +=
+                corner.indices[obj::NORMAL] != obj::NO_INDEX;
+        };
+
+        obj::ParsedCorner first;
+        obj::ParsedCorner previous;
+        std::size_t cornersCount = 0;
+        for (std::string_view token = nextOBJToken(line);
+             !token.empty() && token.front() != '#';
+             token = nextOBJToken(line))
+        {
+            const Optional<obj::ParsedCorner> corner =
+                parseOBJCorner(token, chunk);
+            if (!corner.has_value()) {
+                return false;
+            }
+
+            if (cornersCount == 0) {
+                first = *corner;
+            }
+            else if (cornersCount >= 2) {
+                push(first);
+                push(previous);
+                push(*corner);
+            }
+            previous = *corner;
+            ++cornersCount;
+        }
+
+        return cornersCount >= 3;
+    }
+
+    // Parses a corner of the form p, p/uv, p//n or p/uv/n
+    Optional<obj::ParsedCorner> parseOBJCorner(std::string_view token,
+                                               const obj::Chunk& chunk) {
+        const std::array<std::size_t, 3> parsedCounts = {
+            chunk.positions.size(),
+            chunk.uvs.size(),
+            chunk.normals.size(),
+        };
+
+        obj::ParsedCorner corner;
+        for (std::size_t attribute = obj::POSITION;
+             attribute <= obj::NORMAL;
+             ++attribute)
+        {
+            const std::size_t slash = token.find('/');
+            const std::string_view index = token.substr(0, slash);
+            if (!index.empty()) {
+                std::int64_t value = 0;
+                const char* const last = index.data() + index.size();
+                const auto [end, error] =
+                    std::from_chars(index.data(), last, value);
+                if (error != std::errc{} || end != last || value == 0) {
+                    return pbrt::nullopt;
+                }
+
+                if (value > 0) {
+                    corner.indices[attribute] = value - 1;
+                }
+                else {
+                    corner.indices[attribute] =
+                        static_cast<std::int64_t>(parsedCounts[attribute]) +
+                        value;
+                    corner.isRelative |= 1u << attribute;
+                }
+            }
+            else if (attribute == obj::POSITION) {
+                return pbrt::nullopt;
+            }
+
+            if (slash == std::string_view::npos) {
+                return pbrt::make_optional(corner);
+            }
+            token.remove_prefix(slash + 1);
+        }
+
+        // more than three indices
+        return pbrt::nullopt;
+    }
+
+    // Removes the next whitespace separated token from `line`
+    // and returns it, or an empty token at the end of the line
+    std::string_view nextOBJToken(std::string_view& line) noexcept {
+        const auto isSpace = [](const char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        };
+
+        std::size_t first = 0;
+        while (first < line.size() && isSpace(line[first])) {
+            ++first;
+        }
+        std::size_t last = first;
+        while (last < line.size() && !isSpace(line[last])) {
+            ++last;
+        }
+
+        const std::string_view token = line.substr(first, last - first);
+        line.remove_prefix(last);
+
+        return token;
+    }
+
+    Optional<Float> parseOBJFloat(const std::string_view token) noexcept {
+        const char* first = token.data();
+        const char* const last = first + token.size();
+        // from_chars does not accept a leading plus sign
+        if (first != last && *first == '+') {
+            ++first;
+        }
+
+        Float value = 0.f;
+        const auto [end, error] = std::from_chars(first, last, value);
+
+        return (error == std::errc{} && end == last)
+                   ? pbrt::make_optional(value)
+                   : pbrt::nullopt;
+    }
+
+    // Concatenates the attributes of the chunks in parallel,
+    // at the offsets given by the prefix sums of their counts, and
+    // resolves the indices of the corners. Returns pbrt::nullopt if
+    // some chunk is malformed or some corner refers to an attribute
+    // which does not exist.
+    Optional<obj::Contents>
+    mergeOBJChunks(const std::vector<obj::Chunk>& chunks,
+                   const Transformation& objectToWorld) {
+        if (std::any_of(chunks.begin(),
+                        chunks.end(),
+                        [](const obj::Chunk& chunk) { return !chunk.isValid; }))
+        {
+            return pbrt::nullopt;
+        }
+
+        const auto prefixSums = [&chunks](const auto count) {
+            std::vector<std::size_t> offsets(chunks.size() + 1, 0);
+            for (std::size_t i = 0; i < chunks.size(); ++i) {
+                offsets[i + 1] = offsets[i] + count(chunks[i]);
+            }
+            return offsets;
+        };
+        const std::array<std::vector<std::size_t>, 3> offsets = {
+            prefixSums([](const obj::Chunk& c) { return c.positions.size(); }),
+            prefixSums([](const obj::Chunk& c) { return c.uvs.size(); }),
+            prefixSums([](const obj::Chunk& c) { return c.normals.size(); }),
+        };
+        const std::vector<std::size_t> cornerOffsets =
+            prefixSums([](const obj::Chunk& c) { return c.corners.size(); });
+        const std::array<std::size_t, 3> totals = {offsets[0].back(),
+                                                   offsets[1].back(),
+                                                   offsets[2].back()};
+
+        const std::size_t cornersCount = cornerOffsets.back();
+        if (std::any_of(totals.begin(),
+                        totals.end(),
+                        [](const std::size_t total) {
+                            return total >= obj::NO_VERTEX;
+                        }) ||
+            cornersCount / 3 > std::numeric_limits<unsigned>::max())
+        {
+            return pbrt::nullopt;
+        }
+
+        std::size_t cornersWithUVs = 0;
+        std::size_t cornersWithNormals = 0;
+        for (const obj::Chunk& chunk : chunks) {
+            cornersWithUVs += chunk.cornersWithUVs;
+            cornersWithNormals += chunk.cornersWithNormals;
+        }
+
+        obj::Contents contents;
+        contents.positions.resize(totals[obj::POSITION]);
+        contents.uvs.resize(totals[obj::UV]);
+        contents.normals.resize(totals[obj::NORMAL]);
+        contents.corners.resize(cornersCount);
+        contents.hasUVs = cornersWithUVs == cornersCount;
+        contents.hasNormals = cornersWithNormals == cornersCount;
+
+        std::atomic<bool> isValid = true;
+        std::atomic<bool> sharesIndices = true;
+        const auto merge = [&](const std::int64_t i) {
+            const obj::Chunk& chunk = chunks[i];
+            std::transform(chunk.positions.begin(),
+                           chunk.positions.end(),
+                           contents.positions.begin() +
+                               offsets[obj::POSITION][i],
+                           [&objectToWorld](const Point3f& p) {
+                               return objectToWorld(p);
+                           });
+            std::copy(chunk.uvs.begin(),
+                      chunk.uvs.end(),
+                      contents.uvs.begin() + offsets[obj::UV][i]);
+            std::transform(chunk.normals.begin(),
+                           chunk.normals.end(),
+                           contents.normals.begin() + offsets[obj::NORMAL][i],
+                           [&objectToWorld](const Normal3f& n) {
+                               return objectToWorld(n);
+                           });
+
+            bool chunkSharesIndices = true;
+            for (std::size_t c = 0; c < chunk.corners.size(); ++c) {
+                const obj::ParsedCorner& parsed = chunk.corners[c];
+                obj::Corner& corner = contents.corners[cornerOffsets[i] + c];
+                for (std::size_t a = obj::POSITION; a <= obj::NORMAL; ++a) {
+                    std::int64_t index = parsed.indices[a];
+                    if (index == obj::NO_INDEX) {
+                        corner[a] = obj::NO_VERTEX;
+                        continue;
+                    }
+                    if (parsed.isRelative & (1u << a)) {
+                        index += static_cast<std::int64_t>(offsets[a][i]);
+                    }
+                    if (index < 0 ||
+                        index >= static_cast<std::int64_t>(totals[a]))
+                    {
+                        isValid = false;
+                        return;
+                    }
+                    corner[a] = static_cast<std::uint32_t>(index);
+                }
+
+                chunkSharesIndices &=
+                    (!contents.hasUVs ||
+                     corner[obj::UV] == corner[obj::POSITION]) &&
+                    (!contents.hasNormals ||
+                     corner[obj::NORMAL] == corner[obj::POSITION]);
+            }
+            if (!chunkSharesIndices) {
+                sharesIndices = false;
+            }
+        };
+        parallel::parallelFor(merge, static_cast<std::int64_t>(chunks.size()));
+
+        contents.sharesIndices = sharesIndices;
+
+        return isValid ? pbrt::make_optional(std::move(contents))
+                       : pbrt::nullopt;
+    }
+
+    // When the corners share the indices of their attributes,
+    // each position is a vertex of the mesh. Otherwise a vertex is
+    // created for each distinct combination of attributes the corners
+    // refer to. Finding those is sequential, but it only walks
+    // the short lists of the vertices at each position.
+    std::shared_ptr<TriangleMesh> createOBJTriangleMesh(
+        const obj::Contents& contents,
+        std::shared_ptr<const Texture<Float>> alphaMask,
+        std::shared_ptr<const Texture<Float>> shadowAlphaMask) {
+        using constants::OBJ_RANGE_SIZE;
+
+        std::vector<obj::Corner> vertices;
+        std::vector<std::uint32_t> vertexIndices;
+        if (!contents.sharesIndices) {
+            std::vector<std::uint32_t> firstAtPosition(
+                contents.positions.size(),
+                obj::NO_VERTEX);
+            std::vector<std::uint32_t> nextAtPosition;
+            vertexIndices.resize(contents.corners.size());
+
+            for (std::size_t i = 0; i < contents.corners.size(); ++i) {
+                const obj::Corner& corner = contents.corners[i];
+                const obj::Corner vertex = {
+                    corner[obj::POSITION],
+                    contents.hasUVs ? corner[obj::UV] : obj::NO_VERTEX,
+                    contents.hasNormals ? corner[obj::NORMAL] : obj::NO_VERTEX,
+                };
+
+                std::uint32_t& first = firstAtPosition[vertex[obj::POSITION]];
+                std::uint32_t v = first;
+                while (v != obj::NO_VERTEX && vertices[v] != vertex) {
+                    v = nextAtPosition[v];
+                }
+                if (v == obj::NO_VERTEX) {
+                    v = static_cast<std::uint32_t>(vertices.size());
+                    vertices.push_back(vertex);
+                    nextAtPosition.push_back(first);
+                    first = v;
+                }
+                vertexIndices[i] = v;
+            }
+        }
+
+        const std::size_t verticesCount =
+            contents.sharesIndices ? contents.positions.size()
+                                   : vertices.size();
+        const TriangleMeshAttributes attributes{
+            .normals = contents.hasNormals,
+            .uvs = contents.hasUVs,
+            .faceIndices = false,
+        };
+        const auto mesh = std::make_shared<TriangleMesh>(
+            static_cast<unsigned>(contents.corners.size() / 3),
+            static_cast<unsigned>(verticesCount),
+            attributes,
+            std::move(alphaMask),
+            std::move(shadowAlphaMask));
+
+        const auto writeVertices = [&](const std::size_t first,
+                                       const std::size_t last) {
+            for (std::size_t i = first; i < last; ++i) {
+                const auto index = static_cast<std::uint32_t>(i);
+                const obj::Corner vertex =
+                    contents.sharesIndices ? obj::Corner{index, index, index}
+                                           : vertices[i];
+                mesh->vertexWorldCoordinates[i] =
+                    contents.positions[vertex[obj::POSITION]];
+                // with shared indices, the positions
+                // which no corner refers to may have no other attributes
+                if (attributes.uvs && vertex[obj::UV] < contents.uvs.size()) {
+                    mesh->vertexUVs[i] = contents.uvs[vertex[obj::UV]];
+                }
+                if (attributes.normals &&
+                    vertex[obj::NORMAL] < contents.normals.size())
+                {
+                    mesh->vertexNormalVectors[i] =
+                        contents.normals[vertex[obj::NORMAL]];
+                }
+            }
+        };
+        parallel::parallelForRanges(writeVertices,
+                                    verticesCount,
+                                    OBJ_RANGE_SIZE);
+
+        const auto writeIndices = [&](const std::size_t first,
+                                      const std::size_t last) {
+            for (std::size_t i = first; i < last; ++i) {
+                mesh->vertexIndices.set(
+                    i,
+                    contents.sharesIndices
+                        ? contents.corners[i][obj::POSITION]
+                        : vertexIndices[i]);
+            }
+        };
+        parallel::parallelForRanges(writeIndices,
+                                    contents.corners.size(),
+                                    OBJ_RANGE_SIZE);
+
+        return mesh;
+    }
+} // namespace idragnev::pbrt::shapes
\ No newline at end of file
@@ -0,0 +1,783 @@
+#include "pbrt/shapes/PLYMesh.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/math/Point2.hpp"
+#include "pbrt/core/math/Point3.hpp"
+#include "pbrt/core/math/Normal3.hpp"
+#include "pbrt/memory/MappedFile.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace idragnev::pbrt::shapes {
+    namespace constants {
+        // The vertices or faces converted by one parallel iteration
+        inline constexpr std::size_t PLY_CHUNK_SIZE = 16 * 1024;
+    } // namespace constants
+
+    namespace ply {
+        enum class Type
+        {
+            Int8,
+            UInt8,
+            Int16,
+            UInt16,
+            Int32,
+            UInt32,
+            Float32,
+            Float64,
+        };
+
+        struct Property
+        {
+            std::string name;
+            Type type = Type::Float32;
+            // Set only for list properties, whose items are of `type`
+            Optional<Type> countType = pbrt::nullopt;
+        };
+
+        struct Element
+        {
+            std::string name;
+            std::size_t count = 0;
+            std::vector<Property> properties;
+        };
+
+        struct Header
+        {
+            bool isBigEndian = false;
+            std::vector<Element> elements;
+            // The data of the elements follows the header
+            std::size_t size = 0;
+        };
+
+        // A scalar property at the same offset in all records
+        // of an element
+        struct Field
+        {
+            std::size_t offset = 0;
+            Type type = Type::Float32;
+        };
+
+        struct VertexFields
+        {
+            std::size_t recordSize = 0;
+            std::array<Field, 3> p;
+            Optional<std::array<Field, 3>> n = pbrt::nullopt;
+            Optional<std::array<Field, 2>> uv = pbrt::nullopt;
+        };
+
+        // Reads the values of a file, swapping their bytes
+        // if it is not in the native byte order
+        class Reader
+        {
+        public:
+            explicit Reader(const bool isBigEndian) noexcept
+                : swapBytes(isBigEndian !=
+                            (std::endian::native == std::endian::big)) {}
+
+            Float readFloat(const std::byte* p, const Type type) const;
+            // Only for integral types
+            std::int64_t readInteger(const std::byte* p, const Type type) const;
+
+        private:
+            template <typename T>
+            T read(const std::byte* p) const;
+
+        private:
+            bool swapBytes = false;
+        };
+    } // namespace ply
+
+    Optional<ply::Header> parsePLYHeader(std::span<const std::byte> bytes);
+    Optional<ply::Type> parsePLYType(const std::string_view name);
+    std::size_t sizeOf(const ply::Type type) noexcept;
+    bool isIntegral(const ply::Type type) noexcept;
+    Optional<std::size_t> recordSize(const ply::Element& element);
+    Optional<std::size_t> elementSize(const ply::Element& element,
+                                      const std::span<const std::byte> data,
+                                      const ply::Reader& reader);
+    Optional<ply::Field>
+    findField(const ply::Element& element,
+              std::initializer_list<std::string_view> names);
+    Optional<ply::VertexFields> vertexFields(const ply::Element& vertices);
+
+    void convertVertices(const ply::VertexFields& fields,
+                         const std::span<const std::byte> data,
+                         const ply::Reader& reader,
+                         const Transformation& objectToWorld,
+                         TriangleMesh& mesh);
+    std::shared_ptr<TriangleMesh>
+    convertTriangleFaces(const ply::Element& faces,
+                         const std::span<const std::byte> data,
+                         const ply::Reader& reader,
+                         const unsigned verticesCount,
+                         const TriangleMeshAttributes& attributes);
+    std::shared_ptr<TriangleMesh>
+    convertPolygonFaces(const ply::Element& faces,
+                        const std::span<const std::byte> data,
+                        const ply::Reader& reader,
+                        const unsigned verticesCount,
+                        const TriangleMeshAttributes& attributes);
+
+    Optional<std::vector<std::shared_ptr<Shape>>>
+    loadPLYMesh(const std::filesystem::path& path,
+                const Transformation& objectToWorld,
+                const Transformation& worldToObject,
+                const bool reverseOrientation,
+                std::shared_ptr<const Texture<Float>> alphaMask,
+                std::shared_ptr<const Texture<Float>> shadowAlphaMask) {
+        const memory::MappedFile file{path};
+        const std::span<const std::byte> bytes = file.bytes();
+
+        const Optional<ply::Header> header = parsePLYHeader(bytes);
+        if (!header.has_value()) {
+            return pbrt::nullopt;
+        }
+
+        const ply::Reader reader{header->isBigEndian};
+        const ply::Element* vertices = nullptr;
+        const ply::Element* faces = nullptr;
+        std::span<const std::byte> vertexData;
+        std::span<const std::byte> faceData;
+
+        // Only the elements before the vertices and the faces are walked
+        // to find where their data starts. The data of the elements after
+        // them is not validated.
+        std::span<const std::byte> data = bytes.subspan(header->size);
+        for (const ply::Element& element : header->elements) {
+            if (element.name == "vertex") {
+                vertices = &element;
+                vertexData = data;
+            }
+            else if (element.name == "face") {
+                faces = &element;
+                faceData = data;
+            }
+            if (vertices != nullptr && faces != nullptr) {
+                break;
+            }
+
+            const auto size = elementSize(element, data, reader);
+            if (!size.has_value()) {
+                return pbrt::nullopt;
+            }
+            data = data.subspan(*size);
+        }
+
+        if (vertices == nullptr || faces == nullptr ||
+            vertices->count > std::numeric_limits<unsigned>::max())
+        {
+            return pbrt::nullopt;
+        }
+
+        const Optional<ply::VertexFields> fields = vertexFields(*vertices);
+        if (!fields.has_value() ||
+            !elementSize(*vertices, vertexData, reader).has_value())
+        {
+            return pbrt::nullopt;
+        }
+
+        const auto verticesCount = static_cast<unsigned>(vertices->count);
+        const TriangleMeshAttributes attributes{
+            .normals = fields->n.has_value(),
+            .uvs = fields->uv.has_value(),
+            .faceIndices = std::any_of(faces->properties.begin(),
+                                       faces->properties.end(),
+                                       [](const ply::Property& p) {
+                                           return p.name == "face_indices";
+                                       }),
+        };
+
+        // Most meshes have only triangles, whose records are of the same
+        // size and are converted in parallel. Other meshes are
+        // triangulated sequentially.
+        std::shared_ptr<TriangleMesh> mesh = convertTriangleFaces(
+            *faces, faceData, reader, verticesCount, attributes);
+        if (mesh == nullptr) {
+            mesh = convertPolygonFaces(*faces,
+                                       faceData,
+                                       reader,
+                                       verticesCount,
+                                       attributes);
+        }
+        if (mesh == nullptr) {
+            return pbrt::nullopt;
+        }
+
+        mesh->alphaMask = std::move(alphaMask);
+        mesh->shadowAlphaMask = std::move(shadowAlphaMask);
+        convertVertices(*fields, vertexData, reader, objectToWorld, *mesh);
+
+        return pbrt::make_optional(createTriangles(mesh,
+                                                   objectToWorld,
+                                                   worldToObject,
+                                                   reverseOrientation));
+    }
+
+    Optional<ply::Header> parsePLYHeader(std::span<const std::byte> bytes) {
+        const auto text =
+            std::string_view{reinterpret_cast<const char*>(bytes.data()),
+                             bytes.size()};
+
+        ply::Header header;
+        bool hasFormat = false;
+        std::size_t lineStart = 0;
+        for (std::size_t lineNumber = 0;; ++lineNumber) {
+            const std::size_t lineEnd = text.find('\n', lineStart);
+            if (lineEnd == std::string_view::npos) {
+                return pbrt::nullopt;
+            }
+
+            std::string_view line =
+                text.substr(lineStart, lineEnd - lineStart);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            lineStart = lineEnd + 1;
+
+            std::vector<std::string_view> tokens;
+            for (std::size_t i = 0; i < line.size();) {
+                const std::size_t tokenEnd =
+                    std::min(line.find(' ', i), line.size());
+                if (tokenEnd > i) {
+                    tokens.push_back(line.substr(i, tokenEnd - i));
+                }
+                i = tokenEnd + 1;
+            }
+
+            if (lineNumber == 0) {
+                if (tokens.size() != 1 || tokens[0] != "ply") {
+                    return pbrt::nullopt;
+                }
+            }
+            else if (tokens.empty() || tokens[0] == "comment" ||
+                     tokens[0] == "obj_info")
+            {
+                continue;
+            }
+            else if (tokens[0] == "format" && tokens.size() == 3) {
+                if (tokens[1] != "binary_little_endian" &&
+                    tokens[1] != "binary_big_endian")
+                {
+                    return pbrt::nullopt;
+                }
+                header.isBigEndian = tokens[1] == "binary_big_endian";
+                hasFormat = true;
+            }
+            else if (tokens[0] == "element" && tokens.size() == 3) {
+                ply::Element element;
+                element.name = tokens[1];
+                const char* const first = tokens[2].data();
+                const char* const last = first + tokens[2].size();
+                if (std::from_chars(first, last, element.count).ptr != last) {
+                    return pbrt::nullopt;
+                }
+                header.elements.push_back(std::move(element));
+            }
+            else if (tokens[0] == "property" && !header.elements.empty()) {
+                ply::Property property;
+                if (tokens.size() == 3) {
+                    const auto type = parsePLYType(tokens[1]);
+                    if (!type.has_value()) {
+                        return pbrt::nullopt;
+                    }
+                    property.type = *type;
+                    property.name = tokens[2];
+                }
+                else if (tokens.size() == 5 && tokens[1] == "list") {
+                    const auto countType = parsePLYType(tokens[2]);
+                    const auto type = parsePLYType(tokens[3]);
+                    if (!countType.has_value() || !isIntegral(*countType) ||
+                        !type.has_value())
+                    {
+                        return pbrt::nullopt;
+                    }
+                    property.countType = countType;
+                    property.type = *type;
+                    property.name = tokens[4];
+                }
+                else {
+                    return pbrt::nullopt;
+                }
+                header.elements.back().properties.push_back(
+                    std::move(property));
+            }
+            else if (tokens[0] == "end_header" && tokens.size() == 1) {
+                header.size = lineStart;
+                break;
+            }
+            else {
+                return pbrt::nullopt;
+            }
+        }
+
+        return hasFormat ? pbrt::make_optional(std::move(header))
+                         : pbrt::nullopt;
+    }
+
+    Optional<ply::Type> parsePLYType(const std::string_view name) {
+        using ply::Type;
+
+        if (name == "char" || name == "int8") {
+            return pbrt::make_optional(Type::Int8);
+        }
+        if (name == "uchar" || name == "uint8") {
+            return pbrt::make_optional(Type::UInt8);
+        }
+        if (name == "short" || name == "int16") {
+            return pbrt::make_optional(Type::Int16);
+        }
+        if (name == "ushort" || name == "uint16") {
+            return pbrt::make_optional(Type::UInt16);
+        }
+        if (name == "int" || name == "int32") {
+            return pbrt::make_optional(Type::Int32);
+        }
+        if (name == "uint" || name == "uint32") {
+            return pbrt::make_optional(Type::UInt32);
+        }
+        if (name == "float" || name == "float32") {
+            return pbrt::make_optional(Type::Float32);
+        }
+        if (name == "double" || name == "float64") {
+            return pbrt::make_optional(Type::Float64);
+        }
+
+        return pbrt::nullopt;
+    }
+
+    std::size_t sizeOf(const ply::Type type) noexcept {
+        switch (type) {
+            case ply::Type::Int8:
+            case ply::Type::UInt8: return 1;
+            case ply::Type::Int16:
+            case ply::Type::UInt16: return 2;
+            case ply::Type::Int32:
+            case ply::Type::UInt32:
+            case ply::Type::Float32: return 4;
+            case ply::Type::Float64: return 8;
+        }
+
+        return 0;
+    }
+
+    bool isIntegral(const ply::Type type) noexcept {
+        return type != ply::Type::Float32 && type != ply::Type::Float64;
+    }
+
+    template <typename T>
+    T ply::Reader::read(const std::byte* p) const {
+        std::array<std::byte, sizeof(T)> bytes;
+        std::memcpy(bytes.data(), p, sizeof(T));
+        if (this->swapBytes) {
+            std::reverse(bytes.begin(), bytes.end());
+        }
+
+        return std::bit_cast<T>(bytes);
+    }
+
+    Float ply::Reader::readFloat(const std::byte* p, const Type type) const {
+        switch (type) {
+            case Type::Int8: return static_cast<Float>(read<std::int8_t>(p));
+            case Type::UInt8: return static_cast<Float>(read<std::uint8_t>(p));
+            case Type::Int16: return static_cast<Float>(read<std::int16_t>(p));
+            case Type::UInt16:
+                return static_cast<Float>(read<std::uint16_t>(p));
+            case Type::Int32: return static_cast<Float>(read<std::int32_t>(p));
+            case Type::UInt32:
+                return static_cast<Float>(read<std::uint32_t>(p));
+            case Type::Float32: return static_cast<Float>(read<float>(p));
+            case Type::Float64: return static_cast<Float>(read<double>(p));
+        }
+
+        return 0;
+    }
+
+    std::int64_t ply::Reader::readInteger(const std::byte* p,
+                                          const Type type) const {
+        switch (type) {
+            case Type::Int8: return read<std::int8_t>(p);
+            case Type::UInt8: return read<std::uint8_t>(p);
+            case Type::Int16: return read<std::int16_t>(p);
+            case Type::UInt16: return read<std::uint16_t>(p);
+            case Type::Int32: return read<std::int32_t>(p);
+            case Type::UInt32: return read<std::uint32_t>(p);
+            default: assert(false); return 0;
+        }
+    }
+
+    // The size of the records of an element without list properties
+    Optional<std::size_t> recordSize(const ply::Element& element) {
+        std::size_t size = 0;
+        for (const ply::Property& property : element.properties) {
+            if (property.countType.has_value()) {
+                return pbrt::nullopt;
+            }
+            size += sizeOf(property.type);
+        }
+
+        return pbrt::make_optional(size);
+    }
+
+    // The size of the data of `element` at the start of `data`,
+    // or nullopt if it does not fit in `data`.
+    Optional<std::size_t> elementSize(const ply::Element& element,
+                                      const std::span<const std::byte> data,
+                                      const ply::Reader& reader) {
+        if (const auto size = recordSize(element); size.has_value()) {
+            if (*size != 0 && element.count > data.size() / *size) {
+                return pbrt::nullopt;
+            }
+            return pbrt::make_optional(element.count * *size);
+        }
+
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < element.count; ++i) {
+            for (const ply::Property& property : element.properties) {
+                if (property.countType.has_value()) {
+                    const std::size_t countSize = sizeOf(*property.countType);
+                    if (data.size() - offset < countSize) {
+                        return pbrt::nullopt;
+                    }
+                    const std::int64_t count =
+                        reader.readInteger(data.data() + offset,
+                                           *property.countType);
+                    if (count < 0) {
+                        return pbrt::nullopt;
+                    }
+                    offset += countSize;
+
+                    const auto itemsSize = static_cast<std::size_t>(count) *
+                                           sizeOf(property.type);
+                    if (data.size() - offset < itemsSize) {
+                        return pbrt::nullopt;
+                    }
+                    offset += itemsSize;
+                }
+                else {
+                    if (data.size() - offset < sizeOf(property.type)) {
+                        return pbrt::nullopt;
+                    }
+                    offset += sizeOf(property.type);
+                }
+            }
+        }
+
+        return pbrt::make_optional(offset);
+    }
+
+    // Finds the first of the scalar properties `names` which is
+    // preceded only by scalar properties in the records of `element`
+    Optional<ply::Field>
+    findField(const ply::Element& element,
+              std::initializer_list<std::string_view> names) {
+        for (const std::string_view name : names) {
+            std::size_t offset = 0;
+            for (const ply::Property& property : element.properties) {
+                if (property.countType.has_value()) {
+                    break;
+                }
+                if (property.name == name) {
+                    return pbrt::make_optional(
+                        ply::Field{.offset = offset, .type = property.type});
+                }
+                offset += sizeOf(property.type);
+            }
+        }
+
+        return pbrt::nullopt;
+    }
+
+    Optional<ply::VertexFields> vertexFields(const ply::Element& vertices) {
+        const Optional<std::size_t> size = recordSize(vertices);
+        const auto x = findField(vertices, {"x"});
+        const auto y = findField(vertices, {"y"});
+        const auto z = findField(vertices, {"z"});
+        if (!size.has_value() || !x.has_value() || !y.has_value() ||
+            !z.has_value())
+        {
+            return pbrt::nullopt;
+        }
+
+        ply::VertexFields fields;
+        fields.recordSize = *size;
+        fields.p = {*x, *y, *z};
+
+        const auto nx = findField(vertices, {"nx"});
+        const auto ny = findField(vertices, {"ny"});
+        const auto nz = findField(vertices, {"nz"});
+        if (nx.has_value() && ny.has_value() && nz.has_value()) {
+            fields.n = std::array<ply::Field, 3>{*nx, *ny, *nz};
+        }
+
+        const auto u =
+            findField(vertices, {"u", "s", "texture_u", "texture_s"});
+        const auto v =
+            findField(vertices, {"v", "t", "texture_v", "texture_t"});
+        if (u.has_value() && v.has_value()) {
+            fields.uv = std::array<ply::Field, 2>{*u, *v};
+        }
+
+        return pbrt::make_optional(fields);
+    }
+
+    void convertVertices(const ply::VertexFields& fields,
+                         const std::span<const std::byte> data,
+                         const ply::Reader& reader,
+                         const Transformation& objectToWorld,
+                         TriangleMesh& mesh) {
+        const auto convert = [&](const std::size_t first,
+                                 const std::size_t last) {
+            for (std::size_t i = first; i < last; ++i) {
+                const std::byte* const record =
+                    data.data() + i * fields.recordSize;
+                const auto read = [&reader, record](const ply::Field& f) {
+                    return reader.readFloat(record + f.offset, f.type);
+                };
+
+                mesh.vertexWorldCoordinates[i] = objectToWorld(
+                    Point3f{read(fields.p[0]), read(fields.p[1]),
+                            read(fields.p[2])});
+                if (fields.n.has_value()) {
+                    const auto& n = *fields.n;
+                    mesh.vertexNormalVectors[i] = objectToWorld(
+                        Normal3f{read(n[0]), read(n[1]), read(n[2])});
+                }
+                if (fields.uv.has_value()) {
+                    const auto& uv = *fields.uv;
+                    mesh.vertexUVs[i] = Point2f{read(uv[0]), read(uv[1])};
+                }
+            }
+        };
+        parallel::parallelForRanges(convert,
+                                    mesh.verticesCount,
+                                    constants::PLY_CHUNK_SIZE);
+    }
+
+    // Converts faces whose records all have three vertex indices
+    // in parallel, since they are all of the same size.
+    // Returns nullptr if some face does not have three vertices
+    // or refers to a vertex which does not exist.
+    std::shared_ptr<TriangleMesh>
+    convertTriangleFaces(const ply::Element& faces,
+                         const std::span<const std::byte> data,
+                         const ply::Reader& reader,
+                         const unsigned verticesCount,
+                         const TriangleMeshAttributes& attributes) {
+        // the offsets of the count and the face index,
+        // as if all faces were triangles
+        std::size_t size = 0;
+        Optional<ply::Field> count = pbrt::nullopt;
+        Optional<ply::Field> faceIndex = pbrt::nullopt;
+        ply::Type indexType = ply::Type::Int32;
+        for (const ply::Property& property : faces.properties) {
+            if (property.countType.has_value()) {
+                const bool isIndicesList = property.name == "vertex_indices" ||
+                                           property.name == "vertex_index";
+                if (!isIndicesList || count.has_value() ||
+                    !isIntegral(property.type))
+                {
+                    return nullptr;
+                }
+                count = ply::Field{.offset = size, .type = *property.countType};
+                indexType = property.type;
+                size += sizeOf(*property.countType) + 3 * sizeOf(property.type);
+            }
+            else {
+                if (property.name == "face_indices") {
+                    if (!isIntegral(property.type)) {
+                        return nullptr;
+                    }
+                    faceIndex =
+                        ply::Field{.offset = size, .type = property.type};
+                }
+                size += sizeOf(property.type);
+            }
+        }
+
+        if (!count.has_value() ||
+            faces.count > std::numeric_limits<unsigned>::max() ||
+            faces.count > data.size() / size)
+        {
+            return nullptr;
+        }
+
+        const auto mesh =
+            std::make_shared<TriangleMesh>(static_cast<unsigned>(faces.count),
+                                           verticesCount,
+                                           attributes,
+                                           nullptr,
+                                           nullptr);
+        const std::size_t indicesOffset = count->offset + sizeOf(count->type);
+        const std::size_t indexSize = sizeOf(indexType);
+
+        std::atomic<bool> isValid = true;
+        const auto convert = [&](const std::size_t first,
+                                 const std::size_t last) {
+            for (std::size_t i = first; i < last; ++i) {
+                const std::byte* const record = data.data() + i * size;
+                if (reader.readInteger(record + count->offset, count->type) !=
+                    3)
+                {
+                    isValid = false;
+                    return;
+                }
+
+                for (std::size_t v = 0; v < 3; ++v) {
+                    const std::int64_t index = reader.readInteger(
+                        record + indicesOffset + v * indexSize,
+                        indexType);
+                    if (index < 0 || index >= verticesCount) {
+                        isValid = false;
+                        return;
+                    }
+                    mesh->vertexIndices.set(
+                        3 * i + v,
+                        static_cast<std::uint32_t>(index));
+                }
+
+                if (faceIndex.has_value()) {
+                    mesh->faceIndices[i] = static_cast<std::uint32_t>(
+                        reader.readInteger(record + faceIndex->offset,
+                                           faceIndex->type));
+                }
+            }
+        };
+        parallel::parallelForRanges(convert,
+                                    faces.count,
+                                    constants::PLY_CHUNK_SIZE);
+
+        return isValid ? mesh : nullptr;
+    }
+
+    // Splits each face into a fan of triangles around its first vertex,
+    // walking the records sequentially. Returns nullptr if some face
+    // refers to a vertex which does not exist.
+    std::shared_ptr<TriangleMesh>
+    convertPolygonFaces(const ply::Element& faces,
+                        const std::span<const std::byte> data,
+                        const ply::Reader& reader,
+                        const unsigned verticesCount,
+                        const TriangleMeshAttributes& attributes) {
+        // Calls `f(indices, indexType, polygonSize, faceIndex)`
+        // for each face, once the data of the faces is validated.
+        const auto forEachFace = [&faces, &data, &reader](auto&& f) {
+            const std::byte* record = data.data();
+            for (std::size_t i = 0; i < faces.count; ++i) {
+                const std::byte* indices = nullptr;
+                ply::Type indexType = ply::Type::Int32;
+                std::size_t polygonSize = 0;
+                std::int64_t faceIndex = 0;
+
+                for (const ply::Property& property : faces.properties) {
+                    if (property.countType.has_value()) {
+                        const auto count = static_cast<std::size_t>(
+                            reader.readInteger(record, *property.countType));
+                        record += sizeOf(*property.countType);
+                        if (property.name == "vertex_indices" ||
+                            property.name == "vertex_index")
+                        {
+                            indices = record;
+                            indexType = property.type;
+                            polygonSize = count;
+                        }
+                        record += count * sizeOf(property.type);
+                    }
+                    else {
+                        if (property.name == "face_indices") {
+                            faceIndex = reader.readInteger(record,
+                                                           property.type);
+                        }
+                        record += sizeOf(property.type);
+                    }
+                }
+
+                f(indices, indexType, polygonSize, faceIndex);
+            }
+        };
+
+        if (!elementSize(faces, data, reader).has_value()) {
+            return nullptr;
+        }
+
+        const auto indicesList =
+            std::find_if(faces.properties.begin(),
+                         faces.properties.end(),
+                         [](const ply::Property& p) {
+                             return p.countType.has_value() &&
+                                    (p.name == "vertex_indices" ||
+                                     p.name == "vertex_index");
+                         });
+        const auto faceIndices =
+            std::find_if(faces.properties.begin(),
+                         faces.properties.end(),
+                         [](const ply::Property& p) {
+                             return !p.countType.has_value() &&
+                                    p.name == "face_indices";
+                         });
+        if (indicesList == faces.properties.end() ||
+            !isIntegral(indicesList->type) ||
+            (faceIndices != faces.properties.end() &&
+             !isIntegral(faceIndices->type)))
+        {
+            return nullptr;
+        }
+
+        std::uint64_t trianglesCount = 0;
+        forEachFace([&trianglesCount](const std::byte*,
+                                      const ply::Type,
+                                      const std::size_t polygonSize,
+                                      const std::int64_t) {
+            trianglesCount += polygonSize > 2 ? polygonSize - 2 : 0;
+        });
+        if (trianglesCount > std::numeric_limits<unsigned>::max()) {
+            return nullptr;
+        }
+
+        const auto mesh = std::make_shared<TriangleMesh>(
+            static_cast<unsigned>(trianglesCount),
+            verticesCount,
+            attributes,
+            nullptr,
+            nullptr);
+
+        bool isValid = true;
+        std::size_t triangle = 0;
+        forEachFace([&](const std::byte* indices,
+                        const ply::Type indexType,
+                        const std::size_t polygonSize,
+                        const std::int64_t faceIndex) {
+            const auto indexAt = [&](const std::size_t v) {
+                const std::int64_t index =
+                    reader.readInteger(indices + v * sizeOf(indexType),
+                                       indexType);
+                isValid &= index >= 0 && index < verticesCount;
+                return isValid ? static_cast<std::uint32_t>(index) : 0u;
+            };
+
+            for (std::size_t v = 2; v < polygonSize; ++v) {
+                mesh->vertexIndices.set(3 * triangle, indexAt(0));
+                mesh->vertexIndices.set(3 * triangle + 1, indexAt(v - 1));
+                mesh->vertexIndices.set(3 * triangle + 2, indexAt(v));
+                if (attributes.faceIndices) {
+                    mesh->faceIndices[triangle] =
+                        static_cast<std::uint32_t>(faceIndex);
+                }
+                ++triangle;
+            }
+        });
+
+        return isValid ? mesh : nullptr;
+    }
+} // namespace idragnev::pbrt::shapes
\ No newline at end of file
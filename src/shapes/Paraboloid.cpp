@@ -1,6 +1,7 @@
 #include "pbrt/shapes/Paraboloid.hpp"
 #include "pbrt/core/geometry/Bounds3.hpp"
 #include "pbrt/core/EFloat.hpp"
+#include "pbrt/core/FastEFloat.hpp"
 #include "pbrt/core/transformations/Transformation.hpp"
 
 namespace idragnev::pbrt::shapes {
@@ -22,13 +23,20 @@ namespace idragnev::pbrt::shapes {
                         Point3f{radius, radius, zMax}};
     }
 
-    Optional<HitRecord> Paraboloid::intersect(const Ray& rayInWorldSpace,
-                                                   const bool) const {
-        return intersectImpl<Optional<HitRecord>>(
+    Optional<ShapeHit> Paraboloid::intersectHit(const Ray& rayInWorldSpace,
+                                                const bool) const {
+        return intersectImpl<Optional<ShapeHit>>(
             rayInWorldSpace,
             pbrt::nullopt,
-            [this](const auto&... args) {
-                return pbrt::make_optional(makeHitRecord(args...));
+            [](const RayWithErrorBound& rayWithErrBound,
+               const Point3f& hitPoint,
+               const EFloat& t) {
+                ShapeHit hit;
+                hit.t = static_cast<Float>(t);
+                hit.pObject = hitPoint;
+                hit.pError = computeHitPointError(rayWithErrBound, t);
+                hit.phi = computePhi(hitPoint);
+                return pbrt::make_optional(hit);
             });
     }
 
@@ -65,35 +73,35 @@ namespace idragnev::pbrt::shapes {
         }
 
         auto hitPoint = ray(static_cast<Float>(tHit));
-        auto phi = computePhi(hitPoint);
-        if (hitPoint.z < zMin || hitPoint.z > zMax || phi > phiMax) {
+        if (isClipped(hitPoint)) {
             if (tHit == t1 || t1.upperBound() > ray.tMax) {
                 return failure;
             }
 
             tHit = t1;
             hitPoint = ray(static_cast<Float>(tHit));
-            phi = computePhi(hitPoint);
-            if (hitPoint.z < zMin || hitPoint.z > zMax || phi > phiMax) {
+            if (isClipped(hitPoint)) {
                 return failure;
             }
         }
 
-        return success(rayWithErrBound, hitPoint, tHit, phi);
+        return success(rayWithErrBound, hitPoint, tHit);
     }
 
-    Optional<QuadraticRoots>
-    Paraboloid::findIntersectionParams(const Ray& ray,
-                                       const Vector3f& oErr,
-                                       const Vector3f& dErr) const {
-        const auto ox = EFloat(ray.o.x, oErr.x);
-        const auto oy = EFloat(ray.o.y, oErr.y);
-        const auto oz = EFloat(ray.o.z, oErr.z);
-        const auto dx = EFloat(ray.d.x, dErr.x);
-        const auto dy = EFloat(ray.d.y, dErr.y);
-        const auto dz = EFloat(ray.d.z, dErr.z);
-
-        const auto k = EFloat(zMax) / (EFloat(radius) * EFloat(radius));
+    // will be instantiated only in this translation unit
+    // so it is fine to define it here
+    template <typename EFloatT>
+    auto Paraboloid::solveIntersectionEquation(const Ray& ray,
+                                               const Vector3f& oErr,
+                                               const Vector3f& dErr) const {
+        const auto ox = EFloatT(ray.o.x, oErr.x);
+        const auto oy = EFloatT(ray.o.y, oErr.y);
+        const auto oz = EFloatT(ray.o.z, oErr.z);
+        const auto dx = EFloatT(ray.d.x, dErr.x);
+        const auto dy = EFloatT(ray.d.y, dErr.y);
+        const auto dz = EFloatT(ray.d.z, dErr.z);
+
+        const auto k = EFloatT(zMax) / (EFloatT(radius) * EFloatT(radius));
         const auto a = k * (dx * dx + dy * dy);
         const auto b = 2 * k * (dx * ox + dy * oy) - dz;
         const auto c = k * (ox * ox + oy * oy) - oz;
@@ -101,16 +109,34 @@ namespace idragnev::pbrt::shapes {
         return solveQuadratic(a, b, c);
     }
 
+    Optional<QuadraticRoots>
+    Paraboloid::findIntersectionParams(const Ray& ray,
+                                       const Vector3f& oErr,
+                                       const Vector3f& dErr) const {
+        const FastQuadraticRoots fast =
+            solveIntersectionEquation<FastEFloat>(ray, oErr, dErr);
+        return fast.isAmbiguous
+                   ? solveIntersectionEquation<EFloat>(ray, oErr, dErr)
+                   : fast.roots;
+    }
+
+    bool Paraboloid::isClipped(const Point3f& hitPoint) const {
+        return hitPoint.z < zMin || hitPoint.z > zMax ||
+               (phiMax < 2 * math::constants::Pi &&
+                computePhi(hitPoint) > phiMax);
+    }
+
     Float Paraboloid::computePhi(const Point3f& hitPoint) {
         const Float phi = std::atan2(hitPoint.y, hitPoint.x);
         return phi < 0.f ? (phi + 2 * math::constants::Pi) : phi;
     }
 
-    HitRecord
-    Paraboloid::makeHitRecord(const RayWithErrorBound& rayWithErrBound,
-                              const Point3f& hitPoint,
-                              const EFloat& t,
-                              const Float phi) const {
+    SurfaceInteraction
+    Paraboloid::computeInteraction(const Ray& rayInWorldSpace,
+                                   const ShapeHit& hit) const {
+        const Point3f& hitPoint = hit.pObject;
+        const Float phi = hit.phi;
+
         const auto dpdu =
             Vector3f(-phiMax * hitPoint.y, phiMax * hitPoint.x, 0.f);
         const auto dpdv =
@@ -142,34 +168,27 @@ namespace idragnev::pbrt::shapes {
         const auto dndv = Normal3f{(g * F - f * G) * invEGF2 * dpdu +
                                    (f * F - g * E) * invEGF2 * dpdv};
 
-        const auto pError = computeHitPointError(rayWithErrBound, t);
-
-        const auto& ray = rayWithErrBound.ray;
-        const auto wo = -ray.d;
+        const auto wo = -(*worldToObjectTransform)(rayInWorldSpace.d);
         const Float u = phi / phiMax;
         const Float v = (hitPoint.z - zMin) / (zMax - zMin);
 
         const auto interaction = SurfaceInteraction{hitPoint,
-                                                    pError,
+                                                    hit.pError,
                                                     Point2f{u, v},
                                                     wo,
                                                     dpdu,
                                                     dpdv,
                                                     dndu,
                                                     dndv,
-                                                    ray.time,
+                                                    rayInWorldSpace.time,
                                                     this};
 
-        HitRecord result;
-        result.interaction = (*objectToWorldTransform)(interaction);
-        result.t = static_cast<Float>(t);
-
-        return result;
+        return (*objectToWorldTransform)(interaction);
     }
 
     Vector3f
     Paraboloid::computeHitPointError(const RayWithErrorBound& rayWithErrBound,
-                                     const EFloat& t) const {
+                                     const EFloat& t) {
         const auto& [ray, oErr, dErr] = rayWithErrBound;
 
         const auto ox = EFloat(ray.o.x, oErr.x);
@@ -2,6 +2,7 @@
 #include "pbrt/core/geometry/Bounds3.hpp"
 #include "pbrt/core/transformations/Transformation.hpp"
 #include "pbrt/core/EFloat.hpp"
+#include "pbrt/core/FastEFloat.hpp"
 #include "pbrt/core/math/Math.hpp"
 
 namespace idragnev::pbrt::shapes {
@@ -25,13 +26,17 @@ namespace idragnev::pbrt::shapes {
                         Point3f{radius, radius, zMax}};
     }
 
-    Optional<HitRecord> Sphere::intersect(const Ray& rayInWorldSpace,
-                                               const bool) const {
-        return intersectImpl<Optional<HitRecord>>(
+    Optional<ShapeHit> Sphere::intersectHit(const Ray& rayInWorldSpace,
+                                            const bool) const {
+        return intersectImpl<Optional<ShapeHit>>(
             rayInWorldSpace,
             pbrt::nullopt,
-            [this](const auto&... args) {
-                return pbrt::make_optional(makeHitRecord(args...));
+            [](const Ray&, const Point3f& hitPoint, const EFloat& t) {
+                ShapeHit hit;
+                hit.t = static_cast<Float>(t);
+                hit.pObject = hitPoint;
+                hit.phi = computePhi(hitPoint);
+                return pbrt::make_optional(hit);
             });
     }
 
@@ -68,48 +73,65 @@ namespace idragnev::pbrt::shapes {
             }
         }
 
-        const auto liesInZClippedArea = [this](const Point3f& hitPoint) {
-            return (zMin > -radius && hitPoint.z < zMin) ||
-                   (zMax < radius && hitPoint.z > zMax);
-        };
-
         auto hitPoint = computeHitPoint(ray, tShapeHit);
-        auto phi = computePhi(hitPoint);
-        if (liesInZClippedArea(hitPoint) || phi > phiMax) {
+        if (isClipped(hitPoint)) {
             if (tShapeHit == t1 || t1.upperBound() > ray.tMax) {
                 return failure;
             }
 
             tShapeHit = t1;
             hitPoint = computeHitPoint(ray, tShapeHit);
-            phi = computePhi(hitPoint);
-            if (liesInZClippedArea(hitPoint) || phi > phiMax) {
+            if (isClipped(hitPoint)) {
                 return failure;
             }
         }
 
-        return success(ray, hitPoint, tShapeHit, phi);
+        return success(ray, hitPoint, tShapeHit);
     }
 
-    Optional<QuadraticRoots>
-    Sphere::findIntersectionParams(const Ray& ray,
-                                   const Vector3f& oErr,
-                                   const Vector3f& dErr) const {
-        const auto ox = EFloat(ray.o.x, oErr.x);
-        const auto oy = EFloat(ray.o.y, oErr.y);
-        const auto oz = EFloat(ray.o.z, oErr.z);
-        const auto dx = EFloat(ray.d.x, dErr.x);
-        const auto dy = EFloat(ray.d.y, dErr.y);
-        const auto dz = EFloat(ray.d.z, dErr.z);
+    // will be instantiated only in this translation unit
+    // so it is fine to define it here
+    template <typename EFloatT>
+    auto Sphere::solveIntersectionEquation(const Ray& ray,
+                                           const Vector3f& oErr,
+                                           const Vector3f& dErr) const {
+        const auto ox = EFloatT(ray.o.x, oErr.x);
+        const auto oy = EFloatT(ray.o.y, oErr.y);
+        const auto oz = EFloatT(ray.o.z, oErr.z);
+        const auto dx = EFloatT(ray.d.x, dErr.x);
+        const auto dy = EFloatT(ray.d.y, dErr.y);
+        const auto dz = EFloatT(ray.d.z, dErr.z);
 
         const auto a = dx * dx + dy * dy + dz * dz;
         const auto b = 2.f * (dx * ox + dy * oy + dz * oz);
         const auto c =
-            ox * ox + oy * oy + oz * oz - EFloat(radius) * EFloat(radius);
+            ox * ox + oy * oy + oz * oz - EFloatT(radius) * EFloatT(radius);
 
         return solveQuadratic(a, b, c);
     }
 
+    // Solves in plain floats first and falls back to EFloat only when
+    // the float error bounds cannot settle the roots
+    Optional<QuadraticRoots>
+    Sphere::findIntersectionParams(const Ray& ray,
+                                   const Vector3f& oErr,
+                                   const Vector3f& dErr) const {
+        const FastQuadraticRoots fast =
+            solveIntersectionEquation<FastEFloat>(ray, oErr, dErr);
+        return fast.isAmbiguous
+                   ? solveIntersectionEquation<EFloat>(ray, oErr, dErr)
+                   : fast.roots;
+    }
+
+    // The angle of the hit point is needed only when
+    // the sphere does not sweep a full circle
+    bool Sphere::isClipped(const Point3f& hitPoint) const {
+        return (zMin > -radius && hitPoint.z < zMin) ||
+               (zMax < radius && hitPoint.z > zMax) ||
+               (phiMax < 2 * math::constants::Pi &&
+                computePhi(hitPoint) > phiMax);
+    }
+
     Float Sphere::computePhi(const Point3f& hitPoint) {
         const Float phi = std::atan2(hitPoint.y, hitPoint.x);
         return phi < 0.f ? (phi + 2 * math::constants::Pi) : phi;
@@ -125,10 +147,12 @@ namespace idragnev::pbrt::shapes {
         return p;
     }
 
-    HitRecord Sphere::makeHitRecord(const Ray& ray,
-                                    const Point3f& hitPoint,
-                                    const EFloat& tShapeHit,
-                                    const Float phi) const {
+    SurfaceInteraction
+    Sphere::computeInteraction(const Ray& rayInWorldSpace,
+                               const ShapeHit& hit) const {
+        const Point3f& hitPoint = hit.pObject;
+        const Float phi = hit.phi;
+
         const Float theta = std::acos(clamp(hitPoint.z / radius, -1.f, 1.f));
         const Float u = phi / phiMax;
         const Float v = (theta - thetaMin) / (thetaMax - thetaMin);
@@ -167,7 +191,7 @@ namespace idragnev::pbrt::shapes {
 
         const Vector3f pError = gamma(5) * abs(Vector3f{hitPoint});
 
-        const auto wo = -ray.d;
+        const auto wo = -(*worldToObjectTransform)(rayInWorldSpace.d);
 
         const auto interaction = SurfaceInteraction{hitPoint,
                                                     pError,
@@ -177,13 +201,10 @@ namespace idragnev::pbrt::shapes {
                                                     dpdv,
                                                     dndu,
                                                     dndv,
-                                                    ray.time,
+                                                    rayInWorldSpace.time,
                                                     this};
 
-        auto result = HitRecord{};
-        result.t = static_cast<Float>(tShapeHit);
-        result.interaction = (*objectToWorldTransform)(interaction);
-        return result;
+        return (*objectToWorldTransform)(interaction);
     }
 
     Float Sphere::area() const { return phiMax * radius * (zMax - zMin); }
@@ -9,21 +9,114 @@
 #include "pbrt/functional/Functional.hpp"
 #include "pbrt/core/geometry/Bounds3.hpp"
 
+#include <algorithm>
+#include <assert.h>
+#include <limits>
+#include <unordered_map>
+
 namespace idragnev::pbrt::shapes {
+    struct RayCoordinateSpaceVertices
+    {
+        Point3f p0;
+        Point3f p1;
+        Point3f p2;
+        Float sz;
+    };
+
+    // shears only the x and y dimensions
+    RayCoordinateSpaceVertices verticesInRayCoordinateSpace(const Ray& ray,
+                                                            Point3f p0,
+                                                            Point3f p1,
+                                                            Point3f p2);
+    std::array<Float, 3> edgeFunctionValues(const Point3f& p0,
+                                            const Point3f& p1,
+                                            const Point3f& p2);
+
+    OctahedralVector encodeOctahedral(const Vector3f& v) noexcept;
+    Vector3f decodeOctahedral(const OctahedralVector& v) noexcept;
+    // Maps [-1, 1] to the 16-bit integers
+    std::uint16_t quantizeSignedUnit(const Float x) noexcept;
+    // Folds the lower hemisphere of the octahedron over the upper one
+    std::pair<Float, Float> foldOctahedron(const Float x, const Float y);
+
+    static_assert(sizeof(Triangle) <= sizeof(Shape) + 16);
+
+    TriangleVertexIndices::TriangleVertexIndices(
+        std::vector<std::uint32_t> indices,
+        const std::size_t verticesCount) {
+        assert(std::all_of(indices.begin(),
+                           indices.end(),
+                           [verticesCount](const std::uint32_t i) {
+                               return i < verticesCount;
+                           }));
+
+        if (verticesCount <= (std::size_t{1} << 16)) {
+            this->indices16.assign(indices.begin(), indices.end());
+        }
+        else {
+            this->indices32 = std::move(indices);
+        }
+    }
+
+    TriangleVertexIndices::TriangleVertexIndices(
+        const std::size_t indicesCount,
+        const std::size_t verticesCount) {
+        if (verticesCount <= (std::size_t{1} << 16)) {
+            this->indices16.resize(indicesCount);
+        }
+        else {
+            this->indices32.resize(indicesCount);
+        }
+    }
+
+    void TriangleVertexIndices::set(const std::size_t i,
+                                    const std::uint32_t index) noexcept {
+        if (!this->indices16.empty()) {
+            this->indices16[i] = static_cast<std::uint16_t>(index);
+        }
+        else {
+            this->indices32[i] = index;
+        }
+    }
+
+    std::array<std::uint32_t, 3> TriangleVertexIndices::ofTriangle(
+        const std::uint32_t triangle) const noexcept {
+        const std::size_t first = 3 * static_cast<std::size_t>(triangle);
+        if (!this->indices16.empty()) {
+            return {this->indices16[first],
+                    this->indices16[first + 1],
+                    this->indices16[first + 2]};
+        }
+        else {
+            return {this->indices32[first],
+                    this->indices32[first + 1],
+                    this->indices32[first + 2]};
+        }
+    }
+
+    std::size_t TriangleVertexIndices::size() const noexcept {
+        return this->indices16.size() + this->indices32.size();
+    }
+
+    std::size_t TriangleVertexIndices::bytesPerIndex() const noexcept {
+        return this->indices16.empty() ? sizeof(std::uint32_t)
+                                       : sizeof(std::uint16_t);
+    }
+
     TriangleMesh::TriangleMesh(
         const Transformation& objectToWorld,
         const unsigned trianglesCount,
-        const std::vector<std::size_t>& vertexIndices,
+        std::vector<std::uint32_t> vertexIndices,
         const std::vector<Point3f>& vertexCoordinates,
         const std::vector<Vector3f>& vertexTangentVectors,
         const std::vector<Normal3f>& vertexNormalVectors,
         const std::vector<Point2f>& vertexUVs,
         std::shared_ptr<const Texture<Float>> alphaMask,
         std::shared_ptr<const Texture<Float>> shadowAlphaMask,
-        const std::vector<std::size_t>& faceIndices)
+        std::vector<std::uint32_t> faceIndices)
         : trianglesCount(trianglesCount)
         , verticesCount(static_cast<unsigned>(vertexCoordinates.size()))
-        , vertexIndices(vertexIndices)
+        , vertexIndices(std::move(vertexIndices), vertexCoordinates.size())
         , vertexWorldCoordinates(functional::fmap(
               vertexCoordinates,
               [&objectToWorld](const Point3f& p) { return objectToWorld(p); }))
@@ -36,21 +129,269 @@ namespace idragnev::pbrt::shapes {
         , vertexUVs(vertexUVs)
         , alphaMask(std::move(alphaMask))
         , shadowAlphaMask(std::move(shadowAlphaMask))
-        , faceIndices(faceIndices) {}
+        , faceIndices(std::move(faceIndices)) {
+        assert(this->vertexIndices.size() == 3ull * trianglesCount);
+    }
+
+    TriangleMesh::TriangleMesh(
+        const unsigned trianglesCount,
+        const unsigned verticesCount,
+        const TriangleMeshAttributes& attributes,
+        std::shared_ptr<const Texture<Float>> alphaMask,
+        std::shared_ptr<const Texture<Float>> shadowAlphaMask)
+        : trianglesCount(trianglesCount)
+        , verticesCount(verticesCount)
+        , vertexIndices(3ull * trianglesCount, verticesCount)
+        , vertexWorldCoordinates(verticesCount)
+        , vertexNormalVectors(attributes.normals ? verticesCount : 0)
+        , vertexUVs(attributes.uvs ? verticesCount : 0)
+        , alphaMask(std::move(alphaMask))
+        , shadowAlphaMask(std::move(shadowAlphaMask))
+        , faceIndices(attributes.faceIndices ? trianglesCount : 0) {}
+
+    std::uint32_t
+    TriangleMesh::faceIndex(const std::uint32_t triangle) const noexcept {
+        return this->faceIndices.empty() ? 0 : this->faceIndices[triangle];
+    }
+
+    void TriangleMesh::quantizeVertexAttributes() {
+        using pbrt::constants::Infinity;
+
+        if (this->isQuantized) {
+            return;
+        }
+
+        const auto encode = [](const auto& vectors) {
+            return functional::fmap(vectors, [](const auto& v) {
+                return encodeOctahedral(Vector3f(v));
+            });
+        };
+        this->quantizedNormals = encode(this->vertexNormalVectors);
+        this->quantizedTangentVectors = encode(this->vertexTangentVectors);
+
+        constexpr Float maxQuantized = 65535.f;
+        std::array<Float, 2> uvMax = {};
+        if (!this->vertexUVs.empty()) {
+            this->uvOrigin = {Infinity, Infinity};
+            uvMax = {-Infinity, -Infinity};
+        }
+        for (const Point2f& uv : this->vertexUVs) {
+            for (std::size_t i = 0; i < 2; ++i) {
+                this->uvOrigin[i] = std::min(this->uvOrigin[i], uv[i]);
+                uvMax[i] = std::max(uvMax[i], uv[i]);
+            }
+        }
+        for (std::size_t i = 0; i < 2; ++i) {
+            this->uvScale[i] = (uvMax[i] - this->uvOrigin[i]) / maxQuantized;
+        }
+        this->quantizedUVs = functional::fmap(
+            this->vertexUVs,
+            [this, maxQuantized](const Point2f& uv) {
+                std::array<std::uint16_t, 2> result = {};
+                for (std::size_t i = 0; i < 2; ++i) {
+                    if (this->uvScale[i] > 0.f) {
+                        const Float q =
+                            (uv[i] - this->uvOrigin[i]) / this->uvScale[i];
+                        result[i] = static_cast<std::uint16_t>(
+                            std::round(clamp(q, 0.f, maxQuantized)));
+                    }
+                }
+                return result;
+            });
+
+        // release the exact attributes
+        this->vertexNormalVectors = std::vector<Normal3f>{};
+        this->vertexTangentVectors = std::vector<Vector3f>{};
+        this->vertexUVs = std::vector<Point2f>{};
+        this->isQuantized = true;
+    }
+
+    void TriangleMesh::reorder(
+        const std::span<const std::uint32_t> triangleOrder) {
+        constexpr auto none = std::numeric_limits<std::uint32_t>::max();
+
+        // the new numbers by the current ones and vice versa
+        std::vector<std::uint32_t> newTriangles(this->trianglesCount, none);
+        std::vector<std::uint32_t> oldTriangles;
+        oldTriangles.reserve(this->trianglesCount);
+        const auto renumberTriangle = [&](const std::uint32_t triangle) {
+            if (newTriangles[triangle] == none) {
+                newTriangles[triangle] =
+                    static_cast<std::uint32_t>(oldTriangles.size());
+                oldTriangles.push_back(triangle);
+            }
+        };
+        for (const std::uint32_t triangle : triangleOrder) {
+            assert(triangle < this->trianglesCount);
+            renumberTriangle(triangle);
+        }
+        for (std::uint32_t triangle = 0; triangle < this->trianglesCount;
+             ++triangle)
+        {
+            renumberTriangle(triangle);
+        }
+
+        std::vector<std::uint32_t> newVertices(this->verticesCount, none);
+        std::vector<std::uint32_t> oldVertices;
+        oldVertices.reserve(this->verticesCount);
+        const auto renumberVertex = [&](const std::uint32_t vertex) {
+            if (newVertices[vertex] == none) {
+                newVertices[vertex] =
+                    static_cast<std::uint32_t>(oldVertices.size());
+                oldVertices.push_back(vertex);
+            }
+        };
+        for (const std::uint32_t triangle : oldTriangles) {
+            for (const std::uint32_t vertex :
+                 this->vertexIndices.ofTriangle(triangle))
+            {
+                renumberVertex(vertex);
+            }
+        }
+        for (std::uint32_t vertex = 0; vertex < this->verticesCount; ++vertex)
+        {
+            renumberVertex(vertex);
+        }
+
+        auto indices = TriangleVertexIndices{this->vertexIndices.size(),
+                                             this->verticesCount};
+        for (std::size_t i = 0; i < oldTriangles.size(); ++i) {
+            const auto vertices =
+                this->vertexIndices.ofTriangle(oldTriangles[i]);
+            for (std::size_t j = 0; j < 3; ++j) {
+                indices.set(3 * i + j, newVertices[vertices[j]]);
+            }
+        }
+        this->vertexIndices = std::move(indices);
+
+        const auto permute = [](auto& values,
+                                const std::vector<std::uint32_t>& oldIndices) {
+            if (!values.empty()) {
+                auto permuted = values;
+                for (std::size_t i = 0; i < oldIndices.size(); ++i) {
+                    permuted[i] = values[oldIndices[i]];
+                }
+                values = std::move(permuted);
+            }
+        };
+        permute(this->vertexWorldCoordinates, oldVertices);
+        permute(this->vertexNormalVectors, oldVertices);
+        permute(this->vertexTangentVectors, oldVertices);
+        permute(this->vertexUVs, oldVertices);
+        permute(this->quantizedNormals, oldVertices);
+        permute(this->quantizedTangentVectors, oldVertices);
+        permute(this->quantizedUVs, oldVertices);
+        permute(this->faceIndices, oldTriangles);
+
+        for (Triangle& triangle : this->triangles) {
+            triangle.number = newTriangles[triangle.number];
+        }
+    }
+
+    std::size_t TriangleMesh::memoryUsage() const noexcept {
+        const auto bytesOf = [](const auto& v) {
+            return v.size() * sizeof(v[0]);
+        };
+
+        return sizeof(TriangleMesh) +
+               this->vertexIndices.size() *
+                   this->vertexIndices.bytesPerIndex() +
+               bytesOf(this->vertexWorldCoordinates) +
+               bytesOf(this->vertexNormalVectors) +
+               bytesOf(this->vertexTangentVectors) + bytesOf(this->vertexUVs) +
+               bytesOf(this->quantizedNormals) +
+               bytesOf(this->quantizedTangentVectors) +
+               bytesOf(this->quantizedUVs) + bytesOf(this->faceIndices) +
+               bytesOf(this->triangles);
+    }
+
+    bool TriangleMesh::hasNormals() const noexcept {
+        return this->isQuantized ? !this->quantizedNormals.empty()
+                                 : !this->vertexNormalVectors.empty();
+    }
+
+    bool TriangleMesh::hasTangentVectors() const noexcept {
+        return this->isQuantized ? !this->quantizedTangentVectors.empty()
+                                 : !this->vertexTangentVectors.empty();
+    }
+
+    bool TriangleMesh::hasUVs() const noexcept {
+        return this->isQuantized ? !this->quantizedUVs.empty()
+                                 : !this->vertexUVs.empty();
+    }
+
+    Normal3f
+    TriangleMesh::vertexNormal(const std::uint32_t vertex) const noexcept {
+        return this->isQuantized
+                   ? Normal3f(decodeOctahedral(this->quantizedNormals[vertex]))
+                   : this->vertexNormalVectors[vertex];
+    }
+
+    Vector3f TriangleMesh::vertexTangentVector(
+        const std::uint32_t vertex) const noexcept {
+        return this->isQuantized
+                   ? decodeOctahedral(this->quantizedTangentVectors[vertex])
+                   : this->vertexTangentVectors[vertex];
+    }
+
+    Point2f TriangleMesh::vertexUV(const std::uint32_t vertex) const noexcept {
+        if (!this->isQuantized) {
+            return this->vertexUVs[vertex];
+        }
+
+        const auto& [u, v] = this->quantizedUVs[vertex];
+        return Point2f{this->uvOrigin[0] + u * this->uvScale[0],
+                       this->uvOrigin[1] + v * this->uvScale[1]};
+    }
+
+    OctahedralVector encodeOctahedral(const Vector3f& v) noexcept {
+        const Float l1Norm = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        if (l1Norm == 0.f) {
+            return encodeOctahedral(Vector3f{0.f, 0.f, 1.f});
+        }
+
+        Float x = v.x / l1Norm;
+        Float y = v.y / l1Norm;
+        if (v.z < 0.f) {
+            std::tie(x, y) = foldOctahedron(x, y);
+        }
+
+        return OctahedralVector{
+            .x = quantizeSignedUnit(x),
+            .y = quantizeSignedUnit(y),
+        };
+    }
+
+    Vector3f decodeOctahedral(const OctahedralVector& v) noexcept {
+        constexpr Float maxQuantized = 65535.f;
+        Float x = -1.f + 2.f * (v.x / maxQuantized);
+        Float y = -1.f + 2.f * (v.y / maxQuantized);
+        const Float z = 1.f - std::abs(x) - std::abs(y);
+        if (z < 0.f) {
+            std::tie(x, y) = foldOctahedron(x, y);
+        }
+
+        return normalize(Vector3f{x, y, z});
+    }
+
+    std::pair<Float, Float> foldOctahedron(const Float x, const Float y) {
+        return {(1.f - std::abs(y)) * std::copysign(Float(1), x),
+                (1.f - std::abs(x)) * std::copysign(Float(1), y)};
+    }
+
+    std::uint16_t quantizeSignedUnit(const Float x) noexcept {
+        const Float unit = clamp((x + 1.f) / 2.f, 0.f, 1.f);
+        return static_cast<std::uint16_t>(std::round(unit * 65535.f));
+    }
 
     Triangle::Triangle(const Transformation& objectToWorld,
                        const Transformation& worldToObject,
                        const bool reverseOrientaton,
-                       std::shared_ptr<const TriangleMesh> parentMesh,
-                       const unsigned number)
+                       const TriangleMesh& parentMesh,
+                       const std::uint32_t number)
         : Shape(objectToWorld, worldToObject, reverseOrientaton)
-        , parentMesh(std::move(parentMesh))
-        // unsafe: assumes that parentMesh->vertexIndices will not change
-        // after construction
-        , firstVertexIndexAddress(&parentMesh->vertexIndices[3ull * number])
-        , faceIndex(parentMesh->faceIndices.size() > 0
-                        ? parentMesh->faceIndices[number]
-                        : 0) {}
+        , number(number)
+        , parentMesh(&parentMesh) {}
 
     Bounds3f Triangle::objectBound() const {
         const auto [p0, p1, p2] = verticesCoordinates();
@@ -66,10 +407,14 @@ namespace idragnev::pbrt::shapes {
         return unionOf(Bounds3f{p0, p1}, p2);
     }
 
+    std::array<std::uint32_t, 3> Triangle::vertexIndices() const noexcept {
+        return parentMesh->vertexIndices.ofTriangle(number);
+    }
+
     std::tuple<const Point3f&, const Point3f&, const Point3f&>
     Triangle::verticesCoordinates() const {
         const auto& vertexWorldCoordinates = parentMesh->vertexWorldCoordinates;
-        const auto* const indices = firstVertexIndexAddress;
+        const auto indices = vertexIndices();
 
         const Point3f& p0 = vertexWorldCoordinates[indices[0]];
         const Point3f& p1 = vertexWorldCoordinates[indices[1]];
@@ -79,53 +424,153 @@ namespace idragnev::pbrt::shapes {
     }
 
     std::array<Point2f, 3> Triangle::verticesUVs() const {
-        const auto& uvs = parentMesh->vertexUVs;
-        if (!uvs.empty()) {
-            const auto* const indices = firstVertexIndexAddress;
-            return {uvs[indices[0]], uvs[indices[1]], uvs[indices[2]]};
+        if (parentMesh->hasUVs()) {
+            const auto indices = vertexIndices();
+            return {parentMesh->vertexUV(indices[0]),
+                    parentMesh->vertexUV(indices[1]),
+                    parentMesh->vertexUV(indices[2])};
         }
         else {
             return {Point2f(0, 0), Point2f(1, 0), Point2f(1, 1)};
         }
     }
 
-    Optional<HitRecord>
-    Triangle::intersect(const Ray& ray, const bool testAlphaTexture) const {
-        return intersectImpl<Optional<HitRecord>>(
-            ray,
-            testAlphaTexture,
-            pbrt::nullopt,
-            [this](const auto&... args) {
-                return pbrt::make_optional(makeHitRecord(args...));
-            });
+    // Finds the hit without the partial derivatives and the shading
+    // geometry, which only alpha masks need before the closest hit
+    // is known
+    Optional<ShapeHit>
+    Triangle::intersectHit(const Ray& ray, const bool testAlphaTexture) const {
+        const auto [p0, p1, p2] = verticesCoordinates();
+
+        const Optional<TriangleHit> hit = intersectTriangle(ray, p0, p1, p2);
+        if (!hit.has_value()) {
+            return pbrt::nullopt;
+        }
+
+        if (testAlphaTexture && parentMesh->alphaMask != nullptr) {
+            if (!passesAlphaTest(ray, hit.value())) {
+                return pbrt::nullopt;
+            }
+        }
+        else if (isDegenerate()) {
+            return pbrt::nullopt;
+        }
+
+        return pbrt::make_optional(toShapeHit(hit.value()));
     }
 
+    // The same test as intersectHit without building the hit
+    // and fetching the vertices again for the degeneracy check
     bool Triangle::intersectP(const Ray& ray,
                               const bool testAlphaTexture) const {
-        return intersectImpl<bool>(ray,
-                                   testAlphaTexture,
-                                   false,
-                                   [](const auto&...) { return true; });
-    }
-
-    // will be instantiated only in this translation unit
-    // so it is fine to define it here
-    template <typename R, typename S, typename F>
-    R Triangle::intersectImpl(const Ray& ray,
-                              const bool testAlphaTexture,
-                              F failure,
-                              S success) const {
-        auto [p0t, p1t, p2t, sz] = verticesInRayCoordinateSpace(ray);
+        const auto [p0, p1, p2] = verticesCoordinates();
+
+        const Optional<TriangleHit> hit = intersectTriangle(ray, p0, p1, p2);
+        if (!hit.has_value()) {
+            return false;
+        }
+
+        if (testAlphaTexture && parentMesh->alphaMask != nullptr) {
+            return passesAlphaTest(ray, hit.value());
+        }
+
+        return cross(p2 - p0, p1 - p0).lengthSquared() != 0.f;
+    }
+
+    // Degenerate triangles have no partial derivatives
+    // and never pass the test.
+    bool Triangle::passesAlphaTest(const Ray& ray,
+                                   const TriangleHit& hit) const {
+        const auto partialDerivatives = computePartialDerivatives();
+        if (!partialDerivatives.has_value()) {
+            return false;
+        }
+
+        const auto [p0, p1, p2] = verticesCoordinates();
+        const auto& b = hit.barycentric;
+        const std::array<Point2f, 3> uv = verticesUVs();
+        const Point3f pHit = b[0] * p0 + b[1] * p1 + b[2] * p2;
+        const Point2f uvHit = b[0] * uv[0] + b[1] * uv[1] + b[2] * uv[2];
+
+        const auto localIsect = SurfaceInteraction{pHit,
+                                                   Vector3f::zero(),
+                                                   uvHit,
+                                                   -ray.d,
+                                                   partialDerivatives->dpdu,
+                                                   partialDerivatives->dpdv,
+                                                   Normal3f::zero(),
+                                                   Normal3f::zero(),
+                                                   ray.time,
+                                                   this};
+
+        return parentMesh->alphaMask->evaluate(localIsect) != 0.f;
+    }
+
+    SurfaceInteraction Triangle::computeInteraction(const Ray& ray,
+                                                    const ShapeHit& hit) const {
+        const auto [p0, p1, p2] = verticesCoordinates();
+        const Float b0 = hit.barycentric[0];
+        const Float b1 = hit.barycentric[1];
+        const Float b2 = hit.barycentric[2];
+
+        // intersectHit rejects degenerate triangles
+        const auto partialDerivatives = computePartialDerivatives();
+        assert(partialDerivatives.has_value());
+
+        const Float xAbsSum =
+            (std::abs(b0 * p0.x) + std::abs(b1 * p1.x) + std::abs(b2 * p2.x));
+        const Float yAbsSum =
+            (std::abs(b0 * p0.y) + std::abs(b1 * p1.y) + std::abs(b2 * p2.y));
+        const Float zAbsSum =
+            (std::abs(b0 * p0.z) + std::abs(b1 * p1.z) + std::abs(b2 * p2.z));
+        const Vector3f pError = gamma(7) * Vector3f(xAbsSum, yAbsSum, zAbsSum);
+
+        const std::array<Point2f, 3> uv = verticesUVs();
+        const Point3f pHit = b0 * p0 + b1 * p1 + b2 * p2;
+        const Point2f uvHit = b0 * uv[0] + b1 * uv[1] + b2 * uv[2];
+
+        auto interaction = SurfaceInteraction{pHit,
+                                              pError,
+                                              uvHit,
+                                              -ray.d,
+                                              partialDerivatives->dpdu,
+                                              partialDerivatives->dpdv,
+                                              Normal3f::zero(),
+                                              Normal3f::zero(),
+                                              ray.time,
+                                              this,
+                                              parentMesh->faceIndex(number)};
+        setShadingGeometry(interaction, hit.barycentric);
+
+        return interaction;
+    }
+
+    ShapeHit toShapeHit(const TriangleHit& hit) noexcept {
+        ShapeHit result;
+        result.t = hit.t;
+        result.barycentric[0] = hit.barycentric[0];
+        result.barycentric[1] = hit.barycentric[1];
+        result.barycentric[2] = hit.barycentric[2];
+
+        return result;
+    }
+
+    Optional<TriangleHit> intersectTriangle(const Ray& ray,
+                                            const Point3f& p0,
+                                            const Point3f& p1,
+                                            const Point3f& p2) {
+        auto [p0t, p1t, p2t, sz] =
+            verticesInRayCoordinateSpace(ray, p0, p1, p2);
         const auto [e0, e1, e2] = edgeFunctionValues(p0t, p1t, p2t);
 
         if ((e0 < 0.f || e1 < 0.f || e2 < 0.f) &&
             (e0 > 0.f || e1 > 0.f || e2 > 0.f)) {
-            return failure;
+            return pbrt::nullopt;
         }
 
         const Float det = e0 + e1 + e2;
         if (det == 0.f) {
-            return failure;
+            return pbrt::nullopt;
         }
 
         p0t.z *= sz;
@@ -134,10 +579,10 @@ namespace idragnev::pbrt::shapes {
 
         const Float tScaled = e0 * p0t.z + e1 * p1t.z + e2 * p2t.z;
         if (det < 0 && (tScaled >= 0.f || tScaled < ray.tMax * det)) {
-            return failure;
+            return pbrt::nullopt;
         }
         else if (det > 0 && (tScaled <= 0.f || tScaled > ray.tMax * det)) {
-            return failure;
+            return pbrt::nullopt;
         }
 
         const Float invDet = 1.f / det;
@@ -163,64 +608,19 @@ namespace idragnev::pbrt::shapes {
             std::abs(invDet);
 
         if (t <= deltaT) {
-            return failure;
-        }
-
-        const auto partialDerivatives = computePartialDerivatives();
-        if (!partialDerivatives.has_value()) {
-            return failure;
-        }
-
-        const auto [p0, p1, p2] = verticesCoordinates();
-
-        const Float xAbsSum =
-            (std::abs(b0 * p0.x) + std::abs(b1 * p1.x) + std::abs(b2 * p2.x));
-        const Float yAbsSum =
-            (std::abs(b0 * p0.y) + std::abs(b1 * p1.y) + std::abs(b2 * p2.y));
-        const Float zAbsSum =
-            (std::abs(b0 * p0.z) + std::abs(b1 * p1.z) + std::abs(b2 * p2.z));
-        const Vector3f pError = gamma(7) * Vector3f(xAbsSum, yAbsSum, zAbsSum);
-
-        const std::array<Point2f, 3> uv = verticesUVs();
-        const Point3f pHit = b0 * p0 + b1 * p1 + b2 * p2;
-        const Point2f uvHit = b0 * uv[0] + b1 * uv[1] + b2 * uv[2];
-
-        if (testAlphaTexture && parentMesh->alphaMask != nullptr) {
-            const auto localIsect = SurfaceInteraction{pHit,
-                                                       Vector3f::zero(),
-                                                       uvHit,
-                                                       -ray.d,
-                                                       partialDerivatives->dpdu,
-                                                       partialDerivatives->dpdv,
-                                                       Normal3f::zero(),
-                                                       Normal3f::zero(),
-                                                       ray.time,
-                                                       this};
-            if (parentMesh->alphaMask->evaluate(localIsect) == 0.f) {
-                return failure;
-            }
+            return pbrt::nullopt;
         }
 
-        const Float barycentric[] = {b0, b1, b2};
-
-        return success(ray,
-                       t,
-                       pHit,
-                       pError,
-                       uvHit,
-                       partialDerivatives.value(),
-                       barycentric);
+        return pbrt::make_optional(TriangleHit{
+            .t = t,
+            .barycentric = {b0, b1, b2},
+        });
     }
 
-    Triangle::RayCoordinateSpaceVertices
-    Triangle::verticesInRayCoordinateSpace(const Ray& ray) const {
-        const auto& vertexWorldCoordinates = parentMesh->vertexWorldCoordinates;
-        const auto* const indices = firstVertexIndexAddress;
-
-        Point3f p0 = vertexWorldCoordinates[indices[0]];
-        Point3f p1 = vertexWorldCoordinates[indices[1]];
-        Point3f p2 = vertexWorldCoordinates[indices[2]];
-
+    RayCoordinateSpaceVertices verticesInRayCoordinateSpace(const Ray& ray,
+                                                            Point3f p0,
+                                                            Point3f p1,
+                                                            Point3f p2) {
         p0 -= Vector3f(ray.o);
         p1 -= Vector3f(ray.o);
         p2 -= Vector3f(ray.o);
@@ -256,9 +656,9 @@ namespace idragnev::pbrt::shapes {
         return result;
     }
 
-    std::array<Float, 3> Triangle::edgeFunctionValues(const Point3f& p0,
-                                                      const Point3f& p1,
-                                                      const Point3f& p2) {
+    std::array<Float, 3> edgeFunctionValues(const Point3f& p0,
+                                            const Point3f& p1,
+                                            const Point3f& p2) {
         Float e0 = p1.x * p2.y - p1.y * p2.x;
         Float e1 = p2.x * p0.y - p2.y * p0.x;
         Float e2 = p0.x * p1.y - p0.y * p1.x;
@@ -324,34 +724,6 @@ namespace idragnev::pbrt::shapes {
         return pbrt::make_optional(PartialDerivatives{dpdu, dpdv});
     }
 
-    HitRecord
-    Triangle::makeHitRecord(const Ray& ray,
-                            const Float t,
-                            const Point3f& hitPoint,
-                            const Vector3f& pError,
-                            const Point2f& hitPointUV,
-                            const PartialDerivatives& partialDerivatives,
-                            const Float bs[3]) const {
-        auto interaction = SurfaceInteraction{hitPoint,
-                                              pError,
-                                              hitPointUV,
-                                              -ray.d,
-                                              partialDerivatives.dpdu,
-                                              partialDerivatives.dpdv,
-                                              Normal3f::zero(),
-                                              Normal3f::zero(),
-                                              ray.time,
-                                              this,
-                                              faceIndex};
-        setShadingGeometry(interaction, bs);
-
-        HitRecord result;
-        result.interaction = interaction;
-        result.t = t;
-
-        return result;
-    }
-
     void Triangle::setShadingGeometry(SurfaceInteraction& interaction,
                                       const Float bs[3]) const {
         const auto [p0, p1, p2] = verticesCoordinates();
@@ -368,19 +740,21 @@ namespace idragnev::pbrt::shapes {
             interaction.shading.n = n;
         }
 
-        const auto& normals = parentMesh->vertexNormalVectors;
-        const auto& tangentVectors = parentMesh->vertexTangentVectors;
-
-        if (normals.empty() && tangentVectors.empty()) {
+        const bool hasNormals = parentMesh->hasNormals();
+        const bool hasTangentVectors = parentMesh->hasTangentVectors();
+        if (!hasNormals && !hasTangentVectors) {
             return;
         }
 
-        const auto* const indices = firstVertexIndexAddress;
+        const auto indices = vertexIndices();
 
+        std::array<Normal3f, 3> normals;
         Normal3f ns;
-        if (!normals.empty()) {
-            ns = (bs[0] * normals[indices[0]] + bs[1] * normals[indices[1]] +
-                  bs[2] * normals[indices[2]]);
+        if (hasNormals) {
+            for (std::size_t i = 0; i < 3; ++i) {
+                normals[i] = parentMesh->vertexNormal(indices[i]);
+            }
+            ns = bs[0] * normals[0] + bs[1] * normals[1] + bs[2] * normals[2];
 
             if (ns.lengthSquared() > 0.f) {
                 ns = normalize(ns);
@@ -394,10 +768,10 @@ namespace idragnev::pbrt::shapes {
         }
 
         Vector3f ss;
-        if (!tangentVectors.empty()) {
-            ss = (bs[0] * tangentVectors[indices[0]] +
-                  bs[1] * tangentVectors[indices[1]] +
-                  bs[2] * tangentVectors[indices[2]]);
+        if (hasTangentVectors) {
+            ss = (bs[0] * parentMesh->vertexTangentVector(indices[0]) +
+                  bs[1] * parentMesh->vertexTangentVector(indices[1]) +
+                  bs[2] * parentMesh->vertexTangentVector(indices[2]));
             if (ss.lengthSquared() > 0.f) {
                 ss = normalize(ss);
             }
@@ -426,13 +800,13 @@ namespace idragnev::pbrt::shapes {
 
         auto dndu = Normal3f::zero();
         auto dndv = Normal3f::zero();
-        if (!normals.empty()) {
+        if (hasNormals) {
             const std::array<Point2f, 3> uv = verticesUVs();
             const Vector2f duv02 = uv[0] - uv[2];
             const Vector2f duv12 = uv[1] - uv[2];
 
-            const Normal3f dn1 = normals[indices[0]] - normals[indices[2]];
-            const Normal3f dn2 = normals[indices[1]] - normals[indices[2]];
+            const Normal3f dn1 = normals[0] - normals[2];
+            const Normal3f dn2 = normals[1] - normals[2];
 
             const Float determinant = duv02[0] * duv12[1] - duv02[1] * duv12[0];
             const bool degenerateUV = std::abs(determinant) < 1e-8;
@@ -444,9 +818,8 @@ namespace idragnev::pbrt::shapes {
                 // (rather than giving up) so that ray differentials for
                 // rays reflected from triangles with degenerate
                 // parameterizations are still reasonable.
-                const Vector3f dn =
-                    cross(Vector3f(normals[indices[2]] - normals[indices[0]]),
-                          Vector3f(normals[indices[1]] - normals[indices[0]]));
+                const Vector3f dn = cross(Vector3f(normals[2] - normals[0]),
+                                          Vector3f(normals[1] - normals[0]));
                 if (dn.lengthSquared() == 0) {
                     dndu = Normal3f::zero();
                     dndv = Normal3f::zero();
@@ -473,39 +846,102 @@ namespace idragnev::pbrt::shapes {
         return 0.5f * cross(p1 - p0, p2 - p0).length();
     }
 
+    std::array<Point3f, 3> Triangle::worldVertices() const {
+        const auto [p0, p1, p2] = verticesCoordinates();
+
+        return {p0, p1, p2};
+    }
+
+    bool Triangle::hasAlphaMask() const noexcept {
+        return parentMesh->alphaMask != nullptr;
+    }
+
+    const TriangleMesh& Triangle::mesh() const noexcept { return *parentMesh; }
+
+    std::uint32_t Triangle::numberInMesh() const noexcept { return number; }
+
+    // Degenerate triangles have no partial derivatives
+    // and are never intersected.
+    bool Triangle::isDegenerate() const {
+        const auto [p0, p1, p2] = verticesCoordinates();
+
+        return cross(p2 - p0, p1 - p0).lengthSquared() == 0.f;
+    }
+
     std::vector<std::shared_ptr<Shape>>
     createTriangleMesh(const Transformation& objectToWorld,
                        const Transformation& worldToObject,
                        const bool reverseOrientation,
                        const unsigned trianglesCount,
-                       const std::vector<std::size_t>& vertexIndices,
+                       std::vector<std::uint32_t> vertexIndices,
                        const std::vector<Point3f>& vertexCoordinates,
                        const std::vector<Vector3f>& vertexTangentVectors,
                        const std::vector<Normal3f>& vertexNormalVectors,
                        const std::vector<Point2f>& vertexUVs,
                        std::shared_ptr<const Texture<Float>> alphaMask,
                        std::shared_ptr<const Texture<Float>> shadowAlphaMask,
-                       const std::vector<std::size_t>& faceIndices) {
-        using functional::IntegerRange;
+                       std::vector<std::uint32_t> faceIndices) {
         const auto mesh =
             std::make_shared<TriangleMesh>(objectToWorld,
                                            trianglesCount,
-                                           vertexIndices,
+                                           std::move(vertexIndices),
                                            vertexCoordinates,
                                            vertexTangentVectors,
                                            vertexNormalVectors,
                                            vertexUVs,
                                            std::move(alphaMask),
                                            std::move(shadowAlphaMask),
-                                           faceIndices);
+                                           std::move(faceIndices));
+
+        return createTriangles(mesh,
+                               objectToWorld,
+                               worldToObject,
+                               reverseOrientation);
+    }
+
+    void reorderTriangleMeshes(
+        const std::span<const Triangle* const> triangles,
+        const std::span<const std::shared_ptr<TriangleMesh>> meshes) {
+        std::unordered_map<const TriangleMesh*, std::vector<std::uint32_t>>
+            triangleOrders;
+        for (const auto& mesh : meshes) {
+            triangleOrders.emplace(mesh.get(), std::vector<std::uint32_t>{});
+        }
+        for (const Triangle* const triangle : triangles) {
+            if (const auto it = triangleOrders.find(&triangle->mesh());
+                it != triangleOrders.end())
+            {
+                it->second.push_back(triangle->numberInMesh());
+            }
+        }
+
+        for (const auto& mesh : meshes) {
+            mesh->reorder(triangleOrders[mesh.get()]);
+        }
+    }
+
+    std::vector<std::shared_ptr<Shape>>
+    createTriangles(const std::shared_ptr<TriangleMesh>& mesh,
+                    const Transformation& objectToWorld,
+                    const Transformation& worldToObject,
+                    const bool reverseOrientation) {
+        using functional::IntegerRange;
+        const unsigned trianglesCount = mesh->trianglesCount;
+
+        mesh->triangles.reserve(trianglesCount);
+        for (std::uint32_t i = 0; i < trianglesCount; ++i) {
+            mesh->triangles.emplace_back(objectToWorld,
+                                         worldToObject,
+                                         reverseOrientation,
+                                         *mesh,
+                                         i);
+        }
+
+        // aliasing pointers which own the mesh
         return functional::fmap<std::vector>(
             IntegerRange{0u, trianglesCount},
-            [&](const unsigned i) -> std::shared_ptr<Shape> {
-                return std::make_shared<Triangle>(objectToWorld,
-                                                  worldToObject,
-                                                  reverseOrientation,
-                                                  mesh,
-                                                  i);
+            [&mesh](const unsigned i) -> std::shared_ptr<Shape> {
+                return std::shared_ptr<Shape>(mesh, &mesh->triangles[i]);
             });
     }
 } // namespace idragnev::pbrt::shapes
\ No newline at end of file
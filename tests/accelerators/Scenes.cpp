@@ -0,0 +1,203 @@
+#include "Scenes.hpp"
+
+#include "doctest/doctest.h"
+
+#include "pbrt/core/primitive/GeometricPrimitive.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/shapes/Sphere.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <deque>
+#include <numeric>
+
+pbrt::Point3f randomPoint(pbrt::rng::RNG& rng) {
+    return pbrt::Point3f{rng.uniformFloat(),
+                         rng.uniformFloat(),
+                         rng.uniformFloat()};
+}
+
+PrimsVec makeBoxes(const std::size_t boxesCount,
+                   const std::size_t clusterSize,
+                   const pbrt::Float clusterExtent,
+                   const std::uint64_t seed) {
+    pbrt::rng::RNG rng{seed};
+    pbrt::Point3f clusterCenter;
+
+    PrimsVec result;
+    for (std::size_t i = 0; i < boxesCount; ++i) {
+        if (i % clusterSize == 0) {
+            clusterCenter = 100.f * randomPoint(rng);
+        }
+
+        const pbrt::Point3f center =
+            clusterCenter + clusterExtent * pbrt::Vector3f{randomPoint(rng)};
+        const auto halfExtent =
+            pbrt::Vector3f{0.05f, 0.05f, 0.05f} +
+            0.5f * pbrt::Vector3f{randomPoint(rng)};
+
+        result.push_back(std::make_shared<BoxPrimitive>(
+            pbrt::Bounds3f{center - halfExtent, center + halfExtent}));
+    }
+
+    return result;
+}
+
+std::vector<pbrt::Point3f> makeTriangleVertices(const unsigned trianglesCount,
+                                                const std::uint64_t seed) {
+    pbrt::rng::RNG rng{seed};
+    std::vector<pbrt::Point3f> vertices;
+    for (unsigned i = 0; i < trianglesCount; ++i) {
+        const pbrt::Point3f center = 100.f * randomPoint(rng);
+        for (std::size_t v = 0; v < 3; ++v) {
+            vertices.push_back(center +
+                               (pbrt::Vector3f{randomPoint(rng)} -
+                                pbrt::Vector3f{0.5f, 0.5f, 0.5f}));
+        }
+    }
+
+    return vertices;
+}
+
+std::shared_ptr<pbrt::shapes::TriangleMesh>
+makeTriangleMesh(const std::vector<pbrt::Point3f>& vertices) {
+    static const pbrt::Transformation identity{};
+
+    const auto trianglesCount = static_cast<unsigned>(vertices.size() / 3);
+    std::vector<std::uint32_t> indices(vertices.size());
+    std::iota(indices.begin(), indices.end(), 0u);
+
+    return std::make_shared<pbrt::shapes::TriangleMesh>(
+        identity,
+        trianglesCount,
+        std::move(indices),
+        vertices,
+        std::vector<pbrt::Vector3f>{},
+        std::vector<pbrt::Normal3f>{},
+        std::vector<pbrt::Point2f>{},
+        nullptr,
+        nullptr,
+        std::vector<std::uint32_t>{});
+}
+
+PrimsVec
+makeTriangles(const std::shared_ptr<pbrt::shapes::TriangleMesh>& mesh) {
+    static const pbrt::Transformation identity{};
+
+    PrimsVec result;
+    for (const auto& shape :
+         pbrt::shapes::createTriangles(mesh, identity, identity, false))
+    {
+        result.push_back(std::make_shared<pbrt::GeometricPrimitive>(
+            shape,
+            nullptr,
+            nullptr,
+            pbrt::MediumInterface{}));
+    }
+
+    return result;
+}
+
+PrimsVec makeTriangles(const std::vector<pbrt::Point3f>& vertices) {
+    return makeTriangles(makeTriangleMesh(vertices));
+}
+
+PrimsVec makeTriangles(const unsigned trianglesCount,
+                       const std::uint64_t seed) {
+    return makeTriangles(makeTriangleVertices(trianglesCount, seed));
+}
+
+PrimsVec makeSpheres(const unsigned spheresCount, const std::uint64_t seed) {
+    // shapes refer to their transformations,
+    // so these must outlive all spheres
+    static std::deque<pbrt::Transformation> transformations;
+
+    pbrt::rng::RNG rng{seed};
+    PrimsVec result;
+    for (unsigned i = 0; i < spheresCount; ++i) {
+        const auto& objectToWorld = transformations.emplace_back(
+            pbrt::translation(100.f * pbrt::Vector3f{randomPoint(rng)}));
+        const auto& worldToObject =
+            transformations.emplace_back(inverse(objectToWorld));
+        const pbrt::Float radius = 0.25f + 0.5f * rng.uniformFloat();
+
+        result.push_back(std::make_shared<pbrt::GeometricPrimitive>(
+            std::make_shared<pbrt::shapes::Sphere>(objectToWorld,
+                                                   worldToObject,
+                                                   false,
+                                                   radius,
+                                                   -radius,
+                                                   radius,
+                                                   360.f),
+            nullptr,
+            nullptr,
+            pbrt::MediumInterface{}));
+    }
+
+    return result;
+}
+
+pbrt::Optional<pbrt::SurfaceInteraction> intersectAll(const PrimsVec& prims,
+                                                      const pbrt::Ray& ray) {
+    pbrt::Optional<pbrt::SurfaceInteraction> result = pbrt::nullopt;
+    for (const auto& p : prims) {
+        result = p->intersect(ray).disjunction(std::move(result));
+    }
+    return result;
+}
+
+std::vector<pbrt::Ray> makeRays(const PrimsVec& prims,
+                                const std::size_t raysCount,
+                                const std::uint64_t seed) {
+    pbrt::rng::RNG rng{seed};
+
+    std::vector<pbrt::Ray> result;
+    result.reserve(raysCount);
+    for (std::size_t i = 0; i < raysCount; ++i) {
+        const pbrt::Point3f o =
+            pbrt::Point3f{50.f, 50.f, 50.f} +
+            300.f * normalize(pbrt::Vector3f{randomPoint(rng)} -
+                              pbrt::Vector3f{0.5f, 0.5f, 0.5f});
+        const pbrt::Point3f target =
+            (i % 2 == 0)
+                ? prims[rng.uniformUInt32(static_cast<std::uint32_t>(
+                            prims.size()))]
+                      ->worldBound()
+                      .boundingSphere()
+                      .center
+                : 100.f * randomPoint(rng);
+
+        result.push_back(pbrt::Ray{o, target - o});
+    }
+
+    return result;
+}
+
+void checkMatchesBruteForce(const pbrt::Primitive& accel,
+                            const PrimsVec& prims,
+                            const std::size_t raysCount) {
+    std::size_t mismatches = 0;
+    std::size_t hits = 0;
+    for (const pbrt::Ray& r : makeRays(prims, raysCount, 7)) {
+        const auto ray = pbrt::Ray{r.o, r.d};
+        const auto expectedRay = pbrt::Ray{r.o, r.d};
+
+        const auto actual = accel.intersect(ray);
+        const auto expected = intersectAll(prims, expectedRay);
+        const bool isOccluded = accel.intersectP(pbrt::Ray{r.o, r.d});
+
+        if (actual.has_value() != expected.has_value() ||
+            isOccluded != expected.has_value() ||
+            ray.tMax != expectedRay.tMax ||
+            (actual.has_value() &&
+             (actual->primitive != expected->primitive ||
+              actual->p != expected->p)))
+        {
+            ++mismatches;
+        }
+        hits += expected.has_value() ? 1 : 0;
+    }
+
+    CHECK(hits > 0);
+    CHECK(mismatches == 0);
+}
\ No newline at end of file
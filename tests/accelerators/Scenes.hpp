@@ -0,0 +1,85 @@
+#pragma once
+
+#include "pbrt/core/primitive/Primitive.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/RNG.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace pbrt = idragnev::pbrt;
+
+using PrimsVec = std::vector<std::shared_ptr<const pbrt::Primitive>>;
+
+// An axis-aligned box which is hit at the ray's entry point
+class BoxPrimitive : public pbrt::Aggregate
+{
+public:
+    BoxPrimitive(const pbrt::Bounds3f& bounds) : bounds(bounds) {}
+
+    pbrt::Bounds3f worldBound() const override { return bounds; }
+
+    pbrt::Optional<pbrt::SurfaceInteraction>
+    intersect(const pbrt::Ray& ray) const override {
+        return bounds.intersectP(ray).map([this, &ray](const auto& t) {
+            ray.tMax = t.low();
+
+            pbrt::SurfaceInteraction result;
+            result.p = ray(t.low());
+            result.primitive = this;
+            return result;
+        });
+    }
+
+    bool intersectP(const pbrt::Ray& ray) const override {
+        return bounds.intersectP(ray).has_value();
+    }
+
+private:
+    pbrt::Bounds3f bounds;
+};
+
+pbrt::Point3f randomPoint(pbrt::rng::RNG& rng);
+
+// Places `clusterSize` boxes within `clusterExtent` of
+// each random cluster center in [0, 100]^3
+PrimsVec makeBoxes(const std::size_t boxesCount,
+                   const std::size_t clusterSize,
+                   const pbrt::Float clusterExtent,
+                   const std::uint64_t seed);
+
+// Makes a mesh of small triangles around random points in [0, 100]^3
+// Three vertices for each triangle
+std::vector<pbrt::Point3f> makeTriangleVertices(const unsigned trianglesCount,
+                                                const std::uint64_t seed);
+// A mesh of the triangles with vertices `vertices`
+std::shared_ptr<pbrt::shapes::TriangleMesh>
+makeTriangleMesh(const std::vector<pbrt::Point3f>& vertices);
+// The triangles of `mesh` as primitives, which share its ownership
+PrimsVec
+makeTriangles(const std::shared_ptr<pbrt::shapes::TriangleMesh>& mesh);
+PrimsVec makeTriangles(const std::vector<pbrt::Point3f>& vertices);
+PrimsVec makeTriangles(const unsigned trianglesCount,
+                       const std::uint64_t seed);
+
+// Spheres with radii in [0.25, 0.75] around random points in [0, 100]^3
+PrimsVec makeSpheres(const unsigned spheresCount, const std::uint64_t seed);
+
+// The closest hit found by testing all primitives
+pbrt::Optional<pbrt::SurfaceInteraction> intersectAll(const PrimsVec& prims,
+                                                      const pbrt::Ray& ray);
+
+// Rays from a sphere around the primitives,
+// half of them aimed at primitives
+std::vector<pbrt::Ray> makeRays(const PrimsVec& prims,
+                                const std::size_t raysCount,
+                                const std::uint64_t seed);
+
+// Checks that `accel` finds the same closest hits and occlusions
+// as testing all of `prims`, with `raysCount` rays from makeRays
+void checkMatchesBruteForce(const pbrt::Primitive& accel,
+                            const PrimsVec& prims,
+                            const std::size_t raysCount);
\ No newline at end of file
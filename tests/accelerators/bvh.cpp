@@ -0,0 +1,1094 @@
+#include "doctest/doctest.h"
+
+#include "Scenes.hpp"
+
+#include "pbrt/accelerators/bvh/BVH.hpp"
+#include "pbrt/accelerators/bvh/BVHBuilders.hpp"
+#include "pbrt/accelerators/bvh/DynamicBVH.hpp"
+#include "pbrt/accelerators/bvh/GeometryProxy.hpp"
+#include "pbrt/accelerators/bvh/HLBVHBuilder.hpp"
+#include "pbrt/accelerators/bvh/MotionBVH.hpp"
+#include "pbrt/accelerators/bvh/OutOfCoreBVH.hpp"
+#include "pbrt/accelerators/bvh/TreeletRestructurer.hpp"
+#include "pbrt/accelerators/bvh/TwoLevelBVH.hpp"
+#include "pbrt/core/primitive/GeometricPrimitive.hpp"
+#include "pbrt/core/primitive/TransformedPrimitive.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/RNG.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <memory>
+
+namespace bvh = pbrt::accelerators::bvh;
+
+using pbrt::accelerators::BVH;
+
+// Coherent rays from a point in front of the primitives
+// through the cells of a `resolution` x `resolution` grid
+std::vector<pbrt::Ray> makeCameraRays(const std::size_t resolution) {
+    const pbrt::Point3f eye{50.f, 50.f, -150.f};
+
+    std::vector<pbrt::Ray> result;
+    result.reserve(resolution * resolution);
+    for (std::size_t y = 0; y < resolution; ++y) {
+        for (std::size_t x = 0; x < resolution; ++x) {
+            const pbrt::Point3f target{
+                100.f * (static_cast<float>(x) + 0.5f) /
+                    static_cast<float>(resolution),
+                100.f * (static_cast<float>(y) + 0.5f) /
+                    static_cast<float>(resolution),
+                0.f};
+            result.push_back(pbrt::Ray{eye, target - eye});
+        }
+    }
+
+    return result;
+}
+
+void checkAllBuildsMatchBruteForce(const PrimsVec& prims) {
+    pbrt::parallel::init();
+
+    for (const auto splitMethod : {bvh::SplitMethod::SAH,
+                                   bvh::SplitMethod::HLBVH,
+                                   bvh::SplitMethod::Middle,
+                                   bvh::SplitMethod::EqualCounts,
+                                   bvh::SplitMethod::PLOC})
+    {
+        for (const std::uint32_t maxPrimsInNode : {1u, 4u}) {
+            for (const std::uint32_t restructuringPasses : {0u, 2u}) {
+                // alternate the stacks instead of doubling the builds
+                const auto stack = (restructuringPasses == 0)
+                                       ? bvh::TraversalStack::Full
+                                       : bvh::TraversalStack::Short;
+                const auto accel = BVH{prims,
+                                       splitMethod,
+                                       maxPrimsInNode,
+                                       restructuringPasses,
+                                       stack};
+
+                checkMatchesBruteForce(accel, prims, 500);
+            }
+        }
+    }
+
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("BVH finds the same hits as testing all primitives") {
+    SUBCASE("uniformly distributed primitives") {
+        checkAllBuildsMatchBruteForce(makeBoxes(2'000, 1, 0.f, 1));
+    }
+
+    SUBCASE("densely clustered primitives") {
+        checkAllBuildsMatchBruteForce(makeBoxes(2'000, 500, 1e-3f, 2));
+    }
+
+    SUBCASE("primitives with equal centroids") {
+        checkAllBuildsMatchBruteForce(makeBoxes(1'000, 100, 0.f, 3));
+    }
+
+    SUBCASE("triangles") {
+        checkAllBuildsMatchBruteForce(makeTriangles(2'000, 5));
+    }
+
+    SUBCASE("triangles mixed with other primitives") {
+        PrimsVec prims = makeTriangles(1'000, 6);
+        const PrimsVec boxes = makeBoxes(1'000, 1, 0.f, 7);
+        prims.insert(prims.end(), boxes.begin(), boxes.end());
+
+        checkAllBuildsMatchBruteForce(prims);
+    }
+
+    SUBCASE("triangles mixed with spheres") {
+        PrimsVec prims = makeTriangles(1'000, 8);
+        const PrimsVec spheres = makeSpheres(1'000, 9);
+        prims.insert(prims.end(), spheres.begin(), spheres.end());
+
+        checkAllBuildsMatchBruteForce(prims);
+    }
+}
+
+TEST_CASE("BVH triangle leaves of any size find the same hits") {
+    pbrt::parallel::init();
+
+    const PrimsVec prims = makeTriangles(2'000, 16);
+    // leaves of one partially filled packet and of several packets
+    for (const auto splitMethod : {bvh::SplitMethod::SAH,
+                                   bvh::SplitMethod::EqualCounts})
+    {
+        for (const std::uint32_t maxPrimsInNode : {3u, 8u, 13u}) {
+            const auto accel = BVH{prims, splitMethod, maxPrimsInNode};
+            checkMatchesBruteForce(accel, prims, 500);
+        }
+    }
+
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("reordering the meshes of a BVH keeps its hits") {
+    pbrt::parallel::init();
+
+    const auto mesh = makeTriangleMesh(makeTriangleVertices(2'000, 17));
+    PrimsVec prims = makeTriangles(mesh);
+    const PrimsVec boxes = makeBoxes(500, 1, 0.f, 18);
+    prims.insert(prims.end(), boxes.begin(), boxes.end());
+    BVH accel{prims, bvh::SplitMethod::SAH, 4};
+
+    const std::vector<pbrt::Ray> rays = makeRays(prims, 1'000, 19);
+    const auto intersectAllRays = [&accel, &rays] {
+        std::vector<pbrt::Optional<pbrt::SurfaceInteraction>> hits;
+        for (const pbrt::Ray& r : rays) {
+            hits.push_back(accel.intersect(pbrt::Ray{r.o, r.d}));
+        }
+        return hits;
+    };
+    const auto expected = intersectAllRays();
+    accel.reorderTriangleMeshes(std::span{&mesh, 1});
+    const auto actual = intersectAllRays();
+
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < rays.size(); ++i) {
+        if (actual[i].has_value() != expected[i].has_value() ||
+            (actual[i].has_value() &&
+             (actual[i]->primitive != expected[i]->primitive ||
+              actual[i]->p != expected[i]->p ||
+              actual[i]->uv != expected[i]->uv ||
+              actual[i]->n != expected[i]->n)))
+        {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+    checkMatchesBruteForce(accel, prims, 500);
+
+    // the triangles are numbered in the order of the leaves
+    std::uint32_t expectedNumber = 0;
+    std::size_t outOfOrder = 0;
+    for (const auto& primitive : accel.orderedPrimitives()) {
+        if (const auto* const geometric =
+                dynamic_cast<const pbrt::GeometricPrimitive*>(primitive.get()))
+        {
+            const auto& triangle =
+                static_cast<const pbrt::shapes::Triangle&>(geometric->shape());
+            if (triangle.numberInMesh() != expectedNumber++) {
+                ++outOfOrder;
+            }
+        }
+    }
+    CHECK(outOfOrder == 0);
+    CHECK(expectedNumber == mesh->trianglesCount);
+
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("batched BVH queries find the same hits as single rays") {
+    pbrt::parallel::init();
+
+    PrimsVec prims = makeTriangles(1'000, 10);
+    const PrimsVec boxes = makeBoxes(1'000, 1, 0.f, 11);
+    prims.insert(prims.end(), boxes.begin(), boxes.end());
+
+    for (const auto splitMethod : {bvh::SplitMethod::SAH,
+                                   bvh::SplitMethod::HLBVH})
+    {
+        for (const std::uint32_t maxPrimsInNode : {1u, 4u}) {
+            const auto accel = BVH{prims, splitMethod, maxPrimsInNode};
+
+            const std::vector<pbrt::Ray> rays = makeRays(prims, 2'000, 12);
+            const std::vector<pbrt::Ray> expectedRays = rays;
+
+            std::vector<pbrt::Optional<pbrt::SurfaceInteraction>> hits(
+                rays.size());
+            const auto occluded = std::make_unique<bool[]>(rays.size());
+            accel.intersect(std::span{rays}, std::span{hits});
+            accel.intersectP(std::span{expectedRays},
+                             std::span{occluded.get(), rays.size()});
+
+            std::size_t mismatches = 0;
+            for (std::size_t i = 0; i < rays.size(); ++i) {
+                const auto expected = accel.intersect(expectedRays[i]);
+
+                if (hits[i].has_value() != expected.has_value() ||
+                    occluded[i] != expected.has_value() ||
+                    rays[i].tMax != expectedRays[i].tMax ||
+                    (expected.has_value() &&
+                     hits[i]->primitive != expected->primitive))
+                {
+                    ++mismatches;
+                }
+            }
+            CHECK(mismatches == 0);
+        }
+    }
+
+    pbrt::parallel::cleanup();
+}
+
+void checkPacketsMatchSingleRays(const BVH& accel,
+                                 const std::vector<pbrt::Ray>& rays,
+                                 const bvh::PacketWidth width) {
+    const std::vector<pbrt::Ray> packetRays = rays;
+    const std::vector<pbrt::Ray> expectedRays = rays;
+
+    std::vector<pbrt::Optional<pbrt::SurfaceInteraction>> hits(rays.size());
+    const auto occluded = std::make_unique<bool[]>(rays.size());
+    accel.intersectPackets(std::span{packetRays}, std::span{hits}, width);
+    accel.intersectPPackets(std::span{rays},
+                            std::span{occluded.get(), rays.size()},
+                            width);
+
+    std::size_t mismatches = 0;
+    std::size_t hitsCount = 0;
+    for (std::size_t i = 0; i < rays.size(); ++i) {
+        const auto expected = accel.intersect(expectedRays[i]);
+
+        if (hits[i].has_value() != expected.has_value() ||
+            occluded[i] != expected.has_value() ||
+            packetRays[i].tMax != expectedRays[i].tMax ||
+            (expected.has_value() &&
+             hits[i]->primitive != expected->primitive))
+        {
+            ++mismatches;
+        }
+        hitsCount += expected.has_value() ? 1 : 0;
+    }
+
+    CHECK(hitsCount > 0);
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE("BVH packet queries find the same hits as single rays") {
+    pbrt::parallel::init();
+
+    PrimsVec prims = makeTriangles(1'000, 13);
+    const PrimsVec boxes = makeBoxes(1'000, 1, 0.f, 14);
+    prims.insert(prims.end(), boxes.begin(), boxes.end());
+
+    for (const std::uint32_t maxPrimsInNode : {1u, 4u}) {
+        const auto accel = BVH{prims, bvh::SplitMethod::SAH, maxPrimsInNode};
+
+        for (const auto width : {bvh::PacketWidth::Four,
+                                 bvh::PacketWidth::Eight,
+                                 bvh::PacketWidth::Sixteen})
+        {
+            checkPacketsMatchSingleRays(accel, makeCameraRays(45), width);
+            // mostly fall back to single rays
+            checkPacketsMatchSingleRays(accel,
+                                        makeRays(prims, 1'003, 15),
+                                        width);
+        }
+    }
+
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("BVH traversal handles trees of any depth") {
+    pbrt::parallel::init();
+
+    // Boxes at exponentially growing distances along x. Middle splits
+    // separate only the farthest box at each level, so the tree is
+    // a chain deeper than the traversal stacks.
+    // Only a few of the boxes are on the line of the rays below.
+    PrimsVec boxes;
+    for (int i = 0; i < 100; ++i) {
+        const pbrt::Float x = std::pow(2.2f, static_cast<pbrt::Float>(i));
+        const pbrt::Float y = (i == 0 || i == 40 || i == 99) ? 0.f : 2.f;
+        const pbrt::Float zMax = (i == 40) ? 0.4f : 1.f;
+        boxes.push_back(std::make_shared<BoxPrimitive>(
+            pbrt::Bounds3f{pbrt::Point3f{x, y, 0.f},
+                           pbrt::Point3f{1.5f * x, y + 1.f, zMax}}));
+    }
+
+    // Rays along +x descend the chain, leaving the farther boxes
+    // on the stack, and miss the boxes off their line. Their hit is
+    // in the subtree of an entry which was pushed early, and was
+    // dropped from the stack on the deeper paths.
+    std::vector<pbrt::Ray> rays;
+    for (const int i : {0, 10, 39, 50, 90, 99}) {
+        const pbrt::Float x =
+            1.75f * std::pow(2.2f, static_cast<pbrt::Float>(i));
+        for (const pbrt::Float z : {0.2f, 0.7f}) {
+            rays.push_back(pbrt::Ray{pbrt::Point3f{x, 0.5f, z},
+                                     pbrt::Vector3f{1.f, 0.f, 0.f}});
+            rays.push_back(pbrt::Ray{pbrt::Point3f{x, 0.5f, z},
+                                     pbrt::Vector3f{-1.f, 0.f, 0.f}});
+        }
+    }
+
+    for (const auto stack : {bvh::TraversalStack::Full,
+                             bvh::TraversalStack::Short})
+    {
+        const auto accel = BVH{boxes, bvh::SplitMethod::Middle, 1, 0, stack};
+        CHECK(accel.buildStatistics().maxDepth > 64);
+
+        std::size_t mismatches = 0;
+        for (const pbrt::Ray& r : rays) {
+            const auto ray = pbrt::Ray{r.o, r.d};
+            const auto expectedRay = pbrt::Ray{r.o, r.d};
+
+            const auto actual = accel.intersect(ray);
+            const auto expected = intersectAll(boxes, expectedRay);
+            const bool isOccluded = accel.intersectP(pbrt::Ray{r.o, r.d});
+
+            if (actual.has_value() != expected.has_value() ||
+                isOccluded != expected.has_value() ||
+                ray.tMax != expectedRay.tMax)
+            {
+                ++mismatches;
+            }
+        }
+        CHECK(mismatches == 0);
+
+        checkPacketsMatchSingleRays(accel, rays, bvh::PacketWidth::Four);
+    }
+
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("treelet restructuring lowers the SAH cost of HLBVH trees") {
+    pbrt::parallel::init();
+
+    const PrimsVec prims = makeBoxes(2'000, 1, 0.f, 4);
+    pbrt::memory::MemoryArena arena;
+
+    auto builder = bvh::HLBVHBuilder{1};
+    bvh::BuildResult result = builder(arena, prims);
+    const std::size_t nodesCount = result.tree.nodesCount;
+    const pbrt::Float initialCost = bvh::sahCost(result.tree);
+
+    const auto restructurer = bvh::TreeletRestructurer{1};
+    restructurer(result.tree);
+    const pbrt::Float onePassCost = bvh::sahCost(result.tree);
+
+    const auto moreRestructuring = bvh::TreeletRestructurer{2, 8};
+    moreRestructuring(result.tree);
+    const pbrt::Float threePassesCost = bvh::sahCost(result.tree);
+
+    CHECK(onePassCost < initialCost);
+    CHECK(threePassesCost <= onePassCost);
+    CHECK(result.tree.nodesCount == nodesCount);
+
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("BVH build statistics describe the built tree") {
+    pbrt::parallel::init();
+
+    const PrimsVec prims = makeBoxes(1'000, 1, 0.f, 8);
+
+    for (const auto splitMethod : {bvh::SplitMethod::SAH,
+                                   bvh::SplitMethod::HLBVH})
+    {
+        const auto accel = BVH{prims, splitMethod, 4};
+        const bvh::BuildStatistics& stats = accel.buildStatistics();
+
+        std::size_t leavesByDepth = 0;
+        for (const std::size_t count : stats.leafDepthHistogram) {
+            leavesByDepth += count;
+        }
+
+        std::size_t leavesBySize = 0;
+        std::size_t primsInLeaves = 0;
+        for (std::size_t size = 0; size < stats.leafSizeHistogram.size();
+             ++size) {
+            leavesBySize += stats.leafSizeHistogram[size];
+            primsInLeaves += size * stats.leafSizeHistogram[size];
+        }
+
+        CHECK(stats.nodesCount ==
+              stats.interiorNodesCount + stats.leavesCount);
+        CHECK(stats.leavesCount == stats.interiorNodesCount + 1);
+        CHECK(leavesByDepth == stats.leavesCount);
+        CHECK(leavesBySize == stats.leavesCount);
+        CHECK(primsInLeaves == prims.size());
+        CHECK(stats.leafSizeHistogram.size() <= 5);
+        CHECK(stats.leafDepthHistogram.size() == stats.maxDepth + 1);
+        CHECK(stats.sahCost > 0.f);
+    }
+
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("BVH traversal statistics") {
+    pbrt::parallel::init();
+
+    const PrimsVec prims = makeBoxes(1'000, 1, 0.f, 9);
+    auto accel = BVH{prims, bvh::SplitMethod::SAH, 4};
+    checkMatchesBruteForce(accel, prims, 100);
+
+    const auto closestHit =
+        accel.traversalStatistics(bvh::RayQuery::ClosestHit);
+    const auto anyHit = accel.traversalStatistics(bvh::RayQuery::AnyHit);
+
+    if constexpr (bvh::TRAVERSAL_STATISTICS_ENABLED) {
+        CHECK(closestHit.raysCount == 100);
+        CHECK(anyHit.raysCount == 100);
+        CHECK(closestHit.boxTests >= closestHit.nodesVisited);
+        CHECK(closestHit.nodesVisited > 0);
+        CHECK(closestHit.primitiveTests > 0);
+        CHECK(anyHit.primitiveTests <= closestHit.primitiveTests);
+
+        accel.resetTraversalStatistics();
+        CHECK(accel.traversalStatistics(bvh::RayQuery::AnyHit).raysCount ==
+              0);
+    }
+    else {
+        CHECK(closestHit.raysCount == 0);
+        CHECK(anyHit.boxTests == 0);
+    }
+
+    pbrt::parallel::cleanup();
+}
+
+pbrt::Transformation randomInstanceTransformation(pbrt::rng::RNG& rng) {
+    const pbrt::Float scale = 0.5f + rng.uniformFloat();
+    const pbrt::Vector3f axis =
+        pbrt::Vector3f{randomPoint(rng)} + pbrt::Vector3f{0.1f, 0.1f, 0.1f};
+
+    return pbrt::translation(400.f * pbrt::Vector3f{randomPoint(rng)}) *
+           pbrt::rotation(360.f * rng.uniformFloat(), axis) *
+           pbrt::scaling(scale, scale, scale);
+}
+
+void checkInstancesMatchBruteForce(
+    const pbrt::accelerators::TwoLevelBVH& accel,
+    const std::vector<pbrt::accelerators::BVHInstance>& instances,
+    const std::uint64_t seed) {
+    pbrt::rng::RNG rng{seed};
+
+    std::size_t mismatches = 0;
+    std::size_t hits = 0;
+    for (std::size_t i = 0; i < 1'000; ++i) {
+        const pbrt::Point3f o =
+            pbrt::Point3f{250.f, 250.f, 250.f} +
+            1'000.f * normalize(pbrt::Vector3f{randomPoint(rng)} -
+                                pbrt::Vector3f{0.5f, 0.5f, 0.5f});
+        const auto& aimedAt =
+            instances[rng.uniformUInt32(
+                static_cast<std::uint32_t>(instances.size()))];
+        const pbrt::Point3f target =
+            (i % 2 == 0) ? aimedAt.instanceToWorld(
+                               aimedAt.bvh->worldBound())
+                               .boundingSphere()
+                               .center
+                         : 500.f * randomPoint(rng);
+        const auto ray = pbrt::Ray{o, target - o};
+
+        pbrt::Float expectedTMax = ray.tMax;
+        pbrt::Optional<pbrt::SurfaceInteraction> expected = pbrt::nullopt;
+        for (const auto& instance : instances) {
+            auto instanceRay = inverse(instance.instanceToWorld)(
+                pbrt::Ray{ray.o, ray.d, expectedTMax});
+            if (auto hit = instance.bvh->intersect(instanceRay);
+                hit.has_value()) {
+                expected = std::move(hit);
+                expectedTMax = instanceRay.tMax;
+            }
+        }
+
+        const auto actual = accel.intersect(ray);
+        const bool isOccluded = accel.intersectP(pbrt::Ray{ray.o, ray.d});
+
+        if (actual.has_value() != expected.has_value() ||
+            isOccluded != expected.has_value() ||
+            std::abs(ray.tMax - expectedTMax) > 1e-3f * expectedTMax ||
+            (actual.has_value() && actual->primitive != expected->primitive))
+        {
+            ++mismatches;
+        }
+        hits += expected.has_value() ? 1 : 0;
+    }
+
+    CHECK(hits > 0);
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE("two-level BVH finds the same hits as testing all instances") {
+    pbrt::parallel::init();
+
+    // with and without triangle-only leaves
+    const auto triangles = std::make_shared<const BVH>(
+        makeTriangles(500, 13),
+        bvh::SplitMethod::SAH,
+        4);
+    const auto otherTriangles =
+        std::make_shared<const BVH>(makeTriangles(500, 14),
+                                    bvh::SplitMethod::SAH);
+
+    pbrt::rng::RNG rng{15};
+    std::vector<pbrt::accelerators::BVHInstance> instances;
+    for (std::size_t i = 0; i < 40; ++i) {
+        instances.push_back(pbrt::accelerators::BVHInstance{
+            (i % 2 == 0) ? triangles : otherTriangles,
+            (i == 0) ? pbrt::Transformation{}
+                     : randomInstanceTransformation(rng)});
+    }
+
+    for (const auto splitMethod : {bvh::SplitMethod::SAH,
+                                   bvh::SplitMethod::HLBVH})
+    {
+        auto accel = pbrt::accelerators::TwoLevelBVH{instances, splitMethod};
+        checkInstancesMatchBruteForce(accel, instances, 16);
+
+        // moving the instances refits the top level to them
+        std::vector<pbrt::Transformation> transformations;
+        for (auto& instance : instances) {
+            instance.instanceToWorld = randomInstanceTransformation(rng);
+            transformations.push_back(instance.instanceToWorld);
+        }
+        accel.updateTransformations(transformations);
+        checkInstancesMatchBruteForce(accel, instances, 17);
+    }
+
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("motion BVH finds the same hits as testing all primitives") {
+    pbrt::rng::RNG rng{18};
+
+    // Moving along lines, rotating, moving within a part of
+    // the shutter interval only and not moving at all.
+    // AnimatedTransformation refers to its transformations,
+    // so they are stored first.
+    const PrimsVec triangles = makeTriangles(1'000, 19);
+    std::vector<pbrt::Transformation> transformations;
+    transformations.reserve(2 * triangles.size());
+    for (std::size_t i = 0; i < triangles.size(); ++i) {
+        const pbrt::Vector3f offset =
+            50.f * (pbrt::Vector3f{randomPoint(rng)} -
+                    pbrt::Vector3f{0.5f, 0.5f, 0.5f});
+        const pbrt::Float angle = (i % 4 == 1) ? 90.f * rng.uniformFloat()
+                                               : 0.f;
+
+        transformations.push_back(pbrt::Transformation{});
+        transformations.push_back(pbrt::translation(offset) *
+                                  pbrt::yRotation(angle));
+    }
+
+    PrimsVec prims;
+    for (std::size_t i = 0; i < triangles.size(); ++i) {
+        const pbrt::Float startTime = (i % 4 == 2) ? 0.25f : 0.f;
+        const pbrt::Float endTime = (i % 4 == 2) ? 0.75f : 1.f;
+
+        if (i % 4 == 3) {
+            prims.push_back(triangles[i]);
+        }
+        else {
+            prims.push_back(std::make_shared<pbrt::TransformedPrimitive>(
+                triangles[i],
+                pbrt::AnimatedTransformation{transformations[2 * i],
+                                             startTime,
+                                             transformations[2 * i + 1],
+                                             endTime}));
+        }
+    }
+
+    // including times out of the shutter interval
+    std::vector<pbrt::Ray> rays = makeRays(prims, 2'000, 20);
+    for (pbrt::Ray& ray : rays) {
+        ray.time = -0.1f + 1.2f * rng.uniformFloat();
+    }
+
+    for (const std::uint32_t timeSegmentsCount : {1u, 3u}) {
+        for (const std::uint32_t maxPrimsInNode : {1u, 4u}) {
+            const auto accel =
+                pbrt::accelerators::MotionBVH{prims,
+                                              pbrt::Intervalf{0.f, 1.f},
+                                              maxPrimsInNode,
+                                              timeSegmentsCount};
+            CHECK(accel.timeSegmentsCount() == timeSegmentsCount);
+
+            std::size_t mismatches = 0;
+            std::size_t hits = 0;
+            for (const pbrt::Ray& r : rays) {
+                const auto ray = pbrt::Ray{r.o, r.d, r.tMax, r.time};
+                const auto expectedRay = pbrt::Ray{r.o, r.d, r.tMax, r.time};
+
+                const auto actual = accel.intersect(ray);
+                const auto expected = intersectAll(prims, expectedRay);
+                const bool isOccluded = accel.intersectP(r);
+
+                if (actual.has_value() != expected.has_value() ||
+                    isOccluded != expected.has_value() ||
+                    ray.tMax != expectedRay.tMax)
+                {
+                    ++mismatches;
+                }
+                hits += expected.has_value() ? 1 : 0;
+            }
+
+            CHECK(hits > 0);
+            CHECK(mismatches == 0);
+        }
+    }
+}
+
+TEST_CASE("dynamic BVH finds the same hits as testing all primitives") {
+    PrimsVec prims = makeTriangles(1'000, 21);
+    const PrimsVec boxes = makeBoxes(1'000, 50, 10.f, 22);
+    prims.insert(prims.end(), boxes.begin(), boxes.end());
+
+    pbrt::accelerators::DynamicBVH accel;
+    std::vector<pbrt::accelerators::DynamicBVH::Handle> handles;
+    for (const auto& primitive : prims) {
+        handles.push_back(accel.insert(primitive));
+    }
+    CHECK(accel.size() == prims.size());
+    CHECK(accel.height() < 64);
+    checkMatchesBruteForce(accel, prims, 1'000);
+
+    // the handles of removed primitives are reused by the next insertions
+    PrimsVec remaining;
+    PrimsVec removed;
+    for (std::size_t i = 0; i < prims.size(); ++i) {
+        if (i % 3 == 0) {
+            accel.remove(handles[i]);
+            removed.push_back(prims[i]);
+        }
+        else {
+            remaining.push_back(prims[i]);
+        }
+    }
+    CHECK(accel.size() == remaining.size());
+    checkMatchesBruteForce(accel, remaining, 1'000);
+
+    const PrimsVec inserted = makeBoxes(500, 1, 0.f, 23);
+    for (const auto& primitive : inserted) {
+        accel.insert(primitive);
+    }
+    remaining.insert(remaining.end(), inserted.begin(), inserted.end());
+    checkMatchesBruteForce(accel, remaining, 1'000);
+
+    for (const auto& primitive : removed) {
+        accel.insert(primitive);
+    }
+    remaining.insert(remaining.end(), removed.begin(), removed.end());
+    CHECK(accel.size() == remaining.size());
+    checkMatchesBruteForce(accel, remaining, 1'000);
+}
+
+TEST_CASE("removing all primitives from a dynamic BVH empties it") {
+    const PrimsVec boxes = makeBoxes(100, 1, 0.f, 24);
+
+    pbrt::accelerators::DynamicBVH accel;
+    std::vector<pbrt::accelerators::DynamicBVH::Handle> handles;
+    for (const auto& box : boxes) {
+        handles.push_back(accel.insert(box));
+    }
+    for (const auto handle : handles) {
+        accel.remove(handle);
+    }
+
+    CHECK(accel.size() == 0);
+    CHECK(accel.height() == 0);
+    for (const pbrt::Ray& ray : makeRays(boxes, 100, 25)) {
+        CHECK(accel.intersectP(ray) == false);
+    }
+}
+
+TEST_CASE("out-of-core BVH finds the same hits as testing all triangles") {
+    namespace fs = std::filesystem;
+    using pbrt::accelerators::OutOfCoreBVH;
+
+    // the soup stores the vertices as floats, so they are rounded to
+    // floats for the triangles to match in builds with double Float
+    std::vector<pbrt::Point3f> vertices = makeTriangleVertices(2000, 23);
+    for (pbrt::Point3f& v : vertices) {
+        v = pbrt::Point3f{static_cast<float>(v.x),
+                          static_cast<float>(v.y),
+                          static_cast<float>(v.z)};
+    }
+    const PrimsVec prims = makeTriangles(vertices);
+    const fs::path soup = fs::temp_directory_path() / "pbrt_ooc_test.soup";
+    const fs::path nodeFile = fs::temp_directory_path() / "pbrt_ooc_test.bvh";
+    REQUIRE(pbrt::accelerators::writeTriangleSoup(soup, vertices));
+
+    // small enough to split the triangles out of core
+    // a few times and large enough to build them in memory
+    for (const std::size_t memoryBudget : {std::size_t{20'000},
+                                           std::size_t{1'000'000}})
+    {
+        pbrt::accelerators::OutOfCoreBuildOptions options;
+        options.memoryBudget = memoryBudget;
+        options.maxTrianglesInNode = 4;
+        const auto statistics =
+            pbrt::accelerators::buildOutOfCoreBVH(soup, nodeFile, options);
+        REQUIRE(statistics.has_value());
+        CHECK(statistics->trianglesCount == prims.size());
+        CHECK(statistics->peakMemoryUsage <= memoryBudget);
+        CHECK((statistics->inCoreSubtreesCount > 1) ==
+              (memoryBudget < 1'000'000));
+
+        const auto accel = OutOfCoreBVH::open(nodeFile);
+        REQUIRE(accel.has_value());
+        CHECK(accel->trianglesCount() == prims.size());
+        CHECK(accel->nodesCount() == statistics->nodesCount);
+
+        std::size_t mismatches = 0;
+        std::size_t hits = 0;
+        for (const pbrt::Ray& r : makeRays(prims, 500, 7)) {
+            const auto ray = pbrt::Ray{r.o, r.d};
+            const auto expectedRay = pbrt::Ray{r.o, r.d};
+
+            const auto actual = accel->intersect(ray);
+            const auto expected = intersectAll(prims, expectedRay);
+            const bool isOccluded = accel->intersectP(pbrt::Ray{r.o, r.d});
+
+            // the interactions of the out-of-core BVH name the triangles
+            // by their indices in the triangle soup
+            const auto isSameTriangle = [&prims, &actual, &expected] {
+                return prims[actual->faceIndex].get() == expected->primitive;
+            };
+            if (actual.has_value() != expected.has_value() ||
+                isOccluded != expected.has_value() ||
+                ray.tMax != expectedRay.tMax ||
+                (actual.has_value() && !isSameTriangle()))
+            {
+                ++mismatches;
+            }
+            hits += expected.has_value() ? 1 : 0;
+        }
+
+        CHECK(hits > 0);
+        CHECK(mismatches == 0);
+    }
+
+    fs::remove(soup);
+    fs::remove(nodeFile);
+}
+
+TEST_CASE("out-of-core BVH builds reject too small budgets and bad files") {
+    namespace fs = std::filesystem;
+
+    const fs::path soup = fs::temp_directory_path() / "pbrt_ooc_bad.soup";
+    const fs::path nodeFile = fs::temp_directory_path() / "pbrt_ooc_bad.bvh";
+    REQUIRE(pbrt::accelerators::writeTriangleSoup(
+        soup,
+        makeTriangleVertices(100, 29)));
+
+    pbrt::accelerators::OutOfCoreBuildOptions options;
+    options.memoryBudget = 100;
+
+    CHECK(!pbrt::accelerators::buildOutOfCoreBVH(soup, nodeFile, options)
+               .has_value());
+    CHECK(!fs::exists(nodeFile));
+    // a triangle soup is not a node file
+    CHECK(!pbrt::accelerators::OutOfCoreBVH::open(soup).has_value());
+
+    fs::remove(soup);
+}
+
+TEST_CASE("geometry proxies find the same hits as testing all primitives") {
+    using pbrt::accelerators::GeometryCache;
+    using pbrt::accelerators::GeometryProxy;
+    using pbrt::accelerators::LoadedGeometry;
+
+    pbrt::parallel::init();
+
+    // clusters of boxes and meshes of triangles spread over the scene
+    std::vector<PrimsVec> groups;
+    PrimsVec prims;
+    for (std::uint64_t i = 0; i < 8; ++i) {
+        groups.push_back((i % 2 == 0) ? makeBoxes(200, 200, 10.f, 40 + i)
+                                      : makeTriangles(200, 40 + i));
+        prims.insert(prims.end(), groups.back().begin(), groups.back().end());
+    }
+
+    std::atomic<int> loadsCount = 0;
+    const auto makeProxies = [&groups, &loadsCount](
+                                 const std::shared_ptr<GeometryCache>& cache) {
+        std::vector<std::shared_ptr<const GeometryProxy>> proxies;
+        for (const PrimsVec& group : groups) {
+            pbrt::Bounds3f bounds;
+            for (const auto& primitive : group) {
+                bounds = unionOf(bounds, primitive->worldBound());
+            }
+
+            const auto load = [&group, &loadsCount] {
+                ++loadsCount;
+                return pbrt::make_optional(
+                    LoadedGeometry{group, nullptr, 100 * group.size()});
+            };
+            proxies.push_back(
+                std::make_shared<const GeometryProxy>(bounds,
+                                                      load,
+                                                      cache,
+                                                      bvh::SplitMethod::SAH));
+        }
+
+        return proxies;
+    };
+    const auto asPrimitives = [](const auto& proxies) {
+        return PrimsVec(proxies.begin(), proxies.end());
+    };
+
+    SUBCASE("geometry is loaded once, when it is first hit") {
+        const auto cache = std::make_shared<GeometryCache>(1u << 30);
+        const auto proxies = makeProxies(cache);
+        const auto accel =
+            BVH{asPrimitives(proxies), bvh::SplitMethod::SAH};
+        CHECK(loadsCount == 0);
+        CHECK(cache->loadedProxiesCount() == 0);
+
+        checkMatchesBruteForce(accel, prims, 500);
+
+        const auto statistics = cache->statistics();
+        CHECK(loadsCount == 8);
+        CHECK(statistics.loadsCount == 8);
+        CHECK(statistics.evictionsCount == 0);
+        CHECK(cache->loadedProxiesCount() == 8);
+        CHECK(cache->memoryUsage() > 100 * prims.size());
+        for (const auto& proxy : proxies) {
+            CHECK(proxy->isLoaded());
+        }
+    }
+
+    SUBCASE("the least recently used geometry is evicted") {
+        // room for about half of the geometry
+        std::size_t workingSetMemory = 0;
+        {
+            const auto cache = std::make_shared<GeometryCache>(1u << 30);
+            const auto proxies = makeProxies(cache);
+            checkMatchesBruteForce(BVH{asPrimitives(proxies),
+                                       bvh::SplitMethod::SAH},
+                                   prims,
+                                   500);
+            workingSetMemory = cache->memoryUsage();
+        }
+        const std::size_t memoryBudget = workingSetMemory / 2;
+        loadsCount = 0;
+
+        const auto cache = std::make_shared<GeometryCache>(memoryBudget);
+        const auto proxies = makeProxies(cache);
+        const auto accel =
+            BVH{asPrimitives(proxies), bvh::SplitMethod::SAH};
+        checkMatchesBruteForce(accel, prims, 500);
+
+        const auto statistics = cache->statistics();
+        CHECK(statistics.evictionsCount > 0);
+        CHECK(statistics.loadsCount == static_cast<std::uint64_t>(loadsCount));
+        CHECK(statistics.restoresCount > 0);
+        CHECK(statistics.loadsCount + statistics.restoresCount -
+                  statistics.evictionsCount ==
+              cache->loadedProxiesCount());
+        CHECK(cache->loadedProxiesCount() < 8);
+        CHECK(cache->memoryUsage() <= memoryBudget);
+        // evicted geometry is restored rather than loaded again,
+        // so there is a single copy of each
+        CHECK(loadsCount == 8);
+        CHECK(cache->memoryUsage() + cache->evictedMemoryUsage() ==
+              workingSetMemory);
+
+        // the geometry hit last is kept, here a box of a cluster
+        const GeometryProxy& proxy = *proxies[6];
+        const pbrt::Point3f o{-100.f, -100.f, -100.f};
+        const auto ray = pbrt::Ray{
+            o,
+            groups[6].front()->worldBound().boundingSphere().center - o};
+        CHECK(proxy.intersectP(ray));
+        CHECK(proxy.isLoaded());
+
+        cache->releaseEvictedGeometry();
+        CHECK(cache->evictedMemoryUsage() == 0);
+    }
+
+    SUBCASE("hits mark geometry as used recently") {
+        // room for two of the boxes, whose BVHs take much less memory
+        const PrimsVec boxes = makeBoxes(3, 1, 0.f, 48);
+        const auto cache = std::make_shared<GeometryCache>(2'500);
+        std::vector<std::unique_ptr<GeometryProxy>> proxies;
+        for (const auto& box : boxes) {
+            proxies.push_back(std::make_unique<GeometryProxy>(
+                box->worldBound(),
+                [box] {
+                    return pbrt::make_optional(
+                        LoadedGeometry{PrimsVec{box}, nullptr, 1'000});
+                },
+                cache,
+                bvh::SplitMethod::SAH));
+        }
+        const auto hit = [&boxes, &proxies](const std::size_t i) {
+            const pbrt::Point3f o{-100.f, -100.f, -100.f};
+            const auto ray = pbrt::Ray{
+                o,
+                boxes[i]->worldBound().boundingSphere().center - o};
+            return proxies[i]->intersectP(ray);
+        };
+
+        CHECK(hit(0));
+        CHECK(hit(1));
+        CHECK(hit(0));
+        CHECK(hit(2));
+        CHECK(proxies[0]->isLoaded());
+        CHECK(!proxies[1]->isLoaded());
+        CHECK(proxies[2]->isLoaded());
+        CHECK(cache->statistics().evictionsCount == 1);
+    }
+
+    SUBCASE("evicted geometry is restored until it is released") {
+        // room for one of the boxes
+        const PrimsVec boxes = makeBoxes(2, 1, 0.f, 49);
+        const auto cache = std::make_shared<GeometryCache>(1'500);
+        std::vector<std::unique_ptr<GeometryProxy>> proxies;
+        for (const auto& box : boxes) {
+            proxies.push_back(std::make_unique<GeometryProxy>(
+                box->worldBound(),
+                [box, &loadsCount] {
+                    ++loadsCount;
+                    return pbrt::make_optional(
+                        LoadedGeometry{PrimsVec{box}, nullptr, 1'000});
+                },
+                cache,
+                bvh::SplitMethod::SAH));
+        }
+        const auto hit = [&boxes, &proxies](const std::size_t i) {
+            const pbrt::Point3f o{-100.f, -100.f, -100.f};
+            const auto ray = pbrt::Ray{
+                o,
+                boxes[i]->worldBound().boundingSphere().center - o};
+            return proxies[i]->intersectP(ray);
+        };
+
+        CHECK(hit(0));
+        CHECK(hit(1));
+        const std::size_t liveMemory =
+            cache->memoryUsage() + cache->evictedMemoryUsage();
+        for (int i = 0; i < 10; ++i) {
+            CHECK(hit(0));
+            CHECK(hit(1));
+        }
+        CHECK(loadsCount == 2);
+        CHECK(cache->statistics().restoresCount == 20);
+        CHECK(cache->statistics().evictionsCount == 21);
+        CHECK(cache->loadedProxiesCount() == 1);
+        CHECK(cache->memoryUsage() + cache->evictedMemoryUsage() ==
+              liveMemory);
+
+        cache->releaseEvictedGeometry();
+        CHECK(cache->evictedMemoryUsage() == 0);
+        CHECK(hit(0));
+        CHECK(loadsCount == 3);
+    }
+
+    SUBCASE("a budget smaller than any geometry keeps the last one") {
+        const auto cache = std::make_shared<GeometryCache>(1);
+        const auto proxies = makeProxies(cache);
+        checkMatchesBruteForce(BVH{asPrimitives(proxies),
+                                   bvh::SplitMethod::SAH},
+                               prims,
+                               500);
+
+        CHECK(cache->loadedProxiesCount() == 1);
+        const auto statistics = cache->statistics();
+        CHECK(statistics.evictionsCount ==
+              statistics.loadsCount + statistics.restoresCount - 1);
+    }
+
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("geometry proxies are loaded by one of the queries hitting them") {
+    namespace fs = std::filesystem;
+    using pbrt::accelerators::GeometryCache;
+    using pbrt::accelerators::GeometryProxy;
+    using pbrt::accelerators::LoadedGeometry;
+
+    pbrt::parallel::init();
+
+    const auto cache = std::make_shared<GeometryCache>(1u << 30);
+    const PrimsVec triangles = makeTriangles(1000, 50);
+    const std::vector<pbrt::Ray> rays = makeRays(triangles, 1000, 51);
+    const pbrt::Bounds3f bounds{pbrt::Point3f{-1.f, -1.f, -1.f},
+                                pbrt::Point3f{101.f, 101.f, 101.f}};
+
+    std::atomic<int> loadsCount = 0;
+    const auto proxy = GeometryProxy{
+        bounds,
+        [&triangles, &loadsCount] {
+            ++loadsCount;
+            // long enough for the other queries to wait for it
+            std::this_thread::sleep_for(std::chrono::milliseconds{20});
+            return pbrt::make_optional(LoadedGeometry{triangles, nullptr, 0});
+        },
+        cache,
+        bvh::SplitMethod::SAH};
+    std::atomic<int> mismatches = 0;
+    pbrt::parallel::parallelFor(
+        [&](const std::int64_t i) {
+            const pbrt::Ray& ray = rays[static_cast<std::size_t>(i)];
+            if (proxy.intersectP(ray) !=
+                intersectAll(triangles, ray).has_value())
+            {
+                ++mismatches;
+            }
+        },
+        static_cast<std::int64_t>(rays.size()));
+    CHECK(mismatches == 0);
+    CHECK(loadsCount == 1);
+
+    // not loaded again after failing once
+    int failedLoadsCount = 0;
+    const auto failingProxy =
+        GeometryProxy{bounds,
+                      [&failedLoadsCount] {
+                          ++failedLoadsCount;
+                          return pbrt::Optional<LoadedGeometry>{};
+                      },
+                      cache,
+                      bvh::SplitMethod::SAH};
+    for (const pbrt::Ray& ray : rays) {
+        CHECK(!failingProxy.intersect(ray).has_value());
+    }
+    CHECK(failedLoadsCount == 1);
+    CHECK(cache->statistics().failedLoadsCount == 1);
+
+    // a unit square of two triangles, moved to x, y in [10, 11]
+    const fs::path path = fs::temp_directory_path() / "pbrt_proxy_test.obj";
+    {
+        std::ofstream file(path);
+        file << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n";
+    }
+    const auto meshProxy = GeometryProxy{
+        pbrt::Bounds3f{pbrt::Point3f{10.f, 10.f, 0.f},
+                       pbrt::Point3f{11.f, 11.f, 0.f}},
+        pbrt::accelerators::meshFileLoader(
+            path,
+            pbrt::translation(pbrt::Vector3f{10.f, 10.f, 0.f}),
+            false,
+            nullptr),
+        cache,
+        bvh::SplitMethod::SAH};
+    const auto ray = pbrt::Ray{pbrt::Point3f{10.5f, 10.25f, 2.f},
+                               pbrt::Vector3f{0.f, 0.f, -1.f}};
+    const auto hit = meshProxy.intersect(ray);
+    REQUIRE(hit.has_value());
+    CHECK(ray.tMax == doctest::Approx(2.f));
+    CHECK(hit->p.x == doctest::Approx(10.5f));
+    CHECK(meshProxy.isLoaded());
+    fs::remove(path);
+
+    const auto missingFileProxy = GeometryProxy{
+        bounds,
+        pbrt::accelerators::meshFileLoader(fs::temp_directory_path() /
+                                               "pbrt_proxy_test.missing",
+                                           pbrt::Transformation{},
+                                           false,
+                                           nullptr),
+        cache,
+        bvh::SplitMethod::SAH};
+    CHECK(!missingFileProxy.intersectP(rays.front()));
+    CHECK(cache->statistics().failedLoadsCount == 2);
+
+    pbrt::parallel::cleanup();
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "doctest/doctest.h"
+
+#include "Scenes.hpp"
+
+#include "pbrt/accelerators/grid/Grid.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+using pbrt::accelerators::Grid;
+
+TEST_CASE("grid finds the same hits as testing all primitives") {
+    pbrt::parallel::init();
+
+    SUBCASE("uniformly distributed primitives") {
+        const PrimsVec prims = makeBoxes(2'000, 1, 0.f, 31);
+        checkMatchesBruteForce(Grid{prims}, prims, 500);
+        // coarse cells with many primitives each
+        checkMatchesBruteForce(Grid{prims, 0.01f}, prims, 500);
+    }
+
+    SUBCASE("densely clustered primitives") {
+        const PrimsVec prims = makeBoxes(2'000, 500, 1e-3f, 32);
+        checkMatchesBruteForce(Grid{prims}, prims, 500);
+    }
+
+    SUBCASE("triangles mixed with other primitives") {
+        PrimsVec prims = makeTriangles(1'000, 33);
+        const PrimsVec boxes = makeBoxes(1'000, 1, 0.f, 34);
+        prims.insert(prims.end(), boxes.begin(), boxes.end());
+
+        checkMatchesBruteForce(Grid{prims}, prims, 500);
+    }
+
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("grid resolution follows the density of cells") {
+    pbrt::parallel::init();
+
+    const PrimsVec prims = makeBoxes(1'000, 1, 0.f, 35);
+    const auto cellsCount = [](const Grid& grid) {
+        const auto r = grid.resolution();
+        return static_cast<pbrt::Float>(r[0] * r[1] * r[2]);
+    };
+
+    CHECK(cellsCount(Grid{prims, 1.f}) < cellsCount(Grid{prims, 8.f}));
+    CHECK(cellsCount(Grid{prims, 8.f}) / 1'000.f ==
+          doctest::Approx(8.f).epsilon(0.5));
+
+    const Grid empty{{}};
+    CHECK(!empty.intersect(pbrt::Ray{{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}})
+               .has_value());
+    CHECK(!empty.intersectP(pbrt::Ray{{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}}));
+
+    pbrt::parallel::cleanup();
+}
\ No newline at end of file
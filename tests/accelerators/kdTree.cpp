@@ -0,0 +1,56 @@
+#include "doctest/doctest.h"
+
+#include "Scenes.hpp"
+
+#include "pbrt/accelerators/kdtree/KdTree.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+
+using pbrt::accelerators::KdTree;
+
+TEST_CASE("k-d tree finds the same hits as testing all primitives") {
+    pbrt::parallel::init();
+
+    SUBCASE("uniformly distributed primitives") {
+        const PrimsVec prims = makeBoxes(2'000, 1, 0.f, 41);
+        checkMatchesBruteForce(KdTree{prims}, prims, 500);
+        // shallow trees with large leaves
+        checkMatchesBruteForce(KdTree{prims, 80.f, 1.f, 0.5f, 8, 4},
+                               prims,
+                               500);
+    }
+
+    SUBCASE("densely clustered primitives") {
+        const PrimsVec prims = makeBoxes(2'000, 500, 1e-3f, 42);
+        checkMatchesBruteForce(KdTree{prims}, prims, 500);
+    }
+
+    SUBCASE("subtrees built in parallel") {
+        const PrimsVec prims = makeBoxes(20'000, 20, 0.05f, 43);
+        const KdTree tree{prims};
+
+        CHECK(tree.nodesCount() > 1);
+        checkMatchesBruteForce(tree, prims, 500);
+    }
+
+    SUBCASE("triangles mixed with other primitives") {
+        PrimsVec prims = makeTriangles(1'000, 44);
+        const PrimsVec boxes = makeBoxes(1'000, 1, 0.f, 45);
+        prims.insert(prims.end(), boxes.begin(), boxes.end());
+
+        checkMatchesBruteForce(KdTree{prims}, prims, 500);
+    }
+
+    SUBCASE("spheres") {
+        const PrimsVec prims = makeSpheres(2'000, 46);
+        checkMatchesBruteForce(KdTree{prims}, prims, 500);
+    }
+
+    SUBCASE("no primitives") {
+        const KdTree empty{{}};
+        CHECK(!empty.intersect(pbrt::Ray{{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}})
+                   .has_value());
+        CHECK(!empty.intersectP(pbrt::Ray{{0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}}));
+    }
+
+    pbrt::parallel::cleanup();
+}
\ No newline at end of file
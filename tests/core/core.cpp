@@ -3,6 +3,11 @@
 #include "pbrt/core/math/Vector3.hpp"
 #include "pbrt/core/math/Normal3.hpp"
 #include "pbrt/core/EFloat.hpp"
+#include "pbrt/core/FastEFloat.hpp"
+#include "pbrt/core/RNG.hpp"
+
+#include <cmath>
+#include <limits>
 
 namespace pbrt = idragnev::pbrt;
 
@@ -77,4 +82,88 @@ TEST_CASE("solve quadratic with one root") {
 
     CHECK(t0 == t1);
     CHECK(static_cast<float>(t0) == doctest::Approx(-1.f));
+}
+
+TEST_CASE("FastEFloat error bounds contain the exact results") {
+    pbrt::rng::RNG rng{1};
+    const auto uniform = [&rng](const double min, const double max) {
+        return min + (max - min) * rng.uniformFloat();
+    };
+
+    for (int i = 0; i < 10'000; ++i) {
+        const auto x = static_cast<float>(uniform(-10., 10.));
+        const auto y = static_cast<float>(uniform(-10., 10.));
+        const auto z = static_cast<float>(uniform(-10., 10.));
+        const auto err = static_cast<float>(uniform(0., 1e-3));
+
+        // any values within the errors of the operands
+        const double xExact = x + uniform(-err, err);
+        const double yExact = y + uniform(-err, err);
+        const double zExact = z + uniform(-err, err);
+
+        const auto fx = pbrt::FastEFloat{x, err};
+        const auto fy = pbrt::FastEFloat{y, err};
+        const auto fz = pbrt::FastEFloat{z, err};
+        const auto result = sqrt((fx * fy - fz) / (fz + 20.f) + 10.f);
+        const double exact =
+            std::sqrt((xExact * yExact - zExact) / (zExact + 20.) + 10.);
+
+        REQUIRE(std::abs(exact - static_cast<pbrt::Float>(result)) <=
+                result.absoluteError());
+    }
+}
+
+TEST_CASE("fast quadratic solving") {
+    using pbrt::FastEFloat;
+
+    SUBCASE("no roots") {
+        const auto result = pbrt::solveQuadratic(FastEFloat{1.f},
+                                                 FastEFloat{-1.f},
+                                                 FastEFloat{1.f});
+
+        CHECK(!result.isAmbiguous);
+        CHECK(result.roots == pbrt::nullopt);
+    }
+
+    SUBCASE("two different roots") {
+        const auto result = pbrt::solveQuadratic(FastEFloat{2.f, 1e-6f},
+                                                 FastEFloat{5.f, 1e-6f},
+                                                 FastEFloat{-3.f, 1e-6f});
+
+        REQUIRE(!result.isAmbiguous);
+        REQUIRE(result.roots.has_value());
+
+        const auto [t0, t1] = result.roots.value();
+        CHECK(t0.lowerBound() <= -3.f);
+        CHECK(t0.upperBound() >= -3.f);
+        CHECK(t1.lowerBound() <= 0.5f);
+        CHECK(t1.upperBound() >= 0.5f);
+        CHECK(t1.upperBound() - t1.lowerBound() < 1e-4f);
+    }
+
+    SUBCASE("a double root is ambiguous") {
+        const auto result = pbrt::solveQuadratic(FastEFloat{1.f},
+                                                 FastEFloat{2.f},
+                                                 FastEFloat{1.f});
+
+        CHECK(result.isAmbiguous);
+    }
+
+    SUBCASE("a root whose sign is unknown is ambiguous") {
+        const auto result = pbrt::solveQuadratic(FastEFloat{1.f},
+                                                 FastEFloat{1.f},
+                                                 FastEFloat{0.f, 1e-3f});
+
+        CHECK(result.isAmbiguous);
+    }
+
+    SUBCASE("a NaN discriminant is ambiguous") {
+        const auto nan = std::numeric_limits<pbrt::Float>::quiet_NaN();
+        const auto result = pbrt::solveQuadratic(FastEFloat{1.f},
+                                                 FastEFloat{nan},
+                                                 FastEFloat{1.f});
+
+        CHECK(result.isAmbiguous);
+        CHECK(result.roots == pbrt::nullopt);
+    }
 }
\ No newline at end of file
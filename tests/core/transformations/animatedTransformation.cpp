@@ -0,0 +1,54 @@
+#include "doctest/doctest.h"
+
+#include "pbrt/core/transformations/AnimatedTransformation.hpp"
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/math/Interval.hpp"
+
+namespace pbrt = idragnev::pbrt;
+
+TEST_CASE("linear motion bounds") {
+    const auto bounds = pbrt::Bounds3f{{0.f, 0.f, 0.f}, {1.f, 1.f, 1.f}};
+    const auto start = pbrt::Transformation{};
+
+    SUBCASE("of a translation are the bounds at the interval ends") {
+        const auto end = pbrt::translation({10.f, 0.f, 0.f});
+        const auto motion = pbrt::AnimatedTransformation{start, 0.f, end, 1.f};
+
+        const auto result =
+            motion.linearMotionBounds(bounds, pbrt::Intervalf{0.f, 0.5f});
+
+        CHECK(result.start == bounds);
+        CHECK(result.end ==
+              pbrt::Bounds3f{{5.f, 0.f, 0.f}, {6.f, 1.f, 1.f}});
+    }
+
+    SUBCASE("out of the animation range hold the whole motion") {
+        const auto end = pbrt::translation({10.f, 0.f, 0.f});
+        const auto motion =
+            pbrt::AnimatedTransformation{start, 0.5f, end, 1.f};
+
+        const auto result =
+            motion.linearMotionBounds(bounds, pbrt::Intervalf{0.f, 1.f});
+
+        CHECK(result.start == motion.motionBounds(bounds));
+        CHECK(result.end == motion.motionBounds(bounds));
+    }
+
+    SUBCASE("of a rotation hold the motion within the interval") {
+        const auto end = pbrt::zRotation(90.f);
+        const auto motion = pbrt::AnimatedTransformation{start, 0.f, end, 1.f};
+
+        const auto result =
+            motion.linearMotionBounds(bounds, pbrt::Intervalf{0.f, 0.5f});
+
+        CHECK(result.start == result.end);
+        for (const float time : {0.f, 0.1f, 0.25f, 0.4f, 0.5f}) {
+            const auto moved = motion.interpolate(time)(bounds);
+            CHECK(unionOf(result.start, moved) == result.start);
+        }
+        // but not beyond it
+        const auto atEnd = motion.interpolate(1.f)(bounds);
+        CHECK(unionOf(result.start, atEnd) != result.start);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "doctest/doctest.h"
+#include "pbrt/memory/MappedFile.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace mem = idragnev::pbrt::memory;
+namespace fs = std::filesystem;
+
+fs::path writeTemporaryFile(const std::string& name,
+                            const std::string& contents) {
+    const fs::path path = fs::temp_directory_path() / name;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    return path;
+}
+
+bool hasContents(const mem::MappedFile& file, const std::string& contents) {
+    const auto bytes = file.bytes();
+    return bytes.size() == contents.size() &&
+           std::equal(bytes.begin(),
+                      bytes.end(),
+                      contents.begin(),
+                      [](const std::byte b, const char c) {
+                          return b == static_cast<std::byte>(c);
+                      });
+}
+
+TEST_CASE("mapped file views the contents of the file") {
+    const std::string contents = "mapped file contents";
+    const fs::path path =
+        writeTemporaryFile("pbrt_mapped_file_test.bin", contents);
+
+    {
+        const mem::MappedFile file(path);
+
+        REQUIRE(file.isOpen());
+        CHECK(hasContents(file, contents));
+    }
+
+    fs::remove(path);
+}
+
+TEST_CASE("mapping missing or empty files fails") {
+    const fs::path emptyPath =
+        writeTemporaryFile("pbrt_mapped_file_empty_test.bin", "");
+
+    const mem::MappedFile missing(fs::temp_directory_path() /
+                                  "pbrt_mapped_file_missing.bin");
+    const mem::MappedFile empty(emptyPath);
+
+    CHECK(!missing.isOpen());
+    CHECK(missing.bytes().empty());
+    CHECK(!empty.isOpen());
+
+    fs::remove(emptyPath);
+}
+
+TEST_CASE("moving a mapped file transfers the view") {
+    const std::string contents = "moved";
+    const fs::path path =
+        writeTemporaryFile("pbrt_mapped_file_move_test.bin", contents);
+
+    {
+        mem::MappedFile file(path);
+        mem::MappedFile moved(std::move(file));
+
+        CHECK(!file.isOpen());
+        CHECK(hasContents(moved, contents));
+
+        file = std::move(moved);
+
+        CHECK(!moved.isOpen());
+        CHECK(hasContents(file, contents));
+    }
+
+    fs::remove(path);
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "doctest/doctest.h"
+
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/Shape.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+#include "pbrt/shapes/OBJMesh.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace pbrt = idragnev::pbrt;
+namespace fs = std::filesystem;
+
+namespace {
+    fs::path writeOBJFile(const std::string& fileName,
+                          const std::string& contents) {
+        const fs::path path = fs::temp_directory_path() / fileName;
+        std::ofstream file(path, std::ios::binary);
+        file << contents;
+
+        return path;
+    }
+
+    pbrt::Float totalArea(const std::vector<std::shared_ptr<pbrt::Shape>>& s) {
+        pbrt::Float area = 0.f;
+        for (const auto& shape : s) {
+            area += shape->area();
+        }
+
+        return area;
+    }
+} // namespace
+
+TEST_CASE("OBJ meshes are loaded in world space with their attributes") {
+    pbrt::parallel::init();
+
+    // a unit square in the z = 0 plane, made of two triangles
+    const fs::path path = writeOBJFile("pbrt_obj_test_square.obj",
+                                       "# a square\r\n"
+                                       "mtllib square.mtl\r\n"
+                                       "o square\r\n"
+                                       "v 0 0 0 1\r\n"
+                                       "v 1 0 0\r\n"
+                                       "v 1.0 1.0 0.0\r\n"
+                                       "v 0 +1 0\r\n"
+                                       "\r\n"
+                                       "vt 0 0\r\n"
+                                       "vt 1 0\r\n"
+                                       "vt 1 1\r\n"
+                                       "vt 0 1\r\n"
+                                       "vn 0 0 1\r\n"
+                                       "vn 0 0 1\r\n"
+                                       "vn 0 0 1\r\n"
+                                       "vn 0 0 1\r\n"
+                                       "usemtl white\r\n"
+                                       "s off\r\n"
+                                       "f 1/1/1 2/2/2 3/3/3\r\n"
+                                       "\tf 1/1/1 3/3/3 4/4/4 # upper\r\n");
+
+    const auto objectToWorld =
+        pbrt::translation(pbrt::Vector3f{1.f, 2.f, 3.f});
+    const auto worldToObject = inverse(objectToWorld);
+    const auto triangles =
+        pbrt::shapes::loadOBJMesh(path, objectToWorld, worldToObject, false);
+    REQUIRE(triangles.has_value());
+    REQUIRE(triangles->size() == 2);
+
+    CHECK((*triangles)[0]->worldBound().min == pbrt::Point3f{1.f, 2.f, 3.f});
+    CHECK((*triangles)[1]->worldBound().max == pbrt::Point3f{2.f, 3.f, 3.f});
+
+    const auto ray = pbrt::Ray{pbrt::Point3f{1.25f, 2.75f, 4.f},
+                               pbrt::Vector3f{0.f, 0.f, -1.f}};
+    CHECK(!(*triangles)[0]->intersectP(ray));
+    const auto hit = (*triangles)[1]->intersect(ray);
+    REQUIRE(hit.has_value());
+    CHECK(hit->t == doctest::Approx(1.f));
+    CHECK(hit->interaction.uv.x == doctest::Approx(0.25f));
+    CHECK(hit->interaction.uv.y == doctest::Approx(0.75f));
+    CHECK(hit->interaction.shading.n.z == doctest::Approx(1.f));
+
+    fs::remove(path);
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("OBJ corners with different attribute indices are split into "
+          "vertices") {
+    pbrt::parallel::init();
+
+    // a unit square as one quad whose corners share a texture coordinate
+    // and a normal, with relative indices
+    const fs::path path = writeOBJFile("pbrt_obj_test_quad.obj",
+                                       "v 0 0 0\n"
+                                       "v 1 0 0\n"
+                                       "v 1 1 0\n"
+                                       "v 0 1 0\n"
+                                       "vt 0.5\n"
+                                       "vn 0 0 1\n"
+                                       "f -4/-1/-1 -3/-1/-1 -2/-1/-1 -1/1/1");
+
+    const pbrt::Transformation identity{};
+    const auto triangles =
+        pbrt::shapes::loadOBJMesh(path, identity, identity, false);
+    REQUIRE(triangles.has_value());
+    REQUIRE(triangles->size() == 2);
+    CHECK(totalArea(*triangles) == doctest::Approx(1.f));
+
+    const auto hit = (*triangles)[1]->intersect(
+        pbrt::Ray{pbrt::Point3f{0.25f, 0.75f, 1.f},
+                  pbrt::Vector3f{0.f, 0.f, -1.f}});
+    REQUIRE(hit.has_value());
+    CHECK(hit->interaction.uv.x == doctest::Approx(0.5f));
+    CHECK(hit->interaction.uv.y == doctest::Approx(0.f));
+
+    fs::remove(path);
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("OBJ files of many chunks are merged") {
+    pbrt::parallel::init();
+
+    // a strip of unit squares, each referring to its vertices with
+    // relative indices, which cross the boundaries of the chunks
+    constexpr int squaresCount = 64 * 1024;
+    std::string contents;
+    for (int i = 0; i < squaresCount; ++i) {
+        const std::string x = std::to_string(i);
+        const std::string nextX = std::to_string(i + 1);
+        contents += "v " + x + " 0 0\nv " + nextX + " 0 0\nv " + nextX +
+                    " 1 0\nv " + x + " 1 0\nf -4 -3 -2 -1\n";
+    }
+    contents += "f 1 2 3";
+    const fs::path path = writeOBJFile("pbrt_obj_test_strip.obj", contents);
+
+    const pbrt::Transformation identity{};
+    const auto triangles =
+        pbrt::shapes::loadOBJMesh(path, identity, identity, false);
+    REQUIRE(triangles.has_value());
+    REQUIRE(triangles->size() == 2 * squaresCount + 1);
+    CHECK(totalArea(*triangles) ==
+          doctest::Approx(static_cast<double>(squaresCount) + 0.5));
+    CHECK((*triangles)[2 * squaresCount - 1]->worldBound().max ==
+          pbrt::Point3f{squaresCount, 1.f, 0.f});
+
+    fs::remove(path);
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("malformed OBJ files are rejected") {
+    pbrt::parallel::init();
+
+    const pbrt::Transformation identity{};
+    const auto load = [&identity](const std::string& faces) {
+        const fs::path path = writeOBJFile("pbrt_obj_test_malformed.obj",
+                                           "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                                           "vt 0 0\n" +
+                                               faces);
+        const bool isLoaded =
+            pbrt::shapes::loadOBJMesh(path, identity, identity, false)
+                .has_value();
+        fs::remove(path);
+
+        return isLoaded;
+    };
+
+    REQUIRE(load("f 1 2 3\n"));
+
+    CHECK(!pbrt::shapes::loadOBJMesh(fs::temp_directory_path() /
+                                         "pbrt_obj_test_missing.obj",
+                                     identity,
+                                     identity,
+                                     false)
+               .has_value());
+    CHECK(!load(""));
+    CHECK(!load("f 1 2 4\n"));
+    CHECK(!load("f 0 1 2\n"));
+    CHECK(!load("f 1 2 -4\n"));
+    CHECK(!load("f 1/2 2/1 3/1\n"));
+    CHECK(!load("f 1//1 2//1 3//1\n"));
+    CHECK(!load("f 1 2\n"));
+    CHECK(!load("f 1 2 3x\n"));
+    CHECK(!load("f 1/1/1/1 2 3\n"));
+    CHECK(!load("v 0 zero 0\nf 1 2 3\n"));
+
+    pbrt::parallel::cleanup();
+}
\ No newline at end of file
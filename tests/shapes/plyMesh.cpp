@@ -0,0 +1,254 @@
+#include "doctest/doctest.h"
+
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/Shape.hpp"
+#include "pbrt/parallel/Parallel.hpp"
+#include "pbrt/shapes/PLYMesh.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace pbrt = idragnev::pbrt;
+namespace fs = std::filesystem;
+
+namespace {
+    // Writes a PLY file with the given header and the values appended
+    // with operator<< in the byte order of the header
+    class PLYFileWriter
+    {
+    public:
+        PLYFileWriter(std::string header, const bool isBigEndian)
+            : contents(std::move(header))
+            , swapBytes(isBigEndian !=
+                        (std::endian::native == std::endian::big)) {}
+
+        template <typename T>
+        PLYFileWriter& operator<<(const T value) {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            if (swapBytes) {
+                std::reverse(bytes, bytes + sizeof(T));
+            }
+            contents.append(bytes, sizeof(T));
+
+            return *this;
+        }
+
+        fs::path write(const std::string& fileName) const {
+            const fs::path path = fs::temp_directory_path() / fileName;
+            std::ofstream file(path, std::ios::binary);
+            file.write(contents.data(),
+                       static_cast<std::streamsize>(contents.size()));
+
+            return path;
+        }
+
+    private:
+        std::string contents;
+        bool swapBytes = false;
+    };
+} // namespace
+
+TEST_CASE("PLY meshes are loaded in world space with their attributes") {
+    pbrt::parallel::init();
+
+    // a unit square in the z = 0 plane, made of two triangles
+    auto writer = PLYFileWriter{"ply\n"
+                                "format binary_little_endian 1.0\n"
+                                "comment two triangles\n"
+                                "element vertex 4\n"
+                                "property float x\n"
+                                "property float y\n"
+                                "property float z\n"
+                                "property float nx\n"
+                                "property float ny\n"
+                                "property float nz\n"
+                                "property float u\n"
+                                "property float v\n"
+                                "element face 2\n"
+                                "property list uchar int vertex_indices\n"
+                                "property int face_indices\n"
+                                "end_header\n",
+                                false};
+    for (const auto& [x, y] : {std::pair{0.f, 0.f},
+                               std::pair{1.f, 0.f},
+                               std::pair{1.f, 1.f},
+                               std::pair{0.f, 1.f}})
+    {
+        writer << x << y << 0.f << 0.f << 0.f << 1.f << x << y;
+    }
+    writer << std::uint8_t{3} << 0 << 1 << 2 << 5;
+    writer << std::uint8_t{3} << 0 << 2 << 3 << 6;
+    const fs::path path = writer.write("pbrt_ply_test_square.ply");
+
+    const auto objectToWorld =
+        pbrt::translation(pbrt::Vector3f{1.f, 2.f, 3.f});
+    const auto worldToObject = inverse(objectToWorld);
+    const auto triangles =
+        pbrt::shapes::loadPLYMesh(path, objectToWorld, worldToObject, false);
+    REQUIRE(triangles.has_value());
+    REQUIRE(triangles->size() == 2);
+
+    CHECK((*triangles)[0]->worldBound().min == pbrt::Point3f{1.f, 2.f, 3.f});
+    CHECK((*triangles)[1]->worldBound().max == pbrt::Point3f{2.f, 3.f, 3.f});
+
+    const auto ray = pbrt::Ray{pbrt::Point3f{1.25f, 2.75f, 4.f},
+                               pbrt::Vector3f{0.f, 0.f, -1.f}};
+    CHECK(!(*triangles)[0]->intersectP(ray));
+    const auto hit = (*triangles)[1]->intersect(ray);
+    REQUIRE(hit.has_value());
+    CHECK(hit->t == doctest::Approx(1.f));
+    CHECK(hit->interaction.faceIndex == 6);
+    CHECK(hit->interaction.uv.x == doctest::Approx(0.25f));
+    CHECK(hit->interaction.uv.y == doctest::Approx(0.75f));
+    CHECK(hit->interaction.shading.n.z == doctest::Approx(1.f));
+
+    fs::remove(path);
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("PLY faces of more than three vertices are split into triangles") {
+    pbrt::parallel::init();
+
+    // a unit square and a triangle, after an element which is skipped
+    auto writer = PLYFileWriter{"ply\r\n"
+                                "format binary_big_endian 1.0\r\n"
+                                "element material 1\r\n"
+                                "property list uchar uchar name\r\n"
+                                "element vertex 5\r\n"
+                                "property double x\r\n"
+                                "property double y\r\n"
+                                "property double z\r\n"
+                                "element face 2\r\n"
+                                "property list uchar ushort vertex_index\r\n"
+                                "end_header\r\n",
+                                true};
+    writer << std::uint8_t{2} << 'm' << 'a';
+    for (const auto& [x, y] : {std::pair{0.0, 0.0},
+                               std::pair{1.0, 0.0},
+                               std::pair{1.0, 1.0},
+                               std::pair{0.0, 1.0},
+                               std::pair{0.0, 2.0}})
+    {
+        writer << x << y << 0.0;
+    }
+    writer << std::uint8_t{4} << std::uint16_t{0} << std::uint16_t{1}
+           << std::uint16_t{2} << std::uint16_t{3};
+    writer << std::uint8_t{3} << std::uint16_t{3} << std::uint16_t{2}
+           << std::uint16_t{4};
+    const fs::path path = writer.write("pbrt_ply_test_polygons.ply");
+
+    const pbrt::Transformation identity{};
+    const auto triangles =
+        pbrt::shapes::loadPLYMesh(path, identity, identity, false);
+    REQUIRE(triangles.has_value());
+    REQUIRE(triangles->size() == 3);
+
+    pbrt::Float area = 0.f;
+    for (const auto& triangle : *triangles) {
+        area += triangle->area();
+    }
+    CHECK(area == doctest::Approx(1.5f));
+
+    fs::remove(path);
+    pbrt::parallel::cleanup();
+}
+
+TEST_CASE("malformed PLY files are rejected") {
+    pbrt::parallel::init();
+
+    const pbrt::Transformation identity{};
+    const auto load = [&identity](const PLYFileWriter& writer) {
+        const fs::path path = writer.write("pbrt_ply_test_malformed.ply");
+        const bool isLoaded =
+            pbrt::shapes::loadPLYMesh(path, identity, identity, false)
+                .has_value();
+        fs::remove(path);
+
+        return isLoaded;
+    };
+    const auto header = [](const std::string& format,
+                           const std::string& faceProperty) {
+        return "ply\n"
+               "format " +
+               format +
+               " 1.0\n"
+               "element vertex 3\n"
+               "property float x\n"
+               "property float y\n"
+               "property float z\n"
+               "element face 1\n" +
+               faceProperty + "\nend_header\n";
+    };
+    const auto withTriangle = [](PLYFileWriter writer,
+                                 const int lastIndex) {
+        for (int i = 0; i < 9; ++i) {
+            writer << static_cast<float>(i % 2);
+        }
+        writer << std::uint8_t{3} << 0 << 1 << lastIndex;
+
+        return writer;
+    };
+
+    const std::string indices = "property list uchar int vertex_indices";
+    REQUIRE(load(withTriangle(
+        PLYFileWriter{header("binary_little_endian", indices), false},
+        2)));
+
+    CHECK(!pbrt::shapes::loadPLYMesh(fs::temp_directory_path() /
+                                         "pbrt_ply_test_missing.ply",
+                                     identity,
+                                     identity,
+                                     false)
+               .has_value());
+    // ASCII files
+    CHECK(!load(PLYFileWriter{header("ascii", indices) +
+                                  "0 0 0\n1 0 0\n0 1 0\n3 0 1 2\n",
+                              false}));
+    // out of range vertex indices
+    CHECK(!load(withTriangle(
+        PLYFileWriter{header("binary_little_endian", indices), false},
+        3)));
+    // no vertex indices
+    CHECK(!load(withTriangle(
+        PLYFileWriter{header("binary_little_endian",
+                             "property list uchar int corners"),
+                      false},
+        2)));
+    // truncated data
+    auto truncated =
+        PLYFileWriter{header("binary_little_endian", indices), false};
+    for (int i = 0; i < 9; ++i) {
+        truncated << 0.f;
+    }
+    truncated << std::uint8_t{3} << 0 << 1;
+    CHECK(!load(truncated));
+    // face indices which are not integers, in triangles and in polygons
+    for (const std::uint8_t polygonSize : {3, 4}) {
+        auto floatFaceIndices = PLYFileWriter{
+            header("binary_little_endian",
+                   indices + "\nproperty float face_indices"),
+            false};
+        for (int i = 0; i < 9; ++i) {
+            floatFaceIndices << static_cast<float>(i % 2);
+        }
+        floatFaceIndices << polygonSize;
+        for (int v = 0; v < polygonSize; ++v) {
+            floatFaceIndices << v % 3;
+        }
+        floatFaceIndices << 1.f;
+        CHECK(!load(floatFaceIndices));
+    }
+    // no end of the header
+    CHECK(!load(PLYFileWriter{"ply\nformat binary_little_endian 1.0\n",
+                              false}));
+
+    pbrt::parallel::cleanup();
+}
\ No newline at end of file
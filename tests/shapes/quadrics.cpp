@@ -0,0 +1,211 @@
+#include "doctest/doctest.h"
+
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/RNG.hpp"
+#include "pbrt/shapes/Cone.hpp"
+#include "pbrt/shapes/Cylinder.hpp"
+#include "pbrt/shapes/Disk.hpp"
+#include "pbrt/shapes/Paraboloid.hpp"
+#include "pbrt/shapes/Sphere.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace pbrt = idragnev::pbrt;
+
+namespace {
+    // A shape and a point on it in object space
+    struct QuadricCase
+    {
+        std::shared_ptr<const pbrt::Shape> shape;
+        pbrt::Point3f target;
+    };
+} // namespace
+
+static std::vector<QuadricCase>
+makeQuadrics(const pbrt::Transformation& objectToWorld,
+             const pbrt::Transformation& worldToObject,
+             const pbrt::Float phiMax = 360.f);
+
+TEST_CASE("quadric hits are reported in world space") {
+    const auto objectToWorld =
+        pbrt::translation(pbrt::Vector3f{5.f, 0.f, 0.f});
+    const auto worldToObject = inverse(objectToWorld);
+    const pbrt::shapes::Sphere unitSphere{objectToWorld,
+                                          worldToObject,
+                                          false,
+                                          1.f,
+                                          -1.f,
+                                          1.f,
+                                          360.f};
+    const pbrt::Shape& sphere = unitSphere;
+    const auto ray = pbrt::Ray{pbrt::Point3f{5.f, 0.f, -5.f},
+                               pbrt::Vector3f{0.f, 0.f, 1.f}};
+
+    const auto hit = sphere.intersect(ray);
+    REQUIRE(hit.has_value());
+    CHECK(hit->t == doctest::Approx(4.f));
+    CHECK(hit->interaction.p.x == doctest::Approx(5.f));
+    CHECK(hit->interaction.p.z == doctest::Approx(-1.f));
+    CHECK(hit->interaction.wo.z == doctest::Approx(-1.f));
+    CHECK(sphere.intersectP(ray));
+    CHECK(!sphere.intersectP(pbrt::Ray{pbrt::Point3f{0.f, 0.f, -5.f},
+                                       pbrt::Vector3f{0.f, 0.f, 1.f}}));
+}
+
+TEST_CASE("quadrics which sweep less than a full circle clip their hits") {
+    const pbrt::Transformation identity{};
+    const auto makeSphere = [&identity](const pbrt::Float phiMax) {
+        return pbrt::shapes::Sphere{identity,
+                                    identity,
+                                    false,
+                                    1.f,
+                                    -1.f,
+                                    1.f,
+                                    phiMax};
+    };
+    const auto fullSphere = makeSphere(360.f);
+    const auto halfSphere = makeSphere(180.f);
+    const pbrt::Shape& full = fullSphere;
+    const pbrt::Shape& half = halfSphere;
+
+    // enters the sphere at phi = 270 and leaves it at phi = 90
+    const auto ray = pbrt::Ray{pbrt::Point3f{0.f, -5.f, 0.f},
+                               pbrt::Vector3f{0.f, 1.f, 0.f}};
+    REQUIRE(full.intersect(ray).has_value());
+    REQUIRE(half.intersect(ray).has_value());
+    CHECK(full.intersect(ray)->t == doctest::Approx(4.f));
+    CHECK(half.intersect(ray)->t == doctest::Approx(6.f));
+
+    const auto shortRay = pbrt::Ray{pbrt::Point3f{0.f, -5.f, 0.f},
+                                    pbrt::Vector3f{0.f, 1.f, 0.f},
+                                    5.f};
+    CHECK(full.intersectP(shortRay));
+    CHECK(!half.intersectP(shortRay));
+}
+
+TEST_CASE("two-phase quadric intersection matches intersect") {
+    const auto objectToWorld =
+        pbrt::translation(pbrt::Vector3f{2.f, -3.f, 4.f}) *
+        pbrt::xRotation(30.f);
+    const auto worldToObject = inverse(objectToWorld);
+
+    const pbrt::Vector3f directions[] = {
+        normalize(pbrt::Vector3f{1.f, 0.2f, 0.1f}),
+        normalize(pbrt::Vector3f{-0.3f, 1.f, -0.2f}),
+        normalize(pbrt::Vector3f{0.5f, -0.7f, 0.5f}),
+        normalize(pbrt::Vector3f{-1.f, -0.1f, -0.3f}),
+    };
+
+    for (const QuadricCase& c : makeQuadrics(objectToWorld, worldToObject)) {
+        for (const pbrt::Vector3f& d : directions) {
+            const auto o = c.target - 4.f * d;
+            const auto ray = pbrt::Ray{objectToWorld(o), objectToWorld(d)};
+
+            const auto expected = c.shape->intersect(ray);
+            const auto hit = c.shape->intersectHit(ray);
+            REQUIRE(expected.has_value());
+            REQUIRE(hit.has_value());
+            CHECK(c.shape->intersectP(ray));
+
+            const auto interaction = c.shape->computeInteraction(ray, *hit);
+            CHECK(hit->t == expected->t);
+            CHECK(distance(interaction.p, ray(hit->t)) < 1e-3f);
+            CHECK(interaction.p == expected->interaction.p);
+            CHECK(interaction.n == expected->interaction.n);
+            CHECK(interaction.uv == expected->interaction.uv);
+            CHECK(interaction.pError == expected->interaction.pError);
+        }
+    }
+}
+
+TEST_CASE("quadric any-hit queries agree with closest-hit queries") {
+    const auto objectToWorld =
+        pbrt::translation(pbrt::Vector3f{-1.f, 2.f, 0.5f}) *
+        pbrt::yRotation(45.f);
+    const auto worldToObject = inverse(objectToWorld);
+
+    for (const pbrt::Float phiMax : {360.f, 200.f}) {
+        pbrt::rng::RNG rng{7};
+        const auto randomVector = [&rng] {
+            return pbrt::Vector3f{rng.uniformFloat() - 0.5f,
+                                  rng.uniformFloat() - 0.5f,
+                                  rng.uniformFloat() - 0.5f};
+        };
+
+        for (const QuadricCase& c :
+             makeQuadrics(objectToWorld, worldToObject, phiMax)) {
+            std::size_t hits = 0;
+            std::size_t mismatches = 0;
+            for (int i = 0; i < 2'000; ++i) {
+                const auto o = pbrt::Point3f{0.f, 0.f, 0.f} +
+                               4.f * normalize(randomVector());
+                const auto target = c.target + 2.f * randomVector();
+                const auto ray = objectToWorld(pbrt::Ray{o, target - o});
+
+                const bool isHit = c.shape->intersect(ray).has_value();
+                hits += isHit ? 1 : 0;
+                mismatches += (isHit != c.shape->intersectP(ray)) ? 1 : 0;
+            }
+
+            CHECK(hits > 0);
+            CHECK(mismatches == 0);
+        }
+    }
+}
+
+static std::vector<QuadricCase>
+makeQuadrics(const pbrt::Transformation& objectToWorld,
+             const pbrt::Transformation& worldToObject,
+             const pbrt::Float phiMax) {
+    using namespace pbrt::shapes;
+
+    return {
+        QuadricCase{
+            std::make_shared<Sphere>(objectToWorld,
+                                     worldToObject,
+                                     false,
+                                     1.f,
+                                     -1.f,
+                                     1.f,
+                                     phiMax),
+            pbrt::Point3f{0.1f, 0.1f, 0.3f}},
+        QuadricCase{
+            std::make_shared<Cylinder>(objectToWorld,
+                                       worldToObject,
+                                       false,
+                                       1.f,
+                                       -1.f,
+                                       1.f,
+                                       phiMax),
+            pbrt::Point3f{0.1f, 0.1f, 0.3f}},
+        QuadricCase{
+            std::make_shared<Disk>(objectToWorld,
+                                   worldToObject,
+                                   false,
+                                   0.f,
+                                   1.f,
+                                   0.f,
+                                   phiMax),
+            pbrt::Point3f{0.2f, 0.1f, 0.f}},
+        QuadricCase{
+            std::make_shared<Cone>(objectToWorld,
+                                   worldToObject,
+                                   false,
+                                   1.f,
+                                   1.f,
+                                   phiMax),
+            pbrt::Point3f{0.1f, 0.1f, 0.3f}},
+        QuadricCase{
+            std::make_shared<Paraboloid>(objectToWorld,
+                                         worldToObject,
+                                         false,
+                                         1.f,
+                                         0.f,
+                                         1.f,
+                                         phiMax),
+            pbrt::Point3f{0.1f, 0.1f, 0.5f}},
+    };
+}
\ No newline at end of file
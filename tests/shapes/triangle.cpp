@@ -0,0 +1,401 @@
+#include "doctest/doctest.h"
+
+#include "pbrt/core/transformations/Transformation.hpp"
+#include "pbrt/core/geometry/Bounds3.hpp"
+#include "pbrt/core/geometry/Ray.hpp"
+#include "pbrt/core/SurfaceInteraction.hpp"
+#include "pbrt/core/RNG.hpp"
+#include "pbrt/shapes/Triangle.hpp"
+#include "pbrt/shapes/TrianglePacket.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace pbrt = idragnev::pbrt;
+
+using ShapesVec = std::vector<std::shared_ptr<pbrt::Shape>>;
+
+// A row of `trianglesCount` unit right triangles in the z = 0 plane,
+// the i-th of which has its right angle at (2i, 0, 0)
+static ShapesVec makeTriangleRow(const unsigned trianglesCount,
+                                 std::vector<std::uint32_t> faceIndices);
+
+template <std::size_t Width>
+static void checkPacketsMatchSingleTriangles(const std::uint64_t seed);
+
+// A grid of `n` x `n` vertices in [0, 1]^2 with random unit normals,
+// tangent vectors and texture coordinates in [-3, 5]^2
+static std::shared_ptr<pbrt::shapes::TriangleMesh>
+makeRandomGridMesh(const unsigned n, const std::uint64_t seed);
+
+TEST_CASE("triangle meshes store indices in as few bits as they need") {
+    using pbrt::shapes::TriangleVertexIndices;
+
+    const TriangleVertexIndices small{{0, 1, 2, 2, 1, 3}, 4};
+    CHECK(small.bytesPerIndex() == 2);
+    CHECK(small.size() == 6);
+    CHECK(small.ofTriangle(1) == std::array<std::uint32_t, 3>{2, 1, 3});
+
+    const TriangleVertexIndices largest16Bit{{0, 1, 65'535}, 65'536};
+    CHECK(largest16Bit.bytesPerIndex() == 2);
+    CHECK(largest16Bit.ofTriangle(0)[2] == 65'535);
+
+    const TriangleVertexIndices large{{0, 65'536, 70'000}, 70'001};
+    CHECK(large.bytesPerIndex() == 4);
+    CHECK(large.ofTriangle(0) ==
+          std::array<std::uint32_t, 3>{0, 65'536, 70'000});
+}
+
+TEST_CASE("triangles share the ownership of their mesh") {
+    ShapesVec triangles = makeTriangleRow(100, {});
+    CHECK(triangles.front().use_count() == 100);
+
+    const std::shared_ptr<pbrt::Shape> last = triangles.back();
+    triangles.clear();
+
+    CHECK(last.use_count() == 1);
+    CHECK(last->area() == doctest::Approx(0.5f));
+    CHECK(last->worldBound().min == pbrt::Point3f{198.f, 0.f, 0.f});
+}
+
+TEST_CASE("triangles of large meshes are intersected through 32-bit indices") {
+    // more than 2^16 vertices
+    const ShapesVec triangles = makeTriangleRow(30'000, {});
+
+    for (const unsigned i : {0u, 21'845u, 29'999u}) {
+        const auto x = 2.f * static_cast<pbrt::Float>(i);
+        const auto ray = pbrt::Ray{pbrt::Point3f{x + 0.25f, 0.25f, 1.f},
+                                   pbrt::Vector3f{0.f, 0.f, -1.f}};
+
+        const auto hit = triangles[i]->intersect(ray);
+        REQUIRE(hit.has_value());
+        CHECK(hit->t == doctest::Approx(1.f));
+        CHECK(triangles[i]->intersectP(ray));
+        CHECK(!triangles[(i + 1) % triangles.size()]->intersectP(ray));
+    }
+}
+
+TEST_CASE("triangle hits report the face index of the triangle") {
+    const ShapesVec triangles = makeTriangleRow(3, {7, 8, 9});
+    const auto ray = pbrt::Ray{pbrt::Point3f{4.25f, 0.25f, 1.f},
+                               pbrt::Vector3f{0.f, 0.f, -1.f}};
+
+    const auto hit = triangles[2]->intersect(ray);
+    REQUIRE(hit.has_value());
+    CHECK(hit->interaction.faceIndex == 9);
+}
+
+TEST_CASE("triangle packets find the same hits as testing each triangle") {
+    checkPacketsMatchSingleTriangles<4>(1);
+    checkPacketsMatchSingleTriangles<8>(2);
+}
+
+TEST_CASE("triangle packets are watertight") {
+    // four triangles around the origin, sharing its vertex
+    // and an edge with each of their neighbours
+    const pbrt::Point3f center{0.f, 0.f, 0.f};
+    const pbrt::Point3f corners[4] = {pbrt::Point3f{1.f, 0.f, 0.f},
+                                      pbrt::Point3f{0.f, 1.f, 0.f},
+                                      pbrt::Point3f{-1.f, 0.f, 0.f},
+                                      pbrt::Point3f{0.f, -1.f, 0.f}};
+    pbrt::shapes::TrianglePacket<4> packet;
+    for (std::size_t i = 0; i < 4; ++i) {
+        packet.set(i, center, corners[i], corners[(i + 1) % 4]);
+    }
+    packet.count = 4;
+
+    // through the shared vertex and the midpoints of the shared edges
+    for (const pbrt::Point3f& target : {center,
+                                        pbrt::Point3f{0.5f, 0.f, 0.f},
+                                        pbrt::Point3f{0.f, 0.5f, 0.f},
+                                        pbrt::Point3f{-0.5f, 0.f, 0.f},
+                                        pbrt::Point3f{0.f, -0.5f, 0.f}})
+    {
+        const auto ray = pbrt::Ray{target + pbrt::Vector3f{0.f, 0.f, 1.f},
+                                   pbrt::Vector3f{0.f, 0.f, -1.f}};
+
+        const auto hit = pbrt::shapes::intersectTriangles(ray, packet);
+        REQUIRE(hit.has_value());
+        CHECK(hit->hit.t == doctest::Approx(1.f));
+        CHECK(pbrt::shapes::intersectsAnyTriangle(ray, packet));
+    }
+}
+
+TEST_CASE("quantized vertex attributes are close to the exact ones") {
+    const auto exact = makeRandomGridMesh(8, 3);
+    const auto quantized = makeRandomGridMesh(8, 3);
+    quantized->quantizeVertexAttributes();
+
+    CHECK(quantized->vertexNormalVectors.empty());
+    CHECK(quantized->vertexTangentVectors.empty());
+    CHECK(quantized->vertexUVs.empty());
+    CHECK(quantized->hasNormals());
+    CHECK(quantized->hasTangentVectors());
+    CHECK(quantized->hasUVs());
+
+    // 8 / 131070 for the texture coordinates in [-3, 5]
+    const pbrt::Float maxUVError = 8.f / 131'070.f + 1e-6f;
+    // the sines of the angles, as their cosines round to 1
+    const pbrt::Float maxSin = 1e-4f;
+    std::size_t mismatches = 0;
+    for (std::uint32_t v = 0; v < exact->verticesCount; ++v) {
+        const pbrt::Vector3f n{normalize(exact->vertexNormal(v))};
+        const pbrt::Vector3f t = normalize(exact->vertexTangentVector(v));
+        const pbrt::Point2f uv = exact->vertexUV(v);
+        const pbrt::Point2f quantizedUV = quantized->vertexUV(v);
+        if (cross(n, pbrt::Vector3f{quantized->vertexNormal(v)}).length() >
+                maxSin ||
+            cross(t, quantized->vertexTangentVector(v)).length() > maxSin ||
+            std::abs(uv.x - quantizedUV.x) > maxUVError ||
+            std::abs(uv.y - quantizedUV.y) > maxUVError)
+        {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE("triangles of quantized meshes are intersected at the same points") {
+    static const pbrt::Transformation identity{};
+
+    const auto exact = makeRandomGridMesh(16, 4);
+    const auto quantized = makeRandomGridMesh(16, 4);
+    quantized->quantizeVertexAttributes();
+    const ShapesVec exactTriangles =
+        pbrt::shapes::createTriangles(exact, identity, identity, false);
+    const ShapesVec quantizedTriangles =
+        pbrt::shapes::createTriangles(quantized, identity, identity, false);
+
+    pbrt::rng::RNG rng{5};
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < exactTriangles.size(); ++i) {
+        const pbrt::Point3f target{rng.uniformFloat(),
+                                   rng.uniformFloat(),
+                                   0.f};
+        const auto ray = pbrt::Ray{target + pbrt::Vector3f{0.f, 0.f, 1.f},
+                                   pbrt::Vector3f{0.f, 0.f, -1.f}};
+
+        for (std::size_t j = 0; j < exactTriangles.size(); ++j) {
+            const auto expected = exactTriangles[j]->intersect(ray);
+            const auto actual = quantizedTriangles[j]->intersect(ray);
+            if (expected.has_value() != actual.has_value()) {
+                ++mismatches;
+            }
+            else if (expected.has_value() &&
+                     (expected->t != actual->t ||
+                      expected->interaction.p != actual->interaction.p ||
+                      dot(expected->interaction.shading.n,
+                          actual->interaction.shading.n) < 0.99999f ||
+                      std::abs(expected->interaction.uv.x -
+                               actual->interaction.uv.x) > 1e-3f))
+            {
+                ++mismatches;
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE("reordered meshes renumber triangles and vertices in place") {
+    static const pbrt::Transformation identity{};
+
+    const auto mesh = makeRandomGridMesh(4, 6);
+    const ShapesVec triangles =
+        pbrt::shapes::createTriangles(mesh, identity, identity, false);
+
+    using Hits = std::vector<pbrt::Optional<pbrt::SurfaceInteraction>>;
+    const auto hitsOf = [&triangles] {
+        Hits hits;
+        for (const auto& shape : triangles) {
+            const auto& triangle =
+                static_cast<const pbrt::shapes::Triangle&>(*shape);
+            const auto [p0, p1, p2] = triangle.worldVertices();
+            const pbrt::Point3f centroid = (p0 + p1 + p2) / 3.f;
+            const auto hit = triangle.intersect(
+                pbrt::Ray{centroid + pbrt::Vector3f{0.f, 0.f, 1.f},
+                          pbrt::Vector3f{0.f, 0.f, -1.f}});
+            hits.push_back(
+                hit.map([](const auto& h) { return h.interaction; }));
+        }
+        return hits;
+    };
+    const Hits expected = hitsOf();
+
+    const std::vector<std::uint32_t> order = {5, 0, 5, 12};
+    mesh->reorder(order);
+
+    const auto numberOf = [&triangles](const std::size_t i) {
+        return static_cast<const pbrt::shapes::Triangle&>(*triangles[i])
+            .numberInMesh();
+    };
+    CHECK(numberOf(5) == 0);
+    CHECK(numberOf(0) == 1);
+    CHECK(numberOf(12) == 2);
+    CHECK(numberOf(1) == 3);
+    CHECK(mesh->vertexIndices.ofTriangle(0) ==
+          std::array<std::uint32_t, 3>{0, 1, 2});
+
+    const Hits actual = hitsOf();
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < triangles.size(); ++i) {
+        if (!actual[i].has_value() || !expected[i].has_value() ||
+            actual[i]->p != expected[i]->p ||
+            actual[i]->uv != expected[i]->uv ||
+            actual[i]->shading.n != expected[i]->shading.n ||
+            actual[i]->shading.dpdu != expected[i]->shading.dpdu)
+        {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+template <std::size_t Width>
+static void checkPacketsMatchSingleTriangles(const std::uint64_t seed) {
+    pbrt::rng::RNG rng{seed};
+    const auto randomPoint = [&rng] {
+        return pbrt::Point3f{rng.uniformFloat(),
+                             rng.uniformFloat(),
+                             rng.uniformFloat()};
+    };
+
+    std::size_t mismatches = 0;
+    std::size_t hits = 0;
+    for (std::size_t i = 0; i < 1'000; ++i) {
+        pbrt::shapes::TrianglePacket<Width> packet;
+        packet.count = 1 + rng.uniformUInt32(Width);
+        for (std::size_t lane = 0; lane < packet.count; ++lane) {
+            packet.set(lane, randomPoint(), randomPoint(), randomPoint());
+        }
+
+        // aimed at the centroid of one of the triangles
+        const auto [p0, p1, p2] =
+            packet.vertices(rng.uniformUInt32(packet.count));
+        const pbrt::Point3f target = (p0 + p1 + p2) / 3.f;
+        const pbrt::Point3f origin =
+            randomPoint() + pbrt::Vector3f{-0.5f, -0.5f, -2.f};
+        const auto tMax = (i % 3 == 0) ? 0.9f : pbrt::constants::Infinity;
+        const auto ray = pbrt::Ray{origin, target - origin, tMax};
+
+        const pbrt::Ray expectedRay = ray;
+        pbrt::Optional<pbrt::shapes::TrianglePacketHit> expected;
+        for (std::uint32_t lane = 0; lane < packet.count; ++lane) {
+            const auto [q0, q1, q2] = packet.vertices(lane);
+            const auto hit =
+                pbrt::shapes::intersectTriangle(expectedRay, q0, q1, q2);
+            if (hit.has_value()) {
+                expectedRay.tMax = hit->t;
+                expected = pbrt::shapes::TrianglePacketHit{lane, *hit};
+            }
+        }
+
+        const auto actual = pbrt::shapes::intersectTriangles(ray, packet);
+        if (actual.has_value() != expected.has_value() ||
+            pbrt::shapes::intersectsAnyTriangle(ray, packet) !=
+                expected.has_value() ||
+            (actual.has_value() &&
+             (actual->lane != expected->lane ||
+              actual->hit.t != doctest::Approx(expected->hit.t) ||
+              actual->hit.barycentric[1] !=
+                  doctest::Approx(expected->hit.barycentric[1]))))
+        {
+            ++mismatches;
+        }
+        hits += expected.has_value() ? 1 : 0;
+    }
+
+    CHECK(hits > 0);
+    CHECK(mismatches == 0);
+}
+
+static ShapesVec makeTriangleRow(const unsigned trianglesCount,
+                                 std::vector<std::uint32_t> faceIndices) {
+    static const pbrt::Transformation identity{};
+
+    std::vector<pbrt::Point3f> vertices;
+    std::vector<std::uint32_t> indices;
+    for (unsigned i = 0; i < trianglesCount; ++i) {
+        const auto x = 2.f * static_cast<pbrt::Float>(i);
+        vertices.push_back(pbrt::Point3f{x, 0.f, 0.f});
+        vertices.push_back(pbrt::Point3f{x + 1.f, 0.f, 0.f});
+        vertices.push_back(pbrt::Point3f{x, 1.f, 0.f});
+
+        for (std::uint32_t v = 0; v < 3; ++v) {
+            indices.push_back(3 * i + v);
+        }
+    }
+
+    return pbrt::shapes::createTriangleMesh(identity,
+                                            identity,
+                                            false,
+                                            trianglesCount,
+                                            std::move(indices),
+                                            vertices,
+                                            {},
+                                            {},
+                                            {},
+                                            nullptr,
+                                            nullptr,
+                                            std::move(faceIndices));
+}
+
+static std::shared_ptr<pbrt::shapes::TriangleMesh>
+makeRandomGridMesh(const unsigned n, const std::uint64_t seed) {
+    static const pbrt::Transformation identity{};
+
+    pbrt::rng::RNG rng{seed};
+    const auto randomVector = [&rng] {
+        return pbrt::Vector3f{2.f * rng.uniformFloat() - 1.f,
+                              2.f * rng.uniformFloat() - 1.f,
+                              2.f * rng.uniformFloat() - 1.f};
+    };
+
+    std::vector<pbrt::Point3f> vertices;
+    std::vector<pbrt::Normal3f> normals;
+    std::vector<pbrt::Vector3f> tangents;
+    std::vector<pbrt::Point2f> uvs;
+    for (unsigned y = 0; y < n; ++y) {
+        for (unsigned x = 0; x < n; ++x) {
+            vertices.push_back(
+                pbrt::Point3f{static_cast<pbrt::Float>(x) / (n - 1),
+                              static_cast<pbrt::Float>(y) / (n - 1),
+                              0.f});
+            // unit and facing up, so that interpolating them
+            // does not cancel them out
+            const pbrt::Vector3f v = randomVector();
+            normals.push_back(normalize(
+                pbrt::Normal3f{v.x, v.y, std::abs(v.z) + 0.5f}));
+            tangents.push_back(randomVector());
+            uvs.push_back(pbrt::Point2f{8.f * rng.uniformFloat() - 3.f,
+                                        8.f * rng.uniformFloat() - 3.f});
+        }
+    }
+    // the bounds of the texture coordinates are [-3, 5]^2
+    uvs[0] = pbrt::Point2f{-3.f, -3.f};
+    uvs[1] = pbrt::Point2f{5.f, 5.f};
+
+    std::vector<std::uint32_t> indices;
+    for (unsigned y = 0; y + 1 < n; ++y) {
+        for (unsigned x = 0; x + 1 < n; ++x) {
+            const std::uint32_t v = y * n + x;
+            for (const std::uint32_t i : {v, v + 1, v + n + 1, v, v + n + 1,
+                                          v + n})
+            {
+                indices.push_back(i);
+            }
+        }
+    }
+
+    const auto trianglesCount = static_cast<unsigned>(indices.size() / 3);
+    return std::make_shared<pbrt::shapes::TriangleMesh>(
+        identity,
+        trianglesCount,
+        std::move(indices),
+        vertices,
+        tangents,
+        normals,
+        uvs,
+        nullptr,
+        nullptr,
+        std::vector<std::uint32_t>{});
+}
\ No newline at end of file